@@ -0,0 +1,280 @@
+#include "actuator.h"
+
+// ========================================== ACTUATOR CHANNEL ========================================
+
+ActuatorChannel::ActuatorChannel(int rangeMin, int rangeMax)
+    : m_rangeMin(rangeMin),
+      m_rangeMax(rangeMax),
+      m_demandedValue(0),
+      m_issuedValue(0),
+      m_isIssued(false),
+      m_isPending(false),
+      m_isForced(false),
+      m_lastIssueTimeMSec(0)
+{
+    m_limits = {0, 0, 0};
+    m_counters = {0, 0, 0};
+}
+
+void ActuatorChannel::setLimits(const ActuatorLimits &limits)
+{
+    m_limits = limits;
+}
+
+void ActuatorChannel::setRange(int rangeMin, int rangeMax)
+{
+    m_rangeMin = min(rangeMin, rangeMax);
+    m_rangeMax = max(rangeMin, rangeMax);
+}
+
+void ActuatorChannel::request(int value)
+{
+    value = constrain(value, m_rangeMin, m_rangeMax);
+    m_counters.requested++;
+
+    // A forced demand is not overridden until it has reached the driver
+    if (m_isPending && m_isForced)
+    {
+        m_counters.suppressed++;
+        return;
+    }
+
+    if (m_isIssued)
+    {
+        // The driver already holds this value, drop the demand and anything still pending
+        bool isEndOfRange = (value == m_rangeMin || value == m_rangeMax);
+        if (value == m_issuedValue ||
+            (!isEndOfRange && abs(value - m_issuedValue) < m_limits.deadband))
+        {
+            m_counters.suppressed++;
+            if (m_isPending)
+            {
+                m_counters.suppressed++; // The pending demand is cancelled as well
+                m_isPending = false;
+            }
+            return;
+        }
+    }
+
+    if (m_isPending)
+    {
+        // Either a repeat of the pending demand or a newer one superseding it
+        m_counters.suppressed++;
+    }
+
+    m_demandedValue = value;
+    m_isPending = true;
+}
+
+bool ActuatorChannel::poll(ulong currentTimeMSec, int &command)
+{
+    if (!m_isPending)
+        return false;
+
+    if (!m_isIssued || m_isForced)
+    {
+        command = m_demandedValue;
+        return true;
+    }
+
+    ulong elapsedMSec = currentTimeMSec - m_lastIssueTimeMSec;
+    if (elapsedMSec < m_limits.minDwellMSec)
+        return false;
+
+    command = m_demandedValue;
+    if (m_limits.maxRatePerSec > 0)
+    {
+        // Move towards the demand by what the rate allows for the time since the last command
+        long maxStep = max(1L, static_cast<long>(m_limits.maxRatePerSec * min(elapsedMSec, 60000UL) / 1000));
+        long step = constrain(static_cast<long>(m_demandedValue - m_issuedValue), -maxStep, maxStep);
+        command = m_issuedValue + static_cast<int>(step);
+    }
+    return true;
+}
+
+void ActuatorChannel::commit(int command, ulong currentTimeMSec)
+{
+    m_issuedValue = command;
+    m_isIssued = true;
+    m_lastIssueTimeMSec = currentTimeMSec;
+    m_counters.issued++;
+
+    if (command == m_demandedValue)
+    {
+        m_isPending = false;
+        m_isForced = false;
+    }
+}
+
+void ActuatorChannel::force(int value)
+{
+    // Safety commands (controller stop) are never delayed or filtered
+    m_demandedValue = constrain(value, m_rangeMin, m_rangeMax);
+    m_counters.requested++;
+    m_isPending = true;
+    m_isForced = true;
+}
+
+void ActuatorChannel::reissue()
+{
+    // The driver was commanded past this channel, send the latest demand again without delay
+    if (!m_isIssued && !m_isPending)
+        return;
+
+    if (!m_isPending)
+        m_demandedValue = m_issuedValue;
+    m_isPending = true;
+    m_isForced = true;
+}
+
+int ActuatorChannel::getIssuedValue() const
+{
+    return m_issuedValue;
+}
+
+const ActuatorCounters &ActuatorChannel::getCounters() const
+{
+    return m_counters;
+}
+
+// ========================================== ACTUATORS ===============================================
+
+Actuators::Actuators(Blower &blower, Door &door, Configuration &config)
+    : m_blower(blower),
+      m_door(door),
+      m_config(config),
+      m_blowerChannel(0, BLOWER_MAX_PWM),
+      m_doorChannel(0, DOOR_SERVO_MAX_ANGLE_TENTHS)
+{
+    m_blowerAirflow = 0;
+}
+
+void Actuators::updateLimits()
+{
+    // The configuration can be edited at any time from the GUI and the web server
+    m_blowerChannel.setLimits({m_config.actuatorBlowerDeadbandPWM,
+                               static_cast<ulong>(m_config.actuatorBlowerMinDwellMSec),
+                               m_config.actuatorBlowerMaxRatePWMPerSec});
+    m_doorChannel.setLimits({m_config.actuatorDoorDeadbandDeg * 10,
+                             static_cast<ulong>(m_config.actuatorDoorMinDwellMSec),
+                             m_config.actuatorDoorMaxRateDegPerSec * 10});
+    m_doorChannel.setRange(m_config.doorClosePosition * 10, m_config.doorOpenPosition * 10);
+
+    if (!m_airflowMap.isBuiltFrom(m_config.isBlowerAirflowCalibrated, m_config.blowerAirflowTable))
+    {
+        m_airflowMap.build(m_config.isBlowerAirflowCalibrated, m_config.blowerAirflowTable);
+    }
+}
+
+void Actuators::service(ulong currentTimeMSec)
+{
+    int command;
+
+    updateLimits();
+
+    if (m_blowerChannel.poll(currentTimeMSec, command))
+    {
+#ifdef DEBUG_ACTUATOR
+        DEBUG_PRINTLN("ACT::service - Blower PWM: " + String(command));
+#endif
+        m_blower.setPWM(command);
+        m_blowerChannel.commit(command, currentTimeMSec);
+    }
+
+    // The door retargets a move in progress, so a command takes effect on the next profile step
+    if (m_doorChannel.poll(currentTimeMSec, command))
+    {
+#ifdef DEBUG_ACTUATOR
+        DEBUG_PRINTLN("ACT::service - Door position (0.1 deg): " + String(command));
+#endif
+        m_door.setPositionTenths(command);
+        m_doorChannel.commit(command, currentTimeMSec);
+    }
+}
+
+void Actuators::setBlowerPWM(int pwm)
+{
+    m_blowerAirflow = pwm;
+    m_blowerChannel.request(pwm);
+}
+
+void Actuators::setBlowerAirflow(int airflow)
+{
+    m_blowerAirflow = constrain(airflow, 0, 255);
+    m_blowerChannel.request(m_airflowMap.toPWM(m_blowerAirflow));
+}
+
+void Actuators::setDoorPosition(int position)
+{
+    setDoorPositionTenths(position * 10);
+}
+
+void Actuators::setDoorPositionTenths(int tenths)
+{
+    m_doorChannel.request(tenths);
+}
+
+void Actuators::setDoorAirflow(int airflow)
+{
+    // Fraction of the travel between the closed and the open position
+    int travel = getDoorTravelForAirflow(m_config.isDoorAirflowMapEnabled, m_config.doorAirflowTable, airflow);
+    int closedTenths = m_config.doorClosePosition * 10;
+    int openTenths = m_config.doorOpenPosition * 10;
+    setDoorPositionTenths(closedTenths + (openTenths - closedTenths) * travel / 255);
+}
+
+void Actuators::openDoor()
+{
+    setDoorPosition(m_config.doorOpenPosition);
+}
+
+void Actuators::closeDoor()
+{
+    setDoorPosition(m_config.doorClosePosition);
+}
+
+void Actuators::stop(ulong currentTimeMSec)
+{
+    m_blowerAirflow = 0;
+    m_blowerChannel.force(0);
+    m_doorChannel.force(m_config.doorClosePosition * 10);
+    service(currentTimeMSec);
+}
+
+void Actuators::resync(ulong currentTimeMSec)
+{
+    // Used after the deadline monitor held the drivers in the fail-safe state
+    m_blowerChannel.reissue();
+    m_doorChannel.reissue();
+    service(currentTimeMSec);
+}
+
+uint Actuators::getBlowerPWM()
+{
+    return m_blower.getPWM();
+}
+
+int Actuators::getBlowerAirflow() const
+{
+    return m_blowerAirflow;
+}
+
+uint Actuators::getDoorPosition()
+{
+    return m_door.getPosition();
+}
+
+int Actuators::getDoorPositionTenths()
+{
+    return m_door.getPositionTenths();
+}
+
+const ActuatorCounters &Actuators::getBlowerCounters() const
+{
+    return m_blowerChannel.getCounters();
+}
+
+const ActuatorCounters &Actuators::getDoorCounters() const
+{
+    return m_doorChannel.getCounters();
+}
@@ -0,0 +1,119 @@
+#ifndef ACTUATOR_H
+#define ACTUATOR_H
+
+/**
+ * @file actuator.h
+ * @brief Command conditioning layer between the temperature controller and the actuator drivers.
+ *
+ * The controller demands an actuator state on every control tick, most of the time the same one
+ * it demanded on the previous tick. Forwarding every demand makes the door servo re-attach and
+ * buzz and keeps the blower state machine restarting, so each actuator is fronted by an
+ * ActuatorChannel that only lets a command through when it is worth sending:
+ *
+ *   - deadband:  demands closer than the deadband to the last issued value are dropped, except
+ *                demands for the ends of the range (blower off, door fully open/closed),
+ *   - min dwell: an issued value is held for at least the dwell time before it can change again,
+ *   - rate limit: the issued value moves towards the demand by at most the configured rate.
+ *
+ * Every demand is counted either as issued or as suppressed so the saving can be reported.
+ *
+ * The temperature controller demands blower airflow, which is mapped to a PWM through the
+ * calibrated AirflowMap before it enters the blower channel. Door demands are conditioned in
+ * tenths of a degree, a door airflow demand is mapped to a position through the door airflow map.
+ */
+
+#include <Arduino.h>
+#include "types.h"
+#include "debug.h"
+#include "blower.h"
+#include "door.h"
+#include "airflow.h"
+
+// #define DEBUG_ACTUATOR
+
+#define DEFAULT_ACTUATOR_BLOWER_DEADBAND_PWM 5         // Blower PWM changes smaller than this are dropped
+#define DEFAULT_ACTUATOR_BLOWER_MIN_DWELL_MSEC 2000    // Minimum time between two blower commands
+#define DEFAULT_ACTUATOR_BLOWER_MAX_RATE_PWM_PER_SEC 0 // Blower PWM slew limit, 0 disables the limit
+#define DEFAULT_ACTUATOR_DOOR_DEADBAND_DEG 1           // Door position changes smaller than this are dropped
+#define DEFAULT_ACTUATOR_DOOR_MIN_DWELL_MSEC 5000      // Minimum time between two door commands
+#define DEFAULT_ACTUATOR_DOOR_MAX_RATE_DEG_PER_SEC 0   // Door slew limit, 0 disables the limit
+
+struct ActuatorLimits
+{
+    int deadband;       // Smallest change worth sending
+    ulong minDwellMSec; // Minimum time between two issued commands
+    int maxRatePerSec;  // Largest change per second, 0 disables the limit
+};
+
+struct ActuatorCounters
+{
+    ulong requested;  // Demands received from the controller
+    ulong issued;     // Commands forwarded to the driver
+    ulong suppressed; // Demands dropped as duplicates, inside the deadband or superseded while pending
+};
+
+class ActuatorChannel
+{
+private:
+    ActuatorLimits m_limits;     // Active limits
+    int m_rangeMin;              // Lowest value, always reachable regardless of the deadband
+    int m_rangeMax;              // Highest value, always reachable regardless of the deadband
+    int m_demandedValue;         // Latest accepted demand
+    int m_issuedValue;           // Last value forwarded to the driver
+    bool m_isIssued;             // True once a value has been forwarded
+    bool m_isPending;            // True while the demand differs from the issued value
+    bool m_isForced;             // True when the pending demand skips the dwell and rate limit
+    ulong m_lastIssueTimeMSec;   // Time of the last forwarded command
+    ActuatorCounters m_counters; // Demand statistics
+
+public:
+    ActuatorChannel(int rangeMin, int rangeMax);
+
+    void setLimits(const ActuatorLimits &limits);
+    void setRange(int rangeMin, int rangeMax);
+    void request(int value);
+    bool poll(ulong currentTimeMSec, int &command);
+    void commit(int command, ulong currentTimeMSec);
+    void force(int value);
+    void reissue();
+
+    int getIssuedValue() const;
+    const ActuatorCounters &getCounters() const;
+};
+
+class Actuators
+{
+private:
+    Blower &m_blower;                // Blower driver
+    Door &m_door;                    // Door driver
+    Configuration &m_config;         // Limits and door positions
+    ActuatorChannel m_blowerChannel; // Conditioning of the blower PWM demand
+    ActuatorChannel m_doorChannel;   // Conditioning of the door position demand (tenths of a degree)
+    AirflowMap m_airflowMap;         // Airflow to blower PWM lookup
+    int m_blowerAirflow;             // Last demanded airflow
+
+    void updateLimits();
+
+public:
+    Actuators(Blower &blower, Door &door, Configuration &config);
+
+    void service(ulong currentTimeMSec);
+    void setBlowerPWM(int pwm);
+    void setBlowerAirflow(int airflow);
+    void setDoorPosition(int position);
+    void setDoorPositionTenths(int tenths);
+    void setDoorAirflow(int airflow);
+    void openDoor();
+    void closeDoor();
+    void stop(ulong currentTimeMSec);
+    void resync(ulong currentTimeMSec);
+
+    uint getBlowerPWM();
+    int getBlowerAirflow() const;
+    uint getDoorPosition();
+    int getDoorPositionTenths();
+    const ActuatorCounters &getBlowerCounters() const;
+    const ActuatorCounters &getDoorCounters() const;
+};
+
+#endif // ACTUATOR_H
@@ -0,0 +1,222 @@
+#include "airflow.h"
+#include "actuator.h"
+
+// ============================================ AIRFLOW MAP ============================================
+
+AirflowMap::AirflowMap()
+{
+    uint8_t table[BLOWER_CALIBRATION_POINTS] = {0};
+    build(false, table);
+}
+
+void AirflowMap::build(bool isCalibrated, const uint8_t table[BLOWER_CALIBRATION_POINTS])
+{
+    m_isCalibrated = isCalibrated;
+    memcpy(m_table, table, sizeof(m_table));
+
+    if (!isCalibrated)
+    {
+        for (int airflow = 0; airflow < 256; ++airflow)
+            m_pwm[airflow] = airflow;
+        return;
+    }
+
+    // Walk the PWM range once, every airflow gets the lowest PWM reaching it
+    int airflow = 0;
+    int segment = 0;
+    for (int pwm = 0; pwm <= BLOWER_MAX_PWM && airflow < 256; ++pwm)
+    {
+        while (segment < BLOWER_CALIBRATION_POINTS - 2 && pwm > BLOWER_CALIBRATION_PWM[segment + 1])
+            segment++;
+
+        int pwm0 = BLOWER_CALIBRATION_PWM[segment];
+        int pwm1 = BLOWER_CALIBRATION_PWM[segment + 1];
+        int flow = table[segment] + (table[segment + 1] - table[segment]) * (pwm - pwm0) / (pwm1 - pwm0);
+        while (airflow <= flow && airflow < 256)
+            m_pwm[airflow++] = pwm;
+    }
+    while (airflow < 256)
+        m_pwm[airflow++] = BLOWER_MAX_PWM;
+
+#ifdef DEBUG_AIRFLOW
+    DEBUG_PRINTLN("AIRFLOW::build - 64->" + String(m_pwm[64]) + " 128->" + String(m_pwm[128]) + " 192->" + String(m_pwm[192]));
+#endif
+}
+
+bool AirflowMap::isBuiltFrom(bool isCalibrated, const uint8_t table[BLOWER_CALIBRATION_POINTS]) const
+{
+    return isCalibrated == m_isCalibrated && (!isCalibrated || memcmp(table, m_table, sizeof(m_table)) == 0);
+}
+
+uint8_t AirflowMap::toPWM(int airflow) const
+{
+    return m_pwm[constrain(airflow, 0, 255)];
+}
+
+// ========================================== DOOR AIRFLOW MAP ==========================================
+
+int getDoorTravelForAirflow(bool isMapEnabled, const uint8_t table[DOOR_AIRFLOW_POINTS], int airflow)
+{
+    airflow = constrain(airflow, 0, 255);
+    if (!isMapEnabled)
+        return airflow;
+
+    // Evenly spaced points, the segment follows from the airflow directly
+    const int spacing = 256 / (DOOR_AIRFLOW_POINTS - 1);
+    int segment = min(airflow / spacing, DOOR_AIRFLOW_POINTS - 2);
+    int offset = airflow - segment * spacing;
+    int span = (segment == DOOR_AIRFLOW_POINTS - 2) ? 255 - segment * spacing : spacing;
+    return table[segment] + (table[segment + 1] - table[segment]) * offset / span;
+}
+
+// ========================================= BLOWER CALIBRATOR =========================================
+
+BlowerCalibrator::BlowerCalibrator(Actuators &actuators, Configuration &config)
+    : m_actuators(actuators), m_config(config)
+{
+    m_state = BLOWER_CALIBRATION_IDLE;
+    m_point = 0;
+    m_stateStartMSec = 0;
+    m_sampleCount = 0;
+}
+
+void BlowerCalibrator::start(ulong currentTimeMSec)
+{
+#ifdef DEBUG_AIRFLOW
+    DEBUG_PRINTLN("AIRFLOW::start - Calibration sweep started");
+#endif
+    m_actuators.openDoor(); // The door stays open for the whole sweep
+    enterPoint(0, currentTimeMSec);
+}
+
+void BlowerCalibrator::abort()
+{
+    if (!isRunning())
+        return;
+
+#ifdef DEBUG_AIRFLOW
+    DEBUG_PRINTLN("AIRFLOW::abort - Calibration aborted at level " + String(m_point));
+#endif
+    m_state = BLOWER_CALIBRATION_FAILED;
+}
+
+void BlowerCalibrator::enterPoint(uint point, ulong currentTimeMSec)
+{
+    m_point = point;
+    m_state = BLOWER_CALIBRATION_SETTLING;
+    m_stateStartMSec = currentTimeMSec;
+    m_actuators.setBlowerPWM(BLOWER_CALIBRATION_PWM[point]);
+}
+
+BlowerCalibrationState BlowerCalibrator::service(float temperatureF, ulong currentTimeMSec)
+{
+    if (!isRunning())
+        return m_state;
+
+    if (temperatureF >= BLOWER_CALIBRATION_MAX_TEMP_F)
+    {
+        abort();
+        return m_state;
+    }
+
+    if (m_state == BLOWER_CALIBRATION_SETTLING)
+    {
+        if (currentTimeMSec - m_stateStartMSec < BLOWER_CALIBRATION_SETTLE_MSEC)
+            return m_state;
+
+        m_state = BLOWER_CALIBRATION_MEASURING;
+        m_stateStartMSec = currentTimeMSec;
+        m_sumT = 0.0f;
+        m_sumTT = 0.0f;
+        m_sumY = 0.0f;
+        m_sumTY = 0.0f;
+        m_sampleCount = 0;
+    }
+
+    float t = (currentTimeMSec - m_stateStartMSec) / 60000.0f;
+    m_sumT += t;
+    m_sumTT += t * t;
+    m_sumY += temperatureF;
+    m_sumTY += t * temperatureF;
+    m_sampleCount++;
+
+    if (currentTimeMSec - m_stateStartMSec < BLOWER_CALIBRATION_MEASURE_MSEC)
+        return m_state;
+
+    m_slopes[m_point] = getSlope();
+#ifdef DEBUG_AIRFLOW
+    DEBUG_PRINTLN("AIRFLOW::service - PWM " + String(BLOWER_CALIBRATION_PWM[m_point]) + " slope=" + String(m_slopes[m_point], 2));
+#endif
+
+    if (m_point + 1 < BLOWER_CALIBRATION_POINTS)
+    {
+        enterPoint(m_point + 1, currentTimeMSec);
+        return m_state;
+    }
+
+    m_state = buildTable() ? BLOWER_CALIBRATION_DONE : BLOWER_CALIBRATION_FAILED;
+    return m_state;
+}
+
+float BlowerCalibrator::getSlope() const
+{
+    float n = static_cast<float>(m_sampleCount);
+    float denominator = n * m_sumTT - m_sumT * m_sumT;
+    if (m_sampleCount < 2 || denominator <= 0.0f)
+        return 0.0f;
+    return (n * m_sumTY - m_sumT * m_sumY) / denominator;
+}
+
+bool BlowerCalibrator::buildTable()
+{
+    // Response over the natural cooling with the blower off, forced monotonic
+    float response[BLOWER_CALIBRATION_POINTS];
+    float peak = 0.0f;
+    for (int i = 0; i < BLOWER_CALIBRATION_POINTS; ++i)
+    {
+        peak = max(peak, m_slopes[i] - m_slopes[0]);
+        response[i] = peak;
+    }
+
+    if (peak < BLOWER_CALIBRATION_MIN_RESPONSE_F_PER_MIN)
+    {
+#ifdef DEBUG_AIRFLOW
+        DEBUG_PRINTLN("AIRFLOW::buildTable - Response too weak: " + String(peak, 2));
+#endif
+        return false;
+    }
+
+    for (int i = 0; i < BLOWER_CALIBRATION_POINTS; ++i)
+        m_config.blowerAirflowTable[i] = static_cast<uint8_t>(lroundf(response[i] / peak * 255.0f));
+    m_config.isBlowerAirflowCalibrated = true;
+    return true;
+}
+
+bool BlowerCalibrator::isRunning() const
+{
+    return m_state == BLOWER_CALIBRATION_SETTLING || m_state == BLOWER_CALIBRATION_MEASURING;
+}
+
+BlowerCalibrationState BlowerCalibrator::getState() const
+{
+    return m_state;
+}
+
+uint BlowerCalibrator::getPoint() const
+{
+    return m_point;
+}
+
+int BlowerCalibrator::getProgress(ulong currentTimeMSec) const
+{
+    if (m_state == BLOWER_CALIBRATION_DONE)
+        return 100;
+    if (!isRunning())
+        return 0;
+
+    const ulong pointMSec = BLOWER_CALIBRATION_SETTLE_MSEC + BLOWER_CALIBRATION_MEASURE_MSEC;
+    ulong elapsedMSec = m_point * pointMSec + (currentTimeMSec - m_stateStartMSec);
+    if (m_state == BLOWER_CALIBRATION_MEASURING)
+        elapsedMSec += BLOWER_CALIBRATION_SETTLE_MSEC;
+    return min(99UL, elapsedMSec * 100 / (BLOWER_CALIBRATION_POINTS * pointMSec));
+}
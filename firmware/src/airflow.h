@@ -0,0 +1,106 @@
+#ifndef AIRFLOW_H
+#define AIRFLOW_H
+
+/**
+ * @file airflow.h
+ * @brief Blower airflow characterization, the airflow to PWM map and the door airflow map.
+ *
+ * The blower response is far from linear in PWM, it barely moves air below BLOWER_MIN_PWM and
+ * saturates well before 255. The controllers demand airflow on a 0-255 scale instead and the
+ * AirflowMap turns it into a PWM with a 256 entry lookup table.
+ *
+ * The table is built from the airflow measured at BLOWER_CALIBRATION_POINTS fixed PWM levels,
+ * stored in the configuration. Between the points the airflow is interpolated linearly and every
+ * airflow maps to the lowest PWM that delivers it, so flat (saturated) segments are skipped.
+ * Without a calibration the map is the identity.
+ *
+ * The BlowerCalibrator measures the table. With the door held open it steps the blower through
+ * the calibration levels, lets the pit settle at each one and fits a least squares slope to the
+ * pit temperature over the measurement window. The response of a level is its slope minus the
+ * slope with the blower off, made monotonic and scaled so the strongest level reads 255.
+ *
+ * The damper is just as non-linear, most of the airflow change happens in the first 10-15
+ * degrees of travel. The optional door airflow map gives the fraction of the travel (0-255) at
+ * DOOR_AIRFLOW_POINTS evenly spaced airflows, so an airflow demand lands on a fine position near
+ * closed. Lookups interpolate between the two neighbouring points, O(1).
+ */
+
+#include <Arduino.h>
+#include "types.h"
+#include "debug.h"
+#include "blower.h"
+
+// #define DEBUG_AIRFLOW
+
+#define BLOWER_CALIBRATION_SETTLE_MSEC 120000          // Settling time at each level
+#define BLOWER_CALIBRATION_MEASURE_MSEC 180000         // Slope measurement window at each level
+#define BLOWER_CALIBRATION_MIN_RESPONSE_F_PER_MIN 0.5f // Weaker responses mean the fire cannot be characterized
+#define BLOWER_CALIBRATION_MAX_TEMP_F 450              // Abort the sweep above this pit temperature
+
+// PWM levels of the calibration sweep, the first one must be 0 and the last one BLOWER_MAX_PWM
+static const uint8_t BLOWER_CALIBRATION_PWM[BLOWER_CALIBRATION_POINTS] = {0, 40, 85, 110, 140, 170, 210, 255};
+
+// Door travel (0-255) for evenly spaced airflows, roughly the cube of the airflow
+static const uint8_t DEFAULT_DOOR_AIRFLOW_TABLE[DOOR_AIRFLOW_POINTS] = {0, 0, 4, 13, 32, 62, 108, 171, 255};
+
+class Actuators;
+
+enum BlowerCalibrationState
+{
+    BLOWER_CALIBRATION_IDLE,
+    BLOWER_CALIBRATION_SETTLING,
+    BLOWER_CALIBRATION_MEASURING,
+    BLOWER_CALIBRATION_DONE,
+    BLOWER_CALIBRATION_FAILED
+};
+
+class AirflowMap
+{
+private:
+    uint8_t m_pwm[256];                         // PWM for each airflow
+    uint8_t m_table[BLOWER_CALIBRATION_POINTS]; // Table the map was built from
+    bool m_isCalibrated;                        // False while the map is the identity
+
+public:
+    AirflowMap();
+
+    void build(bool isCalibrated, const uint8_t table[BLOWER_CALIBRATION_POINTS]);
+    bool isBuiltFrom(bool isCalibrated, const uint8_t table[BLOWER_CALIBRATION_POINTS]) const;
+    uint8_t toPWM(int airflow) const;
+};
+
+int getDoorTravelForAirflow(bool isMapEnabled, const uint8_t table[DOOR_AIRFLOW_POINTS], int airflow);
+
+class BlowerCalibrator
+{
+private:
+    Actuators &m_actuators;                    // Blower and door commands
+    Configuration &m_config;                   // Receives the measured table
+    BlowerCalibrationState m_state;            // Current state
+    uint m_point;                              // Calibration level being measured
+    ulong m_stateStartMSec;                    // Time the current state was entered
+    float m_sumT;                              // Sum of the sample times (minutes from the window start)
+    float m_sumTT;                             // Sum of the squared sample times
+    float m_sumY;                              // Sum of the temperatures
+    float m_sumTY;                             // Sum of time * temperature
+    uint m_sampleCount;                        // Samples in the window
+    float m_slopes[BLOWER_CALIBRATION_POINTS]; // Measured slope at each level (F/min)
+
+    void enterPoint(uint point, ulong currentTimeMSec);
+    float getSlope() const;
+    bool buildTable();
+
+public:
+    BlowerCalibrator(Actuators &actuators, Configuration &config);
+
+    void start(ulong currentTimeMSec);
+    void abort();
+    BlowerCalibrationState service(float temperatureF, ulong currentTimeMSec);
+
+    bool isRunning() const;
+    BlowerCalibrationState getState() const;
+    uint getPoint() const;
+    int getProgress(ulong currentTimeMSec) const;
+};
+
+#endif // AIRFLOW_H
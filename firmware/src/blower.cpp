@@ -1,131 +1,257 @@
 #include "blower.h"
 
-const char *blowerStateToString(BlowerState state)
+#ifdef DEBUG_BLOWER
+static const char *blowerStateToString(BlowerState state)
 {
     switch (state)
     {
     case BLOWER_STATE_IDLE:
         return "IDLE";
-    case BLOWER_STATE_STARTING:
-        return "STARTING";
+    case BLOWER_STATE_KICK_STARTING:
+        return "KICK";
+    case BLOWER_STATE_RAMPING:
+        return "RAMPING";
     case BLOWER_STATE_RUNNING_NORMAL_SPEED:
         return "RUNNING_NS";
     case BLOWER_STATE_RUNNING_LOW_SPEED:
         return "RUNNING_LS";
-    case BLOWER_STATE_STOPPING:
-        return "STOPPING";
     default:
         return "UNKNOWN";
     }
 }
+#endif
 
-Blower::Blower() : m_pinPWM(0), m_pinA(0), m_pinB(0) {}
+Blower::Blower() : m_pinPWM(0), m_pinA(0), m_pinB(0), m_pinEnb(0), m_timer(nullptr), m_isStarted(false) {}
 
 Blower::Blower(uint pinPWM, uint pinA, uint pinB, uint enb) : m_pinPWM(pinPWM),
                                                               m_pinA(pinA),
                                                               m_pinB(pinB),
                                                               m_pinEnb(enb)
 {
-    pinMode(m_pinPWM, OUTPUT);
+    m_state = BLOWER_STATE_IDLE;
+    m_prevState = BLOWER_STATE_IDLE; // Initialize previous state to idle
+    m_demandedPWM = 0;
+    m_lastDemandPWM = 0;
+    m_isStartPending = false;
+    m_outputPWM = 0;
+    m_sigmaDeltaAccumulator = 0;
+    m_modulatorTicks = 0;
+    m_isModulatorOn = false;
+    m_rampPWMx256 = 0;
+    m_kickTicksLeft = 0;
+    m_isKicking = false;
+    m_offTicks = UINT16_MAX; // Motor at standstill
+    m_kickCount = 0;
+    setRamp(DEFAULT_BLOWER_KICK_START_MSEC, DEFAULT_BLOWER_SLEW_PWM_PER_SEC);
+    m_frequencyHz = DEFAULT_BLOWER_PWM_FREQUENCY_HZ;
+    m_timer = nullptr;
+    m_isStarted = false;
+}
+
+void Blower::begin(uint frequencyHz)
+{
+    if (m_isStarted)
+        return;
+
     pinMode(m_pinA, OUTPUT);
     pinMode(m_pinB, OUTPUT);
     pinMode(m_pinEnb, OUTPUT);
+    digitalWrite(m_pinEnb, LOW);
+    digitalWrite(m_pinA, LOW);
+    digitalWrite(m_pinB, LOW);
 
-    m_state = BLOWER_STATE_IDLE;
-    m_prevState = BLOWER_STATE_IDLE; // Initialize previous state to idle
-    m_demandedPWM = 255;
-    m_blowerOnTimeMSec = 0;
-    m_isLowSpeed = false;
+    // The carrier runs in hardware, the duty is only rewritten when it changes
+    m_frequencyHz = constrain(frequencyHz, BLOWER_PWM_FREQUENCY_MIN_HZ, BLOWER_PWM_FREQUENCY_MAX_HZ);
+    ledcSetup(BLOWER_LEDC_CHANNEL, m_frequencyHz, BLOWER_LEDC_RESOLUTION);
+    ledcAttachPin(m_pinPWM, BLOWER_LEDC_CHANNEL);
+    ledcWrite(BLOWER_LEDC_CHANNEL, 0);
+
+    const esp_timer_create_args_t timerArgs = {
+        .callback = &Blower::timerCallback,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "blower",
+        .skip_unhandled_events = true};
+    if (esp_timer_create(&timerArgs, &m_timer) != ESP_OK ||
+        esp_timer_start_periodic(m_timer, BLOWER_TIMER_TICK_USEC) != ESP_OK)
+    {
+        Serial.println("Blower timer could not be started!");
+    }
+
+    m_isStarted = true;
 }
 
-void Blower::service(ulong currentTimeMsec)
+void Blower::setFrequency(uint frequencyHz)
 {
-#ifdef DEBUG_BLOWER
-    String debugStr;
-#endif
-
-#ifdef DEBUG_BLOWER
+    frequencyHz = constrain(frequencyHz, BLOWER_PWM_FREQUENCY_MIN_HZ, BLOWER_PWM_FREQUENCY_MAX_HZ);
+    if (frequencyHz == m_frequencyHz)
+        return;
 
-    if (m_state != m_prevState)
+    m_frequencyHz = frequencyHz;
+    if (m_isStarted)
     {
-        debugStr = "Blower State: ";
-        DEBUG_PRINTLN(debugStr);
-        debugStr = "  ";
-        debugStr += String(blowerStateToString(m_prevState));
-        debugStr += "->";
-        debugStr += String(blowerStateToString(m_state));
-        DEBUG_PRINTLN(debugStr);
+        ledcChangeFrequency(BLOWER_LEDC_CHANNEL, m_frequencyHz, BLOWER_LEDC_RESOLUTION);
     }
+#ifdef DEBUG_BLOWER
+    DEBUG_PRINTLN("Blower frequency: " + String(m_frequencyHz));
 #endif
+}
 
-    m_currentTimeMsec = currentTimeMsec;
+void Blower::setRamp(uint kickStartMSec, uint slewPWMPerSec)
+{
+    kickStartMSec = min(kickStartMSec, static_cast<uint>(BLOWER_KICK_START_MAX_MSEC));
+    m_kickStartTicks = kickStartMSec * 1000 / BLOWER_TIMER_TICK_USEC;
+    m_slewStepx256 = slewPWMPerSec * 256 / (1000000 / BLOWER_TIMER_TICK_USEC);
+    if (slewPWMPerSec > 0 && m_slewStepx256 == 0)
+        m_slewStepx256 = 1;
+}
 
-    switch (m_state)
-    {
-    case BLOWER_STATE_IDLE:
-        // Do nothing, waiting for start command
-        break;
+void Blower::timerCallback(void *arg)
+{
+    static_cast<Blower *>(arg)->tick();
+}
 
-    case BLOWER_STATE_STARTING:
-        start(); // Start the blower motor
-        // Set the state based on the speed
-        m_state = m_isLowSpeed ? BLOWER_STATE_RUNNING_LOW_SPEED : BLOWER_STATE_RUNNING_NORMAL_SPEED;
-        m_blowerStartTimeMsec = m_currentTimeMsec; // Record the start time of the blower operation
-        break;
+void Blower::tick()
+{
+    // Runs in the esp_timer task, independent of the main loop
+    uint demand = m_demandedPWM;
+    if (demand == 0)
+        m_isStartPending = false;
+    else if (m_lastDemandPWM == 0)
+        m_isStartPending = true;
+    m_lastDemandPWM = demand;
 
-    case BLOWER_STATE_RUNNING_NORMAL_SPEED:
-        // Do nothing special while running at normal speed
-        break;
+    uint target = getModulatedPWM(demand);
+    uint pwm = getShapedPWM(target, demand < BLOWER_MIN_PWM);
 
-    case BLOWER_STATE_RUNNING_LOW_SPEED:
+    if (demand == 0)
+        m_state = BLOWER_STATE_IDLE;
+    else if (m_isKicking)
+        m_state = BLOWER_STATE_KICK_STARTING;
+    else if (pwm != target)
+        m_state = BLOWER_STATE_RAMPING;
+    else if (demand < BLOWER_MIN_PWM)
+        m_state = BLOWER_STATE_RUNNING_LOW_SPEED;
+    else
+        m_state = BLOWER_STATE_RUNNING_NORMAL_SPEED;
 
-        // Check if the blower has been running for the defined low speed active time
-        if (m_currentTimeMsec - m_blowerStartTimeMsec >= m_blowerOnTimeMSec)
-        {
-            // If the blower has been running for the defined time, stop it
-            stop();
-        }
+    m_offTicks = (pwm == 0) ? min(m_offTicks + 1, static_cast<uint>(UINT16_MAX)) : 0;
+    writeOutput(pwm);
+}
 
-        if (m_currentTimeMsec - m_blowerStartTimeMsec >= BLOWER_LOW_PWM_DUTY_CYCLE_MSEC)
-        {
-            // If the blower has been running for the low speed duty cycle time, restart it
-            m_state = BLOWER_STATE_STARTING; // Set the state to starting to restart the blower
-#ifdef DEBUG_BLOWER
-            debugStr = "Blower low speed restart";
-            DEBUG_PRINTLN(debugStr);
-#endif
-        }
+uint Blower::getModulatedPWM(uint demand)
+{
+    if (demand == 0)
+    {
+        m_sigmaDeltaAccumulator = 0;
+        m_isModulatorOn = false;
+        return 0;
+    }
 
-        break;
+    if (demand >= BLOWER_MIN_PWM)
+    {
+        m_sigmaDeltaAccumulator = 0;
+        m_isModulatorOn = false;
+        return demand;
+    }
 
-    case BLOWER_STATE_STOPPING:
-        stop();                      // Stop the blower motor
-        m_state = BLOWER_STATE_IDLE; // Set the state back to idle after stopping
-        break;
+    // Pulse density modulation between off and the lowest speed the motor sustains
+    if (++m_modulatorTicks >= BLOWER_MODULATOR_TICKS)
+    {
+        m_modulatorTicks = 0;
+        m_sigmaDeltaAccumulator += demand;
+        m_isModulatorOn = m_sigmaDeltaAccumulator >= BLOWER_MIN_PWM;
+        if (m_isModulatorOn)
+            m_sigmaDeltaAccumulator -= BLOWER_MIN_PWM;
+    }
+    return m_isModulatorOn ? BLOWER_MIN_PWM : 0;
+}
 
-    default:
-        // Handle unexpected state
-        Serial.println("Blower in unknown state!");
-        break;
+uint Blower::getShapedPWM(uint target, bool isModulated)
+{
+    m_isKicking = false;
+    if (target == 0)
+    {
+        // Stop at once, the motor coasts down
+        m_kickTicksLeft = 0;
+        m_rampPWMx256 = 0;
+        return 0;
     }
 
-    m_prevState = m_state; // Update the previous state to the current state
+    // Kick-start a motor at standstill on a real start, a modulator pulse after an off gap is not one
+    bool isAtStandstill = m_outputPWM == 0 && m_offTicks * (BLOWER_TIMER_TICK_USEC / 1000) >= BLOWER_KICK_REARM_MSEC;
+    bool isStart = m_isStartPending || !isModulated;
+    m_isStartPending = false;
+    if (isAtStandstill && isStart && m_kickStartTicks > 0)
+    {
+        m_kickTicksLeft = m_kickStartTicks;
+        m_kickCount++;
+    }
+    if (m_kickTicksLeft > 0)
+    {
+        // The motor leaves the kick faster than the target, continue from the target
+        if (--m_kickTicksLeft == 0)
+            m_rampPWMx256 = target << 8;
+        m_isKicking = true;
+        return BLOWER_MAX_PWM;
+    }
+
+    // Ramp towards the target, starting from the lowest speed the motor sustains
+    uint targetx256 = target << 8;
+    uint step = m_slewStepx256;
+    if (m_rampPWMx256 < (BLOWER_MIN_PWM << 8))
+        m_rampPWMx256 = min(targetx256, static_cast<uint>(BLOWER_MIN_PWM << 8));
+    if (step == 0)
+        m_rampPWMx256 = targetx256;
+    else if (m_rampPWMx256 < targetx256)
+        m_rampPWMx256 = min(m_rampPWMx256 + step, targetx256);
+    else if (m_rampPWMx256 > targetx256)
+        m_rampPWMx256 = max(m_rampPWMx256 - step, targetx256);
+
+    return m_rampPWMx256 >> 8;
 }
 
-void Blower::start()
+void Blower::writeOutput(uint pwm)
 {
-    digitalWrite(m_pinEnb, HIGH); // Enable the motor
-    analogWrite(m_pinPWM, m_actualPWM);
-    digitalWrite(m_pinA, HIGH);
-    digitalWrite(m_pinB, LOW);
+    if (pwm == m_outputPWM)
+        return;
+
+    if (pwm == 0)
+    {
+        digitalWrite(m_pinEnb, LOW); // Disable the motor
+        ledcWrite(BLOWER_LEDC_CHANNEL, 0);
+        digitalWrite(m_pinA, LOW);
+        digitalWrite(m_pinB, LOW);
+    }
+    else
+    {
+        if (m_outputPWM == 0)
+        {
+            digitalWrite(m_pinEnb, HIGH); // Enable the motor
+            digitalWrite(m_pinA, HIGH);
+            digitalWrite(m_pinB, LOW);
+        }
+        ledcWrite(BLOWER_LEDC_CHANNEL, pwm);
+    }
+
+    m_outputPWM = pwm;
 }
 
-void Blower::stop()
+void Blower::service(ulong currentTimeMsec)
 {
-    digitalWrite(m_pinEnb, LOW); // Disable the motor
-    analogWrite(m_pinPWM, 0);
-    digitalWrite(m_pinA, LOW);
-    digitalWrite(m_pinB, LOW);
+    // The output and the state are driven by the timer, only the transitions are reported here
+#ifdef DEBUG_BLOWER
+    if (m_state != m_prevState)
+    {
+        String debugStr = "Blower State: ";
+        debugStr += String(blowerStateToString(m_prevState));
+        debugStr += "->";
+        debugStr += String(blowerStateToString(m_state));
+        DEBUG_PRINTLN(debugStr);
+    }
+#endif
+
+    m_prevState = m_state; // Update the previous state to the current state
 }
 
 BlowerState Blower::getState()
@@ -135,62 +261,22 @@ BlowerState Blower::getState()
 
 void Blower::setPWM(uint pwm)
 {
+    pwm = min(pwm, static_cast<uint>(BLOWER_MAX_PWM));
 
     // Check if the PWM value is the same as the current demanded PWM
     if (pwm == m_demandedPWM)
     {
-#ifdef DEBUG_BLOWER
-        DEBUG_PRINTLN("setPWM: NO CHANGE");
-#endif
-        // If the PWM value is the same, do nothing
-        return;
-    }
-
-    // Check the PWM valud is zero, stop the blower if it is
-    if (pwm == 0)
-    {
-#ifdef DEBUG_BLOWER
-        DEBUG_PRINTLN("setPWM: STOPPING");
-#endif
-        m_state = BLOWER_STATE_STOPPING;
-        m_demandedPWM = 0; // Set the demanded PWM to zero
-        m_actualPWM = 0;   // Set the actual PWM to zero
         return;
     }
 
-    // Update the demanded PWM value
+    // The timer picks the new demand up on its next tick
     m_demandedPWM = pwm;
 
-    // Constrain the PWM value to the defined limits
-    m_actualPWM = constrain(pwm, BLOWER_MIN_PWM, BLOWER_MAX_PWM);
-
-    // Calculate the actuve time in milliseconds for the low speed mode
-    if (m_demandedPWM < BLOWER_MIN_PWM)
-    {
-        // Set the blower to low speed mode
-        m_isLowSpeed = true;
-        // Calculate what fraction of the low speed PWM is requested
-        float requestedFraction = static_cast<float>(m_demandedPWM) / BLOWER_MIN_PWM;
-        // Calculate the active time in milliseconds based on the requested fraction
-        m_blowerOnTimeMSec = static_cast<ulong>(BLOWER_LOW_PWM_DUTY_CYCLE_MSEC * requestedFraction);
-    }
-    else
-    {
-        // Set the blower to normal speed mode
-        m_isLowSpeed = false;
-        m_blowerOnTimeMSec = 0; // No active time in normal speed mode
-    }
 #ifdef DEBUG_BLOWER
     String debugStr = "setPWM: ";
-    debugStr += String(m_demandedPWM);
-    DEBUG_PRINTLN(debugStr);
-    debugStr = "blowerOnTimeMSec: ";
-    debugStr += String(m_blowerOnTimeMSec);
+    debugStr += String(pwm);
     DEBUG_PRINTLN(debugStr);
 #endif
-
-    // Set the state to starting
-    m_state = BLOWER_STATE_STARTING;
 }
 
 uint Blower::getPWM()
@@ -198,3 +284,14 @@ uint Blower::getPWM()
     // Return the current demanded PWM value
     return m_demandedPWM;
 }
+
+uint Blower::getOutputPWM()
+{
+    // Duty written to the channel by the last timer tick
+    return m_outputPWM;
+}
+
+uint Blower::getKickCount()
+{
+    return m_kickCount;
+}
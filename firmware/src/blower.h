@@ -1,7 +1,35 @@
 #ifndef MOTOR_H
 #define MOTOR_H
 
+/**
+ * @file blower.h
+ * @brief Blower motor driver on an ESP32 LEDC channel.
+ *
+ * The PWM carrier is generated by the LEDC peripheral at a configurable frequency, so the
+ * motor speed does not depend on the main loop. The motor does not turn reliably below
+ * BLOWER_MIN_PWM, lower demands are produced by a first order sigma-delta modulator clocked
+ * from an esp_timer:
+ *
+ *     accumulator += demand
+ *     if (accumulator >= BLOWER_MIN_PWM) { output BLOWER_MIN_PWM; accumulator -= BLOWER_MIN_PWM; }
+ *     else                               { output 0; }
+ *
+ * The average output equals the demand and the on pulses are spread as evenly as the tick
+ * allows, so the airflow changes smoothly from 0 to 255 and a stalled loop never leaves the
+ * motor stuck on or off.
+ *
+ * The same timer shapes the duty written to the channel:
+ *   - kick-start, a start from standstill (off for BLOWER_KICK_REARM_MSEC or longer) is driven
+ *     at full duty for the kick-start time to break the static friction. Only a real start kicks:
+ *     the demand going from 0 to non-zero, or a demand at or above BLOWER_MIN_PWM. The pulses of
+ *     the modulator are part of the low speed they average to and are never kicked,
+ *   - slew limit, duty changes are ramped at no more than the configured PWM per second so a
+ *     large step does not draw a current spike from the supply. A start ramps up from
+ *     BLOWER_MIN_PWM and a stop is applied immediately.
+ */
+
 #include <Arduino.h>
+#include <esp_timer.h>
 #include "types.h"
 #include "debug.h"
 
@@ -10,42 +38,71 @@
 enum BlowerState
 {
     BLOWER_STATE_IDLE,
-    BLOWER_STATE_STARTING,
+    BLOWER_STATE_KICK_STARTING,
+    BLOWER_STATE_RAMPING,
     BLOWER_STATE_RUNNING_NORMAL_SPEED,
     BLOWER_STATE_RUNNING_LOW_SPEED,
-    BLOWER_STATE_STOPPING,
 };
 
 #define BLOWER_MIN_PWM 85
 #define BLOWER_MAX_PWM 255
-#define BLOWER_LOW_PWM_DUTY_CYCLE_MSEC 500 // Blower interval in milliseconds when running at low speed
+#define DEFAULT_BLOWER_PWM_FREQUENCY_HZ 25000 // Carrier frequency, above the audible range
+#define BLOWER_PWM_FREQUENCY_MIN_HZ 100
+#define BLOWER_PWM_FREQUENCY_MAX_HZ 40000
+#define BLOWER_LEDC_CHANNEL 15                // Low speed timer 3, its 25 kHz carrier stays off the 50 Hz timer 2 of DOOR_LEDC_CHANNEL (13)
+#define BLOWER_LEDC_RESOLUTION 8              // Bits of duty resolution, matches the 0-255 PWM range
+#define DEFAULT_BLOWER_KICK_START_MSEC 300
+#define DEFAULT_BLOWER_SLEW_PWM_PER_SEC 200
+#define BLOWER_KICK_START_MAX_MSEC 2000
+#define BLOWER_KICK_REARM_MSEC 1000           // Off time after which the motor is considered stopped
+#define BLOWER_TIMER_TICK_USEC 10000          // Kick-start and slew limit resolution (10 ms)
+#define BLOWER_MODULATOR_TICKS 10             // Timer ticks per sigma-delta modulator step (100 ms)
 
 class Blower
 {
 private:
-    uint m_pinA;                 // Pin for controlling direction A
-    uint m_pinB;                 // Pin for controlling direction B
-    uint m_pinPWM;               // Pin for controlling PWM speed
-    uint m_pinEnb;               // Pin for enabling the motor
-    BlowerState m_state;         // Current state of the blower
-    BlowerState m_prevState;     // Previous state of the blower for state transitions
-    uint m_demandedPWM;          // Current demanded PWM value for the blower
-    uint m_actualPWM;            // Actual PWM value being applied to the blower
-    ulong m_blowerOnTimeMSec;    // Time for the blower to be active in millisconds at low speeds
-    ulong m_currentTimeMsec;     // Current time in milliseconds
-    ulong m_blowerStartTimeMsec; // Start time of the blower operation in milliseconds
-    bool m_isLowSpeed;           // Flag to indicate if the blower is running at low speed
-
-    void start();
-    void stop();
+    uint m_pinA;                    // Pin for controlling direction A
+    uint m_pinB;                    // Pin for controlling direction B
+    uint m_pinPWM;                  // Pin for controlling PWM speed
+    uint m_pinEnb;                  // Pin for enabling the motor
+    volatile BlowerState m_state;   // Current state of the blower, set by the timer callback
+    BlowerState m_prevState;        // Previous state of the blower for state transitions
+    volatile uint m_demandedPWM;    // Demanded PWM value, read by the timer callback
+    uint m_lastDemandPWM;           // Demand seen by the previous timer tick
+    bool m_isStartPending;          // Demand left 0, the first output from standstill kicks
+    uint m_outputPWM;               // Duty currently written to the LEDC channel
+    uint m_sigmaDeltaAccumulator;   // Sigma-delta modulator state for low speeds
+    uint m_modulatorTicks;          // Ticks since the last modulator step
+    bool m_isModulatorOn;           // Modulator output for low speeds
+    uint m_rampPWMx256;             // Slew limited duty (1/256 PWM)
+    bool m_isKicking;               // True while the kick-start pulse is applied
+    uint m_kickTicksLeft;           // Ticks left in the current kick-start pulse
+    uint m_offTicks;                // Ticks the output has been off
+    volatile uint m_kickStartTicks; // Kick-start length in ticks, 0 disables the kick
+    volatile uint m_slewStepx256;   // Largest duty change per tick (1/256 PWM), 0 disables the limit
+    uint m_kickCount;               // Number of kick-start pulses since boot
+    uint m_frequencyHz;             // PWM carrier frequency
+    esp_timer_handle_t m_timer;     // Modulator timer
+    bool m_isStarted;               // True once the LEDC channel and the timer are set up
+
+    static void timerCallback(void *arg);
+    void tick();
+    uint getModulatedPWM(uint demand);
+    uint getShapedPWM(uint target, bool isModulated);
+    void writeOutput(uint pwm);
 
 public:
     Blower();
     Blower(uint pinPWM, uint pinA, uint pinB, uint enb);
+    void begin(uint frequencyHz);
+    void setFrequency(uint frequencyHz);
+    void setRamp(uint kickStartMSec, uint slewPWMPerSec);
     void service(ulong currentTimeMsec);
     BlowerState getState();
     void setPWM(uint pwm);
     uint getPWM();
+    uint getOutputPWM();
+    uint getKickCount();
 };
 
-#endif
\ No newline at end of file
+#endif
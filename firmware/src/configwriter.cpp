@@ -0,0 +1,165 @@
+#include "configwriter.h"
+
+ConfigWriter::ConfigWriter(ControlChannel &channel, NVRAM &configurationNVRAM, NVRAM &profileNVRAM)
+    : m_channel(channel), m_configurationNVRAM(configurationNVRAM), m_profileNVRAM(profileNVRAM)
+{
+    m_taskHandle = nullptr;
+    m_writeMutex = nullptr;
+    m_dirtyRecords = 0;
+    m_firstRequestMSec = 0;
+    m_lastRequestMSec = 0;
+    m_isFlushRequested = false;
+    m_isDiscarded = false;
+    m_requestCount = 0;
+    m_writeCount = 0;
+    m_mux = portMUX_INITIALIZER_UNLOCKED;
+}
+
+bool ConfigWriter::begin()
+{
+    m_writeMutex = xSemaphoreCreateMutex();
+    if (m_writeMutex == nullptr ||
+        xTaskCreatePinnedToCore(taskEntry, "config_writer", CONFIG_WRITER_TASK_STACK_SIZE, this, CONFIG_WRITER_TASK_PRIORITY,
+                                &m_taskHandle, CONFIG_WRITER_TASK_CORE) != pdPASS)
+    {
+        Serial.println("Config writer task could not be started!");
+        return false;
+    }
+    return true;
+}
+
+void ConfigWriter::markDirty(ConfigRecord record, ulong currentTimeMSec)
+{
+    portENTER_CRITICAL(&m_mux);
+    if (m_dirtyRecords == 0)
+        m_firstRequestMSec = currentTimeMSec;
+    m_dirtyRecords |= record;
+    m_lastRequestMSec = currentTimeMSec;
+    m_requestCount++;
+    portEXIT_CRITICAL(&m_mux);
+}
+
+void ConfigWriter::requestFlush()
+{
+    portENTER_CRITICAL(&m_mux);
+    m_isFlushRequested = true;
+    portEXIT_CRITICAL(&m_mux);
+}
+
+bool ConfigWriter::flush()
+{
+    // Before begin() there is no writer task yet, the caller's task is the only one
+    if (m_writeMutex != nullptr)
+        xSemaphoreTake(m_writeMutex, portMAX_DELAY);
+    bool isWritten = writeRecords(takeDirtyRecords(true, millis()));
+    if (m_writeMutex != nullptr)
+        xSemaphoreGive(m_writeMutex);
+    return isWritten;
+}
+
+void ConfigWriter::discard()
+{
+    if (m_writeMutex != nullptr)
+        xSemaphoreTake(m_writeMutex, portMAX_DELAY);
+    portENTER_CRITICAL(&m_mux);
+    m_dirtyRecords = 0;
+    m_isFlushRequested = false;
+    m_isDiscarded = true;
+    portEXIT_CRITICAL(&m_mux);
+    if (m_writeMutex != nullptr)
+        xSemaphoreGive(m_writeMutex);
+}
+
+uint32_t ConfigWriter::getRequestCount() const
+{
+    portENTER_CRITICAL(&m_mux);
+    uint32_t count = m_requestCount;
+    portEXIT_CRITICAL(&m_mux);
+    return count;
+}
+
+uint32_t ConfigWriter::getWriteCount() const
+{
+    portENTER_CRITICAL(&m_mux);
+    uint32_t count = m_writeCount;
+    portEXIT_CRITICAL(&m_mux);
+    return count;
+}
+
+void ConfigWriter::taskEntry(void *parameter)
+{
+    static_cast<ConfigWriter *>(parameter)->run();
+}
+
+void ConfigWriter::run()
+{
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_WRITER_PERIOD_MSEC));
+
+        xSemaphoreTake(m_writeMutex, portMAX_DELAY);
+        writeRecords(takeDirtyRecords(false, millis()));
+        xSemaphoreGive(m_writeMutex);
+    }
+}
+
+uint8_t ConfigWriter::takeDirtyRecords(bool isForced, ulong currentTimeMSec)
+{
+    // Due after the quiet time, the first request bounds the delay of a steady stream of them
+    uint8_t records = 0;
+    portENTER_CRITICAL(&m_mux);
+    bool isDue = isForced || m_isFlushRequested ||
+                 currentTimeMSec - m_lastRequestMSec >= CONFIG_WRITER_DEBOUNCE_MSEC ||
+                 currentTimeMSec - m_firstRequestMSec >= CONFIG_WRITER_MAX_DELAY_MSEC;
+    if (!m_isDiscarded && isDue)
+    {
+        records = m_dirtyRecords;
+        m_dirtyRecords = 0;
+        m_isFlushRequested = false;
+    }
+    portEXIT_CRITICAL(&m_mux);
+    return records;
+}
+
+bool ConfigWriter::writeRecords(uint8_t records)
+{
+    // Written from the published snapshots, a failed record is marked dirty again for a retry
+    bool isWritten = true;
+    if (records & CONFIG_RECORD_CONFIGURATION)
+    {
+        m_channel.readConfiguration(m_configuration);
+        if (m_configurationNVRAM.writeNVRAM(reinterpret_cast<const uint8_t *>(&m_configuration)))
+        {
+            portENTER_CRITICAL(&m_mux);
+            m_writeCount++;
+            portEXIT_CRITICAL(&m_mux);
+        }
+        else
+        {
+            markDirty(CONFIG_RECORD_CONFIGURATION, millis());
+            isWritten = false;
+        }
+    }
+    if (records & CONFIG_RECORD_PROFILE)
+    {
+        m_channel.readProfile(m_profile);
+        if (m_profileNVRAM.writeNVRAM(reinterpret_cast<const uint8_t *>(&m_profile)))
+        {
+            portENTER_CRITICAL(&m_mux);
+            m_writeCount++;
+            portEXIT_CRITICAL(&m_mux);
+        }
+        else
+        {
+            markDirty(CONFIG_RECORD_PROFILE, millis());
+            isWritten = false;
+        }
+    }
+
+#ifdef DEBUG_CONFIG_WRITER
+    if (records != 0)
+        DEBUG_PRINTLN("CONFIGWRITER::writeRecords - records " + String(records) + ", " + String(getWriteCount()) + " writes for " +
+                      String(getRequestCount()) + " requests");
+#endif
+    return isWritten;
+}
@@ -0,0 +1,94 @@
+#ifndef CONFIGWRITER_H
+#define CONFIGWRITER_H
+
+/**
+ * @file configwriter.h
+ * @brief Deferred, coalescing NVRAM writes of the configuration and the profile table.
+ *
+ * Every confirm in the GUI and every /config or /profile post used to write the whole record on
+ * the control loop at once, turning the knob through several settings wrote it several times.
+ * A save request now only marks the record dirty. A low priority task on the UI core writes it
+ * once the requests stop for CONFIG_WRITER_DEBOUNCE_MSEC, and at the latest
+ * CONFIG_WRITER_MAX_DELAY_MSEC after the first one, so a burst of changes becomes one write:
+ *
+ *   request  |  |   |                          |
+ *   write                  W (debounce after the last request)           W
+ *
+ * The writer never touches the master copies of the control loop. It reads the published
+ * snapshots from the control channel into buffers of its own and writes those, the control loop
+ * publishes every change before its save request is handled.
+ *
+ * Pending records are flushed explicitly:
+ *
+ *   - requestFlush(): on the writer task at its next pass, without waiting (run stop),
+ *   - flush():        on the calling task, holding it until written (before a restart),
+ *   - discard():      pending records dropped and the writer stopped (before a factory reset).
+ *
+ * A mutex keeps a flush() or discard() from running while the writer task is in a write.
+ */
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "types.h"
+#include "nvram.h"
+#include "controlchannel.h"
+#include "debug.h"
+
+// #define DEBUG_CONFIG_WRITER
+
+#define CONFIG_WRITER_TASK_CORE 0          // Core of the UI loop, the control loop keeps its core
+#define CONFIG_WRITER_TASK_PRIORITY 0      // Below the UI task, shares its core with the idle task
+#define CONFIG_WRITER_TASK_STACK_SIZE 4096 // Writer task stack (bytes)
+#define CONFIG_WRITER_PERIOD_MSEC 100      // Polling period of the dirty records
+#define CONFIG_WRITER_DEBOUNCE_MSEC 2000   // Quiet time after the last request
+#define CONFIG_WRITER_MAX_DELAY_MSEC 10000 // Longest delay after the first request
+
+enum ConfigRecord : uint8_t
+{
+    CONFIG_RECORD_CONFIGURATION = 0x01, // Configuration blob
+    CONFIG_RECORD_PROFILE = 0x02        // Profile table blob
+};
+
+class ConfigWriter
+{
+public:
+    ConfigWriter(ControlChannel &channel, NVRAM &configurationNVRAM, NVRAM &profileNVRAM);
+
+    // Setup only, after the first snapshots were published
+    bool begin();
+
+    // Any task
+    void markDirty(ConfigRecord record, ulong currentTimeMSec);
+    void requestFlush();
+    bool flush();
+    void discard();
+
+    uint32_t getRequestCount() const;
+    uint32_t getWriteCount() const;
+
+private:
+    ControlChannel &m_channel;      // Source of the snapshots
+    NVRAM &m_configurationNVRAM;    // Configuration record
+    NVRAM &m_profileNVRAM;          // Profile table record
+    Configuration m_configuration;  // Configuration snapshot being written
+    TempProfileTable m_profile;     // Profile table snapshot being written
+    TaskHandle_t m_taskHandle;      // Writer task
+    SemaphoreHandle_t m_writeMutex; // Held for the length of a write
+    uint8_t m_dirtyRecords;         // ConfigRecord flags waiting for a write
+    ulong m_firstRequestMSec;       // First request since the last write
+    ulong m_lastRequestMSec;        // Latest request
+    bool m_isFlushRequested;        // Write on the next pass, debounce or not
+    bool m_isDiscarded;             // Writer stopped for a factory reset
+    uint32_t m_requestCount;        // Save requests since boot
+    uint32_t m_writeCount;          // Records written since boot
+    mutable portMUX_TYPE m_mux;     // Guards the dirty state and the counters
+
+    static void taskEntry(void *parameter);
+    void run();
+    uint8_t takeDirtyRecords(bool isForced, ulong currentTimeMSec);
+    bool writeRecords(uint8_t records);
+};
+
+#endif // CONFIGWRITER_H
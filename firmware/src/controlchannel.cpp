@@ -0,0 +1,258 @@
+#include "controlchannel.h"
+
+struct ConfigurationField
+{
+    uint16_t offset; // Offset in Configuration
+    uint16_t size;   // Size of the field, an array is one field
+    uint16_t align;  // Alignment of the field, checks the table against the struct
+};
+
+#define CONFIGURATION_FIELD(name) \
+    {offsetof(Configuration, name), sizeof(Configuration::name), alignof(decltype(Configuration::name))}
+
+// Every field of Configuration in declaration order, a new field must be added here as well
+static constexpr ConfigurationField CONFIGURATION_FIELDS[] = {
+    CONFIGURATION_FIELD(temperatureTarget),
+    CONFIGURATION_FIELD(temperatureIntervalMSec),
+    CONFIGURATION_FIELD(isTemperatureProfilingEnabled),
+    CONFIGURATION_FIELD(temperatureProfile),
+    CONFIGURATION_FIELD(temperatureProfileStepsCount),
+    CONFIGURATION_FIELD(profilePitBandF),
+    CONFIGURATION_FIELD(controlAlgorithm),
+    CONFIGURATION_FIELD(kP),
+    CONFIGURATION_FIELD(kI),
+    CONFIGURATION_FIELD(kD),
+    CONFIGURATION_FIELD(bangBangLowThreshold),
+    CONFIGURATION_FIELD(bangBangHighThreshold),
+    CONFIGURATION_FIELD(bangBangHysteresis),
+    CONFIGURATION_FIELD(bangBangFanSpeed),
+    CONFIGURATION_FIELD(blowerPWMFrequencyHz),
+    CONFIGURATION_FIELD(blowerKickStartMSec),
+    CONFIGURATION_FIELD(blowerSlewPWMPerSec),
+    CONFIGURATION_FIELD(isBlowerAirflowCalibrated),
+    CONFIGURATION_FIELD(blowerAirflowTable),
+    CONFIGURATION_FIELD(doorOpenPosition),
+    CONFIGURATION_FIELD(doorClosePosition),
+    CONFIGURATION_FIELD(doorMaxSpeedDegPerSec),
+    CONFIGURATION_FIELD(doorAccelDegPerSec2),
+    CONFIGURATION_FIELD(isDoorAirflowMapEnabled),
+    CONFIGURATION_FIELD(doorAirflowTable),
+    CONFIGURATION_FIELD(actuatorBlowerDeadbandPWM),
+    CONFIGURATION_FIELD(actuatorBlowerMinDwellMSec),
+    CONFIGURATION_FIELD(actuatorBlowerMaxRatePWMPerSec),
+    CONFIGURATION_FIELD(actuatorDoorDeadbandDeg),
+    CONFIGURATION_FIELD(actuatorDoorMinDwellMSec),
+    CONFIGURATION_FIELD(actuatorDoorMaxRateDegPerSec),
+    CONFIGURATION_FIELD(isLidDetectionEnabled),
+    CONFIGURATION_FIELD(lidOpenRateFPerMin),
+    CONFIGURATION_FIELD(lidCloseRateFPerMin),
+    CONFIGURATION_FIELD(lidMaxOpenMSec),
+    CONFIGURATION_FIELD(lidRecoveryMSec),
+    CONFIGURATION_FIELD(foodFinishTemperatureF),
+    CONFIGURATION_FIELD(isFireDetectionEnabled),
+    CONFIGURATION_FIELD(fireDetectMSec),
+    CONFIGURATION_FIELD(deadlineMissedPeriods),
+    CONFIGURATION_FIELD(failSafeDoorPosition),
+    CONFIGURATION_FIELD(themometerSmokerGain),
+    CONFIGURATION_FIELD(themometerSmokerOffset),
+    CONFIGURATION_FIELD(themometerFoodGain),
+    CONFIGURATION_FIELD(themometerFoodOffset),
+    CONFIGURATION_FIELD(isThemometerSimulated),
+    CONFIGURATION_FIELD(isForcedFanPWM),
+    CONFIGURATION_FIELD(forcedFanPWM),
+    CONFIGURATION_FIELD(isForcedDoorPosition),
+    CONFIGURATION_FIELD(forcedDoorPosition),
+    CONFIGURATION_FIELD(isWiFiEnabled),
+    CONFIGURATION_FIELD(wifiSSID),
+    CONFIGURATION_FIELD(wifiPassword),
+    CONFIGURATION_FIELD(otaPolicy),
+    CONFIGURATION_FIELD(resumeWindowMin),
+    CONFIGURATION_FIELD(isResumeAfterPowerLossEnabled),
+    CONFIGURATION_FIELD(isTemperatureFilterEnabled),
+    CONFIGURATION_FIELD(temperatureFilterCoeff)};
+
+static constexpr size_t CONFIGURATION_FIELD_COUNT = sizeof(CONFIGURATION_FIELDS) / sizeof(CONFIGURATION_FIELDS[0]);
+
+// Each field starts where the previous one ends plus its alignment padding, the last one ends the struct
+static constexpr size_t alignUp(size_t offset, size_t align)
+{
+    return (offset + align - 1) / align * align;
+}
+
+static constexpr bool isFieldTableComplete(size_t index, size_t end)
+{
+    return index == CONFIGURATION_FIELD_COUNT
+               ? alignUp(end, alignof(Configuration)) == sizeof(Configuration)
+               : CONFIGURATION_FIELDS[index].offset == alignUp(end, CONFIGURATION_FIELDS[index].align) &&
+                     isFieldTableComplete(index + 1, CONFIGURATION_FIELDS[index].offset + CONFIGURATION_FIELDS[index].size);
+}
+
+static_assert(CONFIGURATION_FIELD_COUNT <= CONFIGURATION_MAX_FIELDS, "Configuration field table larger than the patch mask");
+static_assert(isFieldTableComplete(0, 0), "Configuration field table does not match the Configuration struct");
+
+ControlChannel::ControlChannel()
+{
+    m_commandQueue = nullptr;
+    m_patchMutex = nullptr;
+    memset(&m_patch, 0, sizeof(m_patch));
+    m_profileMailbox = nullptr;
+    m_configurationPostId = 0;
+    m_appliedConfigurationId = 0;
+    m_receivedConfigurationId = 0;
+}
+
+bool ControlChannel::begin()
+{
+    m_commandQueue = xQueueCreate(CONTROL_COMMAND_QUEUE_LENGTH, sizeof(ControlCommand));
+    m_patchMutex = xSemaphoreCreateMutex();
+    m_profileMailbox = xQueueCreate(1, sizeof(TempProfileTable));
+    if (m_commandQueue == nullptr || m_patchMutex == nullptr || m_profileMailbox == nullptr)
+    {
+        Serial.println("Control channel queues could not be created!");
+        return false;
+    }
+
+    NetworkStatus networkStatus;
+    memset(&networkStatus, 0, sizeof(networkStatus));
+    m_networkStatus.write(networkStatus);
+    return true;
+}
+
+bool ControlChannel::postCommand(ControlCommandType type)
+{
+    ControlCommand command = {type};
+    if (m_commandQueue == nullptr || xQueueSend(m_commandQueue, &command, 0) != pdTRUE)
+    {
+#ifdef DEBUG_CONTROL_CHANNEL
+        DEBUG_PRINTLN("CONTROLCHANNEL::postCommand - Queue full, command " + String(type) + " dropped");
+#endif
+        return false;
+    }
+    return true;
+}
+
+uint32_t ControlChannel::postConfiguration(const Configuration &base, const Configuration &configuration)
+{
+    if (m_patchMutex == nullptr)
+        return 0;
+
+    // Only the fields changed from the base are merged, whole, the fields of other posters stay as posted
+    const uint8_t *baseBytes = reinterpret_cast<const uint8_t *>(&base);
+    const uint8_t *postedBytes = reinterpret_cast<const uint8_t *>(&configuration);
+    uint8_t *values = reinterpret_cast<uint8_t *>(&m_patch.values);
+
+    xSemaphoreTake(m_patchMutex, portMAX_DELAY);
+    for (size_t i = 0; i < CONFIGURATION_FIELD_COUNT; ++i)
+    {
+        const ConfigurationField &field = CONFIGURATION_FIELDS[i];
+        if (memcmp(postedBytes + field.offset, baseBytes + field.offset, field.size) == 0)
+            continue;
+        memcpy(values + field.offset, postedBytes + field.offset, field.size);
+        m_patch.changed[i / 8] |= 1 << (i % 8);
+    }
+    uint32_t id = m_configurationPostId.fetch_add(1) + 1;
+    m_patch.id = id;
+    m_patch.isPending = true;
+    xSemaphoreGive(m_patchMutex);
+    return id;
+}
+
+void ControlChannel::readStatus(ControllerStatus &status) const
+{
+    m_status.read(status);
+
+    NetworkStatus networkStatus;
+    m_networkStatus.read(networkStatus);
+    status.RSSI = networkStatus.RSSI;
+    status.bars = networkStatus.bars;
+    memcpy(status.ipAddress, networkStatus.ipAddress, sizeof(status.ipAddress));
+    status.isWiFiConnected = networkStatus.isWiFiConnected;
+    memcpy(status.networkName, networkStatus.networkName, sizeof(status.networkName));
+}
+
+void ControlChannel::readConfiguration(Configuration &configuration) const
+{
+    m_configuration.read(configuration);
+}
+
+uint32_t ControlChannel::getConfigurationSequence() const
+{
+    return m_configuration.getSequence();
+}
+
+uint32_t ControlChannel::getAppliedConfigurationId() const
+{
+    return m_appliedConfigurationId.load();
+}
+
+void ControlChannel::postProfile(const TempProfileTable &profile)
+{
+    if (m_profileMailbox != nullptr)
+        xQueueOverwrite(m_profileMailbox, &profile);
+}
+
+void ControlChannel::readProfile(TempProfileTable &profile) const
+{
+    m_profile.read(profile);
+}
+
+bool ControlChannel::receiveCommand(ControlCommand &command)
+{
+    return m_commandQueue != nullptr && xQueueReceive(m_commandQueue, &command, 0) == pdTRUE;
+}
+
+bool ControlChannel::receiveConfiguration(Configuration &configuration)
+{
+    // A poster holds the mutex for one merge, a busy patch is picked up on the next pass
+    if (m_patchMutex == nullptr || !m_patch.isPending || xSemaphoreTake(m_patchMutex, 0) != pdTRUE)
+        return false;
+
+    uint8_t *bytes = reinterpret_cast<uint8_t *>(&configuration);
+    const uint8_t *values = reinterpret_cast<const uint8_t *>(&m_patch.values);
+    for (size_t i = 0; i < CONFIGURATION_FIELD_COUNT; ++i)
+    {
+        if (isPatched(i))
+            memcpy(bytes + CONFIGURATION_FIELDS[i].offset, values + CONFIGURATION_FIELDS[i].offset, CONFIGURATION_FIELDS[i].size);
+    }
+    memset(m_patch.changed, 0, sizeof(m_patch.changed));
+    m_patch.isPending = false;
+    m_receivedConfigurationId = m_patch.id;
+    xSemaphoreGive(m_patchMutex);
+
+#ifdef DEBUG_CONTROL_CHANNEL
+    DEBUG_PRINTLN("CONTROLCHANNEL::receiveConfiguration - Applied configuration " + String(m_receivedConfigurationId));
+#endif
+    return true;
+}
+
+bool ControlChannel::isPatched(size_t field) const
+{
+    return (m_patch.changed[field / 8] & (1 << (field % 8))) != 0;
+}
+
+bool ControlChannel::receiveProfile(TempProfileTable &profile)
+{
+    return m_profileMailbox != nullptr && xQueueReceive(m_profileMailbox, &profile, 0) == pdTRUE;
+}
+
+void ControlChannel::publishStatus(const ControllerStatus &status)
+{
+    m_status.write(status);
+}
+
+void ControlChannel::publishConfiguration(const Configuration &configuration)
+{
+    // The id follows the snapshot, a reader seeing it also sees the configuration
+    m_configuration.write(configuration);
+    m_appliedConfigurationId.store(m_receivedConfigurationId);
+}
+
+void ControlChannel::publishProfile(const TempProfileTable &profile)
+{
+    m_profile.write(profile);
+}
+
+void ControlChannel::publishNetworkStatus(const NetworkStatus &networkStatus)
+{
+    m_networkStatus.write(networkStatus);
+}
@@ -0,0 +1,164 @@
+#ifndef CONTROLCHANNEL_H
+#define CONTROLCHANNEL_H
+
+/**
+ * @file controlchannel.h
+ * @brief Lock-free status snapshots and the command channel between the control and UI cores.
+ *
+ * The control loop runs on one core and owns the master ControllerStatus and Configuration. The
+ * GUI, the web server and WiFi run on the other core and never touch them directly:
+ *
+ *   - The control loop publishes the status and the configuration through SeqLock snapshots.
+ *     The writer bumps a sequence number to odd, copies the data and bumps it back to even. A
+ *     reader copies the data and retries when the sequence was odd or changed during the copy,
+ *     so readers never block the writer and never see a torn snapshot.
+ *   - Commands (start, stop, calibration, save) travel to the control loop through a FreeRTOS
+ *     queue. Configuration changes travel as a patch: a poster passes the copy it started from
+ *     and its edited copy, only the fields it changed are merged into the pending patch. Fields
+ *     are compared and copied whole from a table of their offsets and sizes, so a value is never
+ *     made of the bytes of two posts and the padding is never compared. The GUI and the web
+ *     server edit at the same time without reverting each other's fields, a field both changed
+ *     goes to the latest post. The control loop is the single writer of the master
+ *     configuration and applies the patch between two control steps.
+ *   - The profile table is too large to travel with every configuration, it has a one slot
+ *     mailbox and a snapshot of its own.
+ *   - The network fields of the status belong to the WiFi code on the UI core, they are
+ *     published through a snapshot of their own and merged into the status by readStatus().
+ *
+ * Every posted configuration gets an id. Once the control loop has applied and published it,
+ * the id shows up in getAppliedConfigurationId(), so a poster knows when the published
+ * configuration includes its change.
+ */
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "types.h"
+#include "debug.h"
+
+// #define DEBUG_CONTROL_CHANNEL
+
+#define CONTROL_COMMAND_QUEUE_LENGTH 8                                       // Commands waiting for the control loop
+#define CONFIGURATION_MAX_FIELDS 64                                          // Entries of the configuration field table at most
+#define CONFIGURATION_PATCH_MASK_LENGTH ((CONFIGURATION_MAX_FIELDS + 7) / 8) // One bit per configuration field
+
+template <typename T>
+class SeqLock
+{
+public:
+    SeqLock() : m_sequence(0) {}
+
+    // Single writer only
+    void write(const T &value)
+    {
+        uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&m_value, &value, sizeof(T));
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Any number of readers, retries while a write is in progress
+    void read(T &value) const
+    {
+        uint32_t before;
+        uint32_t after;
+        do
+        {
+            before = m_sequence.load(std::memory_order_acquire);
+            memcpy(&value, &m_value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+    }
+
+    uint32_t getSequence() const
+    {
+        return m_sequence.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<uint32_t> m_sequence; // Odd while a write is in progress
+    T m_value;                        // Published value
+};
+
+enum ControlCommandType
+{
+    CONTROL_COMMAND_START,
+    CONTROL_COMMAND_STOP,
+    CONTROL_COMMAND_START_BLOWER_CALIBRATION,
+    CONTROL_COMMAND_STOP_BLOWER_CALIBRATION,
+    CONTROL_COMMAND_SAVE_CONFIGURATION,
+    CONTROL_COMMAND_FACTORY_RESET,
+    CONTROL_COMMAND_RESTART
+};
+
+struct ControlCommand
+{
+    ControlCommandType type; // Command to execute
+};
+
+struct NetworkStatus
+{
+    int RSSI;                                     // Signal strength (dBm)
+    int bars;                                     // Signal bars (0-4)
+    char ipAddress[STATUS_IP_ADDRESS_LENGTH];     // Station IP address
+    bool isWiFiConnected;                         // True while connected to the access point
+    char networkName[STATUS_NETWORK_NAME_LENGTH]; // Connected network SSID
+};
+
+struct ConfigurationPatch
+{
+    uint32_t id;                                      // Id of the last post merged in, see getAppliedConfigurationId()
+    bool isPending;                                   // Posted and not received yet
+    Configuration values;                             // Posted values of the changed fields
+    uint8_t changed[CONFIGURATION_PATCH_MASK_LENGTH]; // Changed fields, one bit each in field table order
+};
+
+class ControlChannel
+{
+public:
+    ControlChannel();
+
+    bool begin();
+
+    // Any task
+    bool postCommand(ControlCommandType type);
+    uint32_t postConfiguration(const Configuration &base, const Configuration &configuration);
+    void readStatus(ControllerStatus &status) const;
+    void readConfiguration(Configuration &configuration) const;
+    uint32_t getConfigurationSequence() const;
+    uint32_t getAppliedConfigurationId() const;
+    void postProfile(const TempProfileTable &profile);
+    void readProfile(TempProfileTable &profile) const;
+
+    // Control loop only
+    bool receiveCommand(ControlCommand &command);
+    bool receiveConfiguration(Configuration &configuration);
+    bool receiveProfile(TempProfileTable &profile);
+    void publishStatus(const ControllerStatus &status);
+    void publishConfiguration(const Configuration &configuration);
+    void publishProfile(const TempProfileTable &profile);
+
+    // WiFi code only
+    void publishNetworkStatus(const NetworkStatus &networkStatus);
+
+private:
+    QueueHandle_t m_commandQueue;                   // Commands for the control loop
+    SemaphoreHandle_t m_patchMutex;                 // Guards the configuration patch
+    ConfigurationPatch m_patch;                     // Configuration changes not received yet
+    QueueHandle_t m_profileMailbox;                 // Latest posted profile table, one slot
+    SeqLock<ControllerStatus> m_status;             // Status published by the control loop
+    SeqLock<Configuration> m_configuration;         // Configuration published by the control loop
+    SeqLock<TempProfileTable> m_profile;            // Profile table published by the control loop
+    SeqLock<NetworkStatus> m_networkStatus;         // Network status published by the WiFi code
+    std::atomic<uint32_t> m_configurationPostId;    // Id of the last posted configuration
+    std::atomic<uint32_t> m_appliedConfigurationId; // Id of the last published configuration post
+    uint32_t m_receivedConfigurationId;             // Id of the last received configuration post
+
+    bool isPatched(size_t field) const;
+};
+
+#endif // CONTROLCHANNEL_H
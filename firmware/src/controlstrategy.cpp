@@ -0,0 +1,164 @@
+#include "controlstrategy.h"
+
+// ========================================== PID ==========================================================
+
+static PID s_pid(DEFAULT_PID_KP, DEFAULT_PID_KI, DEFAULT_PID_KD, 0); // Interval is enforced by the controller
+
+static const ControlParameter PID_PARAMETERS[] = {
+    {"kP", "PID kP", CONTROL_PARAMETER_FLOAT, offsetof(Configuration, kP), DEFAULT_PID_KP, PID_GAIN_MIN, PID_GAIN_MAX, PID_GAIN_STEP, PID_GAIN_DECIMAL_PLACES},
+    {"kI", "PID kI", CONTROL_PARAMETER_FLOAT, offsetof(Configuration, kI), DEFAULT_PID_KI, PID_GAIN_MIN, PID_GAIN_MAX, PID_GAIN_STEP, PID_GAIN_DECIMAL_PLACES},
+    {"kD", "PID kD", CONTROL_PARAMETER_FLOAT, offsetof(Configuration, kD), DEFAULT_PID_KD, PID_GAIN_MIN, PID_GAIN_MAX, PID_GAIN_STEP, PID_GAIN_DECIMAL_PLACES}};
+
+static void resetPID(const Configuration &config)
+{
+    s_pid.setKp(config.kP);
+    s_pid.setKi(config.kI);
+    s_pid.setKd(config.kD);
+    s_pid.enable(); // Clears the integral and the derivative history
+    s_pid.setIntegralFrozen(false);
+}
+
+static ControlOutput servicePID(const Configuration &config, int currentTempF, int targetTempF, ulong currentTimeMSec)
+{
+    ControlOutput result;
+
+    // Pick up edited gains
+    s_pid.setKp(config.kP);
+    s_pid.setKi(config.kI);
+    s_pid.setKd(config.kD);
+
+    // Call the PID service to calculate the control output
+    int controlOutput = s_pid.service(currentTempF, targetTempF, currentTimeMSec);
+    result.output = controlOutput;
+
+#ifdef DEBUG_CONTROL_STRATEGY
+    DEBUG_PRINTLN("CS::PID - CONTROL: " + String(controlOutput));
+#endif
+
+    // Heat with the blower and an open door, otherwise starve the fire
+    if (controlOutput > 0)
+    {
+        result.blowerAirflow = constrain(controlOutput, 0, 255);
+        result.doorAirflow = DOOR_AIRFLOW_OPEN;
+    }
+    else
+    {
+        result.blowerAirflow = 0;
+        result.doorAirflow = DOOR_AIRFLOW_CLOSED;
+    }
+
+    return result;
+}
+
+static void freezePIDIntegrator(bool isFrozen)
+{
+    s_pid.setIntegralFrozen(isFrozen);
+}
+
+static float getPIDIntegrator()
+{
+    return s_pid.getIntegral();
+}
+
+static void setPIDIntegrator(float integrator)
+{
+    s_pid.setIntegral(integrator);
+}
+
+// ========================================== BANG-BANG ====================================================
+
+static BangBang s_bangBang(DEFAULT_BANG_BANG_THRESHOLD_LOW, DEFAULT_BANG_BANG_THRESHOLD_HIGH, DEFAULT_BANG_BANG_HYSTERESIS);
+
+static const ControlParameter BANG_BANG_PARAMETERS[] = {
+    {"bangBangLowThreshold", "BangBang Low", CONTROL_PARAMETER_INT, offsetof(Configuration, bangBangLowThreshold), DEFAULT_BANG_BANG_THRESHOLD_LOW, BANG_BANG_THRESHOLD_MIN, BANG_BANG_THRESHOLD_MAX, 1, 0},
+    {"bangBangHighThreshold", "BangBang High", CONTROL_PARAMETER_INT, offsetof(Configuration, bangBangHighThreshold), DEFAULT_BANG_BANG_THRESHOLD_HIGH, BANG_BANG_THRESHOLD_MIN, BANG_BANG_THRESHOLD_MAX, 1, 0},
+    {"bangBangHysteresis", "BangBang Hyst", CONTROL_PARAMETER_INT, offsetof(Configuration, bangBangHysteresis), DEFAULT_BANG_BANG_HYSTERESIS, BANG_BANG_HYSTERESIS_MIN, BANG_BANG_HYSTERESIS_MAX, 1, 0},
+    {"bangBangFanSpeed", "BangBang Fan PWM", CONTROL_PARAMETER_INT, offsetof(Configuration, bangBangFanSpeed), DEFAULT_BANG_BANG_FAN_SPEED, 0, 255, 5, 0}};
+
+static void resetBangBang(const Configuration &config)
+{
+    s_bangBang.setThresholds(config.bangBangLowThreshold, config.bangBangHighThreshold);
+    s_bangBang.setHysteresis(config.bangBangHysteresis);
+}
+
+static ControlOutput serviceBangBang(const Configuration &config, int currentTempF, int targetTempF, ulong currentTimeMSec)
+{
+    ControlOutput result = {0, 0, DOOR_AIRFLOW_OPEN};
+
+    // Pick up edited thresholds
+    s_bangBang.setThresholds(config.bangBangLowThreshold, config.bangBangHighThreshold);
+    s_bangBang.setHysteresis(config.bangBangHysteresis);
+
+    BangBangState controlOutput = s_bangBang.service(currentTempF, currentTimeMSec);
+    result.output = static_cast<int>(controlOutput);
+
+    switch (controlOutput)
+    {
+    case BANGBANG_STATE_IDLE:
+        // If the state is IDLE, stop the blower and keep the door open
+        result.blowerAirflow = 0;
+        result.doorAirflow = DOOR_AIRFLOW_OPEN;
+        break;
+    case BANGBANG_STATE_HEAT:
+        // If the state is HEAT, start the blower and open the door
+        result.blowerAirflow = config.bangBangFanSpeed;
+        result.doorAirflow = DOOR_AIRFLOW_OPEN;
+        break;
+    case BANGBANG_STATE_COOL:
+        // If the state is COOL, stop the blower and close the door
+        result.blowerAirflow = 0;
+        result.doorAirflow = DOOR_AIRFLOW_CLOSED;
+        break;
+    default:
+        break;
+    }
+
+    return result;
+}
+
+// ========================================== REGISTRY =====================================================
+
+#define CONTROL_PARAMETER_COUNT(list) static_cast<uint8_t>(sizeof(list) / sizeof(list[0]))
+
+// Indexed by ControlAlgorithm
+const ControlStrategy CONTROL_STRATEGIES[CONTROL_ALGORITHM_COUNT] = {
+    {"BangBang", BANG_BANG_PARAMETERS, CONTROL_PARAMETER_COUNT(BANG_BANG_PARAMETERS), resetBangBang, serviceBangBang, nullptr, nullptr, nullptr},
+    {"PID", PID_PARAMETERS, CONTROL_PARAMETER_COUNT(PID_PARAMETERS), resetPID, servicePID, freezePIDIntegrator, getPIDIntegrator, setPIDIntegrator}};
+
+const ControlStrategy &getControlStrategy(ControlAlgorithm algorithm)
+{
+    // Fall back to PID if the configuration holds an unknown algorithm
+    if (algorithm >= CONTROL_ALGORITHM_COUNT)
+        algorithm = CONTROL_PID;
+    return CONTROL_STRATEGIES[algorithm];
+}
+
+float getControlParameter(const Configuration &config, const ControlParameter &parameter)
+{
+    const uint8_t *field = reinterpret_cast<const uint8_t *>(&config) + parameter.offset;
+    if (parameter.type == CONTROL_PARAMETER_FLOAT)
+        return *reinterpret_cast<const float *>(field);
+    return static_cast<float>(*reinterpret_cast<const int *>(field));
+}
+
+void setControlParameter(Configuration &config, const ControlParameter &parameter, float value)
+{
+    uint8_t *field = reinterpret_cast<uint8_t *>(&config) + parameter.offset;
+    value = constrain(value, parameter.minValue, parameter.maxValue);
+    if (parameter.type == CONTROL_PARAMETER_FLOAT)
+        *reinterpret_cast<float *>(field) = value;
+    else
+        *reinterpret_cast<int *>(field) = static_cast<int>(lroundf(value));
+}
+
+void loadDefaultControlParameters(Configuration &config)
+{
+    for (int i = 0; i < CONTROL_ALGORITHM_COUNT; ++i)
+    {
+        const ControlStrategy &strategy = CONTROL_STRATEGIES[i];
+        for (int j = 0; j < strategy.parameterCount; ++j)
+        {
+            setControlParameter(config, strategy.parameters[j], strategy.parameters[j].defaultValue);
+        }
+    }
+}
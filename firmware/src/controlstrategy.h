@@ -0,0 +1,96 @@
+#ifndef CONTROL_STRATEGY_H
+#define CONTROL_STRATEGY_H
+
+/**
+ * @file controlstrategy.h
+ * @brief Compile-time registry of the temperature control strategies.
+ *
+ * Every control algorithm is described by a ControlStrategy entry in CONTROL_STRATEGIES, indexed
+ * by the ControlAlgorithm enum stored in the configuration. An entry holds the function pointers
+ * the TemperatureController dispatches through on every control tick, and the list of parameters
+ * the strategy reads from the Configuration.
+ *
+ * The parameter descriptors are the single source of truth for the strategy settings: the
+ * defaults written to NVRAM, the keys served and accepted by /config and the rows of the GUI
+ * settings table are all generated from them. Adding an algorithm means adding an enum value,
+ * its parameters to the Configuration and one entry to the registry.
+ */
+
+#include <Arduino.h>
+#include <stddef.h>
+#include "types.h"
+#include "pid.h"
+#include "bangbang.h"
+
+// #define DEBUG_CONTROL_STRATEGY
+
+// PID parameters
+#define DEFAULT_PID_KP 4.0
+#define DEFAULT_PID_KI 0.0
+#define DEFAULT_PID_KD 1.0
+#define PID_GAIN_MIN 0.0f
+#define PID_GAIN_MAX 10.0f
+#define PID_GAIN_STEP 0.1f
+#define PID_GAIN_DECIMAL_PLACES 2
+
+// Bang-Bang parameters
+#define DEFAULT_BANG_BANG_THRESHOLD_HIGH 260
+#define DEFAULT_BANG_BANG_THRESHOLD_LOW 240
+#define DEFAULT_BANG_BANG_HYSTERESIS 5
+#define DEFAULT_BANG_BANG_FAN_SPEED 255
+#define BANG_BANG_THRESHOLD_MIN 100
+#define BANG_BANG_THRESHOLD_MAX 500
+#define BANG_BANG_HYSTERESIS_MIN 1
+#define BANG_BANG_HYSTERESIS_MAX 50
+
+// Door demands at the ends of the travel
+#define DOOR_AIRFLOW_CLOSED 0
+#define DOOR_AIRFLOW_OPEN 255
+
+// Actuator demand produced by a control strategy on each tick
+struct ControlOutput
+{
+    int output;        // Raw controller output, reported as the temperature error in the status
+    int blowerAirflow; // Demanded blower airflow (0-255), mapped to a PWM by the actuator layer
+    int doorAirflow;   // Demanded door airflow (0 closed - 255 open), mapped to a position by the actuator layer
+};
+
+enum ControlParameterType
+{
+    CONTROL_PARAMETER_INT,
+    CONTROL_PARAMETER_FLOAT
+};
+
+struct ControlParameter
+{
+    const char *key;           // JSON key used by /config
+    const char *label;         // Label used in the GUI settings table
+    ControlParameterType type; // Type of the field in the Configuration
+    size_t offset;             // Offset of the field in the Configuration
+    float defaultValue;        // Value loaded with the default configuration
+    float minValue;            // Lowest accepted value
+    float maxValue;            // Highest accepted value
+    float step;                // GUI increment
+    uint8_t decimalPlaces;     // Decimal places shown in the GUI
+};
+
+struct ControlStrategy
+{
+    const char *name;                   // Name displayed in the GUI
+    const ControlParameter *parameters; // Parameters the strategy reads from the Configuration
+    uint8_t parameterCount;             // Number of entries in parameters
+    void (*reset)(const Configuration &config);
+    ControlOutput (*service)(const Configuration &config, int currentTempF, int targetTempF, ulong currentTimeMSec);
+    void (*freezeIntegrator)(bool isFrozen); // Optional, nullptr for strategies without integral action
+    float (*getIntegrator)();                // Optional, checkpointed with the run state
+    void (*setIntegrator)(float integrator); // Optional, restored when a run resumes
+};
+
+extern const ControlStrategy CONTROL_STRATEGIES[CONTROL_ALGORITHM_COUNT];
+
+const ControlStrategy &getControlStrategy(ControlAlgorithm algorithm);
+float getControlParameter(const Configuration &config, const ControlParameter &parameter);
+void setControlParameter(Configuration &config, const ControlParameter &parameter, float value);
+void loadDefaultControlParameters(Configuration &config);
+
+#endif // CONTROL_STRATEGY_H
@@ -0,0 +1,143 @@
+#include "cookpredictor.h"
+#include <math.h>
+
+// Spacing of the samples in the regression, in hours
+static const double SAMPLE_SPACING_HOURS = COOK_PREDICTOR_SAMPLE_INTERVAL_MSEC / 3600000.0;
+
+CookPredictor::CookPredictor()
+    : m_finishTempF(DEFAULT_FOOD_FINISH_TEMPERATURE_F)
+{
+    reset();
+}
+
+void CookPredictor::reset()
+{
+    m_head = 0;
+    m_count = 0;
+    m_sumT = 0.0;
+    m_sumTT = 0.0;
+    m_sumY = 0.0;
+    m_sumTY = 0.0;
+    m_sumYY = 0.0;
+    m_accumulatorF = 0.0f;
+    m_accumulatorCount = 0;
+    m_sampleStartMSec = 0;
+    m_prediction = {false, false, false, 0.0f, -1, -1, -1};
+}
+
+void CookPredictor::setFinishTemperature(int finishTempF)
+{
+    m_finishTempF = finishTempF;
+}
+
+void CookPredictor::update(int foodTempF, ulong currentTimeMSec)
+{
+    if (m_accumulatorCount == 0)
+    {
+        m_sampleStartMSec = currentTimeMSec;
+    }
+
+    // Average the readings over the sample interval
+    m_accumulatorF += foodTempF;
+    m_accumulatorCount++;
+    if (currentTimeMSec - m_sampleStartMSec < COOK_PREDICTOR_SAMPLE_INTERVAL_MSEC)
+        return;
+
+    addSample(m_accumulatorF / m_accumulatorCount);
+    m_accumulatorF = 0.0f;
+    m_accumulatorCount = 0;
+
+    predict();
+}
+
+void CookPredictor::addSample(float temperatureF)
+{
+    if (m_count == COOK_PREDICTOR_WINDOW_SAMPLES)
+    {
+        // Drop the oldest sample (t = 0) and move the time origin to the next one
+        float oldest = m_samples[m_head];
+        m_sumY -= oldest;
+        m_sumYY -= static_cast<double>(oldest) * oldest;
+        m_head = (m_head + 1) % COOK_PREDICTOR_WINDOW_SAMPLES;
+        m_count--;
+        shiftTime(SAMPLE_SPACING_HOURS);
+    }
+
+    double t = m_count * SAMPLE_SPACING_HOURS;
+    m_samples[(m_head + m_count) % COOK_PREDICTOR_WINDOW_SAMPLES] = temperatureF;
+    m_count++;
+    m_sumT += t;
+    m_sumTT += t * t;
+    m_sumY += temperatureF;
+    m_sumTY += t * temperatureF;
+    m_sumYY += static_cast<double>(temperatureF) * temperatureF;
+}
+
+void CookPredictor::shiftTime(double deltaT)
+{
+    // Rewrite the sums for t' = t - deltaT without touching the samples
+    double n = static_cast<double>(m_count);
+    m_sumTT += -2.0 * deltaT * m_sumT + n * deltaT * deltaT;
+    m_sumTY -= deltaT * m_sumY;
+    m_sumT -= n * deltaT;
+}
+
+void CookPredictor::predict()
+{
+    CookPrediction &p = m_prediction;
+    float lastTempF = m_samples[(m_head + m_count - 1) % COOK_PREDICTOR_WINDOW_SAMPLES];
+
+    p.isDone = lastTempF >= m_finishTempF;
+    p.isValid = m_count >= COOK_PREDICTOR_MIN_SAMPLES;
+    p.etaSec = -1;
+    p.etaLowSec = -1;
+    p.etaHighSec = -1;
+    if (!p.isValid)
+    {
+        p.isStalled = false;
+        p.rateFPerHour = 0.0f;
+        return;
+    }
+
+    double n = static_cast<double>(m_count);
+    double meanT = m_sumT / n;
+    double meanY = m_sumY / n;
+    double sxx = m_sumTT - m_sumT * meanT;
+    double sxy = m_sumTY - m_sumT * meanY;
+    double slope = sxy / sxx;
+    double sse = max(0.0, (m_sumYY - m_sumY * meanY) - slope * sxy);
+    double slopeError = sqrt(sse / (n - 2.0) / sxx);
+
+    p.rateFPerHour = static_cast<float>(slope);
+    p.isStalled = !p.isDone && lastTempF >= COOK_PREDICTOR_STALL_MIN_TEMP_F && slope <= COOK_PREDICTOR_STALL_RATE_F_PER_HOUR;
+
+    if (p.isDone)
+    {
+        p.etaSec = 0;
+        p.etaLowSec = 0;
+        p.etaHighSec = 0;
+    }
+    else if (!p.isStalled && slope >= COOK_PREDICTOR_MIN_RATE_F_PER_HOUR)
+    {
+        // Remaining rise from the fitted value at the last sample
+        double fittedF = meanY + slope * ((n - 1.0) * SAMPLE_SPACING_HOURS - meanT);
+        double remainingF = max(0.0, m_finishTempF - fittedF);
+        double fastSlope = slope + 2.0 * slopeError;
+        double slowSlope = slope - 2.0 * slopeError;
+
+        p.etaSec = min(static_cast<long>(remainingF / slope * 3600.0), COOK_PREDICTOR_MAX_ETA_SEC);
+        p.etaLowSec = min(static_cast<long>(remainingF / fastSlope * 3600.0), COOK_PREDICTOR_MAX_ETA_SEC);
+        if (slowSlope >= COOK_PREDICTOR_MIN_RATE_F_PER_HOUR)
+            p.etaHighSec = min(static_cast<long>(remainingF / slowSlope * 3600.0), COOK_PREDICTOR_MAX_ETA_SEC);
+    }
+
+#ifdef DEBUG_COOK_PREDICTOR
+    DEBUG_PRINTLN("COOK::predict - rate=" + String(p.rateFPerHour, 2) + " F/h stalled=" + String(p.isStalled) +
+                  " eta=" + String(p.etaSec) + " [" + String(p.etaLowSec) + ", " + String(p.etaHighSec) + "]");
+#endif
+}
+
+const CookPrediction &CookPredictor::getPrediction() const
+{
+    return m_prediction;
+}
@@ -0,0 +1,80 @@
+#ifndef COOK_PREDICTOR_H
+#define COOK_PREDICTOR_H
+
+/**
+ * @file cookpredictor.h
+ * @brief Food stall detection and completion time prediction.
+ *
+ * Food temperature readings are averaged into one sample per COOK_PREDICTOR_SAMPLE_INTERVAL_MSEC
+ * and kept in a fixed-size sliding window. A straight line is fitted to the window by least
+ * squares, maintained from running sums so adding a sample and dropping the oldest one is O(1):
+ *
+ *     Sxx   = Sum(t^2) - Sum(t)^2 / n
+ *     slope = (Sum(t * y) - Sum(t) * Sum(y) / n) / Sxx
+ *     s^2   = (Sum(y^2) - n * mean(y)^2 - slope^2 * Sxx) / (n - 2)
+ *     se    = sqrt(s^2 / Sxx)
+ *
+ * where t is in hours and y in F. A slope below COOK_PREDICTOR_STALL_RATE_F_PER_HOUR while the
+ * food is in the collagen range is reported as a stall. Otherwise the time to the finish
+ * temperature is the remaining rise divided by the slope, and the band uses slope -/+ 2 * se.
+ * Sample times are kept relative to the oldest sample in the window so the sums stay small.
+ */
+
+#include <Arduino.h>
+#include "types.h"
+#include "debug.h"
+
+// #define DEBUG_COOK_PREDICTOR
+
+#define DEFAULT_FOOD_FINISH_TEMPERATURE_F 203
+#define COOK_PREDICTOR_SAMPLE_INTERVAL_MSEC 60000UL // One averaged sample per minute
+#define COOK_PREDICTOR_WINDOW_SAMPLES 45            // Regression window (45 minutes)
+#define COOK_PREDICTOR_MIN_SAMPLES 10               // Samples needed before a prediction is made
+#define COOK_PREDICTOR_STALL_RATE_F_PER_HOUR 3.0f   // Rise rate at or below which the food is stalled
+#define COOK_PREDICTOR_STALL_MIN_TEMP_F 140         // Stalls only happen once the food is this hot
+#define COOK_PREDICTOR_MIN_RATE_F_PER_HOUR 0.5f     // Slower rates give no usable completion time
+#define COOK_PREDICTOR_MAX_ETA_SEC (24L * 3600L)    // Longest completion time reported
+
+struct CookPrediction
+{
+    bool isValid;       // True when enough samples have been collected
+    bool isStalled;     // Food temperature on a plateau
+    bool isDone;        // Finish temperature reached
+    float rateFPerHour; // Fitted rise rate
+    long etaSec;        // Time to the finish temperature, -1 when unknown
+    long etaLowSec;     // Early end of the band, -1 when unknown
+    long etaHighSec;    // Late end of the band, -1 when unbounded
+};
+
+class CookPredictor
+{
+private:
+    float m_samples[COOK_PREDICTOR_WINDOW_SAMPLES]; // Averaged food temperatures
+    uint m_head;                                    // Index of the oldest sample
+    uint m_count;                                   // Samples in the window
+    double m_sumT;                                  // Sum of the sample times (hours)
+    double m_sumTT;                                 // Sum of the squared sample times
+    double m_sumY;                                  // Sum of the temperatures
+    double m_sumTY;                                 // Sum of time * temperature
+    double m_sumYY;                                 // Sum of the squared temperatures
+
+    float m_accumulatorF;        // Sum of the readings of the sample being averaged
+    uint m_accumulatorCount;     // Readings in the sample being averaged
+    ulong m_sampleStartMSec;     // Start of the sample being averaged
+    int m_finishTempF;           // Finish temperature
+    CookPrediction m_prediction; // Last prediction
+
+    void addSample(float temperatureF);
+    void shiftTime(double deltaT);
+    void predict();
+
+public:
+    CookPredictor();
+
+    void reset();
+    void setFinishTemperature(int finishTempF);
+    void update(int foodTempF, ulong currentTimeMSec);
+    const CookPrediction &getPrediction() const;
+};
+
+#endif // COOK_PREDICTOR_H
@@ -0,0 +1,110 @@
+#include "deadlinemonitor.h"
+
+DeadlineMonitor::DeadlineMonitor(Scheduler &scheduler, Blower &blower, Door &door)
+    : m_scheduler(scheduler), m_blower(blower), m_door(door), m_timer(nullptr)
+{
+    m_lastKickUSec = 0;
+    m_periodUSec = 10000;
+    m_deadlineUSec = DEFAULT_DEADLINE_MISSED_PERIODS * m_periodUSec;
+    m_safeDoorTenths = 0;
+    m_isFailSafe = false;
+    m_tripCount = 0;
+    m_onTimeChecks = 0;
+    m_lastMiss = {nullptr, 0, 0};
+    m_mux = portMUX_INITIALIZER_UNLOCKED;
+}
+
+bool DeadlineMonitor::begin()
+{
+    m_lastKickUSec = micros();
+
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &DeadlineMonitor::timerCallback;
+    timerArgs.arg = this;
+    timerArgs.name = "deadline";
+    if (esp_timer_create(&timerArgs, &m_timer) != ESP_OK ||
+        esp_timer_start_periodic(m_timer, DEADLINE_MONITOR_CHECK_USEC) != ESP_OK)
+    {
+        Serial.println("Deadline monitor timer could not be started!");
+        return false;
+    }
+    return true;
+}
+
+void DeadlineMonitor::setParameters(ulong periodMSec, uint missedPeriods, int safeDoorTenths)
+{
+    missedPeriods = constrain(missedPeriods, DEADLINE_MISSED_PERIODS_MIN, DEADLINE_MISSED_PERIODS_MAX);
+    m_periodUSec = max(1UL, periodMSec) * 1000;
+    m_deadlineUSec = missedPeriods * m_periodUSec;
+    m_safeDoorTenths = safeDoorTenths;
+}
+
+void DeadlineMonitor::kick()
+{
+    m_lastKickUSec = micros();
+}
+
+bool DeadlineMonitor::isFailSafe() const
+{
+    return m_isFailSafe;
+}
+
+uint32_t DeadlineMonitor::getTripCount() const
+{
+    return m_tripCount;
+}
+
+void DeadlineMonitor::getLastMiss(DeadlineMiss &miss) const
+{
+    portENTER_CRITICAL(&m_mux);
+    miss = m_lastMiss;
+    portEXIT_CRITICAL(&m_mux);
+}
+
+void DeadlineMonitor::timerCallback(void *arg)
+{
+    static_cast<DeadlineMonitor *>(arg)->check();
+}
+
+void DeadlineMonitor::check()
+{
+    uint32_t sinceKickUSec = micros() - m_lastKickUSec;
+
+    if (!m_isFailSafe)
+    {
+        if (sinceKickUSec < m_deadlineUSec)
+            return;
+
+        // The loop missed its deadline, take the actuators to the fail-safe state
+        portENTER_CRITICAL(&m_mux);
+        m_lastMiss.taskName = m_scheduler.getRunningTaskName();
+        m_lastMiss.startMSec = millis() - sinceKickUSec / 1000;
+        m_lastMiss.stallMSec = sinceKickUSec / 1000;
+        portEXIT_CRITICAL(&m_mux);
+
+        m_onTimeChecks = 0;
+        m_tripCount++;
+        m_isFailSafe = true;
+        applyFailSafe();
+        return;
+    }
+
+    // Track the stall until the loop is back, the actuators stay in the fail-safe state meanwhile
+    portENTER_CRITICAL(&m_mux);
+    m_lastMiss.stallMSec = max(m_lastMiss.stallMSec, static_cast<ulong>(sinceKickUSec / 1000));
+    portEXIT_CRITICAL(&m_mux);
+    applyFailSafe();
+
+    m_onTimeChecks = sinceKickUSec <= m_periodUSec ? m_onTimeChecks + 1 : 0;
+    if (m_onTimeChecks >= DEADLINE_MONITOR_RECOVERY_CHECKS)
+    {
+        m_isFailSafe = false; // The control loop resends its demands on its next actuator pass
+    }
+}
+
+void DeadlineMonitor::applyFailSafe()
+{
+    // Repeated on every check, both setters return early once the demand is in place
+    m_blower.setPWM(0);
+    m_door.setPositionTenths(m_safeDoorTenths);
+}
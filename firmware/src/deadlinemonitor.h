@@ -0,0 +1,81 @@
+#ifndef DEADLINEMONITOR_H
+#define DEADLINEMONITOR_H
+
+/**
+ * @file deadlinemonitor.h
+ * @brief Control loop deadline monitor that puts the actuators in a fail-safe state on a stall.
+ *
+ * The control loop kicks the monitor once per scheduler pass. An esp_timer checks the time since
+ * the last kick every DEADLINE_MONITOR_CHECK_USEC, independent of the loop. When the loop has
+ * missed the configured number of control periods the monitor trips:
+ *
+ *   - the blower demand is set to 0 and the door is sent to the safe position. Both drivers are
+ *     stepped by their own timers, so the outputs reach the fail-safe state while the loop hangs,
+ *   - the scheduler task running at the time of the trip and the stall duration are recorded.
+ *
+ * The monitor leaves the fail-safe state once the loop has kicked on time for
+ * DEADLINE_MONITOR_RECOVERY_CHECKS consecutive checks. The control loop holds its actuator
+ * commands while isFailSafe() is true and resends them on recovery, so normal control resumes
+ * from the latest demands.
+ *
+ * The check runs in the esp_timer task, a stall of that task (a blocking timer callback) stops
+ * the blower and door timers as well and is not detected here.
+ */
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include "blower.h"
+#include "door.h"
+#include "scheduler.h"
+#include "debug.h"
+
+// #define DEBUG_DEADLINE_MONITOR
+
+#define DEADLINE_MONITOR_CHECK_USEC 10000   // Check interval (10 ms)
+#define DEADLINE_MONITOR_RECOVERY_CHECKS 10 // Consecutive on time checks before the fail-safe is released
+#define DEFAULT_DEADLINE_MISSED_PERIODS 25  // Missed control periods before the fail-safe trips
+#define DEADLINE_MISSED_PERIODS_MIN 2       // Shortest accepted deadline (periods)
+#define DEADLINE_MISSED_PERIODS_MAX 1000    // Longest accepted deadline (periods)
+
+struct DeadlineMiss
+{
+    const char *taskName; // Scheduler task running at the trip, nullptr between two tasks
+    ulong startMSec;      // Time of the last kick before the stall
+    ulong stallMSec;      // Longest time without a kick during the stall
+};
+
+class DeadlineMonitor
+{
+public:
+    DeadlineMonitor(Scheduler &scheduler, Blower &blower, Door &door);
+
+    bool begin();
+    void setParameters(ulong periodMSec, uint missedPeriods, int safeDoorTenths);
+    void kick();
+
+    bool isFailSafe() const;
+    uint32_t getTripCount() const;
+    void getLastMiss(DeadlineMiss &miss) const;
+
+private:
+    Scheduler &m_scheduler;           // Reports the task running at a trip
+    Blower &m_blower;                 // Stopped on a trip
+    Door &m_door;                     // Sent to the safe position on a trip
+    esp_timer_handle_t m_timer;       // Check timer
+    volatile uint32_t m_lastKickUSec; // Time of the last kick
+    volatile uint32_t m_deadlineUSec; // Time without a kick that trips the fail-safe
+    volatile uint32_t m_periodUSec;   // Control period, a kick within it counts as on time
+    volatile int m_safeDoorTenths;    // Door position held in the fail-safe state
+    volatile bool m_isFailSafe;       // True while the fail-safe state is active
+    volatile uint32_t m_tripCount;    // Trips since boot
+    uint m_onTimeChecks;              // Consecutive on time checks in the fail-safe state
+    DeadlineMiss m_lastMiss;          // Last recorded stall
+    mutable portMUX_TYPE m_mux;       // Guards the last recorded stall
+
+    static void timerCallback(void *arg);
+    void check();
+    void applyFailSafe();
+};
+
+#endif // DEADLINEMONITOR_H
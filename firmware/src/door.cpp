@@ -1,60 +1,117 @@
 #include "door.h"
 
-Door::Door(uint8_t pin, uint closedPos, uint openPos, ulong stepMoveTimeMSec)
+// Profile step in seconds
+static const float DOOR_STEP_TIME_SEC = DOOR_STEP_TIME_USEC / 1000000.0f;
+
+Door::Door(uint8_t pin, uint closedPos, uint openPos)
     : m_pin(pin),
       m_closedPosition(closedPos),
       m_openPosition(openPos),
-      m_currentPosition(0),
-      m_demandedPosition(0),
-      m_state(DOOR_IDLE),
-      m_stepMoveTimeMSec(stepMoveTimeMSec)
+      m_state(DOOR_IDLE)
 {
     m_prevState = m_state;
-    m_lastSetPositionTimeMSec = 0; // Initialize last set position time
+    m_position = 0.0f;
+    m_velocity = 0.0f;
+    m_targetPosition = 0.0f;
+    m_maxSpeed = DEFAULT_DOOR_MAX_SPEED_DEG_PER_SEC * 10.0f;
+    m_acceleration = DEFAULT_DOOR_ACCEL_DEG_PER_SEC2 * 10.0f;
+    m_stopTimeMSec = 0;
+    m_isPulsing = false;
+    m_timer = nullptr;
 }
 
 void Door::begin()
 {
-    m_servo.attach(m_pin, DOOR_SERVO_MIN_PULSE_WIDTH, DOOR_SERVO_MAX_PULSE_WIDTH); // Attach servo with min and max pulse width
-    m_servo.write(0);
-    m_state = DOOR_STOPPED; // Start in stopped state
-    delay(500);             // Allow servo to initialize
-    m_servo.detach();       // Detach servo to allow it to initialize properly
+    ledcSetup(DOOR_LEDC_CHANNEL, 1000000 / DOOR_SERVO_FRAME_USEC, DOOR_LEDC_RESOLUTION);
+    ledcAttachPin(m_pin, DOOR_LEDC_CHANNEL);
+    writePulse(0.0f);
+    m_state = DOOR_STOPPED;          // Start in stopped state
+    delay(500);                      // Allow servo to initialize
+    ledcWrite(DOOR_LEDC_CHANNEL, 0); // Stop the pulses, the servo holds by friction
+
+    const esp_timer_create_args_t timerArgs = {
+        .callback = &Door::timerCallback,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "door",
+        .skip_unhandled_events = true};
+    if (esp_timer_create(&timerArgs, &m_timer) != ESP_OK ||
+        esp_timer_start_periodic(m_timer, DOOR_STEP_TIME_USEC) != ESP_OK)
+    {
+        Serial.println("Door timer could not be started!");
+    }
 }
 
-void Door::service(ulong currentTimeMSec)
+void Door::writePulse(float tenths)
 {
+    // Pulse width for the angle, then the duty over one 20 ms frame
+    float pulseWidthUSec = DOOR_SERVO_MIN_PULSE_WIDTH +
+                           tenths * (DOOR_SERVO_MAX_PULSE_WIDTH - DOOR_SERVO_MIN_PULSE_WIDTH) / DOOR_SERVO_MAX_ANGLE_TENTHS;
+    uint32_t duty = static_cast<uint32_t>(pulseWidthUSec * ((1UL << DOOR_LEDC_RESOLUTION) - 1) / DOOR_SERVO_FRAME_USEC + 0.5f);
+    ledcWrite(DOOR_LEDC_CHANNEL, duty);
+}
 
-    switch (m_state)
-    {
-    case DOOR_IDLE:
+void Door::timerCallback(void *arg)
+{
+    static_cast<Door *>(arg)->step();
+}
 
-        break;
-    case DOOR_STOPPED:
-        // Chill here until a position is set
-        break;
+void Door::step()
+{
+    // Runs in the esp_timer task, the pulses are enabled by setPosition() before a move starts
+    if (m_state != DOOR_MOVING)
+        return;
 
-    case DOOR_STARTING:
-        m_startMoveTimeMSec = currentTimeMSec; // Record the start time
-#ifdef DOOR_DEBUG
-        DEBUG_PRINTLN("DOOR::service - Starting move to position: " + String(m_demandedPosition));
-#endif
-        m_servo.write(m_demandedPosition); // Set the servo to the demanded position
-        m_state = DOOR_MOVING;             // Set state to moving
-        break;
+    float position = m_position;
+    float velocity = m_velocity;
+    float distance = m_targetPosition - position;
+    float direction = distance >= 0.0f ? 1.0f : -1.0f;
+    float accelStep = m_acceleration * DOOR_STEP_TIME_SEC;
 
-    case DOOR_MOVING:
-        if (currentTimeMSec - m_startMoveTimeMSec >= m_traveTimeMsec)
-        {
-            // Movement is complete
-            m_currentPosition = m_demandedPosition; // Update current position
-            m_state = DOOR_STOPPED;                 // Set state to stopped
-            m_servo.detach();                       // Detach servo to stop it from moving
-        }
-        break;
-
-    default:
-        break;
+    // Arrived, the remaining distance is covered within one step at the current speed
+    if (fabsf(distance) <= max(DOOR_POSITION_TOLERANCE_TENTHS, fabsf(velocity) * DOOR_STEP_TIME_SEC) &&
+        fabsf(velocity) <= accelStep * 2.0f)
+    {
+        m_position = m_targetPosition;
+        m_velocity = 0.0f;
+        writePulse(m_position);
+        m_state = DOOR_STOPPED;
+        return;
+    }
+
+    // Brake when heading away from the target or when the stopping distance reaches it
+    float stoppingDistance = velocity * velocity / (2.0f * m_acceleration);
+    bool isHeadingToTarget = velocity * direction > 0.0f;
+    if (!isHeadingToTarget && velocity != 0.0f)
+        velocity += direction * accelStep; // Turn around
+    else if (stoppingDistance >= fabsf(distance))
+        velocity -= direction * accelStep; // Decelerate onto the target
+    else
+        velocity += direction * accelStep; // Accelerate up to the cruise speed
+    velocity = constrain(velocity, -m_maxSpeed, m_maxSpeed);
+
+    position += velocity * DOOR_STEP_TIME_SEC;
+    m_position = position;
+    m_velocity = velocity;
+    writePulse(position);
+}
+
+void Door::service(ulong currentTimeMSec)
+{
+    // The motion runs on the timer, only the pulses are stopped here once the door is at rest
+    if (m_state == DOOR_MOVING)
+    {
+        m_stopTimeMSec = currentTimeMSec;
+    }
+    else if (m_state == DOOR_STOPPED && fabsf(m_position - m_targetPosition) >= DOOR_POSITION_TOLERANCE_TENTHS)
+    {
+        // A retarget raced with the end of the previous move, start over towards the latest target
+        setPositionTenths(lroundf(m_targetPosition));
+    }
+    else if (m_isPulsing && currentTimeMSec - m_stopTimeMSec >= DOOR_DETACH_DELAY_MSEC)
+    {
+        ledcWrite(DOOR_LEDC_CHANNEL, 0); // Stop the pulses to stop the servo from buzzing
+        m_isPulsing = false;
     }
 
 #ifdef DOOR_DEBUG
@@ -69,8 +126,6 @@ void Door::service(ulong currentTimeMSec)
                 return "IDLE";
             case DOOR_STOPPED:
                 return "STOPPED";
-            case DOOR_STARTING:
-                return "STARTING";
             case DOOR_MOVING:
                 return "MOVING";
             default:
@@ -85,57 +140,58 @@ void Door::service(ulong currentTimeMSec)
 
 void Door::setPosition(uint pos)
 {
-    ulong currentTimeMSec = millis(); // Get the current time in milliseconds
+    setPositionTenths(pos * 10);
+}
+
+void Door::setPositionTenths(int tenths)
+{
+    // Constrain the position to the allowed range
+    tenths = constrain(tenths, static_cast<int>(m_closedPosition * 10), static_cast<int>(m_openPosition * 10));
 
-    // If the position is out of bounds, constrain it to the allowed range
 #ifdef DOOR_DEBUG
-    DEBUG_PRINTLN("DOOR::setPosition to " + String(pos));
-#endif
-    // Make sure that the door is not moving
-    if (m_state == DOOR_MOVING)
-    {
-#ifdef DOOR_DEBUG
-        DEBUG_PRINTLN("DOOR:setPosition - Door is Moving");
+    DEBUG_PRINTLN("DOOR::setPositionTenths to " + String(tenths));
 #endif
+
+    // Latest command wins, a move in progress is retargeted on the next step
+    m_targetPosition = tenths;
+    if (m_state == DOOR_MOVING || fabsf(m_position - tenths) < DOOR_POSITION_TOLERANCE_TENTHS)
         return;
-    }
 
-    // Make sure that the position is not the same as the current position
-    if (pos == m_currentPosition)
+    if (!m_isPulsing)
     {
-        if (currentTimeMSec - m_lastSetPositionTimeMSec < DOOR_SERVO_MIN_SET_POSITION_TIMEOUT_MSEC)
-        {
-#ifdef DOOR_DEBUG
-            DEBUG_PRINTLN("DOOR::setPosition - Allready There Position");
-#endif
-            return;
-        }
-        else
-        {
-            m_lastSetPositionTimeMSec = currentTimeMSec; // Update last set position time
-        }
+        writePulse(m_position); // Resume the pulses where the door rests
+        m_isPulsing = true;
     }
+    m_velocity = 0.0f;
+    m_state = DOOR_MOVING; // The timer picks the move up on its next step
+}
 
-    pos = constrain(pos, m_closedPosition, m_openPosition); // Constrain the position to the allowed range
-
-    // Calcuate the travel time based on the step move time and the distance to travel
-    m_traveTimeMsec = abs(static_cast<int>(m_currentPosition) - static_cast<int>(pos)) * DOOR_STEP_MOVE_TIME_MSEC;
-    if (m_traveTimeMsec < DOOR_SERVO_MIN_MOVE_TIME_MSEC)
-    {
-        m_traveTimeMsec = DOOR_SERVO_MIN_MOVE_TIME_MSEC; // Ensure minimum travel time
-    }
-    m_demandedPosition = pos;
-    m_servo.attach(m_pin, DOOR_SERVO_MIN_PULSE_WIDTH, DOOR_SERVO_MAX_PULSE_WIDTH); // Attach servo with min and max pulse width
-    m_state = DOOR_STARTING;                                                       // Set state to starting
+void Door::setPulseWidthUSec(uint pulseWidthUSec)
+{
+    pulseWidthUSec = constrain(pulseWidthUSec, DOOR_SERVO_MIN_PULSE_WIDTH, DOOR_SERVO_MAX_PULSE_WIDTH);
+    setPositionTenths((pulseWidthUSec - DOOR_SERVO_MIN_PULSE_WIDTH) * DOOR_SERVO_MAX_ANGLE_TENTHS /
+                      (DOOR_SERVO_MAX_PULSE_WIDTH - DOOR_SERVO_MIN_PULSE_WIDTH));
+}
 
-#ifdef DOOR_DEBUG
-    DEBUG_PRINTLN("DOOR::setPosition - Demanded Position: " + String(m_demandedPosition) + ", Travel Time: " + String(m_traveTimeMsec));
-#endif
+void Door::setProfile(uint maxSpeedDegPerSec, uint accelDegPerSec2)
+{
+    m_maxSpeed = max(1u, maxSpeedDegPerSec) * 10.0f;
+    m_acceleration = max(1u, accelDegPerSec2) * 10.0f;
 }
 
 uint Door::getPosition()
 {
-    return m_currentPosition;
+    return static_cast<uint>(lroundf(m_position / 10.0f));
+}
+
+int Door::getPositionTenths()
+{
+    return static_cast<int>(lroundf(m_position));
+}
+
+uint Door::getTargetPosition()
+{
+    return static_cast<uint>(lroundf(m_targetPosition / 10.0f));
 }
 
 void Door::open()
@@ -162,17 +218,17 @@ bool Door::isMoving()
 bool Door::isOpen()
 {
 #ifdef DOOR_DEBUG
-    DEBUG_PRINTLN("DOOR::isOpen - Current Position: " + String(m_currentPosition) + ", Open Position: " + String(m_openPosition));
+    DEBUG_PRINTLN("DOOR::isOpen - Current Position: " + String(getPosition()) + ", Open Position: " + String(m_openPosition));
 #endif
-    return m_currentPosition == m_openPosition;
+    return !isMoving() && getPosition() == m_openPosition;
 }
 
 bool Door::isClosed()
 {
 #ifdef DOOR_DEBUG
-    DEBUG_PRINTLN("DOOR::isClosed - Current Position: " + String(m_currentPosition) + ", Closed Position: " + String(m_closedPosition));
+    DEBUG_PRINTLN("DOOR::isClosed - Current Position: " + String(getPosition()) + ", Closed Position: " + String(m_closedPosition));
 #endif
-    return m_currentPosition == m_closedPosition;
+    return !isMoving() && getPosition() == m_closedPosition;
 }
 
 void Door::setBoundaries(uint closedPos, uint openPos)
@@ -182,4 +238,4 @@ void Door::setBoundaries(uint closedPos, uint openPos)
 #endif
     m_closedPosition = closedPos;
     m_openPosition = openPos;
-}
\ No newline at end of file
+}
@@ -1,35 +1,64 @@
 #ifndef DOOR_H
 #define DOOR_H
+
+/**
+ * @file door.h
+ * @brief Servo driven air door with timer-stepped trapezoidal motion profiles.
+ *
+ * An esp_timer steps the servo every DOOR_STEP_TIME_USEC along a trapezoidal velocity profile:
+ * the door accelerates up to the maximum speed, cruises and decelerates so it stops on the
+ * target. Each step compares the stopping distance v^2 / (2 * a) with the distance left and
+ * decides whether to speed up or brake, so the target can be changed at any point of a move.
+ * The latest setPosition() wins and takes effect on the next step, a door moving away from a
+ * new target brakes and turns around without a jump.
+ *
+ * The servo pulses are generated directly by an LEDC channel at 50 Hz with 16 bit resolution
+ * (0.3 us per count), so positions are taken in tenths of a degree or in pulse width
+ * microseconds instead of the whole degrees of the servo library. The pulses are stopped by
+ * service() once the door has been at rest for DOOR_DETACH_DELAY_MSEC so the servo does not
+ * buzz while holding position.
+ */
+
 #include <Arduino.h>
-#include <ESP32Servo.h>
+#include <esp_timer.h>
 #include "types.h"
 #include "debug.h"
 
 // #define DOOR_DEBUG
-#define DOOR_STEP_MOVE_TIME_MSEC 5UL        // Default step move time in milliseconds (type: ulong)
-#define DOOR_SERVO_MIN_MOVE_TIME_MSEC 100UL // Minimum time to move the servo (in milliseconds)
-#define DOOR_SERVO_MIN_PULSE_WIDTH 500      // Minimum pulse width for the servo (in microseconds)
-#define DOOR_SERVO_MAX_PULSE_WIDTH 2500     // Maximum pulse width for the servo (in microseconds)
+#define DOOR_SERVO_MIN_PULSE_WIDTH 500   // Minimum pulse width for the servo (in microseconds)
+#define DOOR_SERVO_MAX_PULSE_WIDTH 2500  // Maximum pulse width for the servo (in microseconds)
+#define DOOR_SERVO_MAX_ANGLE_TENTHS 1800 // Angle at the maximum pulse width (tenths of a degree)
+#define DOOR_SERVO_FRAME_USEC 20000      // Servo frame (50 Hz)
+#define DOOR_LEDC_CHANNEL 13             // Low speed timer 2, clear of the blower channel timer
+#define DOOR_LEDC_RESOLUTION 16          // Bits of duty resolution over one frame
 
-#define DOOR_SERVO_MIN_SET_POSITION_TIMEOUT_MSEC 1000 // Minimum time to wait before setting a new position (in milliseconds)
+#define DEFAULT_DOOR_MAX_SPEED_DEG_PER_SEC 120 // Cruise speed of a move
+#define DEFAULT_DOOR_ACCEL_DEG_PER_SEC2 480    // Acceleration and deceleration of a move
+#define DOOR_STEP_TIME_USEC 20000              // Profile step, one servo frame (20 ms)
+#define DOOR_DETACH_DELAY_MSEC 500             // Rest time before the servo is detached
+#define DOOR_POSITION_TOLERANCE_TENTHS 0.5f    // Distance at which a slow door snaps to the target
 
 enum DoorState
 {
     DOOR_IDLE,
     DOOR_STOPPED,
-    DOOR_STARTING,
     DOOR_MOVING
 };
 
 class Door
 {
 public:
-    Door(uint8_t pin, uint closedPos = 0, uint openPos = 90, ulong stepMoveTimeMSec = 50);
+    Door(uint8_t pin, uint closedPos = 0, uint openPos = 90);
 
     void begin();
     void service(ulong currentTimeMSec);
     void setPosition(uint pos);
+    void setPositionTenths(int tenths);
+    void setPulseWidthUSec(uint pulseWidthUSec);
+    void setProfile(uint maxSpeedDegPerSec, uint accelDegPerSec2);
     uint getPosition();
+    int getPositionTenths();
+    uint getTargetPosition();
     void open();
     void close();
     bool isMoving();
@@ -38,18 +67,23 @@ public:
     void setBoundaries(uint closedPos, uint openPos);
 
 private:
-    DoorState m_state;
-    DoorState m_prevState;
-    ulong m_startMoveTimeMSec;
-    ulong m_stepMoveTimeMSec;
-    ulong m_traveTimeMsec;
-    uint8_t m_pin;
-    uint m_closedPosition;
-    uint m_openPosition;
-    uint m_currentPosition;
-    uint m_demandedPosition;
-    ulong m_lastSetPositionTimeMSec; // Last time the position was set
-    Servo m_servo;
+    volatile DoorState m_state;      // Current state, set by the profile timer while moving
+    DoorState m_prevState;           // Previous state for state change reports
+    uint8_t m_pin;                   // Servo pin
+    uint m_closedPosition;           // Closed position (degrees)
+    uint m_openPosition;             // Open position (degrees)
+    volatile float m_position;       // Commanded position along the profile (tenths of a degree)
+    volatile float m_velocity;       // Profile velocity (tenths of a degree per second)
+    volatile float m_targetPosition; // Latest demanded position (tenths of a degree)
+    volatile float m_maxSpeed;       // Cruise speed (tenths of a degree per second)
+    volatile float m_acceleration;   // Acceleration (tenths of a degree per second^2)
+    ulong m_stopTimeMSec;            // Time the door came to rest
+    bool m_isPulsing;                // True while the servo receives pulses
+    esp_timer_handle_t m_timer;      // Profile step timer
+
+    static void timerCallback(void *arg);
+    void step();
+    void writePulse(float tenths);
 };
 
-#endif // DOOR_H
\ No newline at end of file
+#endif // DOOR_H
@@ -0,0 +1,149 @@
+#include "eventbus.h"
+
+EventBus::EventBus(const char *name) : m_name(name)
+{
+    m_head = 0;
+    m_tail = 0;
+    m_subscriptionCount = 0;
+    m_traceCount = 0;
+    m_sequence = 0;
+    m_publishedCount = 0;
+    m_droppedCount = 0;
+    m_mux = portMUX_INITIALIZER_UNLOCKED;
+}
+
+bool EventBus::subscribe(uint32_t typeMask, EventHandler handler)
+{
+    if (m_subscriptionCount >= EVENT_BUS_MAX_SUBSCRIBERS || handler == nullptr)
+    {
+        Serial.println("Event bus subscriber table full, subscriber not added!");
+        return false;
+    }
+
+    m_subscriptions[m_subscriptionCount].typeMask = typeMask;
+    m_subscriptions[m_subscriptionCount].handler = handler;
+    m_subscriptionCount++;
+    return true;
+}
+
+bool EventBus::publish(EventType type, EventSource source, int32_t value)
+{
+    bool isQueued = false;
+    uint32_t timeMSec = millis();
+
+    portENTER_CRITICAL(&m_mux);
+    uint next = (m_tail + 1) % EVENT_BUS_CAPACITY;
+    if (next != m_head)
+    {
+        Event &event = m_queue[m_tail];
+        event.sequence = m_sequence++;
+        event.timeMSec = timeMSec;
+        event.type = type;
+        event.source = source;
+        event.value = value;
+        m_tail = next;
+        m_publishedCount++;
+        isQueued = true;
+    }
+    else
+    {
+        m_droppedCount++;
+    }
+    portEXIT_CRITICAL(&m_mux);
+
+#ifdef DEBUG_EVENTBUS
+    if (!isQueued)
+        DEBUG_PRINTLN("EVENTBUS::publish - " + String(m_name) + " full, dropped " + String(typeToString(type)));
+#endif
+    return isQueued;
+}
+
+uint EventBus::dispatch()
+{
+    // Only the events pending now, the ones published by the handlers wait for the next call
+    uint tail = m_tail;
+    uint count = 0;
+
+    while (m_head != tail)
+    {
+        Event event;
+        portENTER_CRITICAL(&m_mux);
+        event = m_queue[m_head];
+        m_head = (m_head + 1) % EVENT_BUS_CAPACITY;
+        m_trace[m_traceCount % EVENT_BUS_TRACE_LENGTH] = event;
+        m_traceCount++;
+        portEXIT_CRITICAL(&m_mux);
+
+#ifdef DEBUG_EVENTBUS
+        DEBUG_PRINTLN("EVENTBUS::dispatch - " + String(m_name) + " #" + String(event.sequence) + " " +
+                      String(typeToString(event.type)) + " src=" + String(event.source) + " value=" + String(event.value));
+#endif
+
+        for (uint i = 0; i < m_subscriptionCount; ++i)
+        {
+            if (m_subscriptions[i].typeMask & EVENT_MASK(event.type))
+                m_subscriptions[i].handler(event);
+        }
+        count++;
+    }
+    return count;
+}
+
+bool EventBus::isPending() const
+{
+    return m_head != m_tail;
+}
+
+const char *EventBus::getName() const
+{
+    return m_name;
+}
+
+uint32_t EventBus::getPublishedCount() const
+{
+    return m_publishedCount;
+}
+
+uint32_t EventBus::getDroppedCount() const
+{
+    return m_droppedCount;
+}
+
+uint EventBus::getTrace(Event *events, uint maxEvents) const
+{
+    // Oldest first
+    portENTER_CRITICAL(&m_mux);
+    uint count = min(min(m_traceCount, static_cast<uint>(EVENT_BUS_TRACE_LENGTH)), maxEvents);
+    uint first = m_traceCount - count;
+    for (uint i = 0; i < count; ++i)
+        events[i] = m_trace[(first + i) % EVENT_BUS_TRACE_LENGTH];
+    portEXIT_CRITICAL(&m_mux);
+    return count;
+}
+
+const char *EventBus::typeToString(EventType type)
+{
+    switch (type)
+    {
+    case EVENT_SAMPLE_READY:
+        return "SAMPLE_READY";
+    case EVENT_CONFIG_CHANGED:
+        return "CONFIG_CHANGED";
+    case EVENT_BUTTON:
+        return "BUTTON";
+    case EVENT_RUN_STATE_CHANGED:
+        return "RUN_STATE_CHANGED";
+    case EVENT_SAVE_REQUESTED:
+        return "SAVE_REQUESTED";
+    case EVENT_CALIBRATION_REQUESTED:
+        return "CALIBRATION_REQUESTED";
+    case EVENT_WIFI_CONNECTED:
+        return "WIFI_CONNECTED";
+    case EVENT_WIFI_DISCONNECTED:
+        return "WIFI_DISCONNECTED";
+    case EVENT_RESTART_REQUESTED:
+        return "RESTART_REQUESTED";
+    default:
+        return "NONE";
+    }
+}
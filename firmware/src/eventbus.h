@@ -0,0 +1,110 @@
+#ifndef EVENTBUS_H
+#define EVENTBUS_H
+
+/**
+ * @file eventbus.h
+ * @brief Fixed capacity, allocation free event queue with typed events and subscribers.
+ *
+ * Producers publish typed events (a new sample, a button, a run state change, ...) into a ring
+ * buffer of EVENT_BUS_CAPACITY entries instead of raising read-and-reset flags. Subscribers
+ * register a handler for a mask of event types. dispatch() is called by a scheduler task and
+ * hands every pending event to its subscribers in publication order; events published by a
+ * handler wait for the next dispatch, so one dispatch does a bounded amount of work. With no
+ * pending event a dispatch is a single comparison.
+ *
+ * Every event gets a sequence number and a time stamp. The last EVENT_BUS_TRACE_LENGTH dispatched
+ * events are kept in a trace ring, so the order in which the subsystems saw them can be
+ * reconstructed. A full queue drops the new event and counts it.
+ *
+ * One bus serves one loop. The queue is guarded by a spinlock so events may be published from
+ * another task as well, the handlers always run in the loop that dispatches.
+ */
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "debug.h"
+
+// #define DEBUG_EVENTBUS
+
+#define EVENT_BUS_CAPACITY 32        // Pending events per bus
+#define EVENT_BUS_MAX_SUBSCRIBERS 12 // Subscriptions per bus
+#define EVENT_BUS_TRACE_LENGTH 32    // Dispatched events kept for tracing
+
+#define EVENT_MASK(type) (1UL << (type))
+
+enum EventType : uint8_t
+{
+    EVENT_NONE,
+    EVENT_SAMPLE_READY,          // value: temperature (F, whole degrees)
+    EVENT_CONFIG_CHANGED,        // Configuration applied or changed in place
+    EVENT_BUTTON,                // value: KnobEvent
+    EVENT_RUN_STATE_CHANGED,     // value: 1 started, 0 stopped
+    EVENT_SAVE_REQUESTED,        // Configuration should be written to NVRAM
+    EVENT_CALIBRATION_REQUESTED, // Blower calibration sweep start or stop requested
+    EVENT_WIFI_CONNECTED,        // Station got an IP address
+    EVENT_WIFI_DISCONNECTED,     // value: disconnect reason of the WiFi driver
+    EVENT_RESTART_REQUESTED,     // Restart requested, pending NVRAM writes first
+    EVENT_TYPE_COUNT
+};
+
+enum EventSource : uint8_t
+{
+    EVENT_SOURCE_NONE,
+    EVENT_SOURCE_SMOKER_PROBE,
+    EVENT_SOURCE_FOOD_PROBE,
+    EVENT_SOURCE_KNOB,
+    EVENT_SOURCE_GUI,
+    EVENT_SOURCE_CONTROL,
+    EVENT_SOURCE_WIFI
+};
+
+struct Event
+{
+    uint32_t sequence;  // Publication order on this bus
+    uint32_t timeMSec;  // Publication time
+    EventType type;     // Event type
+    EventSource source; // Producer
+    int32_t value;      // Type specific payload
+};
+
+typedef void (*EventHandler)(const Event &event);
+
+class EventBus
+{
+public:
+    EventBus(const char *name);
+
+    bool subscribe(uint32_t typeMask, EventHandler handler);
+    bool publish(EventType type, EventSource source, int32_t value = 0);
+    uint dispatch();
+
+    bool isPending() const;
+    const char *getName() const;
+    uint32_t getPublishedCount() const;
+    uint32_t getDroppedCount() const;
+    uint getTrace(Event *events, uint maxEvents) const;
+
+    static const char *typeToString(EventType type);
+
+private:
+    struct Subscription
+    {
+        uint32_t typeMask;    // Event types delivered to the handler
+        EventHandler handler; // Subscriber
+    };
+
+    const char *m_name;                                      // Bus name for the reports
+    Event m_queue[EVENT_BUS_CAPACITY];                       // Pending events
+    volatile uint m_head;                                    // Next event to dispatch
+    volatile uint m_tail;                                    // Next free slot
+    Subscription m_subscriptions[EVENT_BUS_MAX_SUBSCRIBERS]; // Subscriber table
+    uint m_subscriptionCount;                                // Subscriptions in use
+    Event m_trace[EVENT_BUS_TRACE_LENGTH];                   // Last dispatched events
+    uint m_traceCount;                                       // Events ever traced
+    uint32_t m_sequence;                                     // Sequence of the next event
+    uint32_t m_publishedCount;                               // Events published
+    uint32_t m_droppedCount;                                 // Events dropped on a full queue
+    mutable portMUX_TYPE m_mux;                              // Guards the queue and the trace
+};
+
+#endif // EVENTBUS_H
@@ -0,0 +1,182 @@
+#include "firemonitor.h"
+
+FireMonitor::FireMonitor()
+    : m_isEnabled(DEFAULT_FIRE_DETECTION_ENABLED),
+      m_detectMSec(DEFAULT_FIRE_DETECT_MSEC)
+{
+    reset();
+}
+
+void FireMonitor::setParameters(bool isEnabled, ulong detectMSec)
+{
+    m_isEnabled = isEnabled;
+    m_detectMSec = detectMSec;
+}
+
+void FireMonitor::reset()
+{
+    m_alarm = FIRE_ALARM_NONE;
+    m_alarmStartMSec = 0;
+    restartWindow(0);
+    m_isSaturated = false; // The window opens with the first saturated sample
+    m_alarmMinTempF = 0.0f;
+    m_previousTargetF = 0;
+    m_lastUpdateMSec = 0;
+}
+
+FireAlarm FireMonitor::update(float temperatureF, int targetTempF, int demandedBlowerPWM, LidState lidState, ulong currentTimeMSec)
+{
+    // Start over after the controller was stopped
+    if (m_lastUpdateMSec == 0 || currentTimeMSec - m_lastUpdateMSec > FIRE_MAX_SAMPLE_GAP_MSEC)
+    {
+        reset();
+        m_previousTargetF = targetTempF;
+    }
+    m_lastUpdateMSec = currentTimeMSec;
+
+    bool isTargetStep = targetTempF - m_previousTargetF >= FIRE_TARGET_STEP_F;
+    m_previousTargetF = targetTempF;
+
+    if (!m_isEnabled)
+    {
+        m_alarm = FIRE_ALARM_NONE;
+        m_isSaturated = false;
+        return m_alarm;
+    }
+
+    // A raised alarm clears once the pit is clearly heating again (refuelled or relit)
+    if (m_alarm != FIRE_ALARM_NONE)
+    {
+        m_alarmMinTempF = min(m_alarmMinTempF, temperatureF);
+        if (temperatureF - m_alarmMinTempF >= FIRE_CLEAR_RISE_F || temperatureF >= targetTempF)
+        {
+#ifdef DEBUG_FIRE_MONITOR
+            DEBUG_PRINTLN("FIRE::update - Alarm cleared at " + String(temperatureF, 1));
+#endif
+            m_alarm = FIRE_ALARM_NONE;
+            m_isSaturated = false;
+        }
+    }
+
+    // Saturation caused by the lid or a target step says nothing about the fuel
+    bool isSaturated = demandedBlowerPWM >= FIRE_SATURATION_PWM &&
+                       targetTempF - temperatureF >= FIRE_MIN_ERROR_F &&
+                       lidState == LID_STATE_CLOSED;
+    if (!isSaturated || isTargetStep)
+    {
+        m_isSaturated = false;
+        return m_alarm;
+    }
+
+    if (!m_isSaturated)
+    {
+        restartWindow(currentTimeMSec);
+    }
+
+    // Average the readings over a minute, the fit runs over the averages of the last detection time
+    m_accumulatorF += temperatureF;
+    m_accumulatorCount++;
+    if (currentTimeMSec - m_sampleStartMSec < FIRE_WINDOW_SAMPLE_MSEC)
+        return m_alarm;
+
+    uint windowSamples = getWindowSamples();
+    addSample(m_accumulatorF / m_accumulatorCount, windowSamples);
+    m_accumulatorF = 0.0f;
+    m_accumulatorCount = 0;
+    m_sampleStartMSec = currentTimeMSec;
+
+    if (m_alarm == FIRE_ALARM_OUT || currentTimeMSec - m_saturationStartMSec < m_detectMSec || m_count < windowSamples)
+        return m_alarm;
+
+    float slope = getSlope();
+    if (slope <= FIRE_MAX_SLOPE_F_PER_MIN)
+    {
+        FireAlarm alarm = (m_samples[m_head] - temperatureF >= FIRE_OUT_DROP_F) ? FIRE_ALARM_OUT : FIRE_ALARM_STALLED;
+        if (alarm != m_alarm)
+        {
+#ifdef DEBUG_FIRE_MONITOR
+            DEBUG_PRINTLN("FIRE::update - Alarm " + String(alarm) + " slope=" + String(slope, 2));
+#endif
+            if (m_alarm == FIRE_ALARM_NONE)
+            {
+                m_alarmStartMSec = currentTimeMSec;
+                m_alarmMinTempF = temperatureF;
+            }
+            m_alarm = alarm;
+        }
+    }
+
+    return m_alarm;
+}
+
+void FireMonitor::restartWindow(ulong currentTimeMSec)
+{
+    m_isSaturated = true;
+    m_saturationStartMSec = currentTimeMSec;
+    m_head = 0;
+    m_count = 0;
+    m_sumT = 0.0f;
+    m_sumTT = 0.0f;
+    m_sumY = 0.0f;
+    m_sumTY = 0.0f;
+    m_accumulatorF = 0.0f;
+    m_accumulatorCount = 0;
+    m_sampleStartMSec = currentTimeMSec;
+}
+
+void FireMonitor::addSample(float temperatureF, uint windowSamples)
+{
+    // Drop the oldest samples (t = 0) and move the time origin to the next one, a shorter
+    // detection time drops several at once
+    while (m_count >= windowSamples)
+    {
+        float oldest = m_samples[m_head];
+        m_head = (m_head + 1) % FIRE_WINDOW_MAX_SAMPLES;
+        m_count--;
+        m_sumY -= oldest;
+
+        // Rewrite the sums for t' = t - 1 minute without touching the samples
+        float n = static_cast<float>(m_count);
+        m_sumTT += -2.0f * m_sumT + n;
+        m_sumTY -= m_sumY;
+        m_sumT -= n;
+    }
+
+    float t = static_cast<float>(m_count);
+    m_samples[(m_head + m_count) % FIRE_WINDOW_MAX_SAMPLES] = temperatureF;
+    m_count++;
+    m_sumT += t;
+    m_sumTT += t * t;
+    m_sumY += temperatureF;
+    m_sumTY += t * temperatureF;
+}
+
+uint FireMonitor::getWindowSamples() const
+{
+    return constrain(m_detectMSec / FIRE_WINDOW_SAMPLE_MSEC, static_cast<ulong>(FIRE_WINDOW_MIN_SAMPLES),
+                     static_cast<ulong>(FIRE_WINDOW_MAX_SAMPLES));
+}
+
+float FireMonitor::getSlope() const
+{
+    float n = static_cast<float>(m_count);
+    float denominator = n * m_sumTT - m_sumT * m_sumT;
+    if (m_count < 2 || denominator <= 0.0f)
+        return 0.0f;
+    return (n * m_sumTY - m_sumT * m_sumY) / denominator;
+}
+
+FireAlarm FireMonitor::getAlarm() const
+{
+    return m_alarm;
+}
+
+ulong FireMonitor::getAlarmStartMSec() const
+{
+    return m_alarmStartMSec;
+}
+
+float FireMonitor::getSlopeFPerMin() const
+{
+    return m_isSaturated ? getSlope() : 0.0f;
+}
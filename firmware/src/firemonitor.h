@@ -0,0 +1,94 @@
+#ifndef FIRE_MONITOR_H
+#define FIRE_MONITOR_H
+
+/**
+ * @file firemonitor.h
+ * @brief Detection of a stalled or exhausted fire from the control path.
+ *
+ * A healthy fire answers a saturated blower with a rising pit temperature. When the fuel runs out
+ * the controller keeps the blower pinned at full output while the temperature stays flat or keeps
+ * falling. The monitor times how long the demanded output has been saturated, averages the
+ * temperature per minute and fits a least squares slope to the averages of the last detection
+ * time only (running sums, O(1) per sample):
+ *
+ *     slope = (n * Sum(t * T) - Sum(t) * Sum(T)) / (n * Sum(t^2) - Sum(t)^2)
+ *
+ * The averages sit in a fixed ring, the oldest one leaves the sums as a new one arrives and the
+ * time origin moves with it, as in the cook predictor. A long saturated warm-up therefore no
+ * longer hides a fire dying at its end. Saturation sustained for the detection time with a
+ * non-positive slope over the window raises FIRE_ALARM_STALLED, and a further drop below the
+ * oldest average of the window raises FIRE_ALARM_OUT.
+ *
+ * Two other situations also saturate the output and are excluded:
+ *   - a lid-open event, the window restarts while the lid detector reports the lid open or recovering,
+ *   - a ramp or profile step, the window restarts when the target jumps up.
+ */
+
+#include <Arduino.h>
+#include "types.h"
+#include "debug.h"
+#include "liddetector.h"
+
+// #define DEBUG_FIRE_MONITOR
+
+#define DEFAULT_FIRE_DETECTION_ENABLED true
+#define DEFAULT_FIRE_DETECT_MSEC 900000 // Saturation time before a stalled fire is reported (15 minutes)
+#define FIRE_SATURATION_PWM 240         // Demanded blower PWM considered saturated
+#define FIRE_MAX_SLOPE_F_PER_MIN 0.0f   // Slope at or below which the fire is not responding
+#define FIRE_OUT_DROP_F 25.0f           // Drop over the window that turns a stall into a fire-out alarm
+#define FIRE_MIN_ERROR_F 10.0f          // Only consider the fire stalled this far below the target
+#define FIRE_TARGET_STEP_F 10           // Target jump treated as a ramp or profile step
+#define FIRE_CLEAR_RISE_F 15.0f         // Rise above the lowest alarm temperature that clears the alarm
+#define FIRE_MAX_SAMPLE_GAP_MSEC 60000  // Restart after a gap (controller stopped)
+#define FIRE_WINDOW_SAMPLE_MSEC 60000UL // One averaged sample per minute
+#define FIRE_WINDOW_MIN_SAMPLES 2       // Shortest window the slope is fitted over
+#define FIRE_WINDOW_MAX_SAMPLES 60      // Longest window (60 minutes), a longer detection time fits the last hour
+
+enum FireAlarm
+{
+    FIRE_ALARM_NONE,
+    FIRE_ALARM_STALLED, // Output saturated and the temperature is not rising
+    FIRE_ALARM_OUT      // Output saturated and the temperature keeps falling
+};
+
+class FireMonitor
+{
+private:
+    bool m_isEnabled;                         // Detection enabled
+    ulong m_detectMSec;                       // Saturation time before an alarm
+    FireAlarm m_alarm;                        // Current alarm
+    ulong m_alarmStartMSec;                   // Time the current alarm was raised
+    bool m_isSaturated;                       // True while a saturation window is open
+    ulong m_saturationStartMSec;              // Start of the saturation
+    float m_samples[FIRE_WINDOW_MAX_SAMPLES]; // Per-minute averaged temperatures
+    uint m_head;                              // Index of the oldest sample
+    uint m_count;                             // Samples in the window
+    float m_sumT;                             // Sum of the sample times (minutes from the oldest sample)
+    float m_sumTT;                            // Sum of the squared sample times
+    float m_sumY;                             // Sum of the temperatures
+    float m_sumTY;                            // Sum of time * temperature
+    float m_accumulatorF;                     // Sum of the readings of the sample being averaged
+    uint m_accumulatorCount;                  // Readings in the sample being averaged
+    ulong m_sampleStartMSec;                  // Start of the sample being averaged
+    float m_alarmMinTempF;                    // Lowest temperature seen while the alarm is raised
+    int m_previousTargetF;                    // Target at the previous sample
+    ulong m_lastUpdateMSec;                   // Time of the previous sample
+
+    void restartWindow(ulong currentTimeMSec);
+    void addSample(float temperatureF, uint windowSamples);
+    uint getWindowSamples() const;
+    float getSlope() const;
+
+public:
+    FireMonitor();
+
+    void setParameters(bool isEnabled, ulong detectMSec);
+    FireAlarm update(float temperatureF, int targetTempF, int demandedBlowerPWM, LidState lidState, ulong currentTimeMSec);
+    void reset();
+
+    FireAlarm getAlarm() const;
+    ulong getAlarmStartMSec() const;
+    float getSlopeFPerMin() const;
+};
+
+#endif // FIRE_MONITOR_H
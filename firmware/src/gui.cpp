@@ -1,10 +1,15 @@
 #include "gui.h"
+#include "liddetector.h"
+#include "firemonitor.h"
+#include "runcheckpoint.h"
+#include "profileengine.h"
+#include "metrics.h"
 #include <math.h>
 
 // ========================================== SETTINGS GETTERS & SETTERS ==============================
 
 // TARGET TEMPERATURE =================================================================================
-static String getTargetTemp(const Configuration &c) { return String(c.temperatureTarget) + " F"; }
+static void getTargetTemp(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "%d F", c.temperatureTarget); }
 void incTargetTemp(Configuration &c)
 {
     if (c.temperatureTarget + GUI_SETTINGS_TEMP_STEP <= GUI_SETTINGS_TEMP_MAX)
@@ -17,7 +22,7 @@ void decTargetTemp(Configuration &c)
 }
 
 // TEMPERATURE INTERVAL ==============================================================================
-static String getInterval(const Configuration &c) { return String(c.temperatureIntervalMSec / 1000) + " sec"; }
+static void getInterval(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "%d sec", c.temperatureIntervalMSec / 1000); }
 void incInterval(Configuration &c)
 {
     if (c.temperatureIntervalMSec + GUI_SETTINGS_INTERVAL_STEP <= GUI_SETTINGS_INTERVAL_MAX)
@@ -30,13 +35,13 @@ void decInterval(Configuration &c)
 }
 
 // TEMPERATURE PROFILING ENABLE SWITCH ============================================================
-static String getIsTemperatureProfilingEnabled(const Configuration &c) { return c.isTemperatureProfilingEnabled ? "Yes" : "No"; }
+static void getIsTemperatureProfilingEnabled(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, c.isTemperatureProfilingEnabled ? "Yes" : "No", size); }
 void incIsTemperatureProfilingEnabled(Configuration &c) { c.isTemperatureProfilingEnabled = !c.isTemperatureProfilingEnabled; }
 void decIsTemperatureProfilingEnabled(Configuration &c) { c.isTemperatureProfilingEnabled = !c.isTemperatureProfilingEnabled; }
 // TEMPERATURE PROFILE STEPS COUNT ================================================================
-static String getTemperatureProfileStepsCount(const Configuration &c)
+static void getTemperatureProfileStepsCount(const Configuration &c, char *buffer, size_t size)
 {
-    return String(c.temperatureProfileStepsCount) + " steps";
+    snprintf(buffer, size, "%d steps", c.temperatureProfileStepsCount);
 }
 void incTemperatureProfileStepsCount(Configuration &c)
 {
@@ -49,115 +54,32 @@ void decTemperatureProfileStepsCount(Configuration &c)
         c.temperatureProfileStepsCount--;
 }
 
-// PID ENABLE SWITCH ==============================================================================
-static String getPIDEnabled(const Configuration &c) { return c.isPIDEnabled ? "Yes" : "No"; }
-void incPIDEnabled(Configuration &c) { c.isPIDEnabled = !c.isPIDEnabled; }
-void decPIDEnabled(Configuration &c) { c.isPIDEnabled = !c.isPIDEnabled; }
-
-// PID K_PROPORTIONAL =============================================================================
-static String getKP(const Configuration &c) { return String(c.kP, GUI_SETTINGS_PID_K_DECIMAL_PLACES); }
-void incKP(Configuration &c)
-{
-    if (c.kP + GUI_SETTINGS_PID_K_STEP <= GUI_SETTINGS_PID_K_MAX)
-        c.kP += GUI_SETTINGS_PID_K_STEP;
-    else
-        c.kP = GUI_SETTINGS_PID_K_MAX;
-}
-void decKP(Configuration &c)
-{
-    if (c.kP - GUI_SETTINGS_PID_K_STEP >= GUI_SETTINGS_PID_K_MIN)
-        c.kP -= GUI_SETTINGS_PID_K_STEP;
-    else
-        c.kP = GUI_SETTINGS_PID_K_MIN;
-}
-
-// PID K_INTEGRAL =================================================================================
-static String getKI(const Configuration &c) { return String(c.kI, GUI_SETTINGS_PID_K_DECIMAL_PLACES); }
-void incKI(Configuration &c)
+// PROFILE PIT BAND, shared by the pit hold conditions of all steps ===============================
+static void getProfilePitBand(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "+/-%d F", c.profilePitBandF); }
+void incProfilePitBand(Configuration &c)
 {
-    if (c.kI + GUI_SETTINGS_PID_K_STEP <= GUI_SETTINGS_PID_K_MAX)
-        c.kI += GUI_SETTINGS_PID_K_STEP;
-    else
-        c.kI = GUI_SETTINGS_PID_K_MAX;
+    if (c.profilePitBandF < PROFILE_PIT_BAND_MAX_F)
+        c.profilePitBandF++;
 }
-void decKI(Configuration &c)
+void decProfilePitBand(Configuration &c)
 {
-    if (c.kI - GUI_SETTINGS_PID_K_STEP >= GUI_SETTINGS_PID_K_MIN)
-        c.kI -= GUI_SETTINGS_PID_K_STEP;
-    else
-        c.kI = GUI_SETTINGS_PID_K_MIN;
+    if (c.profilePitBandF > 1)
+        c.profilePitBandF--;
 }
 
-// PID K_DERIVATIVE ===============================================================================
-static String getKD(const Configuration &c) { return String(c.kD, GUI_SETTINGS_PID_K_DECIMAL_PLACES); }
-void incKD(Configuration &c)
+// CONTROL ALGORITHM ============================================================================
+static void getControlAlgorithm(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, getControlStrategy(c.controlAlgorithm).name, size); }
+void incControlAlgorithm(Configuration &c)
 {
-    if (c.kD + GUI_SETTINGS_PID_K_STEP <= GUI_SETTINGS_PID_K_MAX)
-        c.kD += GUI_SETTINGS_PID_K_STEP;
-    else
-        c.kD = GUI_SETTINGS_PID_K_MAX;
+    c.controlAlgorithm = static_cast<ControlAlgorithm>((c.controlAlgorithm + 1) % CONTROL_ALGORITHM_COUNT);
 }
-void decKD(Configuration &c)
+void decControlAlgorithm(Configuration &c)
 {
-    if (c.kD - GUI_SETTINGS_PID_K_STEP >= GUI_SETTINGS_PID_K_MIN)
-        c.kD -= GUI_SETTINGS_PID_K_STEP;
-    else
-        c.kD = GUI_SETTINGS_PID_K_MIN;
-}
-
-// BANG BANG TEMPERATURE THRESHOLDS ===============================================================
-static String getBangBangBand(const Configuration &c) { return String(c.bangBangHighThreshold - c.bangBangLowThreshold) + " F"; }
-void incBangBangBand(Configuration &c)
-{
-    int band = c.bangBangHighThreshold - c.bangBangLowThreshold;
-    if (band + GUI_SETTINGS_TEMP_BB_BAND_STEP <= GUI_SETTINGS_TEMP_BB_BAND_MAX)
-    {
-        c.bangBangHighThreshold += GUI_SETTINGS_TEMP_BB_BAND_STEP;
-        c.bangBangLowThreshold -= GUI_SETTINGS_TEMP_BB_BAND_STEP;
-    }
-}
-void decBangBangBand(Configuration &c)
-{
-    int band = c.bangBangHighThreshold - c.bangBangLowThreshold;
-    if (band - GUI_SETTINGS_TEMP_BB_BAND_STEP >= GUI_SETTINGS_TEMP_BB_BAND_MIN)
-    {
-        c.bangBangHighThreshold -= GUI_SETTINGS_TEMP_BB_BAND_STEP;
-        c.bangBangLowThreshold += GUI_SETTINGS_TEMP_BB_BAND_STEP;
-    }
-}
-
-// BANG BANG HYSTERESIS ===========================================================================
-static String getBangBangHyst(const Configuration &c) { return String(c.bangBangHysteresis) + " F"; }
-void incBangBangHyst(Configuration &c)
-{
-    if (c.bangBangHysteresis + GUI_SETTINGS_TEMP_BB_BAND_STEP <= GUI_SETTINGS_TEMP_BB_BAND_MAX)
-        c.bangBangHysteresis += GUI_SETTINGS_TEMP_BB_BAND_STEP;
-}
-void decBangBangHyst(Configuration &c)
-{
-    if (c.bangBangHysteresis - GUI_SETTINGS_TEMP_BB_BAND_STEP >= GUI_SETTINGS_TEMP_BB_BAND_MIN)
-        c.bangBangHysteresis -= GUI_SETTINGS_TEMP_BB_BAND_STEP;
-}
-
-// BANG BANG FAN SPEED ============================================================================
-static String getBangBangFan(const Configuration &c) { return String(c.bangBangFanSpeed); }
-void incBangBangFan(Configuration &c)
-{
-    if (c.bangBangFanSpeed + GUI_SETTINGS_PWM_STEP <= GUI_SETTINGS_PWM_MAX)
-        c.bangBangFanSpeed += GUI_SETTINGS_PWM_STEP;
-    else
-        c.bangBangFanSpeed = GUI_SETTINGS_PWM_MAX;
-}
-void decBangBangFan(Configuration &c)
-{
-    if (c.bangBangFanSpeed - GUI_SETTINGS_PWM_STEP >= GUI_SETTINGS_PWM_MIN)
-        c.bangBangFanSpeed -= GUI_SETTINGS_PWM_STEP;
-    else
-        c.bangBangFanSpeed = GUI_SETTINGS_PWM_MIN;
+    c.controlAlgorithm = static_cast<ControlAlgorithm>((c.controlAlgorithm + CONTROL_ALGORITHM_COUNT - 1) % CONTROL_ALGORITHM_COUNT);
 }
 
 // DOOR OPEN POSITION =============================================================================
-static String getDoorOpenPos(const Configuration &c) { return String(c.doorOpenPosition) + " deg"; }
+static void getDoorOpenPos(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "%d deg", c.doorOpenPosition); }
 void incDoorOpenPos(Configuration &c)
 {
     if (c.doorOpenPosition < 180)
@@ -170,7 +92,7 @@ void decDoorOpenPos(Configuration &c)
 }
 
 // DOOR CLOSE POSITION ============================================================================
-static String getDoorClosePos(const Configuration &c) { return String(c.doorClosePosition) + " deg"; }
+static void getDoorClosePos(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "%d deg", c.doorClosePosition); }
 void incDoorClosePos(Configuration &c)
 {
     if (c.doorClosePosition < 180)
@@ -183,14 +105,14 @@ void decDoorClosePos(Configuration &c)
 }
 
 // TEMPERATURE FILTER ENABLE SWITCH ============================================================
-static String getIsTemperatureFilterEnabled(const Configuration &c) { return c.isTemperatureFilterEnabled ? "Yes" : "No"; }
+static void getIsTemperatureFilterEnabled(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, c.isTemperatureFilterEnabled ? "Yes" : "No", size); }
 void incIsTemperatureFilterEnabled(Configuration &c) { c.isTemperatureFilterEnabled = !c.isTemperatureFilterEnabled; }
 void decIsTemperatureFilterEnabled(Configuration &c) { c.isTemperatureFilterEnabled = !c.isTemperatureFilterEnabled; }
 
 // TEMPERATURE FILTER COEFFICIENT ================================================================
-static String getTemperatureFilterCoeff(const Configuration &c)
+static void getTemperatureFilterCoeff(const Configuration &c, char *buffer, size_t size)
 {
-    return String(c.temperatureFilterCoeff, 2); // Display with 2 decimal places
+    snprintf(buffer, size, "%.2f", c.temperatureFilterCoeff); // Display with 2 decimal places
 }
 void incTemperatureFilterCoeff(Configuration &c)
 {
@@ -208,36 +130,59 @@ void decTemperatureFilterCoeff(Configuration &c)
 }
 
 // SMOKER THEMOMETER CALIBRATION - GAIN ===========================================================
-static String getSmokerGain(const Configuration &c) { return String(c.themometerSmokerGain, 2); }
+static void getSmokerGain(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "%.2f", c.themometerSmokerGain); }
 void incSmokerGain(Configuration &c) { c.themometerSmokerGain += 0.01f; }
 void decSmokerGain(Configuration &c) { c.themometerSmokerGain -= 0.01f; }
 
 // SMOKER THEMOMETER CALIBRATION - OFFSET =========================================================
-static String getSmokerOffset(const Configuration &c) { return String(c.themometerSmokerOffset, 2); }
+static void getSmokerOffset(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "%.2f", c.themometerSmokerOffset); }
 void incSmokerOffset(Configuration &c) { c.themometerSmokerOffset += 0.1f; }
 void decSmokerOffset(Configuration &c) { c.themometerSmokerOffset -= 0.1f; }
 
 // FOOD THEMOMETER CALIBRATION - GAIN ============================================================
-static String getFoodGain(const Configuration &c) { return String(c.themometerFoodGain, 2); }
+static void getFoodGain(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "%.2f", c.themometerFoodGain); }
 void incFoodGain(Configuration &c) { c.themometerFoodGain += 0.01f; }
 void decFoodGain(Configuration &c) { c.themometerFoodGain -= 0.01f; }
 
 // FOOD THEMOMETER CALIBRATION - OFFSET ==========================================================
-static String getFoodOffset(const Configuration &c) { return String(c.themometerFoodOffset, 2); }
+static void getFoodOffset(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "%.2f", c.themometerFoodOffset); }
 void incFoodOffset(Configuration &c) { c.themometerFoodOffset += 0.1f; }
 void decFoodOffset(Configuration &c) { c.themometerFoodOffset -= 0.1f; }
 
-static String getIsThemometerSimulated(const Configuration &c) { return c.isThemometerSimulated ? "Yes" : "No"; }
+static void getIsThemometerSimulated(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, c.isThemometerSimulated ? "Yes" : "No", size); }
 void incIsThemometerSimulated(Configuration &c) { c.isThemometerSimulated = !c.isThemometerSimulated; }
 void decIsThemometerSimulated(Configuration &c) { c.isThemometerSimulated = !c.isThemometerSimulated; }
 
+// LID-OPEN DETECTION ENABLE SWITCH ===============================================================
+static void getIsLidDetectionEnabled(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, c.isLidDetectionEnabled ? "Yes" : "No", size); }
+void incIsLidDetectionEnabled(Configuration &c) { c.isLidDetectionEnabled = !c.isLidDetectionEnabled; }
+void decIsLidDetectionEnabled(Configuration &c) { c.isLidDetectionEnabled = !c.isLidDetectionEnabled; }
+
+// FOOD FINISH TEMPERATURE ========================================================================
+static void getFoodFinishTemp(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "%d F", c.foodFinishTemperatureF); }
+void incFoodFinishTemp(Configuration &c)
+{
+    if (c.foodFinishTemperatureF < GUI_SETTINGS_FOOD_TEMP_MAX)
+        c.foodFinishTemperatureF++;
+}
+void decFoodFinishTemp(Configuration &c)
+{
+    if (c.foodFinishTemperatureF > GUI_SETTINGS_FOOD_TEMP_MIN)
+        c.foodFinishTemperatureF--;
+}
+
+// FIRE ALARM ENABLE SWITCH =======================================================================
+static void getIsFireDetectionEnabled(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, c.isFireDetectionEnabled ? "Yes" : "No", size); }
+void incIsFireDetectionEnabled(Configuration &c) { c.isFireDetectionEnabled = !c.isFireDetectionEnabled; }
+void decIsFireDetectionEnabled(Configuration &c) { c.isFireDetectionEnabled = !c.isFireDetectionEnabled; }
+
 // ENABLE MANUAL FAN CONTROL ======================================================================
-static String getIsForcedFan(const Configuration &c) { return c.isForcedFanPWM ? "Yes" : "No"; }
+static void getIsForcedFan(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, c.isForcedFanPWM ? "Yes" : "No", size); }
 void incIsForcedFan(Configuration &c) { c.isForcedFanPWM = !c.isForcedFanPWM; }
 void decIsForcedFan(Configuration &c) { c.isForcedFanPWM = !c.isForcedFanPWM; }
 
 // SET MANUAL FAN PWM VALUE =======================================================================
-static String getForcedFanPWM(const Configuration &c) { return String(c.forcedFanPWM); }
+static void getForcedFanPWM(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "%d", c.forcedFanPWM); }
 void incForcedFanPWM(Configuration &c)
 {
     if (c.forcedFanPWM + GUI_SETTINGS_PWM_STEP <= GUI_SETTINGS_PWM_MAX)
@@ -254,12 +199,15 @@ void decForcedFanPWM(Configuration &c)
 }
 
 // ENABLE MANUAL DOOR CONTROL =====================================================================
-static String getIsForcedDoor(const Configuration &c) { return c.isForcedDoorPosition ? "Yes" : "No"; }
+static void getIsForcedDoor(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, c.isForcedDoorPosition ? "Yes" : "No", size); }
 void incIsForcedDoor(Configuration &c) { c.isForcedDoorPosition = !c.isForcedDoorPosition; }
 void decIsForcedDoor(Configuration &c) { c.isForcedDoorPosition = !c.isForcedDoorPosition; }
 
+// BLOWER AIRFLOW CALIBRATION, selecting the row starts or stops the sweep ========================
+static void getBlowerAirflowMap(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, c.isBlowerAirflowCalibrated ? "Measured" : "Linear", size); }
+
 // SET MANUAL DOOR POSITION VALUE =================================================================
-static String getForcedDoorPos(const Configuration &c) { return String(c.forcedDoorPosition) + " deg"; }
+static void getForcedDoorPos(const Configuration &c, char *buffer, size_t size) { snprintf(buffer, size, "%d deg", c.forcedDoorPosition); }
 void incForcedDoorPos(Configuration &c)
 {
     if (c.forcedDoorPosition < 180)
@@ -271,31 +219,62 @@ void decForcedDoorPos(Configuration &c)
         c.forcedDoorPosition -= 1;
 }
 
+// OTA POLICY =====================================================================
+static const char *const OTA_POLICY_NAMES[OTA_POLICY_COUNT] = {"Allow", "Defer", "Refuse"};
+static void getOTAPolicy(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, OTA_POLICY_NAMES[c.otaPolicy % OTA_POLICY_COUNT], size); }
+void incOTAPolicy(Configuration &c)
+{
+    c.otaPolicy = static_cast<OTAPolicy>((c.otaPolicy + 1) % OTA_POLICY_COUNT);
+}
+void decOTAPolicy(Configuration &c)
+{
+    c.otaPolicy = static_cast<OTAPolicy>((c.otaPolicy + OTA_POLICY_COUNT - 1) % OTA_POLICY_COUNT);
+}
+
+// RUN RESUME AFTER A RESET =======================================================================
+static void getResumeWindow(const Configuration &c, char *buffer, size_t size)
+{
+    if (c.resumeWindowMin > 0)
+        snprintf(buffer, size, "%d min", c.resumeWindowMin);
+    else
+        strlcpy(buffer, "Off", size);
+}
+void incResumeWindow(Configuration &c)
+{
+    c.resumeWindowMin = min(c.resumeWindowMin + RESUME_WINDOW_STEP_MIN, RESUME_WINDOW_MAX_MIN);
+}
+void decResumeWindow(Configuration &c)
+{
+    c.resumeWindowMin = max(c.resumeWindowMin - RESUME_WINDOW_STEP_MIN, 0);
+}
+static void getIsResumeAfterPowerLoss(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, c.isResumeAfterPowerLossEnabled ? "Yes" : "No", size); }
+void incIsResumeAfterPowerLoss(Configuration &c) { c.isResumeAfterPowerLossEnabled = !c.isResumeAfterPowerLossEnabled; }
+void decIsResumeAfterPowerLoss(Configuration &c) { c.isResumeAfterPowerLossEnabled = !c.isResumeAfterPowerLossEnabled; }
+
 // ENABLE MANUAL DOOR CONTROL =====================================================================
-static String getIsWifiEnabled(const Configuration &c) { return c.isWiFiEnabled ? "Yes" : "No"; }
+static void getIsWifiEnabled(const Configuration &c, char *buffer, size_t size) { strlcpy(buffer, c.isWiFiEnabled ? "Yes" : "No", size); }
 void incIsWifiEnabled(Configuration &c) { c.isWiFiEnabled = !c.isWiFiEnabled; }
 void decIsWifiEnabled(Configuration &c) { c.isWiFiEnabled = !c.isWiFiEnabled; }
 
 const char *WIFI_CHAR_SET = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789!@#$%^&*()-_=+";
 const int wifiCharSetLen = strlen(WIFI_CHAR_SET);
 
-static const SettingItem SETTINGS_LIST[] = {
+// Items listed before the control strategy parameters
+static const SettingItem SETTINGS_HEAD_LIST[] = {
     {"Target Temp", getTargetTemp, incTargetTemp, decTargetTemp},
     {"Contol Interval", getInterval, incInterval, decInterval},
     {"Temp Profiling", getIsTemperatureProfilingEnabled, incIsTemperatureProfilingEnabled, decIsTemperatureProfilingEnabled},
     {"Profile Steps", getTemperatureProfileStepsCount, incTemperatureProfileStepsCount, decTemperatureProfileStepsCount},
 
     {"Edit Temp Profiles", nullptr, nullptr, nullptr},
+    {"Profile Pit Band", getProfilePitBand, incProfilePitBand, decProfilePitBand},
 
-    {"PID Enabled", getPIDEnabled, incPIDEnabled, decPIDEnabled},
-    {"PID kP", getKP, incKP, decKP},
-    {"PID kI", getKI, incKI, decKI},
-    {"PID kD", getKD, incKD, decKD},
+    {"Food Finish", getFoodFinishTemp, incFoodFinishTemp, decFoodFinishTemp},
 
-    {"BangBang Band", getBangBangBand, incBangBangBand, decBangBangBand},
-    {"BangBang Hyst", getBangBangHyst, incBangBangHyst, decBangBangHyst},
-    {"BangBang Fan PWM", getBangBangFan, incBangBangFan, decBangBangFan},
+    {"Control Algo", getControlAlgorithm, incControlAlgorithm, decControlAlgorithm}};
 
+// Items listed after the control strategy parameters, the last four are handled by commandSelect()
+static const SettingItem SETTINGS_TAIL_LIST[] = {
     {"Door Open Pos", getDoorOpenPos, incDoorOpenPos, decDoorOpenPos},
     {"Door Close Pos", getDoorClosePos, incDoorClosePos, decDoorClosePos},
 
@@ -309,11 +288,20 @@ static const SettingItem SETTINGS_LIST[] = {
 
     {"Sim. Themometer", getIsThemometerSimulated, incIsThemometerSimulated, decIsThemometerSimulated},
 
+    {"Lid Detect", getIsLidDetectionEnabled, incIsLidDetectionEnabled, decIsLidDetectionEnabled},
+    {"Fire Alarm", getIsFireDetectionEnabled, incIsFireDetectionEnabled, decIsFireDetectionEnabled},
+
     {"Manual Fan", getIsForcedFan, incIsForcedFan, decIsForcedFan},
     {"Forced Fan PWM", getForcedFanPWM, incForcedFanPWM, decForcedFanPWM},
     {"Manual Door", getIsForcedDoor, incIsForcedDoor, decIsForcedDoor},
     {"Forced Door Pos", getForcedDoorPos, incForcedDoorPos, decForcedDoorPos},
 
+    {"OTA While Cooking", getOTAPolicy, incOTAPolicy, decOTAPolicy},
+    {"Resume Window", getResumeWindow, incResumeWindow, decResumeWindow},
+    {"Resume Power Loss", getIsResumeAfterPowerLoss, incIsResumeAfterPowerLoss, decIsResumeAfterPowerLoss},
+
+    {"Fan Calibrate", getBlowerAirflowMap, nullptr, nullptr},
+
     {"Enable WiFi", getIsWifiEnabled, incIsWifiEnabled, decIsWifiEnabled},
     {"WiFi SSID", nullptr, nullptr, nullptr},
     {"WiFi Password", nullptr, nullptr, nullptr},
@@ -322,17 +310,14 @@ static const SettingItem SETTINGS_LIST[] = {
 
     {"Exit", nullptr, nullptr, nullptr}};
 
-static constexpr int SETTINGS_COUNT = sizeof(SETTINGS_LIST) / sizeof(SETTINGS_LIST[0]);
-static constexpr int SETTINGS_TEMP_PROFILE_START_INDEX = 4;             // Index of the first temperature profile setting
-static constexpr int SETTINGS_WIFI_SSID_INDEX = SETTINGS_COUNT - 4;     // Index of WiFi SSID setting
-static constexpr int SETTINGS_WIFI_PASSWORD_INDEX = SETTINGS_COUNT - 3; // Index of WiFi Password setting
-static constexpr int SETTINGS_REBOOT_INDEX = SETTINGS_COUNT - 2;        // Index of WiFi Password setting
-static constexpr int SETTINGS_EXIT_INDEX = SETTINGS_COUNT - 1;          // Index of the last editable setting
+static constexpr int SETTINGS_HEAD_COUNT = sizeof(SETTINGS_HEAD_LIST) / sizeof(SETTINGS_HEAD_LIST[0]);
+static constexpr int SETTINGS_TAIL_COUNT = sizeof(SETTINGS_TAIL_LIST) / sizeof(SETTINGS_TAIL_LIST[0]);
+static constexpr int SETTINGS_TEMP_PROFILE_START_INDEX = 4; // Index of the first temperature profile setting
 
 // ========================================== TEMP PROFILE SETTINGS LIST ==============================
-static String getTempProfileStepType(const TempProfileStep &step)
+static void getTempProfileStepType(const TempProfileStep &step, char *buffer, size_t size)
 {
-    return step.type == TEMP_PROFILE_TYPE_RAMP ? "Ramp" : "Dwell";
+    strlcpy(buffer, step.type == TEMP_PROFILE_TYPE_RAMP ? "Ramp" : "Dwell", size);
 }
 void incTempProfileStepType(TempProfileStep &step)
 {
@@ -343,9 +328,9 @@ void decTempProfileStepType(TempProfileStep &step)
     step.type = (step.type == TEMP_PROFILE_TYPE_RAMP) ? TEMP_PROFILE_TYPE_DWELL : TEMP_PROFILE_TYPE_RAMP;
 }
 
-static String getTempProfileDuration(const TempProfileStep &step)
+static void getTempProfileDuration(const TempProfileStep &step, char *buffer, size_t size)
 {
-    return String(step.timeMSec / (60 * 1000)) + " min";
+    snprintf(buffer, size, "%lu min", step.timeMSec / (60 * 1000));
 }
 void incTempProfileDuration(TempProfileStep &step)
 {
@@ -371,9 +356,9 @@ void decTempProfileDuration(TempProfileStep &step)
     else
         step.timeMSec = GUI_SETTINGS_TEMP_PROFILE_DURATION_MIN;
 }
-static String getTempProfileT1(const TempProfileStep &step)
+static void getTempProfileT1(const TempProfileStep &step, char *buffer, size_t size)
 {
-    return String(step.temperatureStartF) + " F";
+    snprintf(buffer, size, "%d F", step.temperatureStartF);
 }
 void incTempProfileT1(TempProfileStep &step)
 {
@@ -389,9 +374,9 @@ void decTempProfileT1(TempProfileStep &step)
     else
         step.temperatureStartF = GUI_SETTINGS_TEMP_MIN;
 }
-static String getTempProfileT2(const TempProfileStep &step)
+static void getTempProfileT2(const TempProfileStep &step, char *buffer, size_t size)
 {
-    return String(step.temperatureEndF) + " F";
+    snprintf(buffer, size, "%d F", step.temperatureEndF);
 }
 void incTempProfileT2(TempProfileStep &step)
 {
@@ -408,15 +393,127 @@ void decTempProfileT2(TempProfileStep &step)
         step.temperatureEndF = GUI_SETTINGS_TEMP_MIN;
 }
 
+// The advance conditions are picked from presets, a combination set from /config shows as custom
+struct TempProfileAdvancePreset
+{
+    uint8_t conditions; // TempProfileAdvance flags
+    bool isOnAll;       // All conditions must be met
+    const char *label;  // Shown in the step editor
+};
+static const TempProfileAdvancePreset TEMPPROFILE_ADVANCE_PRESETS[] = {
+    {TEMP_PROFILE_ADVANCE_TIME, false, "Time"},
+    {TEMP_PROFILE_ADVANCE_FOOD, false, "Food"},
+    {TEMP_PROFILE_ADVANCE_PIT_HOLD, false, "Pit"},
+    {TEMP_PROFILE_ADVANCE_FOOD | TEMP_PROFILE_ADVANCE_TIME, false, "Fd|Time"},
+    {TEMP_PROFILE_ADVANCE_FOOD | TEMP_PROFILE_ADVANCE_TIME, true, "Fd&Time"},
+    {TEMP_PROFILE_ADVANCE_PIT_HOLD | TEMP_PROFILE_ADVANCE_TIME, false, "Pit|Time"},
+    {TEMP_PROFILE_ADVANCE_PIT_HOLD | TEMP_PROFILE_ADVANCE_TIME, true, "Pit&Time"},
+    {TEMP_PROFILE_ADVANCE_FOOD | TEMP_PROFILE_ADVANCE_PIT_HOLD, false, "Fd|Pit"},
+    {TEMP_PROFILE_ADVANCE_FOOD | TEMP_PROFILE_ADVANCE_PIT_HOLD, true, "Fd&Pit"}};
+static constexpr int TEMPPROFILE_ADVANCE_PRESET_COUNT = sizeof(TEMPPROFILE_ADVANCE_PRESETS) / sizeof(TEMPPROFILE_ADVANCE_PRESETS[0]);
+
+static int findTempProfileAdvancePreset(const TempProfileStep &step)
+{
+    // A single condition matches either way, -1 when no preset matches
+    uint8_t conditions = step.advanceConditions != 0 ? step.advanceConditions : TEMP_PROFILE_ADVANCE_TIME;
+    bool isSingle = (conditions & (conditions - 1)) == 0;
+    for (int i = 0; i < TEMPPROFILE_ADVANCE_PRESET_COUNT; ++i)
+    {
+        const TempProfileAdvancePreset &preset = TEMPPROFILE_ADVANCE_PRESETS[i];
+        if (preset.conditions == conditions && (isSingle || preset.isOnAll == step.isAdvanceOnAll))
+            return i;
+    }
+    return -1;
+}
+static void setTempProfileAdvancePreset(TempProfileStep &step, int index)
+{
+    step.advanceConditions = TEMPPROFILE_ADVANCE_PRESETS[index].conditions;
+    step.isAdvanceOnAll = TEMPPROFILE_ADVANCE_PRESETS[index].isOnAll;
+}
+static void getTempProfileAdvance(const TempProfileStep &step, char *buffer, size_t size)
+{
+    int index = findTempProfileAdvancePreset(step);
+    strlcpy(buffer, index >= 0 ? TEMPPROFILE_ADVANCE_PRESETS[index].label : "Custom", size);
+}
+void incTempProfileAdvance(TempProfileStep &step)
+{
+    int index = findTempProfileAdvancePreset(step);
+    setTempProfileAdvancePreset(step, (index + 1) % TEMPPROFILE_ADVANCE_PRESET_COUNT);
+}
+void decTempProfileAdvance(TempProfileStep &step)
+{
+    int index = findTempProfileAdvancePreset(step);
+    setTempProfileAdvancePreset(step, index > 0 ? index - 1 : TEMPPROFILE_ADVANCE_PRESET_COUNT - 1);
+}
+
+static void getTempProfileAdvanceFood(const TempProfileStep &step, char *buffer, size_t size)
+{
+    snprintf(buffer, size, "%d F", step.advanceFoodF);
+}
+void incTempProfileAdvanceFood(TempProfileStep &step)
+{
+    if (step.advanceFoodF < GUI_SETTINGS_FOOD_TEMP_MAX)
+        step.advanceFoodF++;
+}
+void decTempProfileAdvanceFood(TempProfileStep &step)
+{
+    if (step.advanceFoodF > GUI_SETTINGS_FOOD_TEMP_MIN)
+        step.advanceFoodF--;
+}
+
+static void getTempProfilePitHold(const TempProfileStep &step, char *buffer, size_t size)
+{
+    snprintf(buffer, size, "%lu min", step.advancePitHoldMSec / (60 * 1000));
+}
+void incTempProfilePitHold(TempProfileStep &step)
+{
+    if (step.advancePitHoldMSec + GUI_SETTINGS_PIT_HOLD_STEP <= GUI_SETTINGS_PIT_HOLD_MAX)
+        step.advancePitHoldMSec += GUI_SETTINGS_PIT_HOLD_STEP;
+    else
+        step.advancePitHoldMSec = GUI_SETTINGS_PIT_HOLD_MAX;
+}
+void decTempProfilePitHold(TempProfileStep &step)
+{
+    if (step.advancePitHoldMSec >= GUI_SETTINGS_PIT_HOLD_MIN + GUI_SETTINGS_PIT_HOLD_STEP)
+        step.advancePitHoldMSec -= GUI_SETTINGS_PIT_HOLD_STEP;
+    else
+        step.advancePitHoldMSec = GUI_SETTINGS_PIT_HOLD_MIN;
+}
+
 static const TempProfileItem TEMPPROFILE_SETTINGS_LIST[] = {
     {"Type", getTempProfileStepType, incTempProfileStepType, decTempProfileStepType},
     {"Duration", getTempProfileDuration, incTempProfileDuration, decTempProfileDuration},
     {"Start Temp", getTempProfileT1, incTempProfileT1, decTempProfileT1},
-    {"End Temp", getTempProfileT2, incTempProfileT2, decTempProfileT2}
+    {"End Temp", getTempProfileT2, incTempProfileT2, decTempProfileT2},
+    {"Advance", getTempProfileAdvance, incTempProfileAdvance, decTempProfileAdvance},
+    {"Food Temp", getTempProfileAdvanceFood, incTempProfileAdvanceFood, decTempProfileAdvanceFood},
+    {"Pit Hold", getTempProfilePitHold, incTempProfilePitHold, decTempProfilePitHold}
 
 };
 static constexpr int TEMPPROFILE_SETTINGS_COUNT = sizeof(TEMPPROFILE_SETTINGS_LIST) / sizeof(TEMPPROFILE_SETTINGS_LIST[0]);
 
+// ========================================== TEMPERATURE HISTORY ====================================
+void TemperatureHistory::push_back(const TemperatureHistoryEntry &entry)
+{
+    // The spare entry takes the push that fills the table, the caller decimates right after
+    if (m_count <= GUI_MAX_HISTORY_ENTRIES)
+        m_entries[m_count++] = entry;
+}
+
+void TemperatureHistory::decimate()
+{
+    // Keep the even entries, the lid-open marker of a removed point moves to the point that stays
+    size_t kept = 0;
+    for (size_t i = 0; i < m_count; i += 2)
+    {
+        TemperatureHistoryEntry entry = m_entries[i];
+        if (i + 1 < m_count)
+            entry.isLidOpen |= m_entries[i + 1].isLidOpen;
+        m_entries[kept++] = entry;
+    }
+    m_count = kept;
+}
+
 // ========================================== INTERNAL HELPER METHODS ====================================
 bool operator==(const GuiStateHeader &a, const GuiStateHeader &b)
 {
@@ -522,6 +619,16 @@ SmokeMateGUI::SmokeMateGUI(Adafruit_ST7789 &displayRef, Configuration &config) :
     m_guiState.status.smokerTempF = 0;
     m_guiState.status.foodTempF = 0;
     m_guiState.isControllerRunning = false; // Start with controller not running
+    m_guiState.isLidOpen = false;           // No lid-open event
+    m_guiState.footer.fireAlarm = FIRE_ALARM_NONE;
+    m_guiState.footer.isFoodStalled = false;
+    m_guiState.footer.isCookDone = false;
+    m_guiState.footer.isProfileHolding = false;
+    m_guiState.footer.cookEtaSec = -1;
+    m_guiState.footer.isBlowerCalibrating = false;
+    m_guiState.footer.isOTAUpdating = false;
+    m_guiState.footer.otaProgress = 0;
+    m_guiState.footer.ipAddress[0] = '\0';
     m_guiState.status.fanPercent = 0;       // Start with fan off
     m_guiState.status.doorPercent = 0;      // Start with door closed
     m_guiState.controllerStartTimeMSec = 0; // Start with zero controller start time
@@ -529,12 +636,14 @@ SmokeMateGUI::SmokeMateGUI(Adafruit_ST7789 &displayRef, Configuration &config) :
     m_guiState.settings.scroll = 0;         // Start with scroll at the top
     m_guiState.settings.editingIndex = -1;  // Not editing any setting initially
     // Initialize the history
-    m_guiState.history.clear();
+    m_history.clear();
 
     m_prevGuiState = m_guiState; // Initialize previous state to current state
 
     m_wifiNetworkSSIDs.clear(); // Clear the WiFi SSID list
     m_wifiNetworkRSSIs.clear(); // Clear the WiFi RSSI list
+
+    buildSettingsList();
 }
 
 void SmokeMateGUI::begin()
@@ -575,7 +684,7 @@ void SmokeMateGUI::service(ulong currentTimeMSec)
         if (m_isChartUpdateNeeded)
         {
             m_isChartUpdateNeeded = false; // Reset the flag after drawing
-            drawChartPanel(m_guiState.history);
+            drawChartPanel(m_history);
         }
         break;
 
@@ -672,7 +781,7 @@ void SmokeMateGUI::manageTempChartState(ulong currentTimeMSec)
     if (m_guiState.isControllerRunning && !m_isControllerRunning)
     {
         // Reset the history when the controller starts
-        m_guiState.history.clear();
+        m_history.clear();
         // Reset the last chart update time
         m_chartSampleIntervalMSec = GUI_CHART_UPDATE_INTERVAL_MSEC;
     }
@@ -682,22 +791,16 @@ void SmokeMateGUI::manageTempChartState(ulong currentTimeMSec)
     {
         m_lastChartUpdateTimeMSec = currentTimeMSec;
         // Push the current state to the history
-        m_guiState.history.push_back({currentTimeMSec - m_guiState.controllerStartTimeMSec,
-                                      m_guiState.status.smokerTempF,
-                                      m_guiState.status.foodTempF,
-                                      m_guiState.status.targetTempF});
-        // Deal with the temperature history queue, check for overflow
-        if (m_guiState.history.size() > GUI_MAX_HISTORY_ENTRIES)
+        m_history.push_back({currentTimeMSec - m_guiState.controllerStartTimeMSec,
+                             static_cast<int16_t>(m_guiState.status.smokerTempF),
+                             static_cast<int16_t>(m_guiState.status.foodTempF),
+                             static_cast<int16_t>(m_guiState.status.targetTempF),
+                             m_guiState.isLidOpen});
+        // Deal with the temperature history table, check for overflow
+        if (m_history.size() > GUI_MAX_HISTORY_ENTRIES)
         {
-            // Remove the oldest entry if the queue is full
-            // state.history.pop_front();
-
             // Remove every second data point (keep even indices)
-            for (size_t i = 1; i < m_guiState.history.size();)
-            {
-                m_guiState.history.erase(m_guiState.history.begin() + i);
-                ++i;
-            }
+            m_history.decimate();
             m_chartSampleIntervalMSec *= 2; // Double the interval
         }
         m_isChartUpdateNeeded = true; // Set the flag to indicate that chart update is needed
@@ -708,6 +811,7 @@ void SmokeMateGUI::updateState(const ControllerStatus &controllerStatus, const C
 {
     // Update the GUI state with the controller status
     m_guiState.isControllerRunning = controllerStatus.isRunning;
+    m_guiState.isLidOpen = controllerStatus.lidState == LID_STATE_OPEN;
     m_guiState.status.smokerTempF = controllerStatus.temperatureSmoker;
     m_guiState.status.foodTempF = controllerStatus.temperatureFood;
     m_guiState.status.targetTempF = controllerStatus.temperatureTarget;
@@ -717,14 +821,30 @@ void SmokeMateGUI::updateState(const ControllerStatus &controllerStatus, const C
     m_guiState.footer.isWiFiConnected = controllerStatus.isWiFiConnected;
     m_guiState.footer.RSSI = controllerStatus.RSSI;
     m_guiState.footer.bars = controllerStatus.bars;
-    m_guiState.footer.ipAddress = controllerStatus.ipAddress;
+    strlcpy(m_guiState.footer.ipAddress, controllerStatus.ipAddress, sizeof(m_guiState.footer.ipAddress));
     m_guiState.footer.isControllerRunning = controllerStatus.isRunning;
+    m_guiState.footer.fireAlarm = controllerStatus.fireAlarm;
+    m_guiState.footer.isFoodStalled = controllerStatus.isFoodStalled;
+    m_guiState.footer.isCookDone = controllerStatus.isCookDone;
+    m_guiState.footer.isProfileHolding = controllerStatus.isProfileStepHolding;
+    m_guiState.footer.foodRateFPerHour = controllerStatus.foodRateFPerHour;
+    m_guiState.footer.cookEtaSec = controllerStatus.cookEtaSec;
+    m_guiState.footer.cookEtaLowSec = controllerStatus.cookEtaLowSec;
+    m_guiState.footer.cookEtaHighSec = controllerStatus.cookEtaHighSec;
+    m_guiState.footer.isBlowerCalibrating = controllerStatus.isBlowerCalibrating;
+    m_guiState.footer.calibrationProgress = controllerStatus.blowerCalibrationProgress;
     m_guiState.footer.controllerRunTimeMSec = controllerStatus.controllerStartMSec > 0
                                                   ? (millis() - controllerStatus.controllerStartMSec)
                                                   : 0;
 }
 
-GuiState SmokeMateGUI::getState()
+void SmokeMateGUI::updateOTAState(bool isUpdating, int progress)
+{
+    m_guiState.footer.isOTAUpdating = isUpdating;
+    m_guiState.footer.otaProgress = progress;
+}
+
+const GuiState &SmokeMateGUI::getState() const
 {
     // Return the current GUI state
     return m_guiState;
@@ -760,7 +880,7 @@ void SmokeMateGUI::commandMoveNext()
         break;
     case GUI_STATE_HEADER_SETTINGS_EDIT:
         // Scroll settings in edit mode
-        if (settings.cursor < SETTINGS_COUNT - 1)
+        if (settings.cursor < m_settingsCount - 1)
         {
             settings.cursor++;
             if (settings.cursor >= settings.scroll + GUI_SETTINGS_BLOCK_COUNT)
@@ -776,9 +896,9 @@ void SmokeMateGUI::commandMoveNext()
 
     case GUI_STATE_HEADER_SETTINGS_EDIT_VALUE:
         // Increment the value of the selected setting (not "Exit")
-        if (settings.editingIndex >= 0 && settings.editingIndex < SETTINGS_COUNT - 1)
+        if (settings.editingIndex >= 0 && settings.editingIndex < m_settingsExitIndex)
         {
-            SETTINGS_LIST[settings.editingIndex].incFunc(m_config);
+            incSetting(m_settingsList[settings.editingIndex]);
         }
         break;
 
@@ -886,17 +1006,17 @@ void SmokeMateGUI::commandMovePrevious()
         else
         {
             // Roll to bottom
-            settings.cursor = SETTINGS_COUNT - 1;
-            settings.scroll = SETTINGS_COUNT > GUI_SETTINGS_BLOCK_COUNT
-                                  ? SETTINGS_COUNT - GUI_SETTINGS_BLOCK_COUNT
+            settings.cursor = m_settingsCount - 1;
+            settings.scroll = m_settingsCount > GUI_SETTINGS_BLOCK_COUNT
+                                  ? m_settingsCount - GUI_SETTINGS_BLOCK_COUNT
                                   : 0;
         }
         break;
     case GUI_STATE_HEADER_SETTINGS_EDIT_VALUE:
         // Decrement the value of the selected setting (not "Exit")
-        if (settings.editingIndex >= 0 && settings.editingIndex < SETTINGS_COUNT - 1)
+        if (settings.editingIndex >= 0 && settings.editingIndex < m_settingsExitIndex)
         {
-            SETTINGS_LIST[settings.editingIndex].decFunc(m_config);
+            decSetting(m_settingsList[settings.editingIndex]);
         }
         break;
 
@@ -1002,22 +1122,27 @@ void SmokeMateGUI::commandSelect()
         // Here you would typically handle the settings editing logic
         // For now, we will just reset to the settings state
         // If "Exit" is selected, leave edit mode
-        if (settings.cursor == SETTINGS_EXIT_INDEX)
+        if (settings.cursor == m_settingsExitIndex)
         {
             header.state = GUI_STATE_HEADER_SETTINGS;
         }
-        else if (settings.cursor == SETTINGS_REBOOT_INDEX)
+        else if (settings.cursor == m_settingsRebootIndex)
         {
-            // Reboot the esp32 hadware commnand
-            ESP.restart();
+            // Reboot through the control loop, it writes the pending settings first
+            publishEvent(EVENT_RESTART_REQUESTED);
         }
-        else if (settings.cursor == SETTINGS_WIFI_SSID_INDEX)
+        else if (settings.cursor == m_settingsBlowerCalibrationIndex)
+        {
+            // Start or stop the airflow calibration sweep, the main loop owns the actuators
+            publishEvent(EVENT_CALIBRATION_REQUESTED);
+        }
+        else if (settings.cursor == m_settingsWiFiSSIDIndex)
         {
             header.state = GUI_STATE_HEADER_SETTINGS_EDIT_WIFI_SSID; // Move to WiFi SSID edit state
             startWiFiScan();                                         // Start WiFi scan to populate available networks
             settings.wifiSSIDIndex = 0;                              // Reset the WiFi SSID index
         }
-        else if (settings.cursor == SETTINGS_WIFI_PASSWORD_INDEX)
+        else if (settings.cursor == m_settingsWiFiPasswordIndex)
         {
             header.state = GUI_STATE_HEADER_SETTINGS_EDIT_WIFI_PASSWORD; // Move to WiFi Password edit state
             // Reset the WiFi password character index
@@ -1043,7 +1168,7 @@ void SmokeMateGUI::commandSelect()
     case GUI_STATE_HEADER_SETTINGS_EDIT_VALUE:
         header.state = GUI_STATE_HEADER_SETTINGS_EDIT; // Move back to settings edit state
         settings.editingIndex = -1;                    // Reset the editing index
-        m_isNVRAMSaveRequired = true;                  // Set the flag to indicate that NVRAM save is required
+        publishEvent(EVENT_SAVE_REQUESTED);            // Request an NVRAM save
         break;
 
     case GUI_STATE_HEADER_SETTINGS_EDIT_WIFI_SSID:
@@ -1053,7 +1178,7 @@ void SmokeMateGUI::commandSelect()
         m_config.wifiSSID[sizeof(m_config.wifiSSID) - 1] = '\0'; // Ensure null termination
         // Exit WiFi SSID selection
         header.state = GUI_STATE_HEADER_SETTINGS_EDIT; // Move back to settings edit state
-        m_isNVRAMSaveRequired = true;                  // Set the flag to indicate that NVRAM save is required
+        publishEvent(EVENT_SAVE_REQUESTED);            // Request an NVRAM save
         // clear the wifi password for the next SSID
         m_config.wifiPassword[0] = '\0';
         break;
@@ -1088,7 +1213,7 @@ void SmokeMateGUI::commandSelect()
         header.state = GUI_STATE_HEADER_SETTINGS_TEMP_PROFILE_STEP;
         m_isForcedGUIUpdate = true;                 // Force GUI update
         m_guiState.tempProfileEdit.editing = false; // Set editing to false
-        m_isNVRAMSaveRequired = true;               // Set the flag to indicate that NVRAM save is required
+        publishEvent(EVENT_SAVE_REQUESTED);         // Request an NVRAM save
         break;
 
     default:
@@ -1138,7 +1263,7 @@ void SmokeMateGUI::commandConfirm()
         m_config.wifiPassword[sizeof(m_config.wifiPassword) - 1] = '\0';
         m_wifiPasswordBuffer[0] = '\0'; // Clear buffer for next time
         header.state = GUI_STATE_HEADER_SETTINGS_EDIT;
-        m_isNVRAMSaveRequired = true;
+        publishEvent(EVENT_SAVE_REQUESTED);
         m_isForcedGUIUpdate = true;
         break;
 
@@ -1152,7 +1277,7 @@ void SmokeMateGUI::commandConfirm()
     case GUI_STATE_HEADER_SETTINGS_TEMP_PROFILE_STEP:
         header.state = GUI_STATE_HEADER_SETTINGS_TEMP_PROFILE; // Move back to temperature profile settings state
         m_guiState.tempProfileEdit.editing = false;
-        m_isNVRAMSaveRequired = true;
+        publishEvent(EVENT_SAVE_REQUESTED);
         m_isForcedGUIUpdate = true;
         break;
 
@@ -1164,15 +1289,24 @@ void SmokeMateGUI::commandConfirm()
     }
 }
 
-bool SmokeMateGUI::isNVRAMSaveRequired()
+bool SmokeMateGUI::isEditing()
+{
+    // Settings are edited in place in every state below the three top level headers
+    GUI_STATE_ACTIVE_HEADER state = m_guiState.header.state;
+    return state != GUI_STATE_HEADER_STATUS && state != GUI_STATE_HEADER_CHART && state != GUI_STATE_HEADER_SETTINGS;
+}
+
+void SmokeMateGUI::setEventBus(EventBus *eventBus)
 {
-    // Check if NVRAM save is required
-    if (m_isNVRAMSaveRequired)
+    m_eventBus = eventBus;
+}
+
+void SmokeMateGUI::publishEvent(EventType type)
+{
+    if (m_eventBus != nullptr)
     {
-        m_isNVRAMSaveRequired = false; // Reset the flag after checking
-        return true;                   // Indicate that NVRAM save is required
+        m_eventBus->publish(type, EVENT_SOURCE_GUI);
     }
-    return false; // No NVRAM save required
 }
 
 // ========================================== PRIVATE METHODS ==========================================
@@ -1220,16 +1354,25 @@ void SmokeMateGUI::drawHeader(const GuiStateHeader &header)
 
 void SmokeMateGUI::drawFooter(const GuiState &state, ulong elapsedMillis)
 {
+    METRICS_SCOPE("gui_draw_footer");
     char timeStr[9];
     m_tft.setTextSize(2);
     m_tft.setTextColor(COLOR_TEXT);
 
-    String statusText = state.isControllerRunning ? "ON" : "OFF";
+    const char *statusText = state.isControllerRunning ? "ON" : "OFF";
 
     if (state.isControllerRunning)
     {
-        // Draw the footer background
-        m_tft.fillRect(0, GUI_FOOTER_Y_OFFSET, SCREEN_WIDTH, GUI_FOOTER_HEIGHT, COLOR_HEADER_ACTIVE);
+        // Draw the footer background, red while the fire needs attention
+        if (state.footer.fireAlarm != FIRE_ALARM_NONE)
+        {
+            m_tft.fillRect(0, GUI_FOOTER_Y_OFFSET, SCREEN_WIDTH, GUI_FOOTER_HEIGHT, COLOR_FOOTER_ALARM);
+            statusText = state.footer.fireAlarm == FIRE_ALARM_OUT ? "OUT" : "FIRE";
+        }
+        else
+        {
+            m_tft.fillRect(0, GUI_FOOTER_Y_OFFSET, SCREEN_WIDTH, GUI_FOOTER_HEIGHT, COLOR_HEADER_ACTIVE);
+        }
 
         unsigned long totalSeconds = elapsedMillis / 1000;
         unsigned long hours = totalSeconds / 3600;
@@ -1257,6 +1400,47 @@ void SmokeMateGUI::drawFooter(const GuiState &state, ulong elapsedMillis)
         drawWiFiIcon(GUI_FOOTER_WIFI_X_OFFSET, GUI_FOOTER_Y_OFFSET, m_guiState.footer.bars, m_guiState.footer.isWiFiConnected);
     }
 
+    if (state.footer.isOTAUpdating)
+    {
+        // Firmware upload progress in place of the completion time, the control keeps running
+        m_tft.setTextSize(1);
+        m_tft.setCursor(GUI_FOOTER_ETA_X_OFFSET, GUI_FOOTER_Y_OFFSET + 2);
+        m_tft.print("OTA");
+        m_tft.setCursor(GUI_FOOTER_ETA_X_OFFSET, GUI_FOOTER_Y_OFFSET + 11);
+        m_tft.printf("%d%%", state.footer.otaProgress);
+        m_tft.setTextSize(2);
+    }
+    else if (state.isControllerRunning)
+    {
+        // Cook completion time on two small rows next to the status
+        char etaStr[12];
+        if (state.footer.isCookDone)
+            snprintf(etaStr, sizeof(etaStr), "DONE");
+        else if (state.footer.isFoodStalled)
+            snprintf(etaStr, sizeof(etaStr), "STALL");
+        else if (state.footer.isProfileHolding)
+            snprintf(etaStr, sizeof(etaStr), "HOLD");
+        else
+            formatEta(etaStr, sizeof(etaStr), state.footer.cookEtaSec);
+        m_tft.setTextSize(1);
+        m_tft.setCursor(GUI_FOOTER_ETA_X_OFFSET, GUI_FOOTER_Y_OFFSET + 2);
+        m_tft.print("ETA");
+        m_tft.setCursor(GUI_FOOTER_ETA_X_OFFSET, GUI_FOOTER_Y_OFFSET + 11);
+        m_tft.print(etaStr);
+        m_tft.setTextSize(2);
+    }
+    else if (state.footer.isBlowerCalibrating)
+    {
+        // Calibration sweep progress in place of the completion time
+        statusText = "CAL";
+        m_tft.setTextSize(1);
+        m_tft.setCursor(GUI_FOOTER_ETA_X_OFFSET, GUI_FOOTER_Y_OFFSET + 2);
+        m_tft.print("FAN");
+        m_tft.setCursor(GUI_FOOTER_ETA_X_OFFSET, GUI_FOOTER_Y_OFFSET + 11);
+        m_tft.printf("%d%%", state.footer.calibrationProgress);
+        m_tft.setTextSize(2);
+    }
+
     m_tft.setCursor(6, GUI_FOOTER_Y_OFFSET + 2);
     m_tft.print(statusText);
     m_tft.setCursor(GUI_FOOTER_CLOCK_X_OFFSET, GUI_FOOTER_Y_OFFSET + 2);
@@ -1265,6 +1449,14 @@ void SmokeMateGUI::drawFooter(const GuiState &state, ulong elapsedMillis)
     // Additional footer information can be added here
 }
 
+void SmokeMateGUI::formatEta(char *buffer, size_t size, long etaSec)
+{
+    if (etaSec < 0)
+        snprintf(buffer, size, "--:--");
+    else
+        snprintf(buffer, size, "%ld:%02ld", etaSec / 3600, (etaSec % 3600) / 60);
+}
+
 void SmokeMateGUI::drawStausPanel(const GuiStateStatus &state)
 {
     char foodTempStr[16];
@@ -1320,8 +1512,9 @@ void SmokeMateGUI::drawStatusBlock(uint16_t x, uint16_t y, uint16_t width, uint1
     m_tft.print(text);
 }
 
-void SmokeMateGUI::drawChartPanel(const std::deque<TemperatureHistoryEntry> &history)
+void SmokeMateGUI::drawChartPanel(const TemperatureHistory &history)
 {
+    METRICS_SCOPE("gui_draw_chart_panel");
     const int chartX = 20;
     const int chartY = GUI_CHART_PANEL_Y_OFFSET + 10;
     const int width = SCREEN_WIDTH - chartX - 10;
@@ -1348,8 +1541,8 @@ void SmokeMateGUI::drawChartPanel(const std::deque<TemperatureHistoryEntry> &his
 
     for (const auto &entry : history)
     {
-        minT = std::min({minT, entry.smokerTempF, entry.foodTempF, entry.targetTempF});
-        maxT = std::max({maxT, entry.smokerTempF, entry.foodTempF, entry.targetTempF});
+        minT = std::min<int>({minT, entry.smokerTempF, entry.foodTempF, entry.targetTempF});
+        maxT = std::max<int>({maxT, entry.smokerTempF, entry.foodTempF, entry.targetTempF});
     }
 
     // Pad by 5°F and round to nearest floor/ceiling ending in 5
@@ -1358,8 +1551,8 @@ void SmokeMateGUI::drawChartPanel(const std::deque<TemperatureHistoryEntry> &his
 
     for (const auto &entry : history)
     {
-        minT = std::min({minT, entry.smokerTempF, entry.foodTempF, entry.targetTempF});
-        maxT = std::max({maxT, entry.smokerTempF, entry.foodTempF, entry.targetTempF});
+        minT = std::min<int>({minT, entry.smokerTempF, entry.foodTempF, entry.targetTempF});
+        maxT = std::max<int>({maxT, entry.smokerTempF, entry.foodTempF, entry.targetTempF});
     }
 
     if (maxT - minT < 10)
@@ -1445,6 +1638,17 @@ void SmokeMateGUI::drawChartPanel(const std::deque<TemperatureHistoryEntry> &his
         m_tft.drawFastVLine(x, chartY + 1, height - 2, COLOR_CHART_GRIDLINES);
     }
 
+    // Lid-open events, drawn behind the temperature lines
+    for (size_t i = 1; i < history.size(); ++i)
+    {
+        if (history[i].isLidOpen)
+        {
+            int x0 = chartX + ((history[i - 1].timestampMSec - minTime) * (width - 1)) / (maxTime - minTime ? maxTime - minTime : 1);
+            int x1 = chartX + ((history[i].timestampMSec - minTime) * (width - 1)) / (maxTime - minTime ? maxTime - minTime : 1);
+            m_tft.fillRect(x0, chartY + 1, max(x1 - x0, 1), height - 2, COLOR_CHART_LID_OPEN);
+        }
+    }
+
     // --- Draw Legend (top right corner) ---
     int legendX = chartX + width - 50;
     int legendY = chartY + 8;
@@ -1464,6 +1668,32 @@ void SmokeMateGUI::drawChartPanel(const std::deque<TemperatureHistoryEntry> &his
 
     m_tft.setTextColor(ST77XX_WHITE); // Reset to default for other text
 
+    // --- Cook prediction (top left corner) ---
+    const GuiStateFooter &cook = m_guiState.footer;
+    char cookStr[40];
+    if (cook.isCookDone)
+    {
+        snprintf(cookStr, sizeof(cookStr), "Food done");
+    }
+    else if (cook.isFoodStalled)
+    {
+        snprintf(cookStr, sizeof(cookStr), "Stall %.1f F/h", cook.foodRateFPerHour);
+    }
+    else if (cook.cookEtaSec >= 0)
+    {
+        char etaStr[12], etaLowStr[12], etaHighStr[12];
+        formatEta(etaStr, sizeof(etaStr), cook.cookEtaSec);
+        formatEta(etaLowStr, sizeof(etaLowStr), cook.cookEtaLowSec);
+        formatEta(etaHighStr, sizeof(etaHighStr), cook.cookEtaHighSec);
+        snprintf(cookStr, sizeof(cookStr), "ETA %s (%s-%s)", etaStr, etaLowStr, etaHighStr);
+    }
+    else
+    {
+        cookStr[0] = '\0';
+    }
+    m_tft.setCursor(chartX + 6, chartY + 8);
+    m_tft.print(cookStr);
+
     // Draw lines for smoker, food, and target temps
     for (size_t i = 1; i < history.size(); ++i)
     {
@@ -1498,8 +1728,69 @@ void SmokeMateGUI::drawChartPanel(const std::deque<TemperatureHistoryEntry> &his
     }
 }
 
+void SmokeMateGUI::buildSettingsList()
+{
+    m_settingsCount = 0;
+
+    for (int i = 0; i < SETTINGS_HEAD_COUNT; ++i)
+        m_settingsList[m_settingsCount++] = SETTINGS_HEAD_LIST[i];
+
+    // Every control strategy contributes a row per declared parameter
+    for (int i = 0; i < CONTROL_ALGORITHM_COUNT; ++i)
+    {
+        const ControlStrategy &strategy = CONTROL_STRATEGIES[i];
+        for (int j = 0; j < strategy.parameterCount && m_settingsCount < GUI_SETTINGS_MAX_COUNT - SETTINGS_TAIL_COUNT; ++j)
+        {
+            m_settingsList[m_settingsCount++] = {strategy.parameters[j].label, nullptr, nullptr, nullptr, &strategy.parameters[j]};
+        }
+    }
+
+    for (int i = 0; i < SETTINGS_TAIL_COUNT; ++i)
+        m_settingsList[m_settingsCount++] = SETTINGS_TAIL_LIST[i];
+
+    m_settingsBlowerCalibrationIndex = m_settingsCount - 6;
+    m_settingsWiFiSSIDIndex = m_settingsCount - 4;
+    m_settingsWiFiPasswordIndex = m_settingsCount - 3;
+    m_settingsRebootIndex = m_settingsCount - 2;
+    m_settingsExitIndex = m_settingsCount - 1;
+}
+
+void SmokeMateGUI::getSettingValue(const SettingItem &item, char *buffer, size_t size)
+{
+    if (item.parameter)
+    {
+        const ControlParameter &parameter = *item.parameter;
+        snprintf(buffer, size, "%.*f", parameter.decimalPlaces, getControlParameter(m_config, parameter));
+    }
+    else if (item.getValue)
+    {
+        item.getValue(m_config, buffer, size);
+    }
+    else
+    {
+        buffer[0] = '\0';
+    }
+}
+
+void SmokeMateGUI::incSetting(const SettingItem &item)
+{
+    if (item.parameter)
+        setControlParameter(m_config, *item.parameter, getControlParameter(m_config, *item.parameter) + item.parameter->step);
+    else if (item.incFunc)
+        item.incFunc(m_config);
+}
+
+void SmokeMateGUI::decSetting(const SettingItem &item)
+{
+    if (item.parameter)
+        setControlParameter(m_config, *item.parameter, getControlParameter(m_config, *item.parameter) - item.parameter->step);
+    else if (item.decFunc)
+        item.decFunc(m_config);
+}
+
 void SmokeMateGUI::drawSettingsPanel(const GuiState &state)
 {
+    METRICS_SCOPE("gui_draw_settings_panel");
 
     m_tft.fillRect(0, GUI_SETTINGS_PANEL_Y_OFFSET, SCREEN_WIDTH, GUI_SETTINGS_PANEL_HEIGHT, COLOR_BG);
 
@@ -1508,7 +1799,7 @@ void SmokeMateGUI::drawSettingsPanel(const GuiState &state)
     m_tft.setTextSize(2);
 
     int startIdx = state.settings.scroll;
-    int endIdx = min(startIdx + GUI_SETTINGS_BLOCK_COUNT, SETTINGS_COUNT);
+    int endIdx = min(startIdx + GUI_SETTINGS_BLOCK_COUNT, m_settingsCount);
 
     for (int i = startIdx; i < endIdx; ++i)
     {
@@ -1536,25 +1827,22 @@ void SmokeMateGUI::drawSettingsPanel(const GuiState &state)
         m_tft.setCursor(GUI_SETTINGS_LABEL_OFFSET, blockY + 2);
         m_tft.setTextColor(COLOR_TEXT);
 
-        if (i == SETTINGS_WIFI_SSID_INDEX)
+        if (i == m_settingsWiFiSSIDIndex)
         {
-            // append the SSID label to the settings list item from the config
-            String ssidDisplay = m_config.wifiSSID;
-            if (ssidDisplay.length() > MAX_WIFI_SSID_LENGTH)
-            {
-                ssidDisplay = ssidDisplay.substring(0, MAX_WIFI_SSID_LENGTH);
-            }
-            m_tft.print(String(SETTINGS_LIST[i].label) + ": " + ssidDisplay);
+            // append the SSID label to the settings list item from the config, the SSID cut to fit
+            m_tft.printf("%s: %.*s", m_settingsList[i].label, MAX_WIFI_SSID_LENGTH, m_config.wifiSSID);
         }
         else
         {
-            m_tft.print(SETTINGS_LIST[i].label);
+            m_tft.print(m_settingsList[i].label);
         }
 
-        if (SETTINGS_LIST[i].getValue)
+        if (m_settingsList[i].getValue || m_settingsList[i].parameter)
         {
+            char value[GUI_SETTING_VALUE_LENGTH];
+            getSettingValue(m_settingsList[i], value, sizeof(value));
             m_tft.setCursor(GUI_SETTINGS_VALUE_OFFSET, blockY + 2);
-            m_tft.print(SETTINGS_LIST[i].getValue(m_config));
+            m_tft.print(value);
         }
     }
 }
@@ -1573,13 +1861,7 @@ void SmokeMateGUI::drawWiFiSelectPanel()
             m_tft.fillRect(0, blockY + 1, SCREEN_WIDTH, GUI_SETTINGS_BLOCK_HEIGHT - 1, COLOR_HEADER_PRIMARY);
         m_tft.setCursor(GUI_SETTINGS_LABEL_OFFSET, blockY + 2);
         // Print the SSID and (RSSI) in parentheses
-        String ssidDisplay = m_wifiNetworkSSIDs[i];
-        if (ssidDisplay.length() > MAX_WIFI_SSID_LENGTH)
-        {
-            ssidDisplay = ssidDisplay.substring(0, MAX_WIFI_SSID_LENGTH);
-        }
-        String wifiInfo = ssidDisplay + " (" + String(m_wifiNetworkRSSIs[i]) + ")";
-        m_tft.print(wifiInfo);
+        m_tft.printf("%.*s (%d)", MAX_WIFI_SSID_LENGTH, m_wifiNetworkSSIDs[i].c_str(), m_wifiNetworkRSSIs[i]);
     }
 }
 
@@ -1668,13 +1950,16 @@ void SmokeMateGUI::drawTempProfileStepLine(int n, TempProfileStep &step, bool se
     // Step duration in minutes
     // Step starting temperature in F
     // Step end temperature in F (if applicable, only for Ramp steps)
-    String text = String(n + 1) + " " + (step.type == TEMP_PROFILE_TYPE_DWELL ? "Dwell" : "Ramp") +
-                  " " + String(step.timeMSec / (60 * 1000)) + " min " + step.temperatureStartF;
-    if (step.type == TEMP_PROFILE_TYPE_RAMP)
+    // A '*' after the index marks a step ending on advance conditions
+    bool isConditional = step.advanceConditions != 0 && step.advanceConditions != TEMP_PROFILE_ADVANCE_TIME;
+    char text[48];
+    int length = snprintf(text, sizeof(text), "%d%c%s %lu min %d", n + 1, isConditional ? '*' : ' ',
+                          step.type == TEMP_PROFILE_TYPE_DWELL ? "Dwell" : "Ramp", step.timeMSec / (60 * 1000), step.temperatureStartF);
+    if (step.type == TEMP_PROFILE_TYPE_RAMP && length > 0 && length < static_cast<int>(sizeof(text)))
     {
-        text += "-" + String(step.temperatureEndF);
+        snprintf(text + length, sizeof(text) - length, "-%d", step.temperatureEndF);
     }
-    text += " F";
+    strlcat(text, " F", sizeof(text));
 
     // Draw the label
     m_tft.setCursor(GUI_SETTINGS_LABEL_OFFSET, y + 4);
@@ -1715,7 +2000,9 @@ void SmokeMateGUI::drawTempProfileStepPanel(const GuiStateTempProfile &tempProfi
 
         m_tft.setCursor(GUI_SETTINGS_LABEL_OFFSET, y + 4);
         m_tft.print(TEMPPROFILE_SETTINGS_LIST[i].label);
+        char value[GUI_SETTING_VALUE_LENGTH];
+        TEMPPROFILE_SETTINGS_LIST[i].getValue(step, value, sizeof(value));
         m_tft.setCursor(GUI_SETTINGS_VALUE_OFFSET, y + 4);
-        m_tft.print(TEMPPROFILE_SETTINGS_LIST[i].getValue(step));
+        m_tft.print(value);
     }
 }
\ No newline at end of file
@@ -3,11 +3,12 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
 #include "types.h"
+#include "controlstrategy.h"
 #include <esp_system.h>
 #include <vector>
 #include <WiFi.h>
 #include "debug.h"
-#include <deque>
+#include "eventbus.h"
 
 // #define GUI_DEBUG
 
@@ -31,12 +32,14 @@
 #define COLOR_HEADER_RUNNING HEX_RGB565(0x008610)  // Orange top/bottom
 #define COLOR_HEADER_ACTIVE HEX_RGB565(0x0083FE)   // Blue for active state
 #define COLOR_HEADER_SELECTED HEX_RGB565(0x003D77) // Dark Blue for active selected state
+#define COLOR_FOOTER_ALARM HEX_RGB565(0xD00000)    // Red footer while a fire alarm is raised
 #define COLOR_TEXT HEX_RGB565(0xFFFFFF)
 
 #define COLOR_CHART_SMOKER HEX_RGB565(0xFF6600)    // Red for smoker temperature
 #define COLOR_CHART_FOOD HEX_RGB565(0x0083FE)      // Green for food temperature
 #define COLOR_CHART_TARGET HEX_RGB565(0x00FFD0)    // Blue for target temperature
 #define COLOR_CHART_GRIDLINES HEX_RGB565(0x202020) // Black for chart background
+#define COLOR_CHART_LID_OPEN HEX_RGB565(0x4A2A00)  // Dark amber band for lid-open events
 
 // GUI CONSTANTS ==================================================================================
 
@@ -51,6 +54,7 @@
 #define GUI_FOOTER_CLOCK_X_OFFSET 220 // Offset for the clock in the footer
 #define GUI_FOOTER_WIFI_X_OFFSET 190  // Offset for the WiFi icon in the footer
 #define GUI_FOOTER_IP_X_OFFSET 100    // Offset for the IP address in the footer
+#define GUI_FOOTER_ETA_X_OFFSET 58    // Offset for the cook completion time in the footer
 
 #define GUI_STATUS_PANEL_Y_OFFSET GUI_HEADER_HEIGHT                       // Y offset for the status canvas
 #define GUI_STATUS_PANEL_HEIGHT (GUI_FOOTER_Y_OFFSET - GUI_HEADER_HEIGHT) // Height of the status canvas
@@ -67,14 +71,15 @@
 #define GUI_SETTINGS_BLOCK_HEIGHT (GUI_SETTINGS_PANEL_HEIGHT / GUI_SETTINGS_BLOCK_COUNT)
 #define GUI_SETTINGS_VALUE_OFFSET 220 // Offset for the value in settings panel
 #define GUI_SETTINGS_LABEL_OFFSET 10  // Offset for the label in settings panel
+#define GUI_SETTINGS_MAX_COUNT 48     // Capacity of the settings list, including the control strategy parameters
+#define GUI_SETTING_VALUE_LENGTH 24   // Formatted setting value and the terminator
 
 // --- Temperature settings edit constants
 #define GUI_SETTINGS_TEMP_MIN 100
 #define GUI_SETTINGS_TEMP_MAX 500
 #define GUI_SETTINGS_TEMP_STEP 5
-#define GUI_SETTINGS_TEMP_BB_BAND_STEP 1
-#define GUI_SETTINGS_TEMP_BB_BAND_MIN 1
-#define GUI_SETTINGS_TEMP_BB_BAND_MAX 50
+#define GUI_SETTINGS_FOOD_TEMP_MIN 100
+#define GUI_SETTINGS_FOOD_TEMP_MAX 250
 
 // --- Time interval (step: 1 second, min: 1s, max: 60s) ---
 #define GUI_SETTINGS_INTERVAL_MIN 1000
@@ -86,17 +91,16 @@
 #define GUI_SETTINGS_PWM_MAX 255
 #define GUI_SETTINGS_PWM_STEP 5
 
-// PID settings edit constants
-#define GUI_SETTINGS_PID_K_MIN 0.0f
-#define GUI_SETTINGS_PID_K_MAX 10.0f
-#define GUI_SETTINGS_PID_K_STEP 0.1f
-#define GUI_SETTINGS_PID_K_DECIMAL_PLACES 2 // Decimal places for PID settings
-
 // Temperature profile duration constants
 #define GUI_SETTINGS_TEMP_PROFILE_DURATION_MIN 1 * 60 * 1000       // 10 minutes in milliseconds
 #define GUI_SETTINGS_TEMP_PROFILE_DURATION_MAX 12 * 60 * 60 * 1000 // 12 hours in milliseconds
 #define GUI_SETTINGS_TEMP_PROFILE_DURATION_STEP 1 * 60 * 1000      // 1 minute in milliseconds
 
+// Temperature profile advance condition constants
+#define GUI_SETTINGS_PIT_HOLD_MIN 1 * 60 * 1000      // 1 minute in milliseconds
+#define GUI_SETTINGS_PIT_HOLD_MAX 4 * 60 * 60 * 1000 // 4 hours in milliseconds
+#define GUI_SETTINGS_PIT_HOLD_STEP 1 * 60 * 1000     // 1 minute in milliseconds
+
 enum GUI_STATE_ACTIVE_HEADER
 {
     GUI_STATE_HEADER_STATUS,
@@ -115,9 +119,30 @@ enum GUI_STATE_ACTIVE_HEADER
 struct TemperatureHistoryEntry
 {
     ulong timestampMSec;
-    int smokerTempF;
-    int foodTempF;
-    int targetTempF;
+    int16_t smokerTempF;
+    int16_t foodTempF;
+    int16_t targetTempF;
+    bool isLidOpen; // Lid-open event in progress, drawn as a band on the chart
+};
+
+// Chart history in a fixed table, halved in place when full instead of growing on the heap
+class TemperatureHistory
+{
+public:
+    void clear() { m_count = 0; }
+    void push_back(const TemperatureHistoryEntry &entry);
+    void decimate();
+
+    size_t size() const { return m_count; }
+    const TemperatureHistoryEntry &operator[](size_t index) const { return m_entries[index]; }
+    const TemperatureHistoryEntry &front() const { return m_entries[0]; }
+    const TemperatureHistoryEntry &back() const { return m_entries[m_count - 1]; }
+    const TemperatureHistoryEntry *begin() const { return m_entries; }
+    const TemperatureHistoryEntry *end() const { return m_entries + m_count; }
+
+private:
+    TemperatureHistoryEntry m_entries[GUI_MAX_HISTORY_ENTRIES + 1]; // One spare entry, decimated right after it is used
+    size_t m_count = 0;                                             // Entries in use
 };
 
 struct GuiStateHeader
@@ -162,12 +187,24 @@ struct GuiStateSettings
 
 struct GuiStateFooter
 {
-    bool isControllerRunning;    // Flag to indicate if the controller is running
-    ulong controllerRunTimeMSec; // Controller run time in milliseconds
-    bool isWiFiConnected;        // Flag to indicate if WiFi is connected
-    String ipAddress;            // IP address of the controller
-    int RSSI;                    // WiFi RSSI value
-    int bars;                    // WiFi signal strength in bars (0-5)
+    bool isControllerRunning;                 // Flag to indicate if the controller is running
+    ulong controllerRunTimeMSec;              // Controller run time in milliseconds
+    bool isWiFiConnected;                     // Flag to indicate if WiFi is connected
+    char ipAddress[STATUS_IP_ADDRESS_LENGTH]; // IP address of the controller
+    int RSSI;                                 // WiFi RSSI value
+    int bars;                                 // WiFi signal strength in bars (0-5)
+    int fireAlarm;                            // Fire alarm raised by the controller (FireAlarm)
+    bool isFoodStalled;                       // Food temperature on a stall plateau
+    bool isCookDone;                          // Food reached the finish temperature
+    bool isProfileHolding;                    // Profile step waiting past its time for its conditions
+    float foodRateFPerHour;                   // Fitted food temperature rise rate
+    long cookEtaSec;                          // Predicted time to the finish temperature, -1 when unknown
+    long cookEtaLowSec;                       // Early end of the prediction band, -1 when unknown
+    long cookEtaHighSec;                      // Late end of the prediction band, -1 when unbounded
+    bool isBlowerCalibrating;                 // Blower airflow calibration sweep in progress
+    int calibrationProgress;                  // Calibration sweep progress in percent
+    bool isOTAUpdating;                       // Firmware upload in progress
+    int otaProgress;                          // Firmware upload progress in percent
 };
 
 struct GuiState
@@ -177,9 +214,9 @@ struct GuiState
     GuiStateSettings settings; // Settings state
     GuiStateFooter footer;     // Footer state
 
-    std::deque<TemperatureHistoryEntry> history;
     bool isControllerRunning;
     ulong controllerStartTimeMSec;
+    bool isLidOpen; // Lid-open event reported by the controller
 
     GuiStateTempProfile tempProfile;
     GuiStateTempProfileEdit tempProfileEdit;
@@ -189,18 +226,19 @@ struct GuiState
 typedef void (*SettingEditFunc)(Configuration &);
 struct SettingItem
 {
-    const char *label;                         // Label for the setting
-    String (*getValue)(const Configuration &); // Function to get the setting value as a string
-    SettingEditFunc incFunc;                   // Function to increment the setting value
-    SettingEditFunc decFunc;                   // Function to decrement the setting value
+    const char *label;                                         // Label for the setting
+    void (*getValue)(const Configuration &, char *, size_t);   // Function to format the setting value into a buffer
+    SettingEditFunc incFunc;                                   // Function to increment the setting value
+    SettingEditFunc decFunc;                                   // Function to decrement the setting value
+    const ControlParameter *parameter;                         // Control strategy parameter edited by this item, if any
 };
 
 struct TempProfileItem
 {
     const char *label;
-    String (*getValue)(const TempProfileStep &); // Function to get the temperature profile step value as a string
-    void (*incFunc)(TempProfileStep &);          // Function to increment the temperature profile step value
-    void (*decFunc)(TempProfileStep &);          // Function to decrement the temperature profile step value
+    void (*getValue)(const TempProfileStep &, char *, size_t); // Function to format the temperature profile step value into a buffer
+    void (*incFunc)(TempProfileStep &);                        // Function to increment the temperature profile step value
+    void (*decFunc)(TempProfileStep &);                        // Function to decrement the temperature profile step value
 };
 
 class SmokeMateGUI
@@ -211,41 +249,57 @@ public:
     void service(ulong currentTimeMSec);
 
     void updateState(const ControllerStatus &controllerStatus, const Configuration &config);
-    GuiState getState();
+    void updateOTAState(bool isUpdating, int progress);
+    const GuiState &getState() const;
     void commandMoveNext();
     void commandMovePrevious();
     void commandSelect();
     void commandConfirm();
 
-    bool isNVRAMSaveRequired();
+    bool isEditing();
+    void setEventBus(EventBus *eventBus);
 
 private:
-    Adafruit_ST7789 &m_tft;  // Reference to the display object
-    GuiState m_guiState;     // Current GUI state
-    GuiState m_prevGuiState; // Previous GUI state for comparison
-    Configuration &m_config; // Reference to the configuration object
+    Adafruit_ST7789 &m_tft;       // Reference to the display object
+    GuiState m_guiState;          // Current GUI state
+    GuiState m_prevGuiState;      // Previous GUI state for comparison
+    TemperatureHistory m_history; // Chart history of the current cook
+    Configuration &m_config;      // Reference to the configuration object
 
     std::vector<String> m_wifiNetworkSSIDs; // List of available WiFi networks
     std::vector<int> m_wifiNetworkRSSIs;    // RSSI values for the available networks
 
     char m_wifiPasswordBuffer[65] = {0};
 
+    SettingItem m_settingsList[GUI_SETTINGS_MAX_COUNT]; // Settings table, built from the fixed items and the control strategies
+    int m_settingsCount = 0;                            // Number of entries in the settings table
+    int m_settingsBlowerCalibrationIndex = 0;           // Index of the blower calibration action
+    int m_settingsWiFiSSIDIndex = 0;                    // Index of the WiFi SSID setting
+    int m_settingsWiFiPasswordIndex = 0;                // Index of the WiFi Password setting
+    int m_settingsRebootIndex = 0;                      // Index of the Reboot setting
+    int m_settingsExitIndex = 0;                        // Index of the Exit setting
+
     bool m_isCommandQueued = false;                                   // Flag to indicate if a command is queued
     bool m_isControllerRunning = false;                               // Flag to indicate if the controller is running
     ulong m_lastChartUpdateTimeMSec = 0;                              // Last time the chart was updated
     bool m_isChartUpdateNeeded = false;                               // Flag to indicate if chart update is needed
     ulong m_chartSampleIntervalMSec = GUI_CHART_UPDATE_INTERVAL_MSEC; // Current sampling interval
-    bool m_isNVRAMSaveRequired = false;                               // Flag to indicate if NVRAM save is required
+    EventBus *m_eventBus = nullptr;                                   // Receives the save and calibration requests
     bool m_isForcedGUIUpdate = false;                                 // Flag to force GUI update
     bool m_isFirstHeaderRender = true;                                // Flag to indicate if this is the first header render
 
+    void publishEvent(EventType type);
     void drawHeader(const GuiStateHeader &state);
     void drawFooter(const GuiState &state, ulong controllerRunTimeMSec);
     void drawStausPanel(const GuiStateStatus &state);
 
     void manageTempChartState(ulong currentTimeMSec);
-    void drawChartPanel(const std::deque<TemperatureHistoryEntry> &history);
+    void drawChartPanel(const TemperatureHistory &history);
 
+    void buildSettingsList();
+    void getSettingValue(const SettingItem &item, char *buffer, size_t size);
+    void incSetting(const SettingItem &item);
+    void decSetting(const SettingItem &item);
     void drawSettingsPanel(const GuiState &state);
 
     void drawWiFiSelectPanel();
@@ -261,6 +315,7 @@ private:
     void startWiFiScan(); // Start WiFi scan to populate available networks
 
     void drawWiFiIcon(int x, int y, int bars, bool connected);
+    void formatEta(char *buffer, size_t size, long etaSec);
 
     void drawTempProfilePanel(const GuiStateTempProfile &tempProfile);
     void drawTempProfileStepLine(int n, TempProfileStep &step, bool selected);
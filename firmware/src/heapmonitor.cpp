@@ -0,0 +1,408 @@
+#include "heapmonitor.h"
+#include <esp_debug_helpers.h>
+
+HeapTaskStack HeapMonitor::s_tasks[HEAP_MONITOR_MAX_TASKS];
+uint HeapMonitor::s_taskCount = 0;
+HeapSnapshot HeapMonitor::s_snapshot = {};
+
+#ifdef ENABLE_HEAP_TRACKING
+HeapSite HeapMonitor::s_sites[HEAP_TRACK_MAX_SITES];
+uint HeapMonitor::s_siteCount = 0;
+HeapMonitor::LiveBlock HeapMonitor::s_live[HEAP_TRACK_MAX_LIVE];
+uint HeapMonitor::s_liveCount = 0;
+uint32_t HeapMonitor::s_liveBytes = 0;
+uint32_t HeapMonitor::s_allocCount = 0;
+uint32_t HeapMonitor::s_freeCount = 0;
+uint32_t HeapMonitor::s_untrackedCount = 0;
+TaskHandle_t HeapMonitor::s_loopTask = nullptr;
+uint32_t HeapMonitor::s_loopAllocCount = 0;
+#endif
+
+// Allocations come from every task on both cores and from interrupts
+static portMUX_TYPE s_heapMux = portMUX_INITIALIZER_UNLOCKED;
+
+// ========================================== ALLOCATOR WRAPPERS ====================================
+// Linked in place of the allocator by -Wl,--wrap, the __real_ symbols are the allocator itself.
+// They stay in IRAM like the allocator, malloc may be called while the flash cache is disabled.
+extern "C"
+{
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t count, size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+    void __real_free(void *ptr);
+
+    void *IRAM_ATTR __wrap_malloc(size_t size)
+    {
+        void *ptr = __real_malloc(size);
+#ifdef ENABLE_HEAP_TRACKING
+        HeapMonitor::recordAlloc(ptr, size);
+#endif
+        return ptr;
+    }
+
+    void *IRAM_ATTR __wrap_calloc(size_t count, size_t size)
+    {
+        void *ptr = __real_calloc(count, size);
+#ifdef ENABLE_HEAP_TRACKING
+        HeapMonitor::recordAlloc(ptr, count * size);
+#endif
+        return ptr;
+    }
+
+    void *IRAM_ATTR __wrap_realloc(void *ptr, size_t size)
+    {
+#ifdef ENABLE_HEAP_TRACKING
+        // Untracked first, the old block may be handed out again as soon as realloc releases it
+        uint32_t oldSize = HeapMonitor::recordFree(ptr);
+#endif
+        void *newPtr = __real_realloc(ptr, size);
+#ifdef ENABLE_HEAP_TRACKING
+        // A failed realloc leaves the old block allocated, a tracked one is tracked again
+        if (newPtr == nullptr && size != 0)
+        {
+            if (oldSize > 0)
+                HeapMonitor::recordAlloc(ptr, oldSize);
+        }
+        else
+        {
+            HeapMonitor::recordAlloc(newPtr, size);
+        }
+#endif
+        return newPtr;
+    }
+
+    void IRAM_ATTR __wrap_free(void *ptr)
+    {
+#ifdef ENABLE_HEAP_TRACKING
+        HeapMonitor::recordFree(ptr);
+#endif
+        __real_free(ptr);
+    }
+}
+
+// ========================================== SAMPLING ====================================
+void HeapMonitor::addTask(const char *name, TaskHandle_t handle)
+{
+    if (s_taskCount >= HEAP_MONITOR_MAX_TASKS)
+    {
+        Serial.println("Heap monitor task table full, task not added!");
+        return;
+    }
+
+    portENTER_CRITICAL(&s_heapMux);
+    s_tasks[s_taskCount] = {name, handle, 0};
+    s_taskCount++;
+    portEXIT_CRITICAL(&s_heapMux);
+}
+
+void HeapMonitor::setLoopTask(TaskHandle_t handle)
+{
+#ifdef ENABLE_HEAP_TRACKING
+    portENTER_CRITICAL(&s_heapMux);
+    s_loopTask = handle;
+    s_loopAllocCount = 0;
+    portEXIT_CRITICAL(&s_heapMux);
+#endif
+}
+
+uint32_t HeapMonitor::getLoopAllocCount()
+{
+    uint32_t count = 0;
+#ifdef ENABLE_HEAP_TRACKING
+    portENTER_CRITICAL(&s_heapMux);
+    count = s_loopAllocCount;
+    portEXIT_CRITICAL(&s_heapMux);
+#endif
+    return count;
+}
+
+void HeapMonitor::sample()
+{
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+
+    // Tasks created after the registration (the web server task) are found on a later sample
+    for (uint i = 0; i < s_taskCount; ++i)
+    {
+        if (s_tasks[i].handle == nullptr)
+            s_tasks[i].handle = xTaskGetHandle(s_tasks[i].name);
+    }
+
+    HeapSnapshot snapshot = {};
+    snapshot.timeMSec = millis();
+    snapshot.freeBytes = info.total_free_bytes;
+    snapshot.minFreeBytes = info.minimum_free_bytes;
+    snapshot.largestFreeBlock = info.largest_free_block;
+    snapshot.fragmentationPercent = info.total_free_bytes > 0 ? 100 - info.largest_free_block * 100 / info.total_free_bytes : 0;
+    snapshot.minStackTask = nullptr;
+    snapshot.minStackFreeBytes = UINT32_MAX;
+
+    // On the ESP32 the high-water mark is in bytes
+    uint32_t stackFreeBytes[HEAP_MONITOR_MAX_TASKS];
+    for (uint i = 0; i < s_taskCount; ++i)
+    {
+        stackFreeBytes[i] = s_tasks[i].handle != nullptr ? uxTaskGetStackHighWaterMark(s_tasks[i].handle) : 0;
+        if (s_tasks[i].handle != nullptr && stackFreeBytes[i] < snapshot.minStackFreeBytes)
+        {
+            snapshot.minStackTask = s_tasks[i].name;
+            snapshot.minStackFreeBytes = stackFreeBytes[i];
+        }
+    }
+    if (snapshot.minStackTask == nullptr)
+        snapshot.minStackFreeBytes = 0;
+
+    portENTER_CRITICAL(&s_heapMux);
+    for (uint i = 0; i < s_taskCount; ++i)
+        s_tasks[i].freeBytes = stackFreeBytes[i];
+#ifdef ENABLE_HEAP_TRACKING
+    snapshot.liveBlocks = s_liveCount;
+    snapshot.liveBytes = s_liveBytes;
+    snapshot.allocCount = s_allocCount;
+    snapshot.freeCount = s_freeCount;
+    snapshot.untrackedCount = s_untrackedCount;
+    snapshot.loopAllocCount = s_loopAllocCount;
+#endif
+    s_snapshot = snapshot;
+    portEXIT_CRITICAL(&s_heapMux);
+}
+
+void HeapMonitor::getSnapshot(HeapSnapshot &snapshot)
+{
+    portENTER_CRITICAL(&s_heapMux);
+    snapshot = s_snapshot;
+    portEXIT_CRITICAL(&s_heapMux);
+}
+
+uint HeapMonitor::getTaskCount()
+{
+    return s_taskCount;
+}
+
+void HeapMonitor::getTaskStack(uint index, HeapTaskStack &stack)
+{
+    portENTER_CRITICAL(&s_heapMux);
+    stack = s_tasks[min(index, static_cast<uint>(HEAP_MONITOR_MAX_TASKS - 1))];
+    portEXIT_CRITICAL(&s_heapMux);
+}
+
+// ========================================== ALLOCATION TRACKING ====================================
+#ifdef ENABLE_HEAP_TRACKING
+
+// Code address of a return address read from the stack, see esp_cpu_process_stack_pc()
+static inline uint32_t stackPC(uint32_t pc)
+{
+    if (pc & 0x80000000)
+        pc = (pc & 0x3fffffff) | 0x40000000; // Window size bits to the code segment
+    return pc - 3;                           // Back to the call instruction
+}
+
+// Callers of the allocator wrapper, innermost first. Expanded in the record function, which is
+// called straight from a wrapper: the first frame is the wrapper, the second one its caller.
+static inline __attribute__((always_inline)) void captureCallers(uint32_t *callers)
+{
+    esp_backtrace_frame_t frame = {};
+    esp_backtrace_get_start(&frame.pc, &frame.sp, &frame.next_pc);
+
+    memset(callers, 0, HEAP_TRACK_CALLER_DEPTH * sizeof(uint32_t));
+    if (!esp_backtrace_get_next_frame(&frame))
+        return;
+    for (uint i = 0; i < HEAP_TRACK_CALLER_DEPTH; ++i)
+    {
+        if (frame.next_pc == 0 || !esp_backtrace_get_next_frame(&frame))
+            return;
+        callers[i] = stackPC(frame.pc);
+    }
+}
+
+void IRAM_ATTR __attribute__((noinline)) HeapMonitor::recordAlloc(void *ptr, size_t size)
+{
+    if (ptr == nullptr)
+        return;
+
+    uint32_t callers[HEAP_TRACK_CALLER_DEPTH];
+    captureCallers(callers);
+    track(ptr, size, callers);
+}
+
+uint32_t IRAM_ATTR __attribute__((noinline)) HeapMonitor::recordFree(void *ptr)
+{
+    return ptr != nullptr ? untrack(ptr) : 0;
+}
+
+uint HeapMonitor::getSites(HeapSite *sites, uint maxSites)
+{
+    uint count = 0;
+    portENTER_CRITICAL(&s_heapMux);
+    for (uint i = 0; i < s_siteCount && count < maxSites; ++i)
+        sites[count++] = s_sites[i];
+    if (s_sites[HEAP_TRACK_MAX_SITES - 1].allocCount + s_sites[HEAP_TRACK_MAX_SITES - 1].liveCount > 0 && count < maxSites)
+        sites[count++] = s_sites[HEAP_TRACK_MAX_SITES - 1];
+    portEXIT_CRITICAL(&s_heapMux);
+
+    // Largest live bytes first, the leak candidates lead the report
+    for (uint i = 1; i < count; ++i)
+    {
+        HeapSite site = sites[i];
+        uint j = i;
+        for (; j > 0 && sites[j - 1].liveBytes < site.liveBytes; --j)
+            sites[j] = sites[j - 1];
+        sites[j] = site;
+    }
+    return count;
+}
+
+void HeapMonitor::resetSites()
+{
+    // The live blocks stay tracked, their frees are still charged to their sites
+    portENTER_CRITICAL(&s_heapMux);
+    for (uint i = 0; i < HEAP_TRACK_MAX_SITES; ++i)
+    {
+        s_sites[i].allocCount = 0;
+        s_sites[i].freeCount = 0;
+        s_sites[i].peakLiveBytes = s_sites[i].liveBytes;
+    }
+    s_allocCount = 0;
+    s_freeCount = 0;
+    s_untrackedCount = 0;
+    s_loopAllocCount = 0;
+    portEXIT_CRITICAL(&s_heapMux);
+}
+
+void IRAM_ATTR HeapMonitor::track(void *ptr, size_t size, const uint32_t *callers)
+{
+    // An allocation in an interrupt is not charged to the task it interrupted
+    bool isLoopTask = s_loopTask != nullptr && !xPortInIsrContext() && xTaskGetCurrentTaskHandle() == s_loopTask;
+
+    portENTER_CRITICAL_SAFE(&s_heapMux);
+    s_allocCount++;
+    if (isLoopTask)
+        s_loopAllocCount++;
+    if (s_liveCount >= HEAP_TRACK_MAX_LOAD)
+    {
+        s_untrackedCount++;
+        portEXIT_CRITICAL_SAFE(&s_heapMux);
+        return;
+    }
+
+    // A block still in the table was released around the wrappers, its old entry is dropped
+    uint slot = findLive(ptr);
+    if (slot < HEAP_TRACK_MAX_LIVE)
+    {
+        HeapSite &stale = s_sites[s_live[slot].site];
+        stale.liveCount--;
+        stale.liveBytes -= s_live[slot].size;
+        s_liveCount--;
+        s_liveBytes -= s_live[slot].size;
+    }
+    else
+    {
+        slot = home(ptr);
+        while (s_live[slot].ptr != nullptr)
+            slot = (slot + 1) % HEAP_TRACK_MAX_LIVE;
+    }
+
+    uint siteIndex = findSite(callers);
+    HeapSite &site = s_sites[siteIndex];
+    site.allocCount++;
+    site.liveCount++;
+    site.liveBytes += size;
+    if (site.liveBytes > site.peakLiveBytes)
+        site.peakLiveBytes = site.liveBytes;
+
+    s_live[slot].ptr = ptr;
+    s_live[slot].size = size;
+    s_live[slot].site = siteIndex;
+    s_liveCount++;
+    s_liveBytes += size;
+    portEXIT_CRITICAL_SAFE(&s_heapMux);
+}
+
+uint32_t IRAM_ATTR HeapMonitor::untrack(void *ptr)
+{
+    portENTER_CRITICAL_SAFE(&s_heapMux);
+    s_freeCount++;
+    uint slot = findLive(ptr);
+    if (slot >= HEAP_TRACK_MAX_LIVE)
+    {
+        portEXIT_CRITICAL_SAFE(&s_heapMux);
+        return 0;
+    }
+    uint32_t size = s_live[slot].size;
+
+    HeapSite &site = s_sites[s_live[slot].site];
+    site.freeCount++;
+    site.liveCount--;
+    site.liveBytes -= s_live[slot].size;
+    s_liveCount--;
+    s_liveBytes -= s_live[slot].size;
+
+    // Backward shift deletion, the entries behind the hole move up unless they would pass their home slot
+    uint hole = slot;
+    uint next = slot;
+    for (;;)
+    {
+        next = (next + 1) % HEAP_TRACK_MAX_LIVE;
+        if (s_live[next].ptr == nullptr)
+            break;
+        uint want = home(s_live[next].ptr);
+        bool stays = hole <= next ? (want > hole && want <= next) : (want > hole || want <= next);
+        if (!stays)
+        {
+            s_live[hole] = s_live[next];
+            hole = next;
+        }
+    }
+    s_live[hole].ptr = nullptr;
+    portEXIT_CRITICAL_SAFE(&s_heapMux);
+    return size;
+}
+
+uint IRAM_ATTR HeapMonitor::findSite(const uint32_t *callers)
+{
+    for (uint i = 0; i < s_siteCount; ++i)
+    {
+        if (memcmp(s_sites[i].callers, callers, sizeof(s_sites[i].callers)) == 0)
+            return i;
+    }
+
+    // The last entry is the catch-all site
+    if (s_siteCount >= HEAP_TRACK_MAX_SITES - 1)
+        return HEAP_TRACK_MAX_SITES - 1;
+
+    HeapSite &site = s_sites[s_siteCount];
+    memset(&site, 0, sizeof(HeapSite));
+    memcpy(site.callers, callers, sizeof(site.callers));
+    return s_siteCount++;
+}
+
+uint IRAM_ATTR HeapMonitor::findLive(void *ptr)
+{
+    uint slot = home(ptr);
+    for (uint probes = 0; probes < HEAP_TRACK_MAX_LIVE && s_live[slot].ptr != nullptr; ++probes)
+    {
+        if (s_live[slot].ptr == ptr)
+            return slot;
+        slot = (slot + 1) % HEAP_TRACK_MAX_LIVE;
+    }
+    return HEAP_TRACK_MAX_LIVE;
+}
+
+uint IRAM_ATTR HeapMonitor::home(void *ptr)
+{
+    // Blocks are at least 4-byte aligned, the upper product bits mix the address
+    uint32_t hash = (static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr)) >> 2) * 2654435761u;
+    return (hash >> 16) % HEAP_TRACK_MAX_LIVE;
+}
+
+#else
+
+uint HeapMonitor::getSites(HeapSite *sites, uint maxSites)
+{
+    return 0;
+}
+
+void HeapMonitor::resetSites()
+{
+}
+
+#endif // ENABLE_HEAP_TRACKING
@@ -0,0 +1,129 @@
+#ifndef HEAPMONITOR_H
+#define HEAPMONITOR_H
+
+/**
+ * @file heapmonitor.h
+ * @brief Heap and stack telemetry with allocation tracking by call site.
+ *
+ * malloc, calloc, realloc and free are wrapped at link time (-Wl,--wrap in platformio.ini), so
+ * every allocation of the firmware, the libraries and the framework passes through the tracker.
+ * Each allocation is attributed to a call site, the first HEAP_TRACK_CALLER_DEPTH return
+ * addresses above the allocator found by a short backtrace. new and String allocate through
+ * malloc, so their callers appear as the second and third address of a site. The addresses are
+ * resolved with xtensa-esp32-elf-addr2line -e firmware.elf. A realloc counts as a free of the
+ * old block and an allocation of the new one, a failed realloc tracks the old block again.
+ *
+ * The tracker keeps two fixed tables and never allocates itself:
+ *
+ *   - the site table counts allocations, frees, live blocks and live bytes per call site. A full
+ *     table sends new sites to the last entry, the catch-all site with no callers,
+ *   - the live table maps each tracked block to its size and site, so a free is charged to the
+ *     site that allocated the block. A block allocated while the table was full, before the
+ *     wrappers were linked in or with heap_caps_malloc() is not tracked and its free is ignored.
+ *
+ * A site whose live bytes keep growing over a long cook is the leak. sample() is called
+ * periodically and records the free heap, its low-water mark, the largest free block, the
+ * fragmentation and the stack high-water marks of the registered tasks.
+ *
+ * The allocations made on the control loop task are also counted on their own. Past boot the
+ * control loop keeps off the heap, a count still moving in steady state is reported by the heap
+ * task with DEBUG_MAIN and failed by the test in test/test_loop_allocations.
+ *
+ * Without ENABLE_HEAP_TRACKING the wrappers forward to the allocator and only the sampled heap
+ * and stack figures are reported.
+ */
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "debug.h"
+
+#define ENABLE_HEAP_TRACKING // Comment out to keep the wrappers as plain forwarders
+
+#define HEAP_TRACK_CALLER_DEPTH 3 // Return addresses recorded per call site
+#define HEAP_TRACK_MAX_SITES 48   // Size of the site table, the last entry is the catch-all site
+#define HEAP_TRACK_MAX_LIVE 1024  // Size of the live block table
+#define HEAP_TRACK_MAX_LOAD 768   // Live blocks tracked at most, keeps the probe sequences short
+#define HEAP_MONITOR_MAX_TASKS 8  // Tasks whose stack high-water mark is sampled
+
+struct HeapSite
+{
+    uint32_t callers[HEAP_TRACK_CALLER_DEPTH]; // Return addresses, innermost first
+    uint32_t allocCount;                       // Allocations since boot or the last reset
+    uint32_t freeCount;                        // Tracked frees
+    uint32_t liveCount;                        // Blocks allocated and not freed
+    uint32_t liveBytes;                        // Bytes allocated and not freed
+    uint32_t peakLiveBytes;                    // Highest live bytes
+};
+
+struct HeapTaskStack
+{
+    const char *name;    // Task name, looked up until the task exists
+    TaskHandle_t handle; // Task handle, nullptr until found
+    uint32_t freeBytes;  // Stack high-water mark, the least free stack seen (bytes)
+};
+
+struct HeapSnapshot
+{
+    ulong timeMSec;               // Time of the sample
+    uint32_t freeBytes;           // Free 8-bit capable heap
+    uint32_t minFreeBytes;        // Lowest free heap since boot
+    uint32_t largestFreeBlock;    // Largest single allocation possible
+    uint8_t fragmentationPercent; // Free heap outside the largest block
+    uint32_t liveBlocks;          // Tracked blocks allocated and not freed
+    uint32_t liveBytes;           // Tracked bytes allocated and not freed
+    uint32_t allocCount;          // Allocations seen
+    uint32_t freeCount;           // Frees seen
+    uint32_t untrackedCount;      // Allocations not tracked, live table full
+    uint32_t loopAllocCount;      // Allocations seen on the control loop task
+    const char *minStackTask;     // Registered task with the least free stack
+    uint32_t minStackFreeBytes;   // Its stack high-water mark (bytes)
+};
+
+class HeapMonitor
+{
+public:
+    static void addTask(const char *name, TaskHandle_t handle = nullptr);
+    static void setLoopTask(TaskHandle_t handle);
+    static uint32_t getLoopAllocCount();
+    static void sample();
+    static void getSnapshot(HeapSnapshot &snapshot);
+    static uint getTaskCount();
+    static void getTaskStack(uint index, HeapTaskStack &stack);
+    static uint getSites(HeapSite *sites, uint maxSites);
+    static void resetSites();
+
+    static void recordAlloc(void *ptr, size_t size);
+    static uint32_t recordFree(void *ptr);
+
+private:
+    struct LiveBlock
+    {
+        void *ptr;     // Block address, nullptr for an empty slot
+        uint32_t size; // Requested size
+        uint8_t site;  // Index in the site table
+    };
+
+    static HeapSite s_sites[HEAP_TRACK_MAX_SITES];        // Site table
+    static uint s_siteCount;                              // Sites in use
+    static LiveBlock s_live[HEAP_TRACK_MAX_LIVE];         // Live block table, open addressing
+    static uint s_liveCount;                              // Live blocks tracked
+    static uint32_t s_liveBytes;                          // Live bytes tracked
+    static uint32_t s_allocCount;                         // Allocations seen
+    static uint32_t s_freeCount;                          // Frees seen
+    static uint32_t s_untrackedCount;                     // Allocations not tracked
+    static TaskHandle_t s_loopTask;                       // Control loop task, nullptr until set
+    static uint32_t s_loopAllocCount;                     // Allocations on the control loop task
+    static HeapTaskStack s_tasks[HEAP_MONITOR_MAX_TASKS]; // Registered tasks
+    static uint s_taskCount;                              // Tasks registered
+    static HeapSnapshot s_snapshot;                       // Last sample
+
+    static void track(void *ptr, size_t size, const uint32_t *callers);
+    static uint32_t untrack(void *ptr);
+    static uint findSite(const uint32_t *callers);
+    static uint findLive(void *ptr);
+    static uint home(void *ptr);
+};
+
+#endif // HEAPMONITOR_H
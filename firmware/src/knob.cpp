@@ -66,26 +66,23 @@ void Knob::service(ulong currentTimeMSec)
         break;
 
     case KNOB_STATE_SHORT_BUTTON_PRESSED:
-
-        // Do nothing, just wait for the reset
+        publishEvent(KNOB_EVENT_SHORT_PRESS);
         break;
 
     case KNOB_STATE_LONG_BUTTON_PRESSED:
-
-        // Do nothing, just wait for the reset
+        publishEvent(KNOB_EVENT_LONG_PRESS);
         break;
 
     case KNOB_STATE_ULTRA_LONG_BUTTON_PRESSED:
-        // Do nothing, just wait for the reset
+        publishEvent(KNOB_EVENT_ULTRA_LONG_PRESS);
         break;
 
     case KNOB_STATE_ROTATING_UP:
-
-        // Do nothing, just wait for the reset
+        publishEvent(KNOB_EVENT_ROTATE_UP);
         break;
 
     case KNOB_STATE_ROTATING_DOWN:
-        // Do nothing, just wait for the reset
+        publishEvent(KNOB_EVENT_ROTATE_DOWN);
         break;
     }
 }
@@ -97,52 +94,16 @@ void Knob::reset()
     m_encoder.reset();
 }
 
-bool Knob::isShortButtonPressed()
-{
-    if (m_state == KNOB_STATE_SHORT_BUTTON_PRESSED)
-    {
-        reset();
-        return true;
-    }
-    return false;
-}
-
-bool Knob::isLongButtonPressed()
+void Knob::setEventBus(EventBus *eventBus)
 {
-    if (m_state == KNOB_STATE_LONG_BUTTON_PRESSED)
-    {
-        reset();
-        return true;
-    }
-    return false;
+    m_eventBus = eventBus;
 }
 
-bool Knob::isUltraLongButtonPressed()
+void Knob::publishEvent(KnobEvent event)
 {
-    if (m_state == KNOB_STATE_ULTRA_LONG_BUTTON_PRESSED)
+    if (m_eventBus != nullptr)
     {
-        reset();
-        return true;
+        m_eventBus->publish(EVENT_BUTTON, EVENT_SOURCE_KNOB, event);
     }
-    return false;
+    reset(); // Ready for the next press or rotation
 }
-
-bool Knob::isRotatingUp()
-{
-    if (m_state == KNOB_STATE_ROTATING_UP)
-    {
-        reset();
-        return true;
-    }
-    return false;
-}
-
-bool Knob::isRotatingDown()
-{
-    if (m_state == KNOB_STATE_ROTATING_DOWN)
-    {
-        reset();
-        return true;
-    }
-    return false;
-}
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "types.h"
 #include "encoder.h"
 #include <ezButton.h>
+#include "eventbus.h"
 // #define KNOB_DEBUG
 
 #define KNOB_ULTRALONG_BUTTON_PRESS_TIME_MSEC 5000 // Time for ultra long button press in milliseconds
@@ -19,6 +20,16 @@ enum KNOB_STATE
     KNOB_STATE_ROTATING_DOWN
 };
 
+// Value of the EVENT_BUTTON events published by the knob
+enum KnobEvent
+{
+    KNOB_EVENT_SHORT_PRESS = 0,
+    KNOB_EVENT_LONG_PRESS,
+    KNOB_EVENT_ULTRA_LONG_PRESS,
+    KNOB_EVENT_ROTATE_UP,
+    KNOB_EVENT_ROTATE_DOWN
+};
+
 class Knob
 {
 private:
@@ -31,15 +42,15 @@ private:
 
     ulong m_longPressTimeMSec;
 
+    EventBus *m_eventBus = nullptr; // Receives a button event for every press or rotation
+
+    void publishEvent(KnobEvent event);
+
 public:
     Knob(int pinA, int pinB, int pinButton, ulong longPressTimeMSec = 1000, uint debounceTimeMSec = 50);
     void service(ulong currentTimeMSec);
     void reset();
-    bool isShortButtonPressed();
-    bool isLongButtonPressed();
-    bool isUltraLongButtonPressed();
-    bool isRotatingUp();
-    bool isRotatingDown();
+    void setEventBus(EventBus *eventBus);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "liddetector.h"
+
+#ifdef DEBUG_LID_DETECTOR
+static const char *lidStateToString(LidState state)
+{
+    switch (state)
+    {
+    case LID_STATE_CLOSED:
+        return "CLOSED";
+    case LID_STATE_OPEN:
+        return "OPEN";
+    case LID_STATE_RECOVERING:
+        return "RECOVERING";
+    default:
+        return "UNKNOWN";
+    }
+}
+#endif
+
+LidDetector::LidDetector()
+    : m_state(LID_STATE_CLOSED),
+      m_isEnabled(DEFAULT_LID_DETECTION_ENABLED),
+      m_openRateFPerMin(DEFAULT_LID_OPEN_RATE_F_PER_MIN),
+      m_closeRateFPerMin(DEFAULT_LID_CLOSE_RATE_F_PER_MIN),
+      m_maxOpenMSec(DEFAULT_LID_MAX_OPEN_MSEC),
+      m_recoveryMSec(DEFAULT_LID_RECOVERY_MSEC),
+      m_isSeeded(false),
+      m_previousTempF(0.0f),
+      m_referenceTempF(0.0f),
+      m_rateFPerMin(0.0f),
+      m_lastUpdateMSec(0),
+      m_stateStartMSec(0),
+      m_eventStartTempF(0.0f),
+      m_eventMinTempF(0.0f),
+      m_eventCount(0)
+{
+    m_lastEvent = {0, 0, 0};
+}
+
+void LidDetector::setParameters(bool isEnabled, float openRateFPerMin, float closeRateFPerMin,
+                                ulong maxOpenMSec, ulong recoveryMSec)
+{
+    m_isEnabled = isEnabled;
+    m_openRateFPerMin = openRateFPerMin;
+    m_closeRateFPerMin = closeRateFPerMin;
+    m_maxOpenMSec = maxOpenMSec;
+    m_recoveryMSec = recoveryMSec;
+}
+
+LidState LidDetector::update(float temperatureF, int targetTempF, ulong currentTimeMSec)
+{
+    // The first sample, or the first one after the controller was stopped, only seeds the filters
+    if (!m_isSeeded || currentTimeMSec - m_lastUpdateMSec > LID_MAX_SAMPLE_GAP_MSEC)
+    {
+        m_isSeeded = true;
+        m_previousTempF = temperatureF;
+        m_referenceTempF = temperatureF;
+        m_rateFPerMin = 0.0f;
+        m_lastUpdateMSec = currentTimeMSec;
+        enterState(LID_STATE_CLOSED, currentTimeMSec);
+        return m_state;
+    }
+
+    float deltaMin = (currentTimeMSec - m_lastUpdateMSec) / 60000.0f;
+    if (deltaMin > 0.0f)
+    {
+        float rate = (temperatureF - m_previousTempF) / deltaMin;
+        m_rateFPerMin += LID_RATE_FILTER_COEFF * (rate - m_rateFPerMin);
+    }
+    m_previousTempF = temperatureF;
+    m_lastUpdateMSec = currentTimeMSec;
+
+    if (!m_isEnabled)
+    {
+        m_referenceTempF = temperatureF;
+        if (m_state != LID_STATE_CLOSED)
+            enterState(LID_STATE_CLOSED, currentTimeMSec);
+        return m_state;
+    }
+
+    bool isFastDrop = m_rateFPerMin <= -m_openRateFPerMin;
+
+    switch (m_state)
+    {
+    case LID_STATE_CLOSED:
+        if (isFastDrop && m_referenceTempF - temperatureF >= LID_OPEN_MIN_DROP_F)
+        {
+            m_eventStartTempF = m_referenceTempF;
+            m_eventMinTempF = temperatureF;
+            m_eventCount++;
+            m_lastEvent = {currentTimeMSec, 0, static_cast<int>(m_eventStartTempF - temperatureF)};
+            enterState(LID_STATE_OPEN, currentTimeMSec);
+        }
+        else
+        {
+            m_referenceTempF += LID_REFERENCE_FILTER_COEFF * (temperatureF - m_referenceTempF);
+        }
+        break;
+
+    case LID_STATE_OPEN:
+        m_eventMinTempF = min(m_eventMinTempF, temperatureF);
+        m_lastEvent.dropF = static_cast<int>(m_eventStartTempF - m_eventMinTempF);
+        m_lastEvent.durationMSec = currentTimeMSec - m_lastEvent.startMSec;
+        if (m_rateFPerMin >= m_closeRateFPerMin || m_lastEvent.durationMSec >= m_maxOpenMSec)
+        {
+            enterState(LID_STATE_RECOVERING, currentTimeMSec);
+        }
+        break;
+
+    case LID_STATE_RECOVERING:
+    {
+        // Resume at whichever is lower, the pit temperature before the event or the target
+        float resumeTempF = min(m_eventStartTempF, static_cast<float>(targetTempF));
+        if (isFastDrop)
+        {
+            // Opened again before the pit recovered, the event continues
+            enterState(LID_STATE_OPEN, currentTimeMSec);
+        }
+        else if (temperatureF >= resumeTempF - LID_RECOVERY_BAND_F ||
+                 currentTimeMSec - m_stateStartMSec >= m_recoveryMSec)
+        {
+            m_referenceTempF = temperatureF;
+            enterState(LID_STATE_CLOSED, currentTimeMSec);
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+
+#ifdef DEBUG_LID_DETECTOR
+    DEBUG_PRINTLN("LID::update - T=" + String(temperatureF, 1) + " rate=" + String(m_rateFPerMin, 1) +
+                  " ref=" + String(m_referenceTempF, 1) + " state=" + String(lidStateToString(m_state)));
+#endif
+
+    return m_state;
+}
+
+void LidDetector::enterState(LidState state, ulong currentTimeMSec)
+{
+#ifdef DEBUG_LID_DETECTOR
+    if (state != m_state)
+        DEBUG_PRINTLN("LID::enterState - " + String(lidStateToString(m_state)) + " -> " + String(lidStateToString(state)));
+#endif
+    m_state = state;
+    m_stateStartMSec = currentTimeMSec;
+}
+
+LidState LidDetector::getState() const
+{
+    return m_state;
+}
+
+float LidDetector::getRecoveryFraction(ulong currentTimeMSec) const
+{
+    if (m_state != LID_STATE_RECOVERING || m_recoveryMSec == 0)
+        return 1.0f;
+    float fraction = static_cast<float>(currentTimeMSec - m_stateStartMSec) / m_recoveryMSec;
+    return constrain(fraction, 0.0f, 1.0f);
+}
+
+float LidDetector::getRateFPerMin() const
+{
+    return m_rateFPerMin;
+}
+
+uint LidDetector::getEventCount() const
+{
+    return m_eventCount;
+}
+
+const LidEvent &LidDetector::getLastEvent() const
+{
+    return m_lastEvent;
+}
@@ -0,0 +1,91 @@
+#ifndef LID_DETECTOR_H
+#define LID_DETECTOR_H
+
+/**
+ * @file liddetector.h
+ * @brief Detection of lid-open disturbances from the smoker temperature rate of change.
+ *
+ * Opening the lid drops the pit temperature by 50-100 F within seconds, far faster than the fire
+ * can cool the smoker on its own. The detector filters the temperature slope and runs a small
+ * state machine:
+ *
+ *     CLOSED      -> OPEN        slope below -openRate and the temperature fell minDrop below
+ *                                its slow-moving reference,
+ *     OPEN        -> RECOVERING  slope above +closeRate (lid closed, fire reheating the pit) or
+ *                                the lid has been reported open for longer than maxOpen,
+ *     RECOVERING  -> CLOSED      temperature back within the band of the pre-event or target
+ *                                temperature, or the recovery time elapsed,
+ *     RECOVERING  -> OPEN        another fast drop while recovering.
+ *
+ * The TemperatureController holds the actuators and freezes the integrator while the lid is open,
+ * and ramps the output back in during the recovery so the integral does not wind up.
+ */
+
+#include <Arduino.h>
+#include "types.h"
+#include "debug.h"
+
+// #define DEBUG_LID_DETECTOR
+
+#define DEFAULT_LID_DETECTION_ENABLED true
+#define DEFAULT_LID_OPEN_RATE_F_PER_MIN 30  // Falling slope that marks a lid-open event
+#define DEFAULT_LID_CLOSE_RATE_F_PER_MIN 10 // Rising slope that marks the lid closing
+#define DEFAULT_LID_MAX_OPEN_MSEC 600000    // Give up holding the actuators after 10 minutes
+#define DEFAULT_LID_RECOVERY_MSEC 300000    // Output ramp length after the lid closes
+#define LID_OPEN_MIN_DROP_F 10.0f           // Minimum drop below the reference temperature
+#define LID_RECOVERY_BAND_F 5.0f            // Recovery ends within this band of the resume temperature
+#define LID_RATE_FILTER_COEFF 0.5f          // EWMA coefficient of the slope filter
+#define LID_REFERENCE_FILTER_COEFF 0.1f     // EWMA coefficient of the reference temperature
+#define LID_MAX_SAMPLE_GAP_MSEC 60000       // Reseed after a gap (controller stopped)
+
+enum LidState
+{
+    LID_STATE_CLOSED,
+    LID_STATE_OPEN,
+    LID_STATE_RECOVERING
+};
+
+struct LidEvent
+{
+    ulong startMSec;    // Time the lid was detected open
+    ulong durationMSec; // Time the lid was reported open
+    int dropF;          // Largest drop below the temperature before the event
+};
+
+class LidDetector
+{
+private:
+    LidState m_state;         // Current state
+    bool m_isEnabled;         // Detection enabled, the state stays CLOSED otherwise
+    float m_openRateFPerMin;  // Falling slope threshold
+    float m_closeRateFPerMin; // Rising slope threshold
+    ulong m_maxOpenMSec;      // Longest hold of the actuators
+    ulong m_recoveryMSec;     // Length of the recovery ramp
+    bool m_isSeeded;          // True once a first sample has been taken
+    float m_previousTempF;    // Previous sample
+    float m_referenceTempF;   // Slow average of the temperature while the lid is closed
+    float m_rateFPerMin;      // Filtered slope
+    ulong m_lastUpdateMSec;   // Time of the previous sample
+    ulong m_stateStartMSec;   // Time the current state was entered
+    float m_eventStartTempF;  // Reference temperature when the event started
+    float m_eventMinTempF;    // Lowest temperature seen during the event
+    uint m_eventCount;        // Number of lid-open events since boot
+    LidEvent m_lastEvent;     // Last completed or ongoing event
+
+    void enterState(LidState state, ulong currentTimeMSec);
+
+public:
+    LidDetector();
+
+    void setParameters(bool isEnabled, float openRateFPerMin, float closeRateFPerMin,
+                       ulong maxOpenMSec, ulong recoveryMSec);
+    LidState update(float temperatureF, int targetTempF, ulong currentTimeMSec);
+
+    LidState getState() const;
+    float getRecoveryFraction(ulong currentTimeMSec) const;
+    float getRateFPerMin() const;
+    uint getEventCount() const;
+    const LidEvent &getLastEvent() const;
+};
+
+#endif // LID_DETECTOR_H
@@ -1,15 +1,20 @@
 #include "main.h"
 #include "Arduino.h"
 
+#ifdef PIO_UNIT_TESTING
+// Under pio test the test owns setup() and loop(), it runs the firmware through these
+#define setup firmwareSetup
+#define loop firmwareLoop
+#endif
+
 // Timer variables
-ulong g_loopTimer500MSec = 0;
 ulong g_loopCurrentTimeMSec = 0;
 
 // System configuration
 Configuration g_configuration;
 
 // NVRAM definition
-NVRAM g_nvram = NVRAM(NVRAM_START_ADDRESS, (uint8_t *)&g_configuration, sizeof(Configuration));
+NVRAM g_nvram = NVRAM(NVRAM_START_ADDRESS, (uint8_t *)&g_configuration, sizeof(Configuration), NVRAM_CONFIGURATION_VERSION);
 
 // Knob definition
 Knob g_knob = Knob(PIN_ENCODER_A, PIN_ENCODER_B, PIN_ENCODER_BTN, 1000, 50);
@@ -28,27 +33,72 @@ Door g_door(PIN_DOOR_SERVO, DEFAULT_DOOR_CLOSE_POSITION, DEFAULT_DOOR_OPEN_POSIT
 // Blower motor definition
 Blower g_blowerMotor(PIN_BLOWER_PWM, PIN_BLOWER_A, PIN_BLOWER_B, PIN_BLOWER_ENABLE);
 
+// Blower and door command layer
+Actuators g_actuators(g_blowerMotor, g_door, g_configuration);
+
+// Blower airflow characterization
+BlowerCalibrator g_blowerCalibrator(g_actuators, g_configuration);
+bool g_prevIsBlowerCalibrating = false; // Previous calibration state, starts or aborts the sweep on a change
+
+// Status snapshots and commands between the control and UI cores
+ControlChannel g_controlChannel;
+
+// Event buses, one per loop, dispatched by the events task of its scheduler
+EventBus g_eventBus("control");
+EventBus g_uiEventBus("ui");
+
+// UI core copies of the configuration and the status
+Configuration g_uiConfiguration;        // Edited by the GUI
+Configuration g_uiPostedConfiguration;  // Last configuration posted to the control loop
+uint32_t g_uiPostedConfigurationId = 0; // Id of the last posted configuration
+uint32_t g_uiConfigurationSequence = 0; // Sequence of the last published configuration taken over
+ControllerStatus g_uiStatus;            // Last status snapshot
+NetworkStatus g_networkStatus;          // Owned by the WiFi code
+
 // Initalie the interface
-SmokeMateGUI g_smokeMateGUI(g_tftDisplay, g_configuration);
+SmokeMateGUI g_smokeMateGUI(g_tftDisplay, g_uiConfiguration);
 
 // Device status
 ControllerStatus g_controllerStatus; // Controller status
-bool g_prevIsRunning = false;        // Previous running state for the controller
 
 // Temperature Controller
-TemperatureController g_temperatureController(g_controllerStatus, g_configuration, g_blowerMotor, g_door);
+TemperatureController g_temperatureController(g_controllerStatus, g_configuration, g_actuators);
+
+// Food stall and completion time prediction
+CookPredictor g_cookPredictor;
 
 // Webserver
-WebServer g_webServer = WebServer(WEB_SERVER_PORT, g_controllerStatus, g_configuration);
-bool g_prevWiFiConnected = false;                      // Previous WiFi connected state for the controller
-int g_wiFiConnectAttempts = MAX_WIFI_CONNECT_ATTEMPTS; // Maximum number of attempts to connect to WiFi
+WebServer g_webServer = WebServer(WEB_SERVER_PORT, g_controlChannel);
+
+// WiFi connection state machine, runs in the UI loop
+WiFiManager g_wifiManager;
+
+// Over-the-air updates in their own low priority task
+OTAUpdater g_otaUpdater;
+
+// Temperature profile, the profile table runs instead of the configured steps once it holds any
+ProfileEngine g_profileEngine;
+TempProfileTable g_profileTable;
+NVRAM g_profileNVRAM = NVRAM(NVRAM_START_ADDRESS, (uint8_t *)&g_profileTable, sizeof(TempProfileTable), NVRAM_PROFILE_VERSION, "/profile");
+ConfigWriter g_configWriter(g_controlChannel, g_nvram, g_profileNVRAM); // Deferred NVRAM writes
 
-// Temperature profiling variables
-int g_temperatureProfileStepIndex = -1;      // Current step index in the temperature profile, -1 means no active profile
-ulong g_temperatureProfileStartTimeMSec = 0; // Start time of the current temperature profile step
+// Run state checkpoints, a cook interrupted by a reset resumes at boot
+RunCheckpoint g_runCheckpoint;
 
 Filter g_temperatureFilter(FilterType::NONE, DEFAULT_TEMPERATURE_FILTER_COEFF, 0.0f); // Temperature filter
 
+// Control loop scheduler (loop task) and UI loop scheduler (UI task)
+Scheduler g_scheduler;
+Scheduler g_uiScheduler;
+TaskHandle_t g_uiTaskHandle = nullptr;
+
+// Fail-safe actuator state when the control loop misses its deadline
+DeadlineMonitor g_deadlineMonitor(g_scheduler, g_blowerMotor, g_door);
+uint32_t g_failSafeResyncCount = 0; // Fail-safe trips the actuator demands were resent after
+
+// Control loop allocations seen by the previous heap sample
+uint32_t g_prevLoopAllocCount = 0;
+
 void setup()
 {
 
@@ -75,16 +125,29 @@ void setup()
 
   // Initialize NVRAM
   setupInitializeNVRAM();
+  g_runCheckpoint.begin();
+
+  // Publish the loaded configuration, the UI core starts from the same copy
+  g_controlChannel.begin();
+  g_controlChannel.publishConfiguration(g_configuration);
+  g_controlChannel.publishProfile(g_profileTable);
+  g_controlChannel.publishStatus(g_controllerStatus);
+  g_uiConfiguration = g_configuration;
+  g_uiPostedConfiguration = g_configuration;
+  g_uiConfigurationSequence = g_controlChannel.getConfigurationSequence();
 
   // Initialize the door
   g_door.begin();
   g_door.setBoundaries(g_configuration.doorClosePosition, g_configuration.doorOpenPosition);
+  g_door.setProfile(g_configuration.doorMaxSpeedDegPerSec, g_configuration.doorAccelDegPerSec2);
   g_door.close();
   while (g_door.isMoving())
   {
   }
 
   // Initialize the blower motor
+  g_blowerMotor.setRamp(g_configuration.blowerKickStartMSec, g_configuration.blowerSlewPWMPerSec);
+  g_blowerMotor.begin(g_configuration.blowerPWMFrequencyHz);
   g_blowerMotor.setPWM(0);
 
   // Initalize the interface
@@ -93,194 +156,532 @@ void setup()
   // Initialize the thermometers
   g_thermometerSmoker.setSimulated(g_configuration.isThemometerSimulated);
   g_thermometerFood.setSimulated(g_configuration.isThemometerSimulated);
+  updateConfiguration();
 
-  if (g_configuration.isWiFiEnabled)
-  {
-    // If WiFi is enabled, attempt to connect
-    DEBUG_PRINTLN("WiFi is enabled, attempting to connect...");
-    connectToWiFi();
-    if (g_controllerStatus.isWiFiConnected)
-    {
-      DEBUG_PRINTLN("WiFi connected successfully.");
-      g_webServer.begin(); // Start the web server
-    }
-  }
+  // Pick up a cook interrupted by a reset, before the control loop runs its first pass
+  setupResumeRun();
+
+  // WiFi connects in the background, the first WiFi pass of the UI loop starts it
+  g_wifiManager.begin();
+
+  // Register the tasks of both loops and start the UI loop on its core
+  setupEventBus();
+  setupScheduler();
+  g_webServer.setSchedulers(&g_scheduler, &g_uiScheduler);
+  g_webServer.setEventBuses(&g_eventBus, &g_uiEventBus);
+  g_webServer.setOTAUpdater(&g_otaUpdater);
+  xTaskCreatePinnedToCore(uiTask, "ui", UI_TASK_STACK_SIZE, nullptr, UI_TASK_PRIORITY, &g_uiTaskHandle, UI_TASK_CORE);
+  g_otaUpdater.begin();
+  g_configWriter.begin();
+
+  // Stacks watched by the heap monitor, the ones without a handle are looked up by name
+  HeapMonitor::addTask("loopTask", xTaskGetCurrentTaskHandle()); // Control loop
+  HeapMonitor::addTask("ui", g_uiTaskHandle);
+  HeapMonitor::addTask("async_tcp"); // Web server, started once WiFi connects
+  HeapMonitor::addTask("esp_timer"); // Blower, door and deadline monitor timers
+  HeapMonitor::addTask("ota");
+  HeapMonitor::addTask("config_writer");
+  HeapMonitor::setLoopTask(xTaskGetCurrentTaskHandle());
+  HeapMonitor::sample();
+
+  // Watch the control loop from its first pass on
+  g_deadlineMonitor.begin();
 
   digitalWrite(PIN_LED, LOW); // Turn off LED - setup is now done
 }
 
 void loop()
 {
+  // Control loop, runs on the Arduino core (ARDUINO_RUNNING_CORE)
+  g_loopCurrentTimeMSec = millis();
 
-  ArduinoOTA.handle();
+  // Run the tasks that are due
+  g_scheduler.service();
 
-  // Get the current time in milliseconds
-  g_loopCurrentTimeMSec = millis();
+  // One kick per pass, a stalled pass puts the actuators in the fail-safe state
+  g_deadlineMonitor.kick();
+}
+
+void uiTask(void *parameter)
+{
+  // UI loop, the GUI, WiFi and OTA run here next to the web server task
+  for (;;)
+  {
+    g_uiScheduler.service();
+    vTaskDelay(1); // Let the idle task of this core run and feed its watchdog
+  }
+}
 
-  // ====== SERVICE ALL COMPONENTS THAT RUN AT THE CPU RATE
+void setupScheduler()
+{
+  // Control and acquisition
+  g_scheduler.addTask("events", taskEvents, TASK_EVENTS_PERIOD_MSEC, SCHEDULER_PRIORITY_CRITICAL, TASK_EVENTS_BUDGET_USEC);
+  g_scheduler.addTask("commands", taskCommands, TASK_COMMANDS_PERIOD_MSEC, SCHEDULER_PRIORITY_HIGH, TASK_COMMANDS_BUDGET_USEC);
+  g_scheduler.addTask("thermometers", taskThermometers, TASK_THERMOMETERS_PERIOD_MSEC, SCHEDULER_PRIORITY_HIGH, TASK_THERMOMETERS_BUDGET_USEC);
+  g_scheduler.addTask("actuators", taskActuators, TASK_ACTUATORS_PERIOD_MSEC, SCHEDULER_PRIORITY_CRITICAL, TASK_ACTUATORS_BUDGET_USEC);
+  g_scheduler.addTask("controller", taskController, TASK_CONTROLLER_PERIOD_MSEC, SCHEDULER_PRIORITY_CRITICAL, TASK_CONTROLLER_BUDGET_USEC);
+  g_scheduler.addTask("publish", taskPublish, TASK_PUBLISH_PERIOD_MSEC, SCHEDULER_PRIORITY_NORMAL, TASK_PUBLISH_BUDGET_USEC);
+  g_scheduler.addTask("checkpoint", taskCheckpoint, TASK_CHECKPOINT_PERIOD_MSEC, SCHEDULER_PRIORITY_NORMAL, TASK_CHECKPOINT_BUDGET_USEC);
+
+  // User interface and network
+  g_uiScheduler.addTask("events", taskUIEvents, TASK_EVENTS_PERIOD_MSEC, SCHEDULER_PRIORITY_HIGH, TASK_UI_EVENTS_BUDGET_USEC);
+  g_uiScheduler.addTask("knob", taskKnob, TASK_KNOB_PERIOD_MSEC, SCHEDULER_PRIORITY_HIGH, TASK_KNOB_BUDGET_USEC);
+  g_uiScheduler.addTask("config", taskConfigSync, TASK_CONFIG_SYNC_PERIOD_MSEC, SCHEDULER_PRIORITY_NORMAL, TASK_CONFIG_SYNC_BUDGET_USEC);
+  g_uiScheduler.addTask("gui", taskGUI, TASK_GUI_PERIOD_MSEC, SCHEDULER_PRIORITY_LOW, TASK_GUI_BUDGET_USEC);
+  g_uiScheduler.addTask("wifi", taskWiFi, TASK_WIFI_PERIOD_MSEC, SCHEDULER_PRIORITY_LOW, TASK_WIFI_BUDGET_USEC);
+  g_uiScheduler.addTask("ota", taskOTA, TASK_OTA_PERIOD_MSEC, SCHEDULER_PRIORITY_LOW, TASK_OTA_BUDGET_USEC);
+  g_uiScheduler.addTask("heap", taskHeap, TASK_HEAP_PERIOD_MSEC, SCHEDULER_PRIORITY_LOW, TASK_HEAP_BUDGET_USEC);
+  g_uiScheduler.addTask("checkpoint", taskCheckpointFlush, TASK_CHECKPOINT_FLUSH_PERIOD_MSEC, SCHEDULER_PRIORITY_LOW, TASK_CHECKPOINT_FLUSH_BUDGET_USEC);
+}
 
-  // Service the knob
-  g_knob.service(g_loopCurrentTimeMSec);
+void setupEventBus()
+{
+  // Producers
+  g_thermometerSmoker.setEventBus(&g_eventBus, EVENT_SOURCE_SMOKER_PROBE);
+  g_thermometerFood.setEventBus(&g_eventBus, EVENT_SOURCE_FOOD_PROBE);
+  g_knob.setEventBus(&g_uiEventBus);
+  g_smokeMateGUI.setEventBus(&g_uiEventBus);
+  g_wifiManager.setEventBus(&g_uiEventBus);
+
+  // Control loop subscribers
+  g_eventBus.subscribe(EVENT_MASK(EVENT_SAMPLE_READY), onSampleReady);
+  g_eventBus.subscribe(EVENT_MASK(EVENT_RUN_STATE_CHANGED), onRunStateChanged);
+  g_eventBus.subscribe(EVENT_MASK(EVENT_CONFIG_CHANGED), onConfigurationChanged);
+  g_eventBus.subscribe(EVENT_MASK(EVENT_SAVE_REQUESTED), onSaveRequested);
+
+  // UI loop subscribers
+  g_uiEventBus.subscribe(EVENT_MASK(EVENT_BUTTON), onKnobEvent);
+  g_uiEventBus.subscribe(EVENT_MASK(EVENT_SAVE_REQUESTED) | EVENT_MASK(EVENT_CALIBRATION_REQUESTED) | EVENT_MASK(EVENT_RESTART_REQUESTED),
+                         onGUIRequest);
+  g_uiEventBus.subscribe(EVENT_MASK(EVENT_WIFI_CONNECTED) | EVENT_MASK(EVENT_WIFI_DISCONNECTED), onWiFiEvent);
+}
+
+void taskEvents(ulong currentTimeMSec)
+{
+  // Nothing pending costs one comparison
+  if (g_eventBus.isPending())
+    METRICS_CALL("events", g_eventBus.dispatch());
+}
 
-  // Service the thermometers
-  g_thermometerSmoker.service(g_loopCurrentTimeMSec);
-  g_thermometerFood.service(g_loopCurrentTimeMSec);
+void taskUIEvents(ulong currentTimeMSec)
+{
+  if (g_uiEventBus.isPending())
+    METRICS_CALL("ui_events", g_uiEventBus.dispatch());
+}
 
-  // Service the door and blower
-  g_door.service(g_loopCurrentTimeMSec);
-  g_blowerMotor.service(g_loopCurrentTimeMSec);
+void taskKnob(ulong currentTimeMSec)
+{
+  // The knob publishes its presses and rotations on the UI bus
+  METRICS_CALL("knob", g_knob.service(currentTimeMSec));
+}
 
-  loopServiceKnobButtonEvents();
-  loopUpdateControllerStatus();
-  updateConfiguration();
+void taskThermometers(ulong currentTimeMSec)
+{
+  // The thermometers read at their own interval
+  METRICS_CALL("thermometer_smoker", g_thermometerSmoker.service(currentTimeMSec));
+  METRICS_CALL("thermometer_food", g_thermometerFood.service(currentTimeMSec));
+}
+
+void taskActuators(ulong currentTimeMSec)
+{
+  // Service the actuator command layer, the door and the blower
+  if (g_deadlineMonitor.isFailSafe())
+  {
+    // The deadline monitor holds the drivers, the demands wait in the actuator channels
+  }
+  else if (g_deadlineMonitor.getTripCount() != g_failSafeResyncCount)
+  {
+    // Back from the fail-safe state, resume from the latest demands
+    g_failSafeResyncCount = g_deadlineMonitor.getTripCount();
+    DeadlineMiss deadlineMiss;
+    g_deadlineMonitor.getLastMiss(deadlineMiss);
+    DEBUG_PRINTLN("Control loop stalled for " + String(deadlineMiss.stallMSec) + " ms in " +
+                  String(deadlineMiss.taskName != nullptr ? deadlineMiss.taskName : "loop") + ", resuming control");
+    g_actuators.resync(currentTimeMSec);
+  }
+  else
+  {
+    METRICS_CALL("actuators", g_actuators.service(currentTimeMSec));
+  }
+  METRICS_CALL("door", g_door.service(currentTimeMSec));
+  METRICS_CALL("blower", g_blowerMotor.service(currentTimeMSec));
+}
+
+void taskController(ulong currentTimeMSec)
+{
+  // The controller itself runs on the smoker samples, see onSampleReady()
+  // Start, abort and report the blower airflow calibration sweep
+  loopServiceBlowerCalibration();
+
+  if (!g_controllerStatus.isRunning && !g_controllerStatus.isBlowerCalibrating && g_configuration.isForcedDoorPosition)
+  {
+    g_actuators.setDoorPosition(g_configuration.forcedDoorPosition); // Set the door position if forced
+  }
+
+  if (!g_controllerStatus.isRunning && !g_controllerStatus.isBlowerCalibrating && g_configuration.isForcedFanPWM)
+  {
+    g_actuators.setBlowerPWM(g_configuration.forcedFanPWM); // Set the blower motor PWM if forced
+  }
+}
+
+void onSampleReady(const Event &event)
+{
+  ulong currentTimeMSec = g_loopCurrentTimeMSec;
 
-  // Do actions on the controller status change
-  if (g_controllerStatus.isRunning != g_prevIsRunning)
+  if (event.source == EVENT_SOURCE_SMOKER_PROBE)
   {
-    // if the controller just stopped close the door and stop the blower motor
-    if (!g_controllerStatus.isRunning && g_prevIsRunning)
+    if (g_controllerStatus.isRunning)
     {
-      // Stop the blower motor
-      g_blowerMotor.setPWM(0);
-      // Close the door
-      g_door.close();
+      // Update the target temperature and service the temperature controller
+      g_controllerStatus.temperatureTarget = calculateTemperatureTarget();
+      METRICS_CALL("temperature_controller", g_temperatureController.service(g_temperatureFilter.update(g_thermometerSmoker.getTemperatureF()), currentTimeMSec));
+      g_controllerStatus.temperatureError = g_temperatureController.getLastOutput(); // Get the last output from the temperature controller
     }
-    else if (g_controllerStatus.isRunning && !g_prevIsRunning)
+    else if (g_blowerCalibrator.isRunning())
     {
-      // If the controller just started, set the start time
-      g_controllerStatus.controllerStartMSec = g_loopCurrentTimeMSec;
-      // Reset the temperature profile step index
-      g_temperatureProfileStepIndex = -1; // Reset the temperature profile step index
+      // The calibration sweep measures on the same samples while the controller is stopped
+      METRICS_CALL("blower_calibration", loopServiceBlowerCalibrationSample());
     }
-    g_prevIsRunning = g_controllerStatus.isRunning; // Update the previous running state
   }
+  else if (event.source == EVENT_SOURCE_FOOD_PROBE && g_controllerStatus.isRunning)
+  {
+    // Feed the cook predictor with every new food temperature reading
+    g_cookPredictor.setFinishTemperature(g_configuration.foodFinishTemperatureF);
+    METRICS_CALL("cook_predictor", g_cookPredictor.update(g_thermometerFood.getTemperatureF(), currentTimeMSec));
+  }
+}
 
-  // Service the temperature controller
-  if (g_controllerStatus.isRunning && g_thermometerSmoker.isNewTemperatureAvailable())
+void onRunStateChanged(const Event &event)
+{
+  if (event.value == 0)
   {
-    // Update the target temperature
-    g_controllerStatus.temperatureTarget = calculateTemperatureTarget();
-    // If the controller is not running, we still want to update the temperature
-    g_temperatureController.service(g_temperatureFilter.update(g_thermometerSmoker.getTemperatureF()), g_loopCurrentTimeMSec);
-    g_controllerStatus.temperatureError = g_temperatureController.getLastOutput(); // Get the last output from the temperature controller
+    // Stop the blower motor and close the door, bypassing the deadband and dwell
+    g_actuators.stop(g_loopCurrentTimeMSec);
+
+    // Changes made during the cook are written now rather than after the debounce
+    g_configWriter.requestFlush();
+  }
+  else
+  {
+    // Restart the temperature profile and start a new cook prediction
+    g_profileEngine.reset();
+    g_cookPredictor.reset();
   }
 
-  if (!g_controllerStatus.isRunning && g_configuration.isForcedDoorPosition)
+  // Starts and stops reach the checkpoint at once, not on the next periodic capture
+  g_controllerStatus.isRunResumed = false;
+  captureRunState(g_loopCurrentTimeMSec);
+}
+
+void onConfigurationChanged(const Event &event)
+{
+  // Apply the configuration to the devices and publish it to the UI core
+  updateConfiguration();
+  g_controlChannel.publishConfiguration(g_configuration);
+}
+
+void onSaveRequested(const Event &event)
+{
+  // Coalesced with the requests around it, written from the published snapshot on the writer task
+  g_configWriter.markDirty(CONFIG_RECORD_CONFIGURATION, g_loopCurrentTimeMSec);
+}
+
+void taskCommands(ulong currentTimeMSec)
+{
+  // Commands first, a configuration posted before a save command is then already in the mailbox
+  ControlCommand command;
+  while (g_controlChannel.receiveCommand(command))
   {
-    g_door.setPosition(g_configuration.forcedDoorPosition); // Set the door position if forced
+    switch (command.type)
+    {
+    case CONTROL_COMMAND_START:
+      if (!g_controllerStatus.isRunning)
+      {
+        g_controllerStatus.isRunning = true;
+        g_controllerStatus.controllerStartMSec = currentTimeMSec;
+        g_eventBus.publish(EVENT_RUN_STATE_CHANGED, EVENT_SOURCE_CONTROL, 1);
+      }
+      break;
+    case CONTROL_COMMAND_STOP:
+      if (g_controllerStatus.isRunning)
+      {
+        g_controllerStatus.isRunning = false;
+        g_eventBus.publish(EVENT_RUN_STATE_CHANGED, EVENT_SOURCE_CONTROL, 0);
+      }
+      break;
+    case CONTROL_COMMAND_START_BLOWER_CALIBRATION:
+      if (!g_controllerStatus.isRunning)
+        g_controllerStatus.isBlowerCalibrating = true;
+      break;
+    case CONTROL_COMMAND_STOP_BLOWER_CALIBRATION:
+      g_controllerStatus.isBlowerCalibrating = false;
+      break;
+    case CONTROL_COMMAND_SAVE_CONFIGURATION:
+      // Dispatched after this pass, a configuration received below is saved as well
+      g_eventBus.publish(EVENT_SAVE_REQUESTED, EVENT_SOURCE_CONTROL);
+      break;
+    case CONTROL_COMMAND_FACTORY_RESET:
+      // Reset ESP32 and NVRAM
+      DEBUG_PRINTLN("Factory reset requested, clearing NVRAM resetting ESP32");
+      g_actuators.stop(currentTimeMSec);
+      g_controllerStatus.isRunning = false; // No cook to resume after the restart
+      g_configWriter.discard();             // Drop the pending writes
+      g_nvram.clearNVRAM();                 // Clear NVRAM
+      g_profileNVRAM.clearNVRAM();          // Clear the profile table
+      g_runCheckpoint.clear();              // Forget the run state, stops the flash writer
+      delay(1000);                          // Wait for a second to ensure NVRAM is cleared
+      ESP.restart();                        // Restart the ESP32
+      break;
+    case CONTROL_COMMAND_RESTART:
+      DEBUG_PRINTLN("Restart requested, writing the pending NVRAM records");
+      g_actuators.stop(currentTimeMSec);
+      g_configWriter.flush(); // Pending changes are not lost with the restart
+      ESP.restart();
+      break;
+    }
   }
 
-  if (!g_controllerStatus.isRunning && g_configuration.isForcedFanPWM)
+  // The control loop is the only writer of the configuration
+  if (g_controlChannel.receiveConfiguration(g_configuration))
   {
-    g_blowerMotor.setPWM(g_configuration.forcedFanPWM); // Set the blower motor PWM if forced
+    g_eventBus.publish(EVENT_CONFIG_CHANGED, EVENT_SOURCE_CONTROL);
   }
 
-  // Check nvram save request
-  if (g_webServer.isNVRAMSaveRequired())
+  // A new profile table runs at once, a running profile keeps its start time
+  if (g_controlChannel.receiveProfile(g_profileTable))
   {
-    g_nvram.writeNVRAM(); // Write the configuration to NVRAM
+    updateTemperatureProfile();
+    g_controlChannel.publishProfile(g_profileTable);
+    g_configWriter.markDirty(CONFIG_RECORD_PROFILE, currentTimeMSec);
   }
+}
 
-  // Check the 0.5 second timer
-  if (g_loopCurrentTimeMSec - g_loopTimer500MSec >= 500)
+void taskPublish(ulong currentTimeMSec)
+{
+  // Readers on the UI core copy the snapshot, they never block this loop
+  loopUpdateControllerStatus();
+  g_controlChannel.publishStatus(g_controllerStatus);
+}
+
+void postUIConfigurationIfChanged()
+{
+  // Post the GUI edits against the copy they started from, only the changed fields travel
+  if (memcmp(&g_uiConfiguration, &g_uiPostedConfiguration, sizeof(Configuration)) != 0)
   {
-    g_loopTimer500MSec = g_loopCurrentTimeMSec;
+    g_uiPostedConfigurationId = g_controlChannel.postConfiguration(g_uiPostedConfiguration, g_uiConfiguration);
+    g_uiPostedConfiguration = g_uiConfiguration;
+  }
+}
 
-    // Update GUI state
-    g_smokeMateGUI.updateState(g_controllerStatus, g_configuration);
-    g_smokeMateGUI.service(g_loopCurrentTimeMSec);
-    // Check if the gui requested NVRAM save
-    if (g_smokeMateGUI.isNVRAMSaveRequired())
-    {
-      g_nvram.writeNVRAM(); // Write the configuration to NVRAM
-    }
+void taskConfigSync(ulong currentTimeMSec)
+{
+  postUIConfigurationIfChanged();
+
+  // Take over changes made elsewhere (web server, calibration) once our own posts are applied
+  // and the GUI is not in the middle of an edit. Until then they are not reverted, the GUI posts
+  // only the fields it changed.
+  uint32_t appliedId = g_controlChannel.getAppliedConfigurationId();
+  uint32_t sequence = g_controlChannel.getConfigurationSequence();
+  if (sequence != g_uiConfigurationSequence &&
+      static_cast<int32_t>(appliedId - g_uiPostedConfigurationId) >= 0 &&
+      !g_smokeMateGUI.isEditing())
+  {
+    g_controlChannel.readConfiguration(g_uiConfiguration);
+    g_uiPostedConfiguration = g_uiConfiguration;
+    g_uiConfigurationSequence = sequence;
+  }
+}
 
-    // Update the wifi status
-    if (g_configuration.isWiFiEnabled)
-    {
-      g_controllerStatus.RSSI = WiFi.RSSI();
-      g_controllerStatus.bars = WiFi.RSSI() / -20; // Convert RSSI to bars (0-5)
+void taskGUI(ulong currentTimeMSec)
+{
+  // Update GUI state from the latest status snapshot
+  g_controlChannel.readStatus(g_uiStatus);
+  METRICS_CALL("gui_update_state", g_smokeMateGUI.updateState(g_uiStatus, g_uiConfiguration));
+
+  // OTA progress is drawn at the GUI rate, not on every received chunk
+  OTAStatus otaStatus;
+  g_otaUpdater.getStatus(otaStatus);
+  g_smokeMateGUI.updateOTAState(otaStatus.phase == OTA_PHASE_UPDATING || otaStatus.phase == OTA_PHASE_DONE, otaStatus.percent);
+  METRICS_CALL("gui", g_smokeMateGUI.service(currentTimeMSec));
+}
 
-      // --- WiFi/server auto-reconnect logic ---
-      if (g_prevWiFiConnected &&
-          !g_controllerStatus.isWiFiConnected &&
-          g_wiFiConnectAttempts < MAX_WIFI_CONNECT_ATTEMPTS)
-      {
-        // Lost connection, try to reconnect and restart server
-        DEBUG_PRINTLN("WiFi connection lost, attempting to reconnect...");
-        connectToWiFi();
-        if (g_controllerStatus.isWiFiConnected)
-        {
-          DEBUG_PRINTLN("WiFi reconnected, restarting web server...");
-          g_webServer.begin();
-          g_wiFiConnectAttempts = 0; // Reset the connection attempts
-        }
-        else
-        {
-          g_wiFiConnectAttempts++; // Increment the connection attempts
-          DEBUG_PRINTLN("WiFi reconnect attempt failed, retrying...");
-        }
-      }
-      g_prevWiFiConnected = g_controllerStatus.isWiFiConnected;
+void onGUIRequest(const Event &event)
+{
+  switch (event.type)
+  {
+  case EVENT_SAVE_REQUESTED:
+    // The edits first, the control loop saves after applying them
+    postUIConfigurationIfChanged();
+    g_controlChannel.postCommand(CONTROL_COMMAND_SAVE_CONFIGURATION);
+    break;
+  case EVENT_RESTART_REQUESTED:
+    // The control loop writes the pending records before it restarts
+    g_controlChannel.postCommand(CONTROL_COMMAND_RESTART);
+    break;
+  case EVENT_CALIBRATION_REQUESTED:
+    // Start or stop the blower calibration, only while the controller is stopped
+    g_controlChannel.readStatus(g_uiStatus);
+    if (!g_uiStatus.isRunning)
+    {
+      g_controlChannel.postCommand(g_uiStatus.isBlowerCalibrating ? CONTROL_COMMAND_STOP_BLOWER_CALIBRATION
+                                                                  : CONTROL_COMMAND_START_BLOWER_CALIBRATION);
     }
+    break;
+  default:
+    break;
   }
 }
 
-void loopServiceKnobButtonEvents()
+void taskWiFi(ulong currentTimeMSec)
 {
-  if (g_knob.isShortButtonPressed())
+  // Follow the settings, new credentials reconnect after a short backoff. Then run the connect
+  // timeout and the backoff, never waits on the network
+  g_wifiManager.configure(g_uiConfiguration.isWiFiEnabled, g_uiConfiguration.wifiSSID,
+                          g_uiConfiguration.wifiPassword, currentTimeMSec);
+  g_wifiManager.service(currentTimeMSec);
+
+  g_networkStatus.isWiFiConnected = g_wifiManager.isConnected();
+  if (g_networkStatus.isWiFiConnected)
   {
-    g_smokeMateGUI.commandSelect(); // Handle short button press
+    g_networkStatus.RSSI = WiFi.RSSI();
+    g_networkStatus.bars = rssiToBars(g_networkStatus.RSSI);
+  }
+  g_controlChannel.publishNetworkStatus(g_networkStatus);
+}
+
+void onWiFiEvent(const Event &event)
+{
+  g_wifiManager.handleEvent(event, millis());
+
+  if (event.type == EVENT_WIFI_CONNECTED && g_wifiManager.isConnected())
+  {
+    strlcpy(g_networkStatus.ipAddress, WiFi.localIP().toString().c_str(), sizeof(g_networkStatus.ipAddress));
+    strlcpy(g_networkStatus.networkName, WiFi.SSID().c_str(), sizeof(g_networkStatus.networkName));
+    g_networkStatus.RSSI = WiFi.RSSI();
+    g_networkStatus.bars = rssiToBars(g_networkStatus.RSSI);
+    g_networkStatus.isWiFiConnected = true;
+    DEBUG_PRINTLN("Connected to WiFi, IP Address: " + String(g_networkStatus.ipAddress));
+
+    // (Re)start the web server on the new connection, a server still listening is left as is
+    g_webServer.begin();
+    g_otaUpdater.setNetworkReady(true);
   }
+  else if (event.type == EVENT_WIFI_DISCONNECTED && !g_wifiManager.isConnected())
+  {
+    g_networkStatus.isWiFiConnected = false;
+    g_networkStatus.bars = 0;
+  }
+  g_controlChannel.publishNetworkStatus(g_networkStatus);
+}
+
+void taskOTA(ulong currentTimeMSec)
+{
+  // The OTA task applies the policy between update requests
+  g_otaUpdater.setPolicy(g_uiConfiguration.otaPolicy, g_uiStatus.isRunning);
+}
+
+void taskCheckpoint(ulong currentTimeMSec)
+{
+  // RTC memory on every capture, the UI loop copies it to flash
+  captureRunState(currentTimeMSec);
+}
+
+void taskCheckpointFlush(ulong currentTimeMSec)
+{
+  // Flash writes stay off the control loop
+  g_runCheckpoint.flush(currentTimeMSec);
+}
+
+void captureRunState(ulong currentTimeMSec)
+{
+  RunState state;
+  memset(&state, 0, sizeof(state));
+  state.isRunning = g_controllerStatus.isRunning;
+  state.runElapsedMSec = currentTimeMSec - g_controllerStatus.controllerStartMSec;
+  state.isProfileStarted = g_profileEngine.getState() != PROFILE_STATE_IDLE;
+  state.profileElapsedMSec = g_profileEngine.getProfileTimeMSec(currentTimeMSec);
+  state.profileStepIndex = g_profileEngine.getStepIndex();
+  state.isIntegratorValid = g_temperatureController.getIntegrator(state.algorithm, state.integrator);
+  g_runCheckpoint.capture(state);
+}
+
+void setupResumeRun()
+{
+  g_controllerStatus.resumedAgeSec = RUN_CHECKPOINT_UNKNOWN_AGE;
+
+  RunState state;
+  if (!g_runCheckpoint.restore(state, g_configuration.resumeWindowMin * 60000UL, g_configuration.isResumeAfterPowerLossEnabled))
+    return;
+
+  // Continue the run and the profile where the checkpoint left them, the time spent off is not counted
+  ulong currentTimeMSec = millis();
+  g_controllerStatus.isRunning = true;
+  g_controllerStatus.controllerStartMSec = currentTimeMSec - state.runElapsedMSec;
+  g_controllerStatus.isRunResumed = true;
+  g_controllerStatus.resumedAgeSec = g_runCheckpoint.getRestoredAgeSec();
+  if (state.isProfileStarted)
+    g_profileEngine.resume(state.profileElapsedMSec, state.profileStepIndex, currentTimeMSec);
+  if (state.isIntegratorValid && state.algorithm == g_configuration.controlAlgorithm)
+    g_temperatureController.restoreIntegrator(state.integrator);
+
+  DEBUG_PRINTLN("Resumed the cook interrupted by the last reset");
+}
+
+void taskHeap(ulong currentTimeMSec)
+{
+  // Heap figures and stack high-water marks for /status and /debug/heap
+  HeapMonitor::sample();
+
+  // Past boot the control loop keeps off the heap, new allocations there are reported with DEBUG_MAIN
+  HeapSnapshot snapshot;
+  HeapMonitor::getSnapshot(snapshot);
+#ifdef DEBUG_MAIN
+  if (currentTimeMSec >= HEAP_LOOP_SETTLE_MSEC && snapshot.loopAllocCount > g_prevLoopAllocCount)
+    DEBUG_PRINTLN("Control loop allocated " + String(snapshot.loopAllocCount - g_prevLoopAllocCount) + " times in steady state");
+#endif
+  g_prevLoopAllocCount = snapshot.loopAllocCount;
+}
 
-  // Check for the long press on the knob
-  if (g_knob.isLongButtonPressed())
+void onKnobEvent(const Event &event)
+{
+  switch (event.value)
   {
+  case KNOB_EVENT_SHORT_PRESS:
+    g_smokeMateGUI.commandSelect(); // Handle short button press
+    break;
+
+  case KNOB_EVENT_LONG_PRESS:
     // Check on the current GUI state
     if (g_smokeMateGUI.getState().header.state == GUI_STATE_HEADER_STATUS ||
         g_smokeMateGUI.getState().header.state == GUI_STATE_HEADER_CHART ||
         g_smokeMateGUI.getState().header.state == GUI_STATE_HEADER_SETTINGS)
     {
-      // Toggle the controller running state
-      g_controllerStatus.isRunning = !g_controllerStatus.isRunning;
-      if (g_controllerStatus.isRunning)
-      {
-        // Start the controller
-        g_controllerStatus.controllerStartMSec = g_loopCurrentTimeMSec;
-        // g_blowerMotor.start(); // Start the blower motor
-      }
-      else
-      {
-        // Stop the controller
-        // g_blowerMotor.stop(); // Stop the blower motor
-      }
+      // Toggle the controller running state, the control loop sets the start time
+      g_controlChannel.readStatus(g_uiStatus);
+      g_controlChannel.postCommand(g_uiStatus.isRunning ? CONTROL_COMMAND_STOP : CONTROL_COMMAND_START);
     }
     else
     {
       g_smokeMateGUI.commandConfirm(); // Handle long button press in settings edit mode
     }
-  }
+    break;
 
-  if (g_knob.isUltraLongButtonPressed())
-  {
-    // Reset ESP32 and NVRAM
+  case KNOB_EVENT_ULTRA_LONG_PRESS:
+    // Reset ESP32 and NVRAM, the control loop owns the NVRAM
     g_tftDisplay.fillScreen(ST77XX_BLACK); // Clear the display
-    DEBUG_PRINTLN("Ultra long button press detected, clearing NVRAM resetting ESP32");
-    g_nvram.clearNVRAM(); // Clear NVRAM
-    delay(1000);          // Wait for a second to ensure NVRAM is cleared
-    ESP.restart();        // Restart the ESP32
-  }
+    DEBUG_PRINTLN("Ultra long button press detected");
+    g_controlChannel.postCommand(CONTROL_COMMAND_FACTORY_RESET);
+    break;
 
-  if (g_knob.isRotatingUp())
-  {
+  case KNOB_EVENT_ROTATE_UP:
     // Increase the target temperature
     g_smokeMateGUI.commandMoveNext();
-  }
+    break;
 
-  if (g_knob.isRotatingDown())
-  {
+  case KNOB_EVENT_ROTATE_DOWN:
     // Decrease the target temperature
     g_smokeMateGUI.commandMovePrevious();
+    break;
   }
 }
 
@@ -288,26 +689,43 @@ void updateConfiguration()
 {
   g_thermometerSmoker.setSimulated(g_configuration.isThemometerSimulated);
   g_thermometerFood.setSimulated(g_configuration.isThemometerSimulated);
+  g_blowerMotor.setFrequency(g_configuration.blowerPWMFrequencyHz);
+  g_blowerMotor.setRamp(g_configuration.blowerKickStartMSec, g_configuration.blowerSlewPWMPerSec);
+  g_door.setProfile(g_configuration.doorMaxSpeedDegPerSec, g_configuration.doorAccelDegPerSec2);
   g_temperatureFilter.setType(g_configuration.isTemperatureFilterEnabled ? FilterType::EWMA : FilterType::NONE,
                               g_configuration.temperatureFilterCoeff);
+  g_deadlineMonitor.setParameters(TASK_ACTUATORS_PERIOD_MSEC, g_configuration.deadlineMissedPeriods,
+                                  g_configuration.failSafeDoorPosition * 10);
+  updateTemperatureProfile();
+}
+
+void updateTemperatureProfile()
+{
+  // Compiled on every change, the lookups of the control loop only search the segment table
+  if (g_profileTable.stepsCount > 0)
+    g_profileEngine.compile(g_profileTable.steps, g_profileTable.stepsCount, g_configuration.profilePitBandF);
+  else
+    g_profileEngine.compile(g_configuration.temperatureProfile, g_configuration.temperatureProfileStepsCount,
+                            g_configuration.profilePitBandF);
 }
 
 void loopUpdateControllerStatus()
 {
   // Update the status variable of the controller
   g_controllerStatus.temperatureSmoker = g_thermometerSmoker.getTemperatureF();
+  g_controllerStatus.schedulerOverrunCount = g_scheduler.getOverrunCount();
+  g_controllerStatus.schedulerMaxPassTimeUSec = g_scheduler.getMaxPassTimeUSec();
   g_controllerStatus.temperatureFood = g_thermometerFood.getTemperatureF();
   g_controllerStatus.fanPWM = g_blowerMotor.getPWM();
+  g_controllerStatus.blowerOutputPWM = g_blowerMotor.getOutputPWM();
+  g_controllerStatus.blowerKickCount = g_blowerMotor.getKickCount();
   g_controllerStatus.doorPosition = g_door.getPosition();
   g_controllerStatus.uptime = g_loopCurrentTimeMSec;
-  // g_controllerStatus.RSSI = WiFi.RSSI();
-  // g_controllerStatus.bars = WiFi.RSSI() / -20;             // Convert RSSI to bars (0-5)
-  g_controllerStatus.isWiFiConnected = WiFi.isConnected(); // Update WiFi connection status
   if (!g_controllerStatus.isRunning)
   {
-    if (g_configuration.isTemperatureProfilingEnabled && g_configuration.temperatureProfileStepsCount > 0)
+    if (g_configuration.isTemperatureProfilingEnabled && g_profileEngine.getSegmentCount() > 0)
     {
-      g_controllerStatus.temperatureTarget = g_configuration.temperatureProfile[0].temperatureStartF; // Set target temperature to the first profile step
+      g_controllerStatus.temperatureTarget = g_profileEngine.getFirstTarget(); // Set target temperature to the first profile step
     }
     else
     {
@@ -315,47 +733,125 @@ void loopUpdateControllerStatus()
     }
   }
 
-  int temperatureProfileisRunning = 0;
-  if (g_temperatureProfileStepIndex == -1)
-  {
-    temperatureProfileisRunning = 0; // No active profile step, profile is not running
-  }
-  else if (g_temperatureProfileStepIndex >= 0 &&
-           g_temperatureProfileStepIndex < g_configuration.temperatureProfileStepsCount)
+  // Profile state, 0 not started, 1 running, 2 finished
+  g_controllerStatus.isProfileRunning = g_profileEngine.getState();
+  g_controllerStatus.temperatureProfileStepIndex = g_profileEngine.getStepIndex();             // Current step index in the temperature profile
+  g_controllerStatus.temperatureProfileStartTimeMSec = g_profileEngine.getStepStartTimeMSec(); // Start time of the current temperature profile step
+  g_controllerStatus.temperatureProfileStepsCount = g_profileEngine.getSegmentCount();         // Number of steps in the temperature profile
+  g_controllerStatus.temperatureProfileStepType = g_profileEngine.getStepType();               // Type of the current step, dwell when none
+  g_controllerStatus.isProfileStepHolding = g_profileEngine.isStepHolding();                   // Step waiting past its time for its conditions
+
+  // Identified plant model
+  PlantModel plantModel = g_temperatureController.getPlantModel();
+  g_controllerStatus.isPlantModelValid = plantModel.isValid;
+  g_controllerStatus.plantGain = plantModel.gain;
+  g_controllerStatus.plantTimeConstantSec = plantModel.timeConstantSec;
+  g_controllerStatus.plantDeadTimeSec = plantModel.deadTimeSec;
+
+  // Actuator command statistics
+  g_controllerStatus.blowerCommandsIssued = g_actuators.getBlowerCounters().issued;
+  g_controllerStatus.blowerCommandsSuppressed = g_actuators.getBlowerCounters().suppressed;
+  g_controllerStatus.doorCommandsIssued = g_actuators.getDoorCounters().issued;
+  g_controllerStatus.doorCommandsSuppressed = g_actuators.getDoorCounters().suppressed;
+
+  // Lid-open events
+  const LidDetector &lidDetector = g_temperatureController.getLidDetector();
+  g_controllerStatus.lidState = g_controllerStatus.isRunning ? lidDetector.getState() : LID_STATE_CLOSED;
+  g_controllerStatus.lidEventCount = lidDetector.getEventCount();
+  g_controllerStatus.lastLidEventStartMSec = lidDetector.getLastEvent().startMSec;
+  g_controllerStatus.lastLidEventDurationMSec = lidDetector.getLastEvent().durationMSec;
+  g_controllerStatus.lastLidEventDropF = lidDetector.getLastEvent().dropF;
+
+  // Fire alarm, only meaningful while the controller is running
+  const FireMonitor &fireMonitor = g_temperatureController.getFireMonitor();
+  g_controllerStatus.fireAlarm = g_controllerStatus.isRunning ? fireMonitor.getAlarm() : FIRE_ALARM_NONE;
+  g_controllerStatus.isFireAlarm = g_controllerStatus.fireAlarm != FIRE_ALARM_NONE;
+  g_controllerStatus.fireAlarmStartMSec = fireMonitor.getAlarmStartMSec();
+
+  // Food stall and completion time
+  const CookPrediction &cookPrediction = g_cookPredictor.getPrediction();
+  bool isCookPredictionValid = g_controllerStatus.isRunning && cookPrediction.isValid;
+  g_controllerStatus.isFoodStalled = isCookPredictionValid && cookPrediction.isStalled;
+  g_controllerStatus.isCookDone = isCookPredictionValid && cookPrediction.isDone;
+  g_controllerStatus.foodRateFPerHour = isCookPredictionValid ? cookPrediction.rateFPerHour : 0.0f;
+  g_controllerStatus.cookEtaSec = isCookPredictionValid ? cookPrediction.etaSec : -1;
+  g_controllerStatus.cookEtaLowSec = isCookPredictionValid ? cookPrediction.etaLowSec : -1;
+  g_controllerStatus.cookEtaHighSec = isCookPredictionValid ? cookPrediction.etaHighSec : -1;
+
+  // Control loop deadline misses
+  DeadlineMiss deadlineMiss;
+  g_deadlineMonitor.getLastMiss(deadlineMiss);
+  g_controllerStatus.isFailSafe = g_deadlineMonitor.isFailSafe();
+  g_controllerStatus.failSafeTripCount = g_deadlineMonitor.getTripCount();
+  strlcpy(g_controllerStatus.failSafeTask, deadlineMiss.taskName != nullptr ? deadlineMiss.taskName : "",
+          sizeof(g_controllerStatus.failSafeTask));
+  g_controllerStatus.failSafeStartMSec = deadlineMiss.startMSec;
+  g_controllerStatus.failSafeStallMSec = deadlineMiss.stallMSec;
+}
+
+void loopServiceBlowerCalibration()
+{
+  // The controller takes the actuators back when it starts
+  if (g_controllerStatus.isRunning)
   {
-    temperatureProfileisRunning = 1; // Profile is running
+    g_controllerStatus.isBlowerCalibrating = false;
   }
-  else
+
+  if (g_controllerStatus.isBlowerCalibrating != g_prevIsBlowerCalibrating)
   {
-    temperatureProfileisRunning = 2; // Profile finished
+    if (g_controllerStatus.isBlowerCalibrating)
+    {
+      g_blowerCalibrator.start(g_loopCurrentTimeMSec);
+    }
+    else
+    {
+      g_blowerCalibrator.abort();
+      if (!g_controllerStatus.isRunning)
+        g_actuators.stop(g_loopCurrentTimeMSec);
+    }
+    g_prevIsBlowerCalibrating = g_controllerStatus.isBlowerCalibrating;
   }
-  g_controllerStatus.isProfileRunning = temperatureProfileisRunning;
-  g_controllerStatus.temperatureProfileStepIndex = g_temperatureProfileStepIndex;                 // Current step index in the temperature profile
-  g_controllerStatus.temperatureProfileStartTimeMSec = g_temperatureProfileStartTimeMSec;         // Start time of the current temperature profile step
-  g_controllerStatus.temperatureProfileStepsCount = g_configuration.temperatureProfileStepsCount; // Number of steps in the temperature profile
-  if (g_temperatureProfileStepIndex >= 0 && g_temperatureProfileStepIndex < g_configuration.temperatureProfileStepsCount)
+
+  g_controllerStatus.blowerCalibrationState = g_blowerCalibrator.getState();
+  g_controllerStatus.blowerCalibrationProgress = g_blowerCalibrator.getProgress(g_loopCurrentTimeMSec);
+}
+
+void loopServiceBlowerCalibrationSample()
+{
+  if (g_blowerCalibrator.service(g_thermometerSmoker.getTemperatureF(), g_loopCurrentTimeMSec) == BLOWER_CALIBRATION_DONE)
   {
-    g_controllerStatus.temperatureProfileStepType = g_configuration.temperatureProfile[g_temperatureProfileStepIndex].type; // Type of the current temperature profile step
+    // Publish and keep the measured airflow table
+    g_eventBus.publish(EVENT_CONFIG_CHANGED, EVENT_SOURCE_CONTROL);
+    g_eventBus.publish(EVENT_SAVE_REQUESTED, EVENT_SOURCE_CONTROL);
   }
-  else
+  if (!g_blowerCalibrator.isRunning())
   {
-    g_controllerStatus.temperatureProfileStepType = TEMP_PROFILE_TYPE_DWELL; // Default to dwell type if no active profile step
+    // Sweep finished or failed, stop the blower and close the door
+    g_controllerStatus.isBlowerCalibrating = false;
+    g_prevIsBlowerCalibrating = false;
+    g_actuators.stop(g_loopCurrentTimeMSec);
   }
 }
 
 void setupInitializeControllerStatus(ControllerStatus &controllerStatus)
 {
   controllerStatus.isRunning = false;                                     // Start with controller not running
-  controllerStatus.uuid = "00000000-0000-0000-0000-000000000000";         // Default UUID
+  strcpy(controllerStatus.uuid, "00000000-0000-0000-0000-000000000000");  // Default UUID
   controllerStatus.uptime = 0;                                            // Start with zero uptime
   controllerStatus.controllerStartMSec = 0;                               // Set controller start time
   controllerStatus.temperatureSmoker = 0;                                 // Start with zero smoker temperature
   controllerStatus.temperatureFood = 0;                                   // Start with zero food temperature
   controllerStatus.temperatureTarget = g_configuration.temperatureTarget; // Set target temperature from configuration
   controllerStatus.fanPWM = 0;                                            // Start with fan off
+  controllerStatus.isBlowerCalibrating = false;                           // No calibration sweep at startup
   controllerStatus.doorPosition = 0;                                      // Get initial door position
   controllerStatus.RSSI = 0;                                              // Start with zero RSSI
   controllerStatus.bars = 0;                                              // Start with zero bars
+  controllerStatus.schedulerOverrunCount = 0;                             // No task overran yet
+  controllerStatus.schedulerMaxPassTimeUSec = 0;                          // No pass measured yet
+  controllerStatus.isFailSafe = false;                                    // Actuators under control
+  controllerStatus.failSafeTripCount = 0;                                 // No deadline missed yet
+  controllerStatus.failSafeTask[0] = '\0';                                // No stalled task recorded
 }
 
 void loadDefaultConfiguration(Configuration *ptr_configuration)
@@ -371,21 +867,49 @@ void loadDefaultConfiguration(Configuration *ptr_configuration)
     ptr_configuration->temperatureProfile[i].type = TEMP_PROFILE_TYPE_DWELL;                 // Default to dwell type
     ptr_configuration->temperatureProfile[i].temperatureStartF = DEFAULT_TEMPERATURE_TARGET; // Default to target temperature
     ptr_configuration->temperatureProfile[i].temperatureEndF = DEFAULT_TEMPERATURE_TARGET;   // Default to target temperature
+    ptr_configuration->temperatureProfile[i].advanceConditions = TEMP_PROFILE_ADVANCE_TIME;  // Default to a timed step
+    ptr_configuration->temperatureProfile[i].isAdvanceOnAll = false;
+    ptr_configuration->temperatureProfile[i].advanceFoodF = DEFAULT_PROFILE_ADVANCE_FOOD_F;
+    ptr_configuration->temperatureProfile[i].advancePitHoldMSec = DEFAULT_PROFILE_PIT_HOLD_MSEC;
   }
+  ptr_configuration->profilePitBandF = DEFAULT_PROFILE_PIT_BAND_F;
 
-  ptr_configuration->isPIDEnabled = true;
-  ptr_configuration->kP = DEFAULT_PID_KP;
-  ptr_configuration->kI = DEFAULT_PID_KI;
-  ptr_configuration->kD = DEFAULT_PID_KD;
-
-  ptr_configuration->bangBangLowThreshold = DEFAULT_BANG_BANG_THRESHOLD_LOW;
-  ptr_configuration->bangBangHighThreshold = DEFAULT_BANG_BANG_THRESHOLD_HIGH;
-  ptr_configuration->bangBangHysteresis = DEFAULT_BANG_BANG_HYSTERESIS;
-  ptr_configuration->bangBangFanSpeed = DEFAULT_BANG_BANG_FAN_SPEED;
+  ptr_configuration->controlAlgorithm = CONTROL_PID;
+  loadDefaultControlParameters(*ptr_configuration); // Defaults declared by each control strategy
 
+  ptr_configuration->blowerPWMFrequencyHz = DEFAULT_BLOWER_PWM_FREQUENCY_HZ;
+  ptr_configuration->blowerKickStartMSec = DEFAULT_BLOWER_KICK_START_MSEC;
+  ptr_configuration->blowerSlewPWMPerSec = DEFAULT_BLOWER_SLEW_PWM_PER_SEC;
+  ptr_configuration->isBlowerAirflowCalibrated = false; // Linear airflow until a calibration sweep is run
+  memcpy(ptr_configuration->blowerAirflowTable, BLOWER_CALIBRATION_PWM, sizeof(ptr_configuration->blowerAirflowTable));
   ptr_configuration->doorOpenPosition = DEFAULT_DOOR_OPEN_POSITION;
+  ptr_configuration->doorMaxSpeedDegPerSec = DEFAULT_DOOR_MAX_SPEED_DEG_PER_SEC;
+  ptr_configuration->doorAccelDegPerSec2 = DEFAULT_DOOR_ACCEL_DEG_PER_SEC2;
+  ptr_configuration->isDoorAirflowMapEnabled = false; // Linear door travel until the map is enabled
+  memcpy(ptr_configuration->doorAirflowTable, DEFAULT_DOOR_AIRFLOW_TABLE, sizeof(ptr_configuration->doorAirflowTable));
   ptr_configuration->doorClosePosition = DEFAULT_DOOR_CLOSE_POSITION;
 
+  ptr_configuration->actuatorBlowerDeadbandPWM = DEFAULT_ACTUATOR_BLOWER_DEADBAND_PWM;
+  ptr_configuration->actuatorBlowerMinDwellMSec = DEFAULT_ACTUATOR_BLOWER_MIN_DWELL_MSEC;
+  ptr_configuration->actuatorBlowerMaxRatePWMPerSec = DEFAULT_ACTUATOR_BLOWER_MAX_RATE_PWM_PER_SEC;
+  ptr_configuration->actuatorDoorDeadbandDeg = DEFAULT_ACTUATOR_DOOR_DEADBAND_DEG;
+  ptr_configuration->actuatorDoorMinDwellMSec = DEFAULT_ACTUATOR_DOOR_MIN_DWELL_MSEC;
+  ptr_configuration->actuatorDoorMaxRateDegPerSec = DEFAULT_ACTUATOR_DOOR_MAX_RATE_DEG_PER_SEC;
+
+  ptr_configuration->isLidDetectionEnabled = DEFAULT_LID_DETECTION_ENABLED;
+  ptr_configuration->lidOpenRateFPerMin = DEFAULT_LID_OPEN_RATE_F_PER_MIN;
+  ptr_configuration->lidCloseRateFPerMin = DEFAULT_LID_CLOSE_RATE_F_PER_MIN;
+  ptr_configuration->lidMaxOpenMSec = DEFAULT_LID_MAX_OPEN_MSEC;
+  ptr_configuration->lidRecoveryMSec = DEFAULT_LID_RECOVERY_MSEC;
+
+  ptr_configuration->foodFinishTemperatureF = DEFAULT_FOOD_FINISH_TEMPERATURE_F;
+
+  ptr_configuration->isFireDetectionEnabled = DEFAULT_FIRE_DETECTION_ENABLED;
+  ptr_configuration->fireDetectMSec = DEFAULT_FIRE_DETECT_MSEC;
+
+  ptr_configuration->deadlineMissedPeriods = DEFAULT_DEADLINE_MISSED_PERIODS;
+  ptr_configuration->failSafeDoorPosition = DEFAULT_DOOR_CLOSE_POSITION; // Starve the fire while the loop is stalled
+
   ptr_configuration->themometerSmokerGain = DEFAULT_THERMOMETER_SMOKER_GAIN;
   ptr_configuration->themometerSmokerOffset = DEFAULT_THERMOMETER_SMOKER_OFFSET;
   ptr_configuration->themometerFoodGain = DEFAULT_THERMOMETER_FOOD_GAIN;
@@ -403,6 +927,9 @@ void loadDefaultConfiguration(Configuration *ptr_configuration)
   ptr_configuration->wifiSSID[sizeof(ptr_configuration->wifiSSID) - 1] = '\0';
   strncpy(ptr_configuration->wifiPassword, NETWORK_PASSWORD, sizeof(ptr_configuration->wifiPassword) - 1); // Default password
   ptr_configuration->wifiPassword[sizeof(ptr_configuration->wifiPassword) - 1] = '\0';
+  ptr_configuration->otaPolicy = DEFAULT_OTA_POLICY;
+  ptr_configuration->resumeWindowMin = DEFAULT_RESUME_WINDOW_MIN;
+  ptr_configuration->isResumeAfterPowerLossEnabled = DEFAULT_RESUME_AFTER_POWER_LOSS;
 
   ptr_configuration->isTemperatureFilterEnabled = DEFAULT_TEMPERATURE_FILTER_ENABLED; // Default temperature filter enabled
   ptr_configuration->temperatureFilterCoeff = DEFAULT_TEMPERATURE_FILTER_COEFF;       // Default temperature filter coefficient
@@ -463,173 +990,36 @@ void setupInitializeNVRAM()
     DEBUG_PRINTLN("NVRAM READ success");
 #endif
   }
+
+  // The profile table is optional, without one the configured steps run
+  if (!g_profileNVRAM.readNVRAM())
+    g_profileTable.stepsCount = 0;
+  g_profileTable.stepsCount = constrain(g_profileTable.stepsCount, 0, MAX_PROFILE_TABLE_STEPS);
 }
 
-void connectToWiFi()
+int rssiToBars(int rssi)
 {
-  // attempt to connect to WiFi with the stored credentials, repeating until successful or number of attempts is reached
-  int attempts = 0;
-  g_controllerStatus.isWiFiConnected = false;
-  while (attempts < MAX_WIFI_CONNECT_ATTEMPTS)
-  {
-
-    // If NVRAM read was successful, try to connect to WiFi
-    if (g_configuration.wifiSSID[0] != '\0' && g_configuration.wifiPassword[0] != '\0')
-    {
-      DEBUG_PRINTLN("Connecting to WiFi...");
-      WiFi.begin(g_configuration.wifiSSID, g_configuration.wifiPassword);
-      if (WiFi.waitForConnectResult() == WL_CONNECTED)
-      {
-        // Store the IP address in the controller status
-        g_controllerStatus.ipAddress = WiFi.localIP().toString();
-        g_controllerStatus.RSSI = WiFi.RSSI();
-
-        if (g_controllerStatus.RSSI > -55)
-          g_controllerStatus.bars = 4;
-        else if (g_controllerStatus.RSSI > -70)
-          g_controllerStatus.bars = 3;
-        else if (g_controllerStatus.RSSI > -80)
-          g_controllerStatus.bars = 2;
-        else if (g_controllerStatus.RSSI > -90)
-          g_controllerStatus.bars = 1;
-        else
-          g_controllerStatus.bars = 0;
-
-        g_controllerStatus.isWiFiConnected = true; // Set WiFi connected status
-        g_prevWiFiConnected = true;                // Update previous WiFi connected status
-        DEBUG_PRINTLN("Connected to WiFi");
-        // print the IP address
-        DEBUG_PRINTLN("IP Address: ");
-        DEBUG_PRINTLN(g_controllerStatus.ipAddress);
-
-        break; // Exit loop on successful connection
-      }
-    }
-
-    attempts++;
-    delay(1000); // Wait before retrying
-  }
-
-  if (g_controllerStatus.isWiFiConnected)
-  {
-    // Set Network name
-    g_controllerStatus.networkName = WiFi.SSID();
-
-    // OTA setup
-    ArduinoOTA.setHostname("smokemate9002");
-
-    ArduinoOTA.onStart(
-        []()
-        {
-          Serial.println("OTA Update Starting...");
-          // Show message on TFT
-          g_tftDisplay.fillRect(0, 260, 240, 60, ST77XX_BLACK); // Clear area
-          g_tftDisplay.setCursor(10, 280);
-          g_tftDisplay.setTextColor(ST77XX_YELLOW, ST77XX_BLACK);
-          g_tftDisplay.setTextSize(2);
-          g_tftDisplay.print("OTA Update...");
-        });
-    ArduinoOTA.onEnd(
-        []()
-        {
-          // Print to serial
-          Serial.println("OTA Update Complete!");
-          // Show message on TFT
-          g_tftDisplay.fillRect(0, 260, 240, 60, ST77XX_BLACK); // Clear area
-          g_tftDisplay.setCursor(10, 280);
-          g_tftDisplay.setTextColor(ST77XX_GREEN, ST77XX_BLACK);
-          g_tftDisplay.setTextSize(2);
-          g_tftDisplay.print("OTA Done!");
-        });
-    ArduinoOTA.onProgress(
-        [](unsigned int progress, unsigned int total)
-        {
-          // Calculate percentage
-          int percent = (progress * 100) / total;
-
-          // Print to serial
-          Serial.printf("OTA Progress: %u%%\r\n", percent);
-
-          // Show progress on TFT (simple example)
-          g_tftDisplay.fillRect(10, 300, 220, 10, ST77XX_BLACK);                   // Clear previous bar
-          g_tftDisplay.fillRect(10, 300, (220 * percent) / 100, 10, ST77XX_GREEN); // Draw progress bar
-          g_tftDisplay.setCursor(10, 280);
-          g_tftDisplay.setTextColor(ST77XX_WHITE, ST77XX_BLACK);
-          g_tftDisplay.setTextSize(2);
-          g_tftDisplay.printf("OTA: %d%%", percent);
-        });
-    ArduinoOTA.onError([](ota_error_t error) {});
-
-    ArduinoOTA.begin();
-  }
+  if (rssi > -55)
+    return 4;
+  else if (rssi > -70)
+    return 3;
+  else if (rssi > -80)
+    return 2;
+  else if (rssi > -90)
+    return 1;
+  return 0;
 }
 
 int calculateTemperatureTarget()
 {
   // Check if the temperature profiling is disabled or there are no configured steps
   // then just set the target based on the configuration
-  if (!g_configuration.isTemperatureProfilingEnabled ||
-      g_configuration.temperatureProfileStepsCount == 0)
-
+  if (!g_configuration.isTemperatureProfilingEnabled || g_profileEngine.getSegmentCount() == 0)
   {
-    // Temperature profiling is disabled or no steps are configured then just return the target temperature
     return g_configuration.temperatureTarget; // Return the target temperature from configuration
   }
-  else if (g_configuration.isTemperatureProfilingEnabled && g_temperatureProfileStepIndex >= g_configuration.temperatureProfileStepsCount)
-  {
-    // If the temperature profiling is enabled but the current step index is out of bounds, return the last step's temperature
-    // If the last step is a ramp step, return the end temperature of the last step
-    TempProfileStep lastStep = g_configuration.temperatureProfile[g_configuration.temperatureProfileStepsCount - 1];
-    if (lastStep.type == TEMP_PROFILE_TYPE_RAMP)
-    {
-      return lastStep.temperatureEndF; // Return the end temperature of the last step
-    }
-    else
-    {
-      return lastStep.temperatureStartF; // Return the start temperature of the last step
-    }
-  }
-  else
-  {
-    // Check if the current call is the first call for the profile
-    if (g_temperatureProfileStepIndex < 0)
-    {
-      // If the current step index is -1, it means we are starting the profile
-      g_temperatureProfileStepIndex = 0;                         // Start from the first step
-      g_temperatureProfileStartTimeMSec = g_loopCurrentTimeMSec; // Set the start time for the profile step
-    }
-
-    // Get the current step from the temperature profile
-    TempProfileStep step = g_configuration.temperatureProfile[g_temperatureProfileStepIndex];
-
-    // Check if the time has elapsed for the current step
-    if (g_loopCurrentTimeMSec - g_temperatureProfileStartTimeMSec >= step.timeMSec)
-    {
-      // If the time has elapsed, move to the next step
-      g_temperatureProfileStepIndex++;
-      g_temperatureProfileStartTimeMSec = g_loopCurrentTimeMSec; // Reset the start time for the next step
-    }
-    else
-    {
-      // Check the type of the current step
-      if (step.type == TEMP_PROFILE_TYPE_RAMP)
-      {
-        // If the step is a ramp, calculate the target temperature based on the elapsed time
-        float elapsedTime = (g_loopCurrentTimeMSec - g_temperatureProfileStartTimeMSec) / 1000.0; // Convert to seconds
-        float totalRampTime = step.timeMSec / 1000.0;                                             // Total ramp time in seconds
-        float temperatureChange = step.temperatureEndF - step.temperatureStartF;                  // Temperature change for the ramp
-        float temperaturePerSecond = temperatureChange / totalRampTime;                           // Temperature change per second
-
-        // Calculate the target temperature based on the elapsed time
-        return step.temperatureStartF + (temperaturePerSecond * elapsedTime);
-      }
-      else
-      {
-        // If the step is a dwell, return the start temperature of the dwell step
-        return step.temperatureStartF; // Return the start temperature of the dwell step
-      }
-    }
-  }
 
-  return 0; // Fallback return value, should not be reached
+  // Looked up from the time since the profile start, a stalled loop catches up on its next pass.
+  // Only the conditions of the current step are checked against the probes.
+  return g_profileEngine.service(g_loopCurrentTimeMSec, g_thermometerSmoker.getTemperatureF(), g_thermometerFood.getTemperatureF());
 }
\ No newline at end of file
@@ -6,19 +6,32 @@
 #include <Adafruit_ST7789.h>
 #include <SPI.h>
 #include <WiFi.h>
-#include <ArduinoOTA.h>
 #include "types.h"
 #include "knob.h"
 #include "nvram.h"
 #include "thermometer.h"
 #include "door.h"
 #include "blower.h"
+#include "actuator.h"
+#include "airflow.h"
 #include "gui.h"
 #include "temperaturecontroller.h"
 #include "tftdebug.h"
 #include "debug.h"
 #include "webserver.h"
 #include "filtering.h"
+#include "cookpredictor.h"
+#include "scheduler.h"
+#include "metrics.h"
+#include "controlchannel.h"
+#include "eventbus.h"
+#include "deadlinemonitor.h"
+#include "heapmonitor.h"
+#include "wifimanager.h"
+#include "otaupdater.h"
+#include "profileengine.h"
+#include "runcheckpoint.h"
+#include "configwriter.h"
 
 // ============================ DEFAULT PASSWORDS =========================
 #if __has_include("passwords.h")
@@ -36,23 +49,56 @@
 #define WEB_SERVER_PORT 80 // Web server port
 #define BAUD_RATE 115200
 #define NVRAM_START_ADDRESS 0
+#define NVRAM_CONFIGURATION_VERSION 1 // Bumped on every Configuration layout change
+#define NVRAM_PROFILE_VERSION 1       // Bumped on every TempProfileTable layout change
 
 #define WIFI_SCAN_TIMEOUT_MSEC 5000 // Timeout for WiFi scan in milliseconds
 #define MAX_WIFI_NETWORKS 8         // Maximum number of WiFi networks to store
-#define MAX_WIFI_CONNECT_ATTEMPTS 3 // Maximum number of attempts to connect to WiFi
+
+// The control loop runs in the Arduino loop task (core 1), the GUI, WiFi and OTA in the UI task
+#define UI_TASK_CORE 0          // Core of the UI task, shared with the WiFi stack and the web server
+#define UI_TASK_PRIORITY 1      // Same priority as the Arduino loop task
+#define UI_TASK_STACK_SIZE 8192 // UI task stack (bytes)
+
+// Control loop task periods (ms, 0 runs on every pass) and time budgets (us)
+#define TASK_EVENTS_PERIOD_MSEC 0
+#define TASK_EVENTS_BUDGET_USEC 50000 // Covers the controller step
+#define TASK_COMMANDS_PERIOD_MSEC 10
+#define TASK_COMMANDS_BUDGET_USEC 500
+#define TASK_THERMOMETERS_PERIOD_MSEC 10
+#define TASK_THERMOMETERS_BUDGET_USEC 1000
+#define TASK_ACTUATORS_PERIOD_MSEC 10
+#define TASK_ACTUATORS_BUDGET_USEC 500
+#define TASK_CONTROLLER_PERIOD_MSEC 100
+#define TASK_CONTROLLER_BUDGET_USEC 500
+#define TASK_PUBLISH_PERIOD_MSEC 100
+#define TASK_PUBLISH_BUDGET_USEC 500
+
+// UI loop task periods (ms, 0 runs on every pass) and time budgets (us)
+#define TASK_UI_EVENTS_BUDGET_USEC 20000 // Knob and GUI events, shares TASK_EVENTS_PERIOD_MSEC
+#define TASK_KNOB_PERIOD_MSEC 0
+#define TASK_KNOB_BUDGET_USEC 500
+#define TASK_CONFIG_SYNC_PERIOD_MSEC 100
+#define TASK_CONFIG_SYNC_BUDGET_USEC 500
+#define TASK_GUI_PERIOD_MSEC 500
+#define TASK_GUI_BUDGET_USEC 60000
+#define TASK_WIFI_PERIOD_MSEC 500
+#define TASK_WIFI_BUDGET_USEC 2000
+#define TASK_OTA_PERIOD_MSEC 500 // Policy only, the transfer runs in the OTA task
+#define TASK_OTA_BUDGET_USEC 100
+#define TASK_HEAP_PERIOD_MSEC 1000
+#define TASK_HEAP_BUDGET_USEC 1000
+#define HEAP_LOOP_SETTLE_MSEC 30000 // Control loop allocations are reported after boot settled
+#define TASK_CHECKPOINT_PERIOD_MSEC 1000
+#define TASK_CHECKPOINT_BUDGET_USEC 200
+#define TASK_CHECKPOINT_FLUSH_PERIOD_MSEC 1000
+#define TASK_CHECKPOINT_FLUSH_BUDGET_USEC 50000 // Covers a flash record write
 
 // Default configuration values
 #define DEFAULT_TEMPERATURE_TARGET 250
 #define DEFAULT_TEMPERATURE_INTERVAL_MSEC 5000
-#define DEFAULT_BANG_BANG_THRESHOLD_HIGH 260
-#define DEFAULT_BANG_BANG_THRESHOLD_LOW 240
-#define DEFAULT_BANG_BANG_HYSTERESIS 5
-#define DEFAULT_BANG_BANG_FAN_SPEED 255
 #define DEFAULT_DOOR_OPEN_POSITION 110
 #define DEFAULT_DOOR_CLOSE_POSITION 4
-#define DEFAULT_PID_KP 4.0
-#define DEFAULT_PID_KI 0.0
-#define DEFAULT_PID_KD 1.0
 #define DEFAULT_THERMOMETER_SMOKER_GAIN 1.0
 #define DEFAULT_THERMOMETER_SMOKER_OFFSET 0.0
 #define DEFAULT_THERMOMETER_FOOD_GAIN 1.0
@@ -108,10 +154,40 @@ void loadDefaultConfiguration(Configuration *ptr_configuration);
 void setupInitializeNVRAM();
 void setupInitializeGuiState(GuiState &guiState);
 void setupInitializeControllerStatus(ControllerStatus &controllerStatus);
-void loopServiceKnobButtonEvents();
 void loopUpdateControllerStatus();
+void loopServiceBlowerCalibration();
+void loopServiceBlowerCalibrationSample();
+void setupEventBus();
+void taskEvents(ulong currentTimeMSec);
+void taskUIEvents(ulong currentTimeMSec);
+void onSampleReady(const Event &event);
+void onRunStateChanged(const Event &event);
+void onConfigurationChanged(const Event &event);
+void onSaveRequested(const Event &event);
+void onKnobEvent(const Event &event);
+void onGUIRequest(const Event &event);
+void onWiFiEvent(const Event &event);
+void postUIConfigurationIfChanged();
+void setupScheduler();
+void uiTask(void *parameter);
+void taskCommands(ulong currentTimeMSec);
+void taskThermometers(ulong currentTimeMSec);
+void taskActuators(ulong currentTimeMSec);
+void taskController(ulong currentTimeMSec);
+void taskPublish(ulong currentTimeMSec);
+void taskKnob(ulong currentTimeMSec);
+void taskConfigSync(ulong currentTimeMSec);
+void taskGUI(ulong currentTimeMSec);
+void taskWiFi(ulong currentTimeMSec);
+void taskOTA(ulong currentTimeMSec);
+void taskHeap(ulong currentTimeMSec);
+void taskCheckpoint(ulong currentTimeMSec);
+void taskCheckpointFlush(ulong currentTimeMSec);
+void captureRunState(ulong currentTimeMSec);
+void setupResumeRun();
 void updateConfiguration();
-void connectToWiFi();
+void updateTemperatureProfile();
+int rssiToBars(int rssi);
 int calculateTemperatureTarget();
 
 #endif // MAIN_H
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "metrics.h"
+
+#ifdef ENABLE_METRICS
+
+MetricSite Metrics::s_sites[METRICS_MAX_SITES];
+uint Metrics::s_siteCount = 0;
+
+// Sites are created from the loops on both cores
+static portMUX_TYPE s_siteMux = portMUX_INITIALIZER_UNLOCKED;
+
+MetricSite *Metrics::getSite(const char *name)
+{
+    MetricSite *site = nullptr;
+    portENTER_CRITICAL(&s_siteMux);
+    for (uint i = 0; i < s_siteCount && site == nullptr; ++i)
+    {
+        if (strcmp(s_sites[i].name, name) == 0)
+            site = &s_sites[i];
+    }
+
+    if (site == nullptr && s_siteCount < METRICS_MAX_SITES)
+    {
+        site = &s_sites[s_siteCount];
+        memset(site, 0, sizeof(MetricSite));
+        site->name = name;
+        site->minCycles = UINT32_MAX;
+        s_siteCount++;
+    }
+    portEXIT_CRITICAL(&s_siteMux);
+
+    if (site == nullptr)
+    {
+        Serial.println("Metrics site table full, site dropped!");
+    }
+    return site;
+}
+
+void Metrics::record(MetricSite *site, uint32_t cycles)
+{
+    if (site == nullptr)
+        return;
+
+    // Index of the highest set bit, 0 and 1 share the first bucket
+    uint bucket = cycles > 1 ? 31 - __builtin_clz(cycles) : 0;
+    site->histogram[min(bucket, static_cast<uint>(METRICS_HISTOGRAM_BUCKETS - 1))]++;
+    site->count++;
+    site->sumCycles += cycles;
+    if (cycles < site->minCycles)
+        site->minCycles = cycles;
+    if (cycles > site->maxCycles)
+        site->maxCycles = cycles;
+}
+
+void Metrics::reset()
+{
+    for (uint i = 0; i < s_siteCount; ++i)
+    {
+        MetricSite &site = s_sites[i];
+        site.count = 0;
+        site.minCycles = UINT32_MAX;
+        site.maxCycles = 0;
+        site.sumCycles = 0;
+        memset(site.histogram, 0, sizeof(site.histogram));
+    }
+}
+
+void Metrics::writePrometheus(Print &out)
+{
+    out.printf("# HELP " METRICS_PREFIX "cpu_frequency_hz CPU clock, converts cycles to seconds\n");
+    out.printf("# TYPE " METRICS_PREFIX "cpu_frequency_hz gauge\n");
+    out.printf(METRICS_PREFIX "cpu_frequency_hz %u\n", ESP.getCpuFreqMHz() * 1000000);
+
+    out.printf("# HELP " METRICS_PREFIX "section_cycles CPU cycles spent in an instrumented section\n");
+    out.printf("# TYPE " METRICS_PREFIX "section_cycles histogram\n");
+    for (uint i = 0; i < s_siteCount; ++i)
+    {
+        const MetricSite &site = s_sites[i];
+
+        // Prometheus buckets are cumulative with an inclusive le, bucket b ends below 2^(b+1) cycles
+        // so its le is the last whole cycle count in it, 2^(b+1) - 1
+        uint32_t cumulative = 0;
+        for (int b = 0; b < METRICS_HISTOGRAM_BUCKETS - 1; ++b)
+        {
+            cumulative += site.histogram[b];
+            out.printf(METRICS_PREFIX "section_cycles_bucket{site=\"%s\",le=\"%lu\"} %u\n",
+                       site.name, (2UL << b) - 1, cumulative);
+        }
+        out.printf(METRICS_PREFIX "section_cycles_bucket{site=\"%s\",le=\"+Inf\"} %u\n", site.name, site.count);
+        out.printf(METRICS_PREFIX "section_cycles_sum{site=\"%s\"} %llu\n", site.name, site.sumCycles);
+        out.printf(METRICS_PREFIX "section_cycles_count{site=\"%s\"} %u\n", site.name, site.count);
+    }
+
+    out.printf("# HELP " METRICS_PREFIX "section_cycles_min Shortest sample of a section\n");
+    out.printf("# TYPE " METRICS_PREFIX "section_cycles_min gauge\n");
+    for (uint i = 0; i < s_siteCount; ++i)
+    {
+        const MetricSite &site = s_sites[i];
+        out.printf(METRICS_PREFIX "section_cycles_min{site=\"%s\"} %u\n", site.name, site.count > 0 ? site.minCycles : 0);
+    }
+
+    out.printf("# HELP " METRICS_PREFIX "section_cycles_max Longest sample of a section\n");
+    out.printf("# TYPE " METRICS_PREFIX "section_cycles_max gauge\n");
+    for (uint i = 0; i < s_siteCount; ++i)
+    {
+        const MetricSite &site = s_sites[i];
+        out.printf(METRICS_PREFIX "section_cycles_max{site=\"%s\"} %u\n", site.name, site.maxCycles);
+    }
+
+    out.printf("# HELP " METRICS_PREFIX "section_cycles_mean Mean sample of a section\n");
+    out.printf("# TYPE " METRICS_PREFIX "section_cycles_mean gauge\n");
+    for (uint i = 0; i < s_siteCount; ++i)
+    {
+        const MetricSite &site = s_sites[i];
+        out.printf(METRICS_PREFIX "section_cycles_mean{site=\"%s\"} %llu\n", site.name,
+                   site.count > 0 ? site.sumCycles / site.count : 0ULL);
+    }
+}
+
+#endif // ENABLE_METRICS
@@ -0,0 +1,89 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+/**
+ * @file metrics.h
+ * @brief Cycle count instrumentation of code sections with a Prometheus text exporter.
+ *
+ * A section is timed with the CPU cycle counter (ESP.getCycleCount(), a single register read)
+ * and recorded in its metric site: count, min, max, sum and a log2 histogram where bucket i
+ * counts the sections of [2^i, 2^(i+1)) cycles, the last bucket being open ended. The cycle
+ * counter wraps every 2^32 cycles (about 18 s at 240 MHz), far above any timed section.
+ *
+ * Sites are created on first use and kept in a fixed table, a full table drops new sites.
+ * Recording takes a few dozen cycles. Each site is updated from one loop and read by the web
+ * server without a lock, a report may mix two consecutive samples of one site.
+ *
+ * METRICS_SCOPE(name) times the rest of the enclosing block, METRICS_CALL(name, expr) times a
+ * single call. Without ENABLE_METRICS both compile to the bare code and the classes are gone.
+ */
+
+#include <Arduino.h>
+
+#define ENABLE_METRICS // Comment out to compile the instrumentation out
+
+#define METRICS_MAX_SITES 24         // Size of the site table
+#define METRICS_HISTOGRAM_BUCKETS 28 // Log2 cycle buckets, the last one counts everything above ~0.5 s at 240 MHz
+#define METRICS_PREFIX "smokemate_"  // Prefix of the exported metric names
+
+#ifdef ENABLE_METRICS
+
+struct MetricSite
+{
+    const char *name;                              // Site name, exported as the site label
+    uint32_t count;                                // Number of samples
+    uint32_t minCycles;                            // Shortest sample
+    uint32_t maxCycles;                            // Longest sample
+    uint64_t sumCycles;                            // Sum of all samples
+    uint32_t histogram[METRICS_HISTOGRAM_BUCKETS]; // Log2 cycle buckets
+};
+
+class Metrics
+{
+public:
+    static MetricSite *getSite(const char *name);
+    static void record(MetricSite *site, uint32_t cycles);
+    static void reset();
+    static void writePrometheus(Print &out);
+
+private:
+    static MetricSite s_sites[METRICS_MAX_SITES]; // Site table
+    static uint s_siteCount;                      // Sites in use
+};
+
+class MetricScope
+{
+public:
+    explicit MetricScope(MetricSite *site) : m_site(site), m_startCycles(ESP.getCycleCount()) {}
+    ~MetricScope() { Metrics::record(m_site, ESP.getCycleCount() - m_startCycles); }
+
+private:
+    MetricSite *m_site;     // Site receiving the sample
+    uint32_t m_startCycles; // Cycle counter at the start of the section
+};
+
+#define METRICS_CONCAT_INNER(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT_INNER(a, b)
+
+#define METRICS_SCOPE(name)                                                           \
+    static MetricSite *METRICS_CONCAT(metricSite, __LINE__) = Metrics::getSite(name); \
+    MetricScope METRICS_CONCAT(metricScope, __LINE__)(METRICS_CONCAT(metricSite, __LINE__))
+#define METRICS_CALL(name, expr) \
+    do                           \
+    {                            \
+        METRICS_SCOPE(name);     \
+        expr;                    \
+    } while (0)
+
+#else
+
+#define METRICS_SCOPE(name)
+#define METRICS_CALL(name, expr) \
+    do                           \
+    {                            \
+        expr;                    \
+    } while (0)
+
+#endif // ENABLE_METRICS
+
+#endif // METRICS_H
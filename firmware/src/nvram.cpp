@@ -1,14 +1,20 @@
 #include "nvram.h"
+#include <rom/crc.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 // Constructor
 ///////////////////////////////////////////////////////////////////////////////
 
-NVRAM::NVRAM(uint address, uint8_t *dataPtr, uint length)
+NVRAM::NVRAM(uint address, uint8_t *dataPtr, uint length, uint16_t version, const char *name)
 {
     m_address = address;
     m_dataPtr = dataPtr;
     m_length = length;
+    m_version = version;
+    m_name = name;
+    m_activeSlot = NVRAM_NO_SLOT;
+    m_sequence = 0;
+    m_writeCount = 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -43,138 +49,100 @@ bool NVRAM::initNVRAM()
 
 bool NVRAM::readNVRAM()
 {
-    // Read the NVRAM data
-    if (!readNVRAMFile(NVRAM_DATA_FILE_NAME, m_dataPtr, m_length))
+    // Headers of both slots, the newest one is read first and the other one is the fallback
+    NVRAMRecordHeader headers[NVRAM_SLOTS];
+    bool isHeaderValid[NVRAM_SLOTS];
+    for (int slot = 0; slot < NVRAM_SLOTS; ++slot)
     {
-        DEBUG_PRINTLN();
-        DEBUG_PRINTLN("An error occurred while reading the NVRAM data");
-        delay(1000);
-        return false;
-    }
-
-#ifdef NVRAM_DEBUG
-    // Print the NVRAM data
-    DEBUG_PRINTLN("NVRAM data:");
-    for (int i = 0; i < m_length; ++i)
-    {
-        // Print each byte and their index
-        DEBUG_PRINT("Index: ");
-        DEBUG_PRINT(i);
-        DEBUG_PRINT(" DATA: ");
-        DEBUG_PRINT(m_dataPtr[i]);
-        DEBUG_PRINTLN();
+        isHeaderValid[slot] = readHeader(slot, headers[slot]);
+        if (isHeaderValid[slot])
+            m_sequence = max(m_sequence, headers[slot].sequence);
     }
-    DEBUG_PRINTLN();
-#endif
 
-    // Read the NVRAM CRC
-    uint8_t crcData[2];
-    if (!readNVRAMFile(NVRAM_CRC_FILE_NAME, crcData, 2))
+    int newest = isHeaderValid[1] && (!isHeaderValid[0] || headers[1].sequence > headers[0].sequence) ? 1 : 0;
+    int order[NVRAM_SLOTS] = {newest, 1 - newest};
+    for (int i = 0; i < NVRAM_SLOTS; ++i)
     {
-        DEBUG_PRINTLN();
-        DEBUG_PRINTLN("An error occurred while reading the NVRAM CRC");
-        delay(1000);
-        return false;
-    }
-
-    // Calculate the CRC of the NVRAM data
-    uint16_t crc = calculateCRC(m_dataPtr, m_length);
-
+        int slot = order[i];
+        if (isHeaderValid[slot] && readRecord(slot, headers[slot]))
+        {
+            m_activeSlot = slot;
 #ifdef NVRAM_DEBUG
-    // Print the NVRAM CRC
-    DEBUG_PRINT("NVRAM CRC: ");
-    DEBUG_PRINTLN(crc);
-    // Print the calculated CRC
-    DEBUG_PRINT("Calculated CRC: ");
-    DEBUG_PRINTLN(crcData[0] << 8 | crcData[1]);
+            DEBUG_PRINTLN("NVRAM::readNVRAM - " + String(m_name) + " slot " + String(slot) + ", sequence " + String(headers[slot].sequence));
 #endif
+            return true;
+        }
+    }
 
-    // Compare the calculated CRC with the read CRC
-    if (crc != (crcData[0] << 8 | crcData[1]))
+    // No record yet, the data and CRC files of earlier firmware are migrated once
+    if (readLegacy())
     {
-        DEBUG_PRINTLN("The NVRAM data is corrupted");
-        return false;
+        DEBUG_PRINTLN("Migrating the NVRAM data to a record");
+        if (!writeNVRAM())
+            return false;
+
+        char fileName[NVRAM_FILE_NAME_LENGTH];
+        getLegacyFileName(".bin", fileName, sizeof(fileName));
+        deleteNVRAMFile(fileName);
+        getLegacyFileName("_crc.bin", fileName, sizeof(fileName));
+        deleteNVRAMFile(fileName);
+        return true;
     }
 
-    return true;
+    DEBUG_PRINTLN("The NVRAM data is missing or corrupted");
+    return false;
 }
 
 bool NVRAM::writeNVRAM()
 {
-    // Write the NVRAM data
-    if (!writeNVRAMFile(NVRAM_DATA_FILE_NAME, m_dataPtr, m_length))
-    {
-        DEBUG_PRINTLN();
-        DEBUG_PRINTLN("An error occurred while writing the NVRAM data");
-        delay(1000);
-        return false;
-    }
+    return writeNVRAM(m_dataPtr);
+}
 
-    // Calculate the CRC of the NVRAM data
-    uint16_t crc = calculateCRC(m_dataPtr, m_length);
+bool NVRAM::writeNVRAM(const uint8_t *dataPtr)
+{
+    // The slot without the newest record is replaced, that record stays valid until this one is
+    NVRAMRecordHeader header;
+    header.magic = NVRAM_RECORD_MAGIC;
+    header.version = m_version;
+    header.reserved = 0;
+    header.length = m_length;
+    header.sequence = m_sequence + 1;
+    header.crc = calculateCRC(header, dataPtr);
 
-    // Write the NVRAM CRC
-    uint8_t crcData[2] = {static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc & 0xFF)};
-    if (!writeNVRAMFile(NVRAM_CRC_FILE_NAME, crcData, 2))
-    {
-        DEBUG_PRINTLN();
-        DEBUG_PRINTLN("An error occurred while writing the NVRAM CRC");
-        delay(1000);
-        return false;
-    }
+    int slot = m_activeSlot == NVRAM_NO_SLOT ? 0 : (m_activeSlot + 1) % NVRAM_SLOTS;
+    char fileName[NVRAM_FILE_NAME_LENGTH];
+    getSlotFileName(slot, fileName, sizeof(fileName));
 
-#ifdef NVRAM_DEBUG
-    // Read entire data from NVRAM and compare with the dataPtr byte by byte
-    uint8_t dataPtrRead[NVRAM_SIZE];
-    if (!readNVRAMFile(NVRAM_DATA_FILE_NAME, dataPtrRead, m_length))
+    File file = SPIFFS.open(fileName, FILE_WRITE);
+    if (!file)
     {
-        DEBUG_PRINTLN();
-        DEBUG_PRINTLN("An error occurred while reading the NVRAM data");
-        delay(1000);
+        DEBUG_PRINTLN("Failed to open file for writing");
         return false;
     }
-    // Compare the dataPtr with the dataPtrRead
-    DEBUG_PRINTLN("Comparing the NVRAM data with the dataPtr");
-    for (int i = 0; i < m_length; ++i)
-    {
-        // Print each byte and their index
-        DEBUG_PRINT("Index: ");
-        DEBUG_PRINT(i);
-        DEBUG_PRINT(": DATA: ");
-        DEBUG_PRINT(m_dataPtr[i]);
-        DEBUG_PRINT(" NVRAM: ");
-        DEBUG_PRINTLN(dataPtrRead[i]);
-        // Compare each byte
-        if (m_dataPtr[i] != dataPtrRead[i])
-        {
-            // If the bytes are different, print an error message and index
-            DEBUG_PRINTLN("The NVRAM data is corrupted");
-            DEBUG_PRINTLN(i);
-            return false;
-        }
-    }
+    size_t written = file.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+    written += file.write(dataPtr, m_length);
+    file.close();
 
-    // Read the NVRAM CRC and compare with the calculated CRC
-    uint8_t crcDataRead[2];
-    if (!readNVRAMFile(NVRAM_CRC_FILE_NAME, crcDataRead, 2))
+    if (written != sizeof(header) + m_length)
     {
         DEBUG_PRINTLN();
-        DEBUG_PRINTLN("An error occurred while reading the NVRAM CRC");
-        delay(1000);
+        DEBUG_PRINTLN("An error occurred while writing the NVRAM data");
         return false;
     }
-    // Compare the calculated CRC with the read CRC
-    DEBUG_PRINTLN()
-    DEBUG_PRINTLN("Calculated CRC: ");
-    DEBUG_PRINTLN(crc);
-    DEBUG_PRINTLN("NVRAM CRC: ");
-    DEBUG_PRINTLN(crcDataRead[0] << 8 | crcDataRead[1]);
-    if (crc != (crcDataRead[0] << 8 | crcDataRead[1]))
+
+    m_activeSlot = slot;
+    m_sequence = header.sequence;
+    m_writeCount++;
+
+#ifdef NVRAM_DEBUG
+    // Read the header back, the payload was written from the same buffer in the same file
+    NVRAMRecordHeader headerRead;
+    if (!readHeader(slot, headerRead) || headerRead.crc != header.crc)
     {
         DEBUG_PRINTLN("The NVRAM data is corrupted");
-        delay(1000);
         return false;
     }
+    DEBUG_PRINTLN("NVRAM::writeNVRAM - " + String(m_name) + " slot " + String(slot) + ", sequence " + String(m_sequence));
 #endif
 
     return true;
@@ -182,15 +150,36 @@ bool NVRAM::writeNVRAM()
 
 void NVRAM::clearNVRAM()
 {
-    deleteNVRAMFile(NVRAM_DATA_FILE_NAME);
-    deleteNVRAMFile(NVRAM_CRC_FILE_NAME);
+    char fileName[NVRAM_FILE_NAME_LENGTH];
+    for (int slot = 0; slot < NVRAM_SLOTS; ++slot)
+    {
+        getSlotFileName(slot, fileName, sizeof(fileName));
+        deleteNVRAMFile(fileName);
+    }
+    getLegacyFileName(".bin", fileName, sizeof(fileName));
+    deleteNVRAMFile(fileName);
+    getLegacyFileName("_crc.bin", fileName, sizeof(fileName));
+    deleteNVRAMFile(fileName);
+
+    m_activeSlot = NVRAM_NO_SLOT;
+}
+
+uint32_t NVRAM::getWriteCount() const
+{
+    return m_writeCount;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Private methods
 ///////////////////////////////////////////////////////////////////////////////
 
-uint16_t NVRAM::calculateCRC(uint8_t *dataPtr, uint length)
+uint32_t NVRAM::calculateCRC(const NVRAMRecordHeader &header, const uint8_t *dataPtr)
+{
+    uint32_t crc = crc32_le(0, reinterpret_cast<const uint8_t *>(&header), offsetof(NVRAMRecordHeader, crc));
+    return crc32_le(crc, dataPtr, m_length);
+}
+
+uint16_t NVRAM::calculateLegacyCRC(uint8_t *dataPtr, uint length)
 {
     uint16_t crc = 0xFFFF;
     for (int i = 0; i < length; ++i)
@@ -212,6 +201,64 @@ uint16_t NVRAM::calculateCRC(uint8_t *dataPtr, uint length)
     return crc;
 }
 
+bool NVRAM::readHeader(int slot, NVRAMRecordHeader &header)
+{
+    char fileName[NVRAM_FILE_NAME_LENGTH];
+    getSlotFileName(slot, fileName, sizeof(fileName));
+    if (!SPIFFS.exists(fileName))
+        return false;
+
+    File file = SPIFFS.open(fileName);
+    if (!file)
+        return false;
+    bool isRead = file.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) == sizeof(header);
+    file.close();
+
+    // A record of another layout is not loaded into this blob
+    return isRead && header.magic == NVRAM_RECORD_MAGIC && header.version == m_version && header.length == m_length;
+}
+
+bool NVRAM::readRecord(int slot, const NVRAMRecordHeader &header)
+{
+    char fileName[NVRAM_FILE_NAME_LENGTH];
+    getSlotFileName(slot, fileName, sizeof(fileName));
+    File file = SPIFFS.open(fileName);
+    if (!file)
+        return false;
+
+    // The payload goes straight into the blob, a failed CRC leaves it to the caller's defaults
+    file.seek(sizeof(header));
+    bool isRead = file.read(m_dataPtr, m_length) == m_length;
+    file.close();
+    return isRead && calculateCRC(header, m_dataPtr) == header.crc;
+}
+
+bool NVRAM::readLegacy()
+{
+    char fileName[NVRAM_FILE_NAME_LENGTH];
+    getLegacyFileName(".bin", fileName, sizeof(fileName));
+    if (!SPIFFS.exists(fileName))
+        return false;
+
+    File file = SPIFFS.open(fileName);
+    if (!file)
+        return false;
+    bool isRead = file.size() == m_length && file.read(m_dataPtr, m_length) == m_length;
+    file.close();
+    if (!isRead)
+        return false;
+
+    uint8_t crcData[2];
+    getLegacyFileName("_crc.bin", fileName, sizeof(fileName));
+    file = SPIFFS.open(fileName);
+    if (!file)
+        return false;
+    isRead = file.read(crcData, sizeof(crcData)) == sizeof(crcData);
+    file.close();
+
+    return isRead && calculateLegacyCRC(m_dataPtr, m_length) == (crcData[0] << 8 | crcData[1]);
+}
+
 bool NVRAM::deleteNVRAMFile(const char *fileName)
 {
     if (SPIFFS.exists(fileName))
@@ -227,42 +274,12 @@ bool NVRAM::deleteNVRAMFile(const char *fileName)
     return true;
 }
 
-bool NVRAM::writeNVRAMFile(const char *fileName, uint8_t *dataPtr, uint length)
+void NVRAM::getSlotFileName(int slot, char *buffer, size_t size)
 {
-    // Open file for writing
-    File file = SPIFFS.open(fileName, FILE_WRITE);
-    if (!file)
-    {
-        DEBUG_PRINTLN("Failed to open file for writing");
-        return false;
-    }
-
-    // Write the NVRAM data
-    for (int i = 0; i < length; ++i)
-    {
-        file.write(dataPtr[i]);
-    }
-    file.close();
-
-    return true;
+    snprintf(buffer, size, "%s_%c.rec", m_name, 'a' + slot);
 }
 
-bool NVRAM::readNVRAMFile(const char *fileName, uint8_t *dataPtr, uint length)
+void NVRAM::getLegacyFileName(const char *suffix, char *buffer, size_t size)
 {
-    // Open file for reading
-    File file = SPIFFS.open(fileName);
-    if (!file)
-    {
-        DEBUG_PRINTLN("Failed to open file for reading");
-        return false;
-    }
-
-    // Read the data into the m_dataPtr array
-    for (int i = 0; i < length; ++i)
-    {
-        dataPtr[i] = file.read();
-    }
-    file.close();
-
-    return true;
-}
\ No newline at end of file
+    snprintf(buffer, size, "%s%s", m_name, suffix);
+}
@@ -1,6 +1,25 @@
 #ifndef NVRAM_H
 #define NVRAM_H
 
+/**
+ * @file nvram.h
+ * @brief POD blob stored as a versioned record in two alternating SPIFFS slots.
+ *
+ * Every write produces one record, a header followed by the payload:
+ *
+ *   magic | version | length | sequence | CRC32 | payload
+ *
+ * The header and the payload go out in bulk to one file, the slot not holding the newest record.
+ * A reset in the middle of a write leaves a record failing its CRC next to the intact previous
+ * one, so the blob is always replaced as a whole. On read the slot with the highest valid
+ * sequence wins, the payload comes back in one read straight into the blob. A record with another
+ * version or length belongs to a different layout and is ignored, the caller loads its defaults.
+ * A writer that must not touch the live blob passes a copy of it to writeNVRAM(dataPtr).
+ *
+ * The data and CRC file pair of earlier firmware is migrated once: when no record exists and the
+ * pair matches the blob length and its CRC16, it is written as a record and removed.
+ */
+
 #include <Arduino.h>
 #include <SPIFFS.h>
 #include "types.h"
@@ -9,7 +28,20 @@
 // #define NVRAM_DEBUG
 // #define NVRAM_FORMAT
 
-#define NVRAM_SIZE 512
+#define NVRAM_RECORD_MAGIC 0x564E4D53 // "SMNV"
+#define NVRAM_SLOTS 2                 // Slots written in turn
+#define NVRAM_NO_SLOT -1              // No valid record read or written yet
+#define NVRAM_FILE_NAME_LENGTH 32     // SPIFFS object name limit
+
+struct NVRAMRecordHeader
+{
+    uint32_t magic;    // NVRAM_RECORD_MAGIC
+    uint16_t version;  // Layout version of the payload
+    uint16_t reserved; // Zero
+    uint32_t length;   // Payload length
+    uint32_t sequence; // Write number, the highest valid slot wins
+    uint32_t crc;      // CRC32 of the fields above and the payload
+};
 
 class NVRAM
 {
@@ -17,21 +49,29 @@ private:
     uint m_address;
     uint8_t *m_dataPtr;
     uint m_length;
+    uint16_t m_version;    // Layout version of the blob
+    const char *m_name;    // Record name, slots and legacy files derive from it
+    int m_activeSlot;      // Slot of the newest valid record
+    uint32_t m_sequence;   // Sequence of the newest record
+    uint32_t m_writeCount; // Records written since boot
 
-    const char *NVRAM_DATA_FILE_NAME = "/nvram.bin";
-    const char *NVRAM_CRC_FILE_NAME = "/nvram_crc.bin";
-
-    uint16_t calculateCRC(uint8_t *dataPtr, uint length);
+    uint32_t calculateCRC(const NVRAMRecordHeader &header, const uint8_t *dataPtr);
+    uint16_t calculateLegacyCRC(uint8_t *dataPtr, uint length);
+    bool readHeader(int slot, NVRAMRecordHeader &header);
+    bool readRecord(int slot, const NVRAMRecordHeader &header);
+    bool readLegacy();
     bool deleteNVRAMFile(const char *fileName);
-    bool writeNVRAMFile(const char *fileName, uint8_t *dataPtr, uint length);
-    bool readNVRAMFile(const char *fileName, uint8_t *dataPtr, uint length);
+    void getSlotFileName(int slot, char *buffer, size_t size);
+    void getLegacyFileName(const char *suffix, char *buffer, size_t size);
 
 public:
-    NVRAM(uint address, uint8_t *dataPtr, uint length);
+    NVRAM(uint address, uint8_t *dataPtr, uint length, uint16_t version, const char *name = "/nvram");
     bool initNVRAM();
     bool readNVRAM();
     bool writeNVRAM();
+    bool writeNVRAM(const uint8_t *dataPtr);
     void clearNVRAM();
+    uint32_t getWriteCount() const;
 };
 
-#endif
\ No newline at end of file
+#endif
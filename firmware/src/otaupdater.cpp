@@ -0,0 +1,161 @@
+#include "otaupdater.h"
+
+OTAUpdater::OTAUpdater()
+{
+    m_taskHandle = nullptr;
+    m_isNetworkReady = false;
+    m_policy = OTA_POLICY_ALLOW;
+    m_isCookRunning = false;
+    m_isListening = false;
+    m_status = {OTA_PHASE_OFF, 0, 0, 0, -1, 0};
+    m_mux = portMUX_INITIALIZER_UNLOCKED;
+}
+
+bool OTAUpdater::begin()
+{
+    if (xTaskCreatePinnedToCore(taskEntry, "ota", OTA_TASK_STACK_SIZE, this, OTA_TASK_PRIORITY, &m_taskHandle, OTA_TASK_CORE) != pdPASS)
+    {
+        Serial.println("OTA task could not be started!");
+        return false;
+    }
+    return true;
+}
+
+void OTAUpdater::setNetworkReady(bool isReady)
+{
+    m_isNetworkReady = isReady;
+}
+
+void OTAUpdater::setPolicy(OTAPolicy policy, bool isCookRunning)
+{
+    m_policy = policy;
+    m_isCookRunning = isCookRunning;
+}
+
+void OTAUpdater::getStatus(OTAStatus &status) const
+{
+    portENTER_CRITICAL(&m_mux);
+    status = m_status;
+    portEXIT_CRITICAL(&m_mux);
+}
+
+const char *OTAUpdater::phaseToString(OTAPhase phase)
+{
+    switch (phase)
+    {
+    case OTA_PHASE_IDLE:
+        return "IDLE";
+    case OTA_PHASE_DEFERRED:
+        return "DEFERRED";
+    case OTA_PHASE_REFUSED:
+        return "REFUSED";
+    case OTA_PHASE_UPDATING:
+        return "UPDATING";
+    case OTA_PHASE_DONE:
+        return "DONE";
+    case OTA_PHASE_ERROR:
+        return "ERROR";
+    default:
+        return "OFF";
+    }
+}
+
+void OTAUpdater::taskEntry(void *parameter)
+{
+    static_cast<OTAUpdater *>(parameter)->run();
+}
+
+void OTAUpdater::run()
+{
+    // ArduinoOTA is only touched from this task
+    ArduinoOTA.setHostname(OTA_HOSTNAME);
+    setupCallbacks();
+
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(OTA_TASK_PERIOD_MSEC));
+
+        // The listener needs the network stack, it survives later reconnects
+        if (!m_isNetworkReady)
+            continue;
+
+        bool isHeld = m_isCookRunning && m_policy != OTA_POLICY_ALLOW;
+        if (isHeld && m_policy == OTA_POLICY_REFUSE)
+        {
+            if (m_isListening)
+            {
+                ArduinoOTA.end();
+                m_isListening = false;
+            }
+            setPhase(OTA_PHASE_REFUSED);
+            continue;
+        }
+
+        if (!m_isListening)
+        {
+            ArduinoOTA.begin();
+            m_isListening = true;
+        }
+
+        if (isHeld)
+        {
+            // Requests stay queued in the listener until the cook ends
+            setPhase(OTA_PHASE_DEFERRED);
+            continue;
+        }
+
+        // Held here for the whole transfer once an upload starts, a successful one reboots
+        setPhase(OTA_PHASE_IDLE);
+        ArduinoOTA.handle();
+    }
+}
+
+void OTAUpdater::setupCallbacks()
+{
+    ArduinoOTA.onStart(
+        [this]()
+        {
+            Serial.println("OTA Update Starting...");
+            portENTER_CRITICAL(&m_mux);
+            m_status.phase = OTA_PHASE_UPDATING;
+            m_status.percent = 0;
+            m_status.bytes = 0;
+            m_status.totalBytes = 0;
+            m_status.updateCount++;
+            portEXIT_CRITICAL(&m_mux);
+        });
+    ArduinoOTA.onEnd(
+        [this]()
+        {
+            Serial.println("OTA Update Complete!");
+            setPhase(OTA_PHASE_DONE);
+        });
+    ArduinoOTA.onProgress(
+        [this](unsigned int progress, unsigned int total)
+        {
+            // Called on every chunk, recorded only, the GUI draws it on its own pass
+            portENTER_CRITICAL(&m_mux);
+            m_status.bytes = progress;
+            m_status.totalBytes = total;
+            m_status.percent = total > 0 ? static_cast<uint8_t>(static_cast<uint64_t>(progress) * 100 / total) : 0;
+            portEXIT_CRITICAL(&m_mux);
+        });
+    ArduinoOTA.onError(
+        [this](ota_error_t error)
+        {
+            Serial.printf("OTA Update failed: %d\r\n", static_cast<int>(error));
+            portENTER_CRITICAL(&m_mux);
+            m_status.phase = OTA_PHASE_ERROR;
+            m_status.lastError = static_cast<int>(error);
+            portEXIT_CRITICAL(&m_mux);
+        });
+}
+
+void OTAUpdater::setPhase(OTAPhase phase)
+{
+    portENTER_CRITICAL(&m_mux);
+    // A failed upload stays reported until the next one starts
+    if (!(m_status.phase == OTA_PHASE_ERROR && phase == OTA_PHASE_IDLE))
+        m_status.phase = phase;
+    portEXIT_CRITICAL(&m_mux);
+}
@@ -0,0 +1,93 @@
+#ifndef OTAUPDATER_H
+#define OTAUPDATER_H
+
+/**
+ * @file otaupdater.h
+ * @brief Over-the-air updates in their own low priority task, apart from the control and UI loops.
+ *
+ * ArduinoOTA.handle() returns quickly while idle but runs the whole transfer inside the call once
+ * an upload starts. The updater therefore owns ArduinoOTA in a dedicated task on the UI core at
+ * a priority below the UI loop: during an upload the control loop keeps its core and the UI loop
+ * keeps running, the transfer uses the time left over.
+ *
+ * The ArduinoOTA callbacks run in the updater task and only record the phase and the byte count
+ * under a spinlock. The GUI reads them with getStatus() on its own pass, so the progress is drawn
+ * at the GUI rate instead of on every received chunk, and the display stays with the UI loop.
+ *
+ * The OTA policy decides what happens while a cook is running:
+ *
+ *   - OTA_POLICY_ALLOW:  updates are accepted at any time,
+ *   - OTA_POLICY_DEFER:  the listener stays open but requests are not served until the cook
+ *                        ends, an uploader retrying after the cook gets through,
+ *   - OTA_POLICY_REFUSE: the listener is closed while the cook runs, the device drops out of the
+ *                        network port list and uploads fail at once.
+ *
+ * The policy is checked between requests, an upload already in progress when a cook starts is
+ * completed. The device reboots into the new image at the end of a successful upload.
+ */
+
+#include <Arduino.h>
+#include <ArduinoOTA.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "types.h"
+#include "debug.h"
+
+// #define DEBUG_OTA
+
+#define OTA_TASK_CORE 0          // Core of the UI loop and the WiFi stack
+#define OTA_TASK_PRIORITY 0      // Below the UI task, shares its core with the idle task
+#define OTA_TASK_STACK_SIZE 6144 // Updater task stack (bytes)
+#define OTA_TASK_PERIOD_MSEC 50  // Polling period of the listener
+#define OTA_HOSTNAME "smokemate9002"
+#define DEFAULT_OTA_POLICY OTA_POLICY_ALLOW
+
+enum OTAPhase : uint8_t
+{
+    OTA_PHASE_OFF,      // Not started, waits for the first network connection
+    OTA_PHASE_IDLE,     // Listening for update requests
+    OTA_PHASE_DEFERRED, // Requests held until the cook ends
+    OTA_PHASE_REFUSED,  // Listener closed until the cook ends
+    OTA_PHASE_UPDATING, // Upload in progress
+    OTA_PHASE_DONE,     // Upload complete, rebooting
+    OTA_PHASE_ERROR     // Last upload failed, back to listening
+};
+
+struct OTAStatus
+{
+    OTAPhase phase;       // Updater phase
+    uint8_t percent;      // Upload progress
+    uint32_t bytes;       // Bytes received
+    uint32_t totalBytes;  // Image size
+    int lastError;        // ota_error_t of the last failed upload, -1 when none
+    uint32_t updateCount; // Uploads started since boot
+};
+
+class OTAUpdater
+{
+public:
+    OTAUpdater();
+
+    bool begin();
+    void setNetworkReady(bool isReady);
+    void setPolicy(OTAPolicy policy, bool isCookRunning);
+    void getStatus(OTAStatus &status) const;
+
+    static const char *phaseToString(OTAPhase phase);
+
+private:
+    TaskHandle_t m_taskHandle;      // Updater task
+    volatile bool m_isNetworkReady; // Network up at least once, set by the UI loop
+    volatile OTAPolicy m_policy;    // Policy, set by the UI loop
+    volatile bool m_isCookRunning;  // Cook state, set by the UI loop
+    bool m_isListening;             // ArduinoOTA started, updater task only
+    OTAStatus m_status;             // Updater status
+    mutable portMUX_TYPE m_mux;     // Guards the status
+
+    static void taskEntry(void *parameter);
+    void run();
+    void setupCallbacks();
+    void setPhase(OTAPhase phase);
+};
+
+#endif // OTAUPDATER_H
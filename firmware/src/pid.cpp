@@ -5,7 +5,8 @@ PID::PID(float kP, float kI, float kD, ulong updateInterval)
       m_previousError(0.0f), m_integral(0.0f),
       m_lastTimeMsec(0), m_updateIntervalMsec(updateInterval),
       m_isEnabled(false),
-      m_lastOutput(0)
+      m_lastOutput(0),
+      m_isIntegralFrozen(false)
 {
 }
 
@@ -38,6 +39,26 @@ bool PID::isEnabled() const
     return m_isEnabled;
 }
 
+void PID::setIntegralFrozen(bool isFrozen)
+{
+    m_isIntegralFrozen = isFrozen;
+}
+
+bool PID::isIntegralFrozen() const
+{
+    return m_isIntegralFrozen;
+}
+
+float PID::getIntegral() const
+{
+    return m_integral;
+}
+
+void PID::setIntegral(float integral)
+{
+    m_integral = integral;
+}
+
 int PID::service(int currentTemp, int targetTemp, ulong currentTimeMSec)
 {
     if (!m_isEnabled)
@@ -54,8 +75,9 @@ int PID::service(int currentTemp, int targetTemp, ulong currentTimeMSec)
     if (m_lastTimeMsec != 0)
         deltaTime = (currentTimeMSec - m_lastTimeMsec) / 1000.0f; // seconds
 
-    // Integral with anti-windup (clamp)
-    m_integral += error * deltaTime;
+    // Integral with anti-windup (clamp), held while frozen
+    if (!m_isIntegralFrozen)
+        m_integral += error * deltaTime;
     const float integralMax = 10000.0f;
     if (m_integral > integralMax)
         m_integral = integralMax;
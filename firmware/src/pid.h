@@ -17,6 +17,7 @@ private:
     ulong m_updateIntervalMsec; // Update interval in milliseconds
     bool m_isEnabled;           // PID enabled/disabled state
     int m_lastOutput;           // Last output value
+    bool m_isIntegralFrozen;    // Integral held at its current value (disturbance in progress)
 public:
     PID(float kP, float kI, float kD, ulong updateInterval = 1000);
 
@@ -35,6 +36,14 @@ public:
     void disable();
     bool isEnabled() const;
 
+    // Hold the integral term while a disturbance is in progress
+    void setIntegralFrozen(bool isFrozen);
+    bool isIntegralFrozen() const;
+
+    // Integral term, restored when a run resumes after a reset
+    float getIntegral() const;
+    void setIntegral(float integral);
+
     // Calculate the control output based on the current temperature and target temperature
     int service(int currentTemp, int targetTemp, ulong currentTimeMSec);
 };
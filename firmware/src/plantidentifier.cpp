@@ -0,0 +1,200 @@
+#include "plantidentifier.h"
+#include <math.h>
+
+// Dead time candidates in samples, one per estimator
+static const uint PLANT_ID_DELAY_SAMPLES[PLANT_ID_DELAY_CANDIDATES] = {0, 2, 6, PLANT_ID_MAX_DELAY_SAMPLES};
+
+PlantIdentifier::PlantIdentifier(float forgettingFactor)
+    : m_forgettingFactor(forgettingFactor)
+{
+    reset();
+}
+
+void PlantIdentifier::reset()
+{
+    for (int i = 0; i < PLANT_ID_DELAY_CANDIDATES; ++i)
+    {
+        resetEstimator(m_estimators[i]);
+    }
+    m_historyHead = 0;
+    m_historyCount = 0;
+    m_previousTempF = 0.0f;
+    m_sampleTimeSec = 0.0f;
+    m_lastUpdateMSec = 0;
+    m_sampleCount = 0;
+    m_bestCandidate = 0;
+}
+
+void PlantIdentifier::setForgettingFactor(float forgettingFactor)
+{
+    m_forgettingFactor = constrain(forgettingFactor, 0.9f, 1.0f);
+}
+
+void PlantIdentifier::update(float temperatureF, float blowerPWM, float doorFraction, ulong currentTimeMSec)
+{
+    float blower = constrain(blowerPWM / 255.0f, 0.0f, 1.0f);
+    float door = constrain(doorFraction, 0.0f, 1.0f);
+
+    // The first sample, or a sample after a long gap (controller stopped), only seeds the regressor,
+    // the inputs applied over the gap are not part of the history
+    ulong deltaMSec = currentTimeMSec - m_lastUpdateMSec;
+    if (m_lastUpdateMSec == 0 ||
+        (m_sampleTimeSec > 0.0f && deltaMSec > PLANT_ID_MAX_SAMPLE_GAP_FACTOR * m_sampleTimeSec * 1000.0f))
+    {
+        restartRegressor(temperatureF, currentTimeMSec);
+    }
+    else
+    {
+        // Track the actual sample time, the model parameters are only meaningful for it
+        float deltaSec = deltaMSec / 1000.0f;
+        m_sampleTimeSec = (m_sampleTimeSec == 0.0f) ? deltaSec : 0.9f * m_sampleTimeSec + 0.1f * deltaSec;
+
+        // Push the inputs applied over the interval ending with this sample, u[k-1] of the model
+        m_historyHead = (m_historyHead + 1) % (PLANT_ID_MAX_DELAY_SAMPLES + 1);
+        m_blowerHistory[m_historyHead] = blower;
+        m_doorHistory[m_historyHead] = door;
+        if (m_historyCount < PLANT_ID_MAX_DELAY_SAMPLES + 1)
+            m_historyCount++;
+
+        // Update every estimator whose dead time is covered by the input history
+        for (int i = 0; i < PLANT_ID_DELAY_CANDIDATES; ++i)
+        {
+            uint delay = PLANT_ID_DELAY_SAMPLES[i];
+            if (delay >= m_historyCount)
+                continue;
+
+            uint index = (m_historyHead + (PLANT_ID_MAX_DELAY_SAMPLES + 1) - delay) % (PLANT_ID_MAX_DELAY_SAMPLES + 1);
+            float phi[PLANT_ID_PARAMETER_COUNT] = {m_previousTempF, m_blowerHistory[index], m_doorHistory[index], 1.0f};
+            updateEstimator(m_estimators[i], phi, temperatureF);
+        }
+
+        // Pick the dead time candidate that currently predicts best
+        for (int i = 0; i < PLANT_ID_DELAY_CANDIDATES; ++i)
+        {
+            if (PLANT_ID_DELAY_SAMPLES[i] < m_historyCount &&
+                m_estimators[i].errorSquared < m_estimators[m_bestCandidate].errorSquared)
+            {
+                m_bestCandidate = i;
+            }
+        }
+        m_sampleCount++;
+    }
+
+    m_previousTempF = temperatureF;
+    m_lastUpdateMSec = currentTimeMSec;
+
+#ifdef DEBUG_PLANT_IDENTIFIER
+    const Estimator &e = m_estimators[m_bestCandidate];
+    DEBUG_PRINTLN("PLANT::update - d=" + String(PLANT_ID_DELAY_SAMPLES[m_bestCandidate]) +
+                  " a=" + String(e.theta[0], 4) + " bB=" + String(e.theta[1], 3) +
+                  " bD=" + String(e.theta[2], 3) + " c=" + String(e.theta[3], 3));
+#endif
+}
+
+PlantModel PlantIdentifier::getModel() const
+{
+    PlantModel model = {};
+    const Estimator &e = m_estimators[m_bestCandidate];
+
+    model.a = e.theta[0];
+    model.bBlower = e.theta[1];
+    model.bDoor = e.theta[2];
+    model.c = e.theta[3];
+    model.sampleTimeSec = m_sampleTimeSec;
+    model.deadTimeSec = PLANT_ID_DELAY_SAMPLES[m_bestCandidate] * m_sampleTimeSec;
+    model.predictionErrorF = sqrtf(e.errorSquared);
+
+    // Only a pole strictly inside (0, 1) describes a stable, non-oscillating first order plant
+    model.isValid = m_sampleCount >= PLANT_ID_MIN_SAMPLES && model.a > 0.0f && model.a < 1.0f;
+    if (model.isValid)
+    {
+        model.gain = model.bBlower / (1.0f - model.a);
+        model.doorGain = model.bDoor / (1.0f - model.a);
+        model.timeConstantSec = -m_sampleTimeSec / logf(model.a);
+    }
+
+    return model;
+}
+
+float PlantIdentifier::predict(float temperatureF, float blowerPWM, float doorFraction) const
+{
+    // One step ahead prediction assuming the inputs have been held for at least the dead time
+    const Estimator &e = m_estimators[m_bestCandidate];
+    float blower = constrain(blowerPWM / 255.0f, 0.0f, 1.0f);
+    float door = constrain(doorFraction, 0.0f, 1.0f);
+    return e.theta[0] * temperatureF + e.theta[1] * blower + e.theta[2] * door + e.theta[3];
+}
+
+void PlantIdentifier::resetEstimator(Estimator &estimator)
+{
+    for (int i = 0; i < PLANT_ID_PARAMETER_COUNT; ++i)
+    {
+        estimator.theta[i] = 0.0f;
+        for (int j = 0; j < PLANT_ID_PARAMETER_COUNT; ++j)
+        {
+            estimator.P[i][j] = (i == j) ? PLANT_ID_INITIAL_COVARIANCE : 0.0f;
+        }
+    }
+    // Start with a slow pole so the first predictions are "temperature stays where it is"
+    estimator.theta[0] = 1.0f;
+    // Start pessimistic so a candidate that has seen fewer samples never wins by default
+    estimator.errorSquared = PLANT_ID_INITIAL_ERROR_SQUARED;
+}
+
+void PlantIdentifier::updateEstimator(Estimator &estimator, const float *phi, float y)
+{
+    float Pphi[PLANT_ID_PARAMETER_COUNT];
+    float denominator = m_forgettingFactor;
+    float prediction = 0.0f;
+
+    // P * phi, phi' * P * phi and the a priori prediction
+    for (int i = 0; i < PLANT_ID_PARAMETER_COUNT; ++i)
+    {
+        Pphi[i] = 0.0f;
+        for (int j = 0; j < PLANT_ID_PARAMETER_COUNT; ++j)
+        {
+            Pphi[i] += estimator.P[i][j] * phi[j];
+        }
+        denominator += phi[i] * Pphi[i];
+        prediction += phi[i] * estimator.theta[i];
+    }
+
+    float error = y - prediction;
+    estimator.errorSquared += PLANT_ID_ERROR_FILTER_COEFF * (error * error - estimator.errorSquared);
+
+    // Gain vector and parameter update
+    float gain[PLANT_ID_PARAMETER_COUNT];
+    for (int i = 0; i < PLANT_ID_PARAMETER_COUNT; ++i)
+    {
+        gain[i] = Pphi[i] / denominator;
+        estimator.theta[i] += gain[i] * error;
+    }
+
+    // Covariance update, forgetting is suspended when the covariance grows too large (poor excitation)
+    float trace = 0.0f;
+    for (int i = 0; i < PLANT_ID_PARAMETER_COUNT; ++i)
+    {
+        trace += estimator.P[i][i];
+    }
+    float lambda = (trace > PLANT_ID_MAX_COVARIANCE_TRACE) ? 1.0f : m_forgettingFactor;
+
+    // P is symmetric so phi' * P equals (P * phi)'
+    for (int i = 0; i < PLANT_ID_PARAMETER_COUNT; ++i)
+    {
+        for (int j = i; j < PLANT_ID_PARAMETER_COUNT; ++j)
+        {
+            float value = (estimator.P[i][j] - gain[i] * Pphi[j]) / lambda;
+            estimator.P[i][j] = value;
+            estimator.P[j][i] = value;
+        }
+    }
+}
+
+void PlantIdentifier::restartRegressor(float temperatureF, ulong currentTimeMSec)
+{
+    // Keep the parameter estimates, only forget the input history, the next sample pushes its first entry
+    m_historyHead = 0;
+    m_historyCount = 0;
+    m_previousTempF = temperatureF;
+    m_lastUpdateMSec = currentTimeMSec;
+}
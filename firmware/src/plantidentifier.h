@@ -0,0 +1,106 @@
+#ifndef PLANT_IDENTIFIER_H
+#define PLANT_IDENTIFIER_H
+
+/**
+ * @file plantidentifier.h
+ * @brief Online recursive-least-squares (RLS) identification of the smoker thermal response.
+ *
+ * The smoker is modelled as a first-order discrete system with dead time, driven by the
+ * blower and the door:
+ *
+ *     y[k] = a * y[k-1] + bBlower * uBlower[k-1-d] + bDoor * uDoor[k-1-d] + c
+ *
+ * where:
+ *   - y[k] is the smoker temperature (F),
+ *   - uBlower is the blower PWM normalized to 0..1,
+ *   - uDoor is the door opening normalized to 0..1 (closed..open),
+ *   - d is the dead time in samples,
+ *   - c absorbs the ambient temperature and the heat released by an idle fire.
+ *
+ * RLS cannot estimate the dead time directly, so a small bank of estimators runs in parallel,
+ * one per candidate dead time, and the candidate with the lowest filtered prediction error wins.
+ *
+ * update() takes the sample y[k] with the inputs applied over the interval ending with it, which
+ * are u[k-1]: the history entry d samples back from the newest one is u[k-1-d].
+ *
+ * Every estimator uses a forgetting factor so the model tracks the fire as it changes, and all
+ * matrices are fixed-size so an update is allocation-free.
+ *
+ * From the winning estimator the continuous-time parameters are derived:
+ *
+ *     gain         K   = bBlower / (1 - a)   (F per 100% blower)
+ *     time const.  tau = -Ts / ln(a)         (seconds)
+ *     dead time    L   = d * Ts              (seconds)
+ */
+
+#include <Arduino.h>
+#include "types.h"
+#include "debug.h"
+
+// #define DEBUG_PLANT_IDENTIFIER
+
+#define PLANT_ID_PARAMETER_COUNT 4                 // Model parameters: a, bBlower, bDoor, c
+#define PLANT_ID_DELAY_CANDIDATES 4                // Number of dead time candidates evaluated in parallel
+#define PLANT_ID_MAX_DELAY_SAMPLES 12              // Longest dead time candidate (in samples)
+#define PLANT_ID_DEFAULT_FORGETTING_FACTOR 0.995f  // Default RLS forgetting factor (0 < lambda <= 1)
+#define PLANT_ID_INITIAL_COVARIANCE 1000.0f        // Initial diagonal of the covariance matrix
+#define PLANT_ID_MAX_COVARIANCE_TRACE 100000.0f    // Stop forgetting above this trace to avoid covariance windup
+#define PLANT_ID_ERROR_FILTER_COEFF 0.05f          // EWMA coefficient for the squared prediction error
+#define PLANT_ID_INITIAL_ERROR_SQUARED 10000.0f    // Initial squared prediction error (F^2)
+#define PLANT_ID_MIN_SAMPLES 20                    // Samples required before the model is reported as valid
+#define PLANT_ID_MAX_SAMPLE_GAP_FACTOR 3           // Restart the regressor if a sample arrives this many intervals late
+
+struct PlantModel
+{
+    bool isValid;           // True when enough samples have been processed and the model is stable
+    float a;                // Discrete pole
+    float bBlower;          // Discrete blower input gain (F per sample at 100% blower)
+    float bDoor;            // Discrete door input gain (F per sample at fully open door)
+    float c;                // Discrete offset (F per sample)
+    float gain;             // Steady state blower gain (F per 100% blower)
+    float doorGain;         // Steady state door gain (F per fully open door)
+    float timeConstantSec;  // Time constant in seconds
+    float deadTimeSec;      // Dead time in seconds
+    float sampleTimeSec;    // Sample time the model was identified at
+    float predictionErrorF; // RMS one-step prediction error (F)
+};
+
+class PlantIdentifier
+{
+private:
+    struct Estimator
+    {
+        float theta[PLANT_ID_PARAMETER_COUNT];                       // Parameter estimates
+        float P[PLANT_ID_PARAMETER_COUNT][PLANT_ID_PARAMETER_COUNT]; // Covariance matrix
+        float errorSquared;                                          // Filtered squared a priori error
+    };
+
+    Estimator m_estimators[PLANT_ID_DELAY_CANDIDATES];     // One estimator per dead time candidate
+    float m_blowerHistory[PLANT_ID_MAX_DELAY_SAMPLES + 1]; // Ring buffer of past blower inputs
+    float m_doorHistory[PLANT_ID_MAX_DELAY_SAMPLES + 1];   // Ring buffer of past door inputs
+    uint m_historyHead;                                    // Index of the most recent input
+    uint m_historyCount;                                   // Number of valid inputs in the ring buffer
+
+    float m_forgettingFactor; // RLS forgetting factor
+    float m_previousTempF;    // Temperature at the previous sample
+    float m_sampleTimeSec;    // Filtered sample time in seconds
+    ulong m_lastUpdateMSec;   // Time of the last update
+    uint m_sampleCount;       // Number of samples processed since the last reset
+    int m_bestCandidate;      // Index of the dead time candidate with the lowest error
+
+    void resetEstimator(Estimator &estimator);
+    void updateEstimator(Estimator &estimator, const float *phi, float y);
+    void restartRegressor(float temperatureF, ulong currentTimeMSec);
+
+public:
+    PlantIdentifier(float forgettingFactor = PLANT_ID_DEFAULT_FORGETTING_FACTOR);
+
+    void reset();
+    void setForgettingFactor(float forgettingFactor);
+    void update(float temperatureF, float blowerPWM, float doorFraction, ulong currentTimeMSec);
+
+    PlantModel getModel() const;
+    float predict(float temperatureF, float blowerPWM, float doorFraction) const;
+};
+
+#endif // PLANT_IDENTIFIER_H
@@ -0,0 +1,241 @@
+#include "profileengine.h"
+
+ProfileEngine::ProfileEngine()
+{
+    m_segmentCount = 0;
+    m_nextConditional[0] = 0;
+    m_pitBandF = DEFAULT_PROFILE_PIT_BAND_F;
+    m_isStarted = false;
+    m_startTimeMSec = 0;
+    m_stepIndex = -1;
+    m_isHolding = false;
+    m_bandStepIndex = -1;
+    m_isPitInBand = false;
+    m_pitInBandMSec = 0;
+}
+
+int ProfileEngine::compile(const TempProfileStep *steps, int stepsCount, int pitBandF)
+{
+    stepsCount = constrain(stepsCount, 0, PROFILE_MAX_SEGMENTS);
+
+    ulong timeMSec = 0;
+    for (int i = 0; i < stepsCount; ++i)
+    {
+        const TempProfileStep &step = steps[i];
+        ProfileSegment &segment = m_segments[i];
+        segment.startMSec = timeMSec;
+        timeMSec += step.timeMSec;
+        segment.endMSec = timeMSec;
+        segment.type = step.type;
+        segment.temperatureStartF = step.temperatureStartF;
+        segment.temperatureEndF = step.type == TEMP_PROFILE_TYPE_RAMP ? step.temperatureEndF : step.temperatureStartF;
+
+        // A step without conditions is a timed one
+        uint8_t conditions = step.advanceConditions & TEMP_PROFILE_ADVANCE_ALL;
+        segment.advanceConditions = conditions != 0 ? conditions : TEMP_PROFILE_ADVANCE_TIME;
+        segment.isAdvanceOnAll = step.isAdvanceOnAll;
+        segment.advanceFoodF = step.advanceFoodF;
+        segment.advancePitHoldMSec = step.advancePitHoldMSec;
+    }
+    m_segmentCount = stepsCount;
+    m_pitBandF = pitBandF;
+
+    // Built backwards, the search of a timed step stops at the next conditional one
+    m_nextConditional[m_segmentCount] = m_segmentCount;
+    for (int i = m_segmentCount - 1; i >= 0; --i)
+        m_nextConditional[i] = m_segments[i].advanceConditions != TEMP_PROFILE_ADVANCE_TIME ? i : m_nextConditional[i + 1];
+
+    // A running profile keeps its start time, the next service() finds its place in the new table
+    if (m_isStarted)
+        m_stepIndex = min(m_stepIndex, m_segmentCount);
+
+#ifdef DEBUG_PROFILE_ENGINE
+    DEBUG_PRINTLN("PROFILEENGINE::compile - " + String(m_segmentCount) + " segments, " + String(timeMSec) + " ms");
+#endif
+    return m_segmentCount;
+}
+
+void ProfileEngine::reset()
+{
+    m_isStarted = false;
+    m_stepIndex = -1;
+    m_isHolding = false;
+    m_bandStepIndex = -1;
+}
+
+void ProfileEngine::resume(ulong profileTimeMSec, int stepIndex, ulong currentTimeMSec)
+{
+    // Started as if it had run for the profile time, the next service() continues from the step
+    m_isStarted = true;
+    m_startTimeMSec = currentTimeMSec - profileTimeMSec;
+    m_stepIndex = constrain(stepIndex, 0, m_segmentCount);
+    m_bandStepIndex = -1;
+}
+
+int ProfileEngine::service(ulong currentTimeMSec, int pitTemperatureF, int foodTemperatureF)
+{
+    if (!m_isStarted)
+    {
+        // The profile starts with the first target asked for
+        m_isStarted = true;
+        m_startTimeMSec = currentTimeMSec;
+        m_stepIndex = 0;
+    }
+    if (m_segmentCount == 0)
+        return 0;
+
+    ulong profileTimeMSec = currentTimeMSec - m_startTimeMSec;
+    int index = max(m_stepIndex, 0);
+    m_isHolding = false;
+
+    // At most one pass per step, conditions met on consecutive steps advance them all on this tick
+    while (index < m_segmentCount)
+    {
+        const ProfileSegment &segment = m_segments[index];
+        if (segment.advanceConditions == TEMP_PROFILE_ADVANCE_TIME)
+        {
+            // Timed steps are passed by the search, up to the next conditional step
+            int found = max(findSegment(profileTimeMSec), index);
+            int conditional = m_nextConditional[index];
+            if (found < conditional)
+            {
+                index = found;
+                break;
+            }
+            index = conditional;
+            continue;
+        }
+
+        if (isAdvanceMet(index, profileTimeMSec, pitTemperatureF, foodTemperatureF, currentTimeMSec))
+        {
+            // Early, the clock jumps to the segment end so the next segment starts in full
+            if (profileTimeMSec < segment.endMSec)
+            {
+                m_startTimeMSec -= segment.endMSec - profileTimeMSec;
+                profileTimeMSec = segment.endMSec;
+            }
+            index++;
+            continue;
+        }
+
+        if (profileTimeMSec >= segment.endMSec)
+        {
+            // Late, the clock holds at the segment end and the step keeps its end temperature
+            m_startTimeMSec += profileTimeMSec - segment.endMSec;
+            profileTimeMSec = segment.endMSec;
+            m_isHolding = true;
+        }
+        break;
+    }
+
+    m_stepIndex = index;
+    if (index >= m_segmentCount)
+        return m_segments[m_segmentCount - 1].temperatureEndF; // Finished, the last target holds
+    return interpolate(m_segments[index], profileTimeMSec);
+}
+
+ProfileState ProfileEngine::getState() const
+{
+    if (!m_isStarted || m_stepIndex < 0)
+        return PROFILE_STATE_IDLE;
+    return m_stepIndex < m_segmentCount ? PROFILE_STATE_RUNNING : PROFILE_STATE_FINISHED;
+}
+
+int ProfileEngine::getSegmentCount() const
+{
+    return m_segmentCount;
+}
+
+int ProfileEngine::getStepIndex() const
+{
+    return m_stepIndex;
+}
+
+ulong ProfileEngine::getStepStartTimeMSec() const
+{
+    if (m_stepIndex < 0 || m_stepIndex >= m_segmentCount)
+        return m_startTimeMSec;
+    return m_startTimeMSec + m_segments[m_stepIndex].startMSec;
+}
+
+TempProfileType ProfileEngine::getStepType() const
+{
+    if (m_stepIndex < 0 || m_stepIndex >= m_segmentCount)
+        return TEMP_PROFILE_TYPE_DWELL;
+    return m_segments[m_stepIndex].type;
+}
+
+bool ProfileEngine::isStepHolding() const
+{
+    return m_isHolding;
+}
+
+int ProfileEngine::getFirstTarget() const
+{
+    return m_segmentCount > 0 ? m_segments[0].temperatureStartF : 0;
+}
+
+ulong ProfileEngine::getProfileTimeMSec(ulong currentTimeMSec) const
+{
+    return m_isStarted ? currentTimeMSec - m_startTimeMSec : 0;
+}
+
+int ProfileEngine::findSegment(ulong profileTimeMSec) const
+{
+    // First segment ending after the profile time, m_segmentCount past the end
+    int low = 0;
+    int high = m_segmentCount;
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+        if (m_segments[middle].endMSec <= profileTimeMSec)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+int ProfileEngine::interpolate(const ProfileSegment &segment, ulong profileTimeMSec) const
+{
+    if (segment.temperatureStartF == segment.temperatureEndF || profileTimeMSec >= segment.endMSec)
+        return segment.temperatureEndF;
+    if (profileTimeMSec <= segment.startMSec)
+        return segment.temperatureStartF;
+
+    // Integer interpolation, a long ramp still moves in whole degrees at the right times
+    int32_t rangeF = segment.temperatureEndF - segment.temperatureStartF;
+    int64_t elapsedMSec = profileTimeMSec - segment.startMSec;
+    int64_t durationMSec = segment.endMSec - segment.startMSec;
+    return segment.temperatureStartF + static_cast<int>(rangeF * elapsedMSec / durationMSec);
+}
+
+bool ProfileEngine::isAdvanceMet(int index, ulong profileTimeMSec, int pitTemperatureF, int foodTemperatureF, ulong currentTimeMSec)
+{
+    const ProfileSegment &segment = m_segments[index];
+
+    // The band time of a step counts from its first evaluation
+    if (index != m_bandStepIndex)
+    {
+        m_bandStepIndex = index;
+        m_isPitInBand = false;
+    }
+
+    uint8_t met = 0;
+    if (profileTimeMSec >= segment.endMSec)
+        met |= TEMP_PROFILE_ADVANCE_TIME;
+    if (foodTemperatureF >= segment.advanceFoodF)
+        met |= TEMP_PROFILE_ADVANCE_FOOD;
+    if (segment.advanceConditions & TEMP_PROFILE_ADVANCE_PIT_HOLD)
+    {
+        bool isInBand = abs(pitTemperatureF - interpolate(segment, profileTimeMSec)) <= m_pitBandF;
+        if (isInBand && !m_isPitInBand)
+            m_pitInBandMSec = currentTimeMSec;
+        m_isPitInBand = isInBand;
+        if (isInBand && currentTimeMSec - m_pitInBandMSec >= segment.advancePitHoldMSec)
+            met |= TEMP_PROFILE_ADVANCE_PIT_HOLD;
+    }
+
+    met &= segment.advanceConditions;
+    return segment.isAdvanceOnAll ? met == segment.advanceConditions : met != 0;
+}
@@ -0,0 +1,106 @@
+#ifndef PROFILEENGINE_H
+#define PROFILEENGINE_H
+
+/**
+ * @file profileengine.h
+ * @brief Temperature profile compiled into a cumulative time segment table.
+ *
+ * compile() turns the profile steps into one segment per step, each holding its start and end
+ * on the profile time axis and the temperatures at both ends. A dwell is a segment with equal
+ * temperatures, a ramp interpolates between them:
+ *
+ *   step       0: dwell 225F 1h   1: ramp 225F->275F 30m   2: dwell 275F 2h
+ *   segment    [0, 1h)            [1h, 1h30m)              [1h30m, 3h30m)
+ *
+ * The target at profile time t is found with a binary search for the first segment ending after
+ * t. Timed steps are not advanced one by one, the position follows from the time since the
+ * profile start: a loop stalled across several steps lands on the right one on its next pass,
+ * and a profile compiled again during a run keeps its start time. Steps without duration take no
+ * time on the axis and are never selected.
+ *
+ * A step with advance conditions (TempProfileAdvance) ends when they are met instead:
+ *
+ *   - met before the end of its segment, the profile clock jumps forward to the segment end,
+ *   - not met at the end of its segment, the clock holds there and the step keeps its end
+ *     temperature. A step with the time condition and any-matching ends there at the latest,
+ *     with all-matching the time is a minimum.
+ *
+ * Both move the profile start time, the segment table never changes. The search stops at the
+ * next conditional step, found in a table compiled with the segments, and only that step's
+ * conditions are evaluated on a control tick. The pit hold condition counts from the last time
+ * the pit entered the band around the target.
+ *
+ * The engine holds up to PROFILE_MAX_SEGMENTS segments, enough for the profile table stored
+ * apart from the configuration (TempProfileTable).
+ */
+
+#include <Arduino.h>
+#include "types.h"
+#include "debug.h"
+
+// #define DEBUG_PROFILE_ENGINE
+
+#define PROFILE_MAX_SEGMENTS MAX_PROFILE_TABLE_STEPS // One segment per step
+#define DEFAULT_PROFILE_ADVANCE_FOOD_F 165
+#define DEFAULT_PROFILE_PIT_HOLD_MSEC (10 * 60 * 1000)
+#define DEFAULT_PROFILE_PIT_BAND_F 10
+#define PROFILE_PIT_BAND_MAX_F 50
+
+enum ProfileState : uint8_t
+{
+    PROFILE_STATE_IDLE,    // Not started since the last reset
+    PROFILE_STATE_RUNNING, // Inside the profile
+    PROFILE_STATE_FINISHED // Past the last segment, holds its end temperature
+};
+
+struct ProfileSegment
+{
+    ulong startMSec;           // Profile time at the start of the segment
+    ulong endMSec;             // Profile time at the end of the segment, start of the next one
+    int16_t temperatureStartF; // Target at the start of the segment
+    int16_t temperatureEndF;   // Target at the end of the segment, the start one for a dwell
+    TempProfileType type;      // Type of the step
+    uint8_t advanceConditions; // TempProfileAdvance flags, TEMP_PROFILE_ADVANCE_TIME alone for a timed step
+    bool isAdvanceOnAll;       // All conditions must be met
+    int16_t advanceFoodF;      // Food temperature of TEMP_PROFILE_ADVANCE_FOOD
+    ulong advancePitHoldMSec;  // Hold time of TEMP_PROFILE_ADVANCE_PIT_HOLD
+};
+
+class ProfileEngine
+{
+public:
+    ProfileEngine();
+
+    int compile(const TempProfileStep *steps, int stepsCount, int pitBandF);
+    void reset();
+    void resume(ulong profileTimeMSec, int stepIndex, ulong currentTimeMSec);
+    int service(ulong currentTimeMSec, int pitTemperatureF, int foodTemperatureF);
+
+    ProfileState getState() const;
+    int getSegmentCount() const;
+    int getStepIndex() const;
+    ulong getStepStartTimeMSec() const;
+    TempProfileType getStepType() const;
+    bool isStepHolding() const;
+    int getFirstTarget() const;
+    ulong getProfileTimeMSec(ulong currentTimeMSec) const;
+
+private:
+    ProfileSegment m_segments[PROFILE_MAX_SEGMENTS];     // Compiled profile
+    uint8_t m_nextConditional[PROFILE_MAX_SEGMENTS + 1]; // First conditional segment at or after each one, m_segmentCount when none
+    int m_segmentCount;                                  // Compiled segments
+    int m_pitBandF;                                      // Pit band of TEMP_PROFILE_ADVANCE_PIT_HOLD
+    bool m_isStarted;                                    // Start time taken on the first service()
+    ulong m_startTimeMSec;                               // Time of the profile start, moved by early advances and holds
+    int m_stepIndex;                                     // Current step, -1 before the start, m_segmentCount once finished
+    bool m_isHolding;                                    // Clock held at the end of a conditional step
+    int m_bandStepIndex;                                 // Step the pit band time is counted for
+    bool m_isPitInBand;                                  // Pit inside the band at the last tick
+    ulong m_pitInBandMSec;                               // Time the pit entered the band
+
+    int findSegment(ulong profileTimeMSec) const;
+    int interpolate(const ProfileSegment &segment, ulong profileTimeMSec) const;
+    bool isAdvanceMet(int index, ulong profileTimeMSec, int pitTemperatureF, int foodTemperatureF, ulong currentTimeMSec);
+};
+
+#endif // PROFILEENGINE_H
@@ -0,0 +1,210 @@
+#include "runcheckpoint.h"
+#include <sys/time.h>
+#include <esp_system.h>
+#include <rom/crc.h>
+
+// Survives every reset but a power-on one, checked by its magic and CRC
+RTC_NOINIT_ATTR static RunCheckpointRecord s_rtcRecord;
+
+RunCheckpoint::RunCheckpoint()
+{
+    memset(&m_flashRecord, 0, sizeof(m_flashRecord));
+    m_nextSlot = 0;
+    m_sequence = 0;
+    m_flashedSequence = 0;
+    m_isFlashedRunning = false;
+    m_lastFlashMSec = 0;
+    m_flashWriteCount = 0;
+    m_restoredAgeSec = RUN_CHECKPOINT_UNKNOWN_AGE;
+    m_flushMutex = nullptr;
+    m_isCleared = false;
+}
+
+void RunCheckpoint::begin()
+{
+    m_flushMutex = xSemaphoreCreateMutex();
+    if (m_flushMutex == nullptr)
+        Serial.println("Run checkpoint mutex could not be created!");
+
+    // Newest valid flash record, the slot after it is written next
+    char fileName[16];
+    for (int slot = 0; slot < RUN_CHECKPOINT_FLASH_SLOTS; ++slot)
+    {
+        getSlotFileName(slot, fileName, sizeof(fileName));
+        File file = SPIFFS.open(fileName);
+        if (!file)
+            continue;
+
+        RunCheckpointRecord record;
+        bool isRead = file.read(reinterpret_cast<uint8_t *>(&record), sizeof(record)) == sizeof(record);
+        file.close();
+        if (isRead && isValid(record) && record.sequence >= m_flashRecord.sequence)
+        {
+            memcpy(&m_flashRecord, &record, sizeof(record)); // Padding included in the CRC
+            m_nextSlot = (slot + 1) % RUN_CHECKPOINT_FLASH_SLOTS;
+        }
+    }
+
+    m_sequence = m_flashRecord.sequence;
+    if (isValid(s_rtcRecord))
+        m_sequence = max(m_sequence, s_rtcRecord.sequence);
+    m_flashedSequence = m_flashRecord.sequence;
+    m_isFlashedRunning = isValid(m_flashRecord) && m_flashRecord.state.isRunning;
+
+#ifdef DEBUG_RUN_CHECKPOINT
+    DEBUG_PRINTLN("RUNCHECKPOINT::begin - flash " + String(m_flashRecord.sequence) + ", RTC " +
+                  String(isValid(s_rtcRecord) ? s_rtcRecord.sequence : 0));
+#endif
+}
+
+bool RunCheckpoint::restore(RunState &state, ulong resumeWindowMSec, bool isPowerLossResumeEnabled)
+{
+    // The RTC record is the newer one unless RTC memory was lost
+    const RunCheckpointRecord *record = nullptr;
+    if (isValid(s_rtcRecord))
+        record = &s_rtcRecord;
+    if (isValid(m_flashRecord) && (record == nullptr || m_flashRecord.sequence > record->sequence))
+        record = &m_flashRecord;
+    if (record == nullptr || !record->state.isRunning || resumeWindowMSec == 0)
+        return false;
+
+    // The RTC clock restarts on a power-on reset only, the age is unknown then
+    int64_t clockUSec = getClockUSec();
+    bool isAgeKnown = esp_reset_reason() != ESP_RST_POWERON && clockUSec >= record->clockUSec;
+    if (isAgeKnown)
+    {
+        int64_t ageMSec = (clockUSec - record->clockUSec) / 1000;
+        if (ageMSec > static_cast<int64_t>(resumeWindowMSec))
+            return false;
+        m_restoredAgeSec = static_cast<long>(ageMSec / 1000);
+    }
+    else if (!isPowerLossResumeEnabled)
+    {
+        return false;
+    }
+
+#ifdef DEBUG_RUN_CHECKPOINT
+    DEBUG_PRINTLN("RUNCHECKPOINT::restore - resuming from " + String(record == &s_rtcRecord ? "RTC" : "flash") +
+                  " record " + String(record->sequence) + ", age " + String(m_restoredAgeSec) + " s");
+#endif
+    state = record->state;
+    return true;
+}
+
+void RunCheckpoint::capture(const RunState &state)
+{
+    RunCheckpointRecord record;
+    memset(&record, 0, sizeof(record)); // Padding included in the CRC
+    record.magic = RUN_CHECKPOINT_MAGIC;
+    record.sequence = ++m_sequence;
+    record.clockUSec = getClockUSec();
+    memcpy(&record.state, &state, sizeof(state));
+    record.crc = calculateCRC(record);
+
+    memcpy(&s_rtcRecord, &record, sizeof(record));
+    m_snapshot.write(record);
+}
+
+void RunCheckpoint::flush(ulong currentTimeMSec)
+{
+    if (m_flushMutex != nullptr)
+        xSemaphoreTake(m_flushMutex, portMAX_DELAY);
+    flushRecord(currentTimeMSec);
+    if (m_flushMutex != nullptr)
+        xSemaphoreGive(m_flushMutex);
+}
+
+void RunCheckpoint::flushRecord(ulong currentTimeMSec)
+{
+    // Nothing is written once the run state was cleared
+    if (m_isCleared)
+        return;
+
+    RunCheckpointRecord record;
+    m_snapshot.read(record);
+    if (record.magic != RUN_CHECKPOINT_MAGIC || record.sequence == m_flashedSequence)
+        return;
+
+    // Starts and stops at once, a running cook once per period, nothing while stopped
+    bool isStateChanged = record.state.isRunning != m_isFlashedRunning;
+    if (!isStateChanged &&
+        (!record.state.isRunning || currentTimeMSec - m_lastFlashMSec < RUN_CHECKPOINT_FLASH_PERIOD_MSEC))
+        return;
+
+    char fileName[16];
+    getSlotFileName(m_nextSlot, fileName, sizeof(fileName));
+    File file = SPIFFS.open(fileName, FILE_WRITE);
+    if (!file)
+    {
+        DEBUG_PRINTLN("Failed to open the run checkpoint for writing");
+        return;
+    }
+    size_t written = file.write(reinterpret_cast<const uint8_t *>(&record), sizeof(record));
+    file.close();
+
+    // A short write leaves a torn record, the same slot is written again on the next pass
+    if (written != sizeof(record))
+    {
+        DEBUG_PRINTLN("An error occurred while writing the run checkpoint");
+        return;
+    }
+
+    m_nextSlot = (m_nextSlot + 1) % RUN_CHECKPOINT_FLASH_SLOTS;
+    m_flashedSequence = record.sequence;
+    m_isFlashedRunning = record.state.isRunning;
+    m_lastFlashMSec = currentTimeMSec;
+    m_flashWriteCount++;
+}
+
+void RunCheckpoint::clear()
+{
+    // A flush in progress finishes first, its record is removed with the others
+    if (m_flushMutex != nullptr)
+        xSemaphoreTake(m_flushMutex, portMAX_DELAY);
+    m_isCleared = true;
+
+    char fileName[16];
+    for (int slot = 0; slot < RUN_CHECKPOINT_FLASH_SLOTS; ++slot)
+    {
+        getSlotFileName(slot, fileName, sizeof(fileName));
+        if (SPIFFS.exists(fileName))
+            SPIFFS.remove(fileName);
+    }
+    s_rtcRecord.magic = 0;
+
+    if (m_flushMutex != nullptr)
+        xSemaphoreGive(m_flushMutex);
+}
+
+long RunCheckpoint::getRestoredAgeSec() const
+{
+    return m_restoredAgeSec;
+}
+
+uint32_t RunCheckpoint::getFlashWriteCount() const
+{
+    return m_flashWriteCount;
+}
+
+uint32_t RunCheckpoint::calculateCRC(const RunCheckpointRecord &record)
+{
+    return crc32_le(0, reinterpret_cast<const uint8_t *>(&record), offsetof(RunCheckpointRecord, crc));
+}
+
+bool RunCheckpoint::isValid(const RunCheckpointRecord &record)
+{
+    return record.magic == RUN_CHECKPOINT_MAGIC && record.crc == calculateCRC(record);
+}
+
+int64_t RunCheckpoint::getClockUSec()
+{
+    // System time runs from the RTC timer, it keeps counting through every reset but a power-on one
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    return static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_usec;
+}
+
+void RunCheckpoint::getSlotFileName(int slot, char *buffer, size_t size)
+{
+    snprintf(buffer, size, "/run%d.bin", slot);
+}
@@ -0,0 +1,111 @@
+#ifndef RUNCHECKPOINT_H
+#define RUNCHECKPOINT_H
+
+/**
+ * @file runcheckpoint.h
+ * @brief Run state checkpoints that let a cook resume after a reset.
+ *
+ * A brown-out or watchdog reset in the middle of a cook used to boot the controller stopped with
+ * the blower off. The control loop now captures the run state every second: running flag, run
+ * and profile time and the integrator of the control strategy. Every capture goes to two places:
+ *
+ *   - RTC memory (RTC_NOINIT): written on every capture, it survives every reset but a power-on
+ *     one, together with the RTC clock the age of the checkpoint is measured with.
+ *   - Flash: written by the UI loop once per RUN_CHECKPOINT_FLASH_PERIOD_MSEC while running and
+ *     once on every start and stop. The writes rotate over RUN_CHECKPOINT_FLASH_SLOTS files, a
+ *     record torn by a reset leaves the previous slot in place and no file is rewritten more
+ *     often than once per RUN_CHECKPOINT_FLASH_SLOTS periods.
+ *
+ * Every record carries a magic, a sequence number and a CRC32. On boot restore() takes the valid
+ * record with the highest sequence. The run resumes when the record was captured while running
+ * and its age is within the resume window. After a power-on reset the RTC clock restarted and
+ * the outage length is unknown, the flash record is then only used when resuming after a power
+ * loss is enabled. The run and profile times continue where the checkpoint left them, the time
+ * spent off is not counted.
+ *
+ * clear() stops the flash writer for good, a flush in progress is waited for, so no record of the
+ * forgotten run is written between a factory reset and its restart.
+ */
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "types.h"
+#include "controlchannel.h"
+#include "debug.h"
+
+// #define DEBUG_RUN_CHECKPOINT
+
+#define RUN_CHECKPOINT_MAGIC 0x534D5243        // "SMRC"
+#define RUN_CHECKPOINT_FLASH_SLOTS 4           // Flash records written in turn
+#define RUN_CHECKPOINT_FLASH_PERIOD_MSEC 60000 // Flash record period while running
+#define RUN_CHECKPOINT_UNKNOWN_AGE -1          // Checkpoint age after a power-on reset
+#define DEFAULT_RESUME_WINDOW_MIN 30
+#define RESUME_WINDOW_MAX_MIN 720
+#define RESUME_WINDOW_STEP_MIN 5
+#define DEFAULT_RESUME_AFTER_POWER_LOSS false
+
+struct RunState
+{
+    bool isRunning;             // Cook in progress
+    ulong runElapsedMSec;       // Time since the run start
+    bool isProfileStarted;      // Profile time valid
+    ulong profileElapsedMSec;   // Time since the profile start
+    int profileStepIndex;       // Profile step, conditional steps are not found from the time
+    ControlAlgorithm algorithm; // Strategy the integrator belongs to
+    bool isIntegratorValid;     // Strategy with integral action
+    float integrator;           // Integral term of the strategy
+};
+
+struct RunCheckpointRecord
+{
+    uint32_t magic;    // RUN_CHECKPOINT_MAGIC
+    uint32_t sequence; // Capture number, the highest valid one wins
+    int64_t clockUSec; // RTC clock at the capture
+    RunState state;    // Captured run state
+    uint32_t crc;      // CRC32 of the fields above
+};
+
+class RunCheckpoint
+{
+public:
+    RunCheckpoint();
+
+    // Setup only, SPIFFS mounted
+    void begin();
+    bool restore(RunState &state, ulong resumeWindowMSec, bool isPowerLossResumeEnabled);
+
+    // Control loop only
+    void capture(const RunState &state);
+
+    // UI loop only
+    void flush(ulong currentTimeMSec);
+
+    // Factory reset, right before the restart, any task
+    void clear();
+
+    long getRestoredAgeSec() const;
+    uint32_t getFlashWriteCount() const;
+
+private:
+    RunCheckpointRecord m_flashRecord;       // Newest valid flash record at boot
+    int m_nextSlot;                          // Flash slot written next
+    uint32_t m_sequence;                     // Sequence of the last capture
+    SeqLock<RunCheckpointRecord> m_snapshot; // Last capture, read by the flash writer
+    uint32_t m_flashedSequence;              // Sequence of the last flash record
+    bool m_isFlashedRunning;                 // Running flag of the last flash record
+    ulong m_lastFlashMSec;                   // Time of the last flash record
+    uint32_t m_flashWriteCount;              // Flash records written since boot
+    long m_restoredAgeSec;                   // Age of the checkpoint resumed from, unknown when none
+    SemaphoreHandle_t m_flushMutex;          // Held for the length of a flush or a clear
+    volatile bool m_isCleared;               // Flash writer stopped for a factory reset
+
+    void flushRecord(ulong currentTimeMSec);
+    static uint32_t calculateCRC(const RunCheckpointRecord &record);
+    static bool isValid(const RunCheckpointRecord &record);
+    static int64_t getClockUSec();
+    static void getSlotFileName(int slot, char *buffer, size_t size);
+};
+
+#endif // RUNCHECKPOINT_H
@@ -0,0 +1,142 @@
+#include "scheduler.h"
+
+Scheduler::Scheduler()
+{
+    m_taskCount = 0;
+    m_overrunCount = 0;
+    m_maxPassTimeUSec = 0;
+    m_runningTaskName = nullptr;
+}
+
+int Scheduler::addTask(const char *name, SchedulerTaskCallback callback, ulong periodMSec,
+                       SchedulerPriority priority, ulong budgetUSec)
+{
+    if (m_taskCount >= SCHEDULER_MAX_TASKS || callback == nullptr)
+    {
+        Serial.println("Scheduler task table full, task not added!");
+        return -1;
+    }
+
+    // Insert behind the tasks of the same or a higher priority, registration order breaks ties
+    uint index = m_taskCount;
+    while (index > 0 && m_tasks[index - 1].priority < priority)
+    {
+        m_tasks[index] = m_tasks[index - 1];
+        index--;
+    }
+
+    SchedulerTask &task = m_tasks[index];
+    memset(&task, 0, sizeof(task));
+    task.name = name;
+    task.callback = callback;
+    task.periodUSec = periodMSec * 1000;
+    task.budgetUSec = budgetUSec;
+    task.priority = priority;
+    task.dueTimeUSec = micros();
+    m_taskCount++;
+    return index;
+}
+
+void Scheduler::service()
+{
+    uint32_t passStartUSec = micros();
+
+    for (uint i = 0; i < m_taskCount; ++i)
+    {
+        SchedulerTask &task = m_tasks[i];
+        uint32_t nowUSec = micros();
+
+        // Wrap safe due check
+        if (task.periodUSec > 0 && static_cast<int32_t>(nowUSec - task.dueTimeUSec) < 0)
+            continue;
+
+        if (task.priority < SCHEDULER_PRIORITY_CRITICAL && nowUSec - passStartUSec >= SCHEDULER_PASS_BUDGET_USEC)
+        {
+            task.stats.deferCount++;
+            continue;
+        }
+
+        runTask(task, nowUSec);
+    }
+
+    m_maxPassTimeUSec = max(m_maxPassTimeUSec, static_cast<uint32_t>(micros() - passStartUSec));
+}
+
+void Scheduler::runTask(SchedulerTask &task, uint32_t startUSec)
+{
+    SchedulerTaskStats &stats = task.stats;
+
+    if (task.periodUSec > 0)
+    {
+        uint32_t latenessUSec = startUSec - task.dueTimeUSec;
+        stats.latenessHistogram[getHistogramBucket(latenessUSec)]++;
+        stats.maxLatenessUSec = max(stats.maxLatenessUSec, latenessUSec);
+
+        // Keep the phase, resynchronize a task that fell more than a period behind
+        task.dueTimeUSec += task.periodUSec;
+        if (latenessUSec >= task.periodUSec)
+        {
+            stats.skipCount += latenessUSec / task.periodUSec;
+            task.dueTimeUSec = startUSec + task.periodUSec;
+        }
+    }
+
+    m_runningTaskName = task.name; // Read by the deadline monitor from another task
+    task.callback(millis());
+    m_runningTaskName = nullptr;
+
+    uint32_t runTimeUSec = micros() - startUSec;
+    stats.runCount++;
+    stats.runTimeHistogram[getHistogramBucket(runTimeUSec)]++;
+    stats.maxRunTimeUSec = max(stats.maxRunTimeUSec, runTimeUSec);
+
+    if (task.budgetUSec > 0 && runTimeUSec > task.budgetUSec)
+    {
+        stats.overrunCount++;
+        m_overrunCount++;
+#ifdef DEBUG_SCHEDULER
+        DEBUG_PRINTLN("SCHEDULER::runTask - " + String(task.name) + " overran its budget: " +
+                      String(runTimeUSec) + " us > " + String(task.budgetUSec) + " us");
+#endif
+    }
+}
+
+void Scheduler::resetStats()
+{
+    for (uint i = 0; i < m_taskCount; ++i)
+        memset(&m_tasks[i].stats, 0, sizeof(SchedulerTaskStats));
+    m_overrunCount = 0;
+    m_maxPassTimeUSec = 0;
+}
+
+uint Scheduler::getTaskCount() const
+{
+    return m_taskCount;
+}
+
+const SchedulerTask *Scheduler::getTask(uint index) const
+{
+    return index < m_taskCount ? &m_tasks[index] : nullptr;
+}
+
+uint32_t Scheduler::getOverrunCount() const
+{
+    return m_overrunCount;
+}
+
+uint32_t Scheduler::getMaxPassTimeUSec() const
+{
+    return m_maxPassTimeUSec;
+}
+
+const char *Scheduler::getRunningTaskName() const
+{
+    return m_runningTaskName;
+}
+
+uint Scheduler::getHistogramBucket(uint32_t valueUSec)
+{
+    // Index of the highest set bit, 0 and 1 share the first bucket
+    uint bucket = valueUSec > 1 ? 31 - __builtin_clz(valueUSec) : 0;
+    return min(bucket, static_cast<uint>(SCHEDULER_HISTOGRAM_BUCKETS - 1));
+}
@@ -0,0 +1,92 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+/**
+ * @file scheduler.h
+ * @brief Cooperative scheduler for the main loop with per-task periods, budgets and statistics.
+ *
+ * Every subsystem registers a task with a period, a priority and a time budget. Each call to
+ * service() runs the tasks that are due in priority order; a period of 0 runs the task on every
+ * pass. Periodic tasks keep their phase, the next due time advances by one period per run, and a
+ * task that fell more than a period behind is resynchronized instead of running back to back.
+ *
+ * Once a pass has used SCHEDULER_PASS_BUDGET_USEC, the remaining due tasks below
+ * SCHEDULER_PRIORITY_CRITICAL wait for the next pass, so one slow task delays the others by at
+ * most one pass.
+ *
+ * For each task the scheduler records the run time and the lateness (start time minus due time)
+ * in log2 histograms, bucket i counting the samples of [2^i, 2^(i+1)) microseconds with the last
+ * bucket open ended. A run longer than the task budget is counted as an overrun.
+ */
+
+#include <Arduino.h>
+#include "debug.h"
+
+// #define DEBUG_SCHEDULER
+
+#define SCHEDULER_MAX_TASKS 16          // Size of the task table
+#define SCHEDULER_HISTOGRAM_BUCKETS 20  // Log2 buckets, the last one counts everything above 0.5 s
+#define SCHEDULER_PASS_BUDGET_USEC 5000 // Pass time after which only critical tasks still run
+
+enum SchedulerPriority
+{
+    SCHEDULER_PRIORITY_LOW,
+    SCHEDULER_PRIORITY_NORMAL,
+    SCHEDULER_PRIORITY_HIGH,
+    SCHEDULER_PRIORITY_CRITICAL
+};
+
+typedef void (*SchedulerTaskCallback)(ulong currentTimeMSec);
+
+struct SchedulerTaskStats
+{
+    uint32_t runCount;                                       // Number of runs
+    uint32_t overrunCount;                                   // Runs longer than the budget
+    uint32_t deferCount;                                     // Passes the task was due but deferred
+    uint32_t skipCount;                                      // Periods dropped by a resynchronization
+    uint32_t maxRunTimeUSec;                                 // Longest run
+    uint32_t maxLatenessUSec;                                // Latest start
+    uint32_t runTimeHistogram[SCHEDULER_HISTOGRAM_BUCKETS];  // Run times, log2 microsecond buckets
+    uint32_t latenessHistogram[SCHEDULER_HISTOGRAM_BUCKETS]; // Lateness, log2 microsecond buckets
+};
+
+struct SchedulerTask
+{
+    const char *name;               // Task name for the reports
+    SchedulerTaskCallback callback; // Task body
+    uint32_t periodUSec;            // Period, 0 runs the task on every pass
+    uint32_t budgetUSec;            // Time budget of one run
+    SchedulerPriority priority;     // Order within a pass
+    uint32_t dueTimeUSec;           // Next due time
+    SchedulerTaskStats stats;       // Run statistics
+};
+
+class Scheduler
+{
+public:
+    Scheduler();
+
+    int addTask(const char *name, SchedulerTaskCallback callback, ulong periodMSec,
+                SchedulerPriority priority, ulong budgetUSec);
+    void service();
+    void resetStats();
+
+    uint getTaskCount() const;
+    const SchedulerTask *getTask(uint index) const;
+    uint32_t getOverrunCount() const;
+    uint32_t getMaxPassTimeUSec() const;
+    const char *getRunningTaskName() const;
+
+    static uint getHistogramBucket(uint32_t valueUSec);
+
+private:
+    SchedulerTask m_tasks[SCHEDULER_MAX_TASKS]; // Task table, sorted by priority
+    uint m_taskCount;                           // Registered tasks
+    uint32_t m_overrunCount;                    // Overruns over all tasks
+    uint32_t m_maxPassTimeUSec;                 // Longest pass
+    const char *volatile m_runningTaskName;     // Task in progress, nullptr between tasks
+
+    void runTask(SchedulerTask &task, uint32_t startUSec);
+};
+
+#endif // SCHEDULER_H
@@ -1,20 +1,18 @@
 #include "temperaturecontroller.h"
 
-TemperatureController::TemperatureController(ControllerStatus &status, Configuration &config, Blower &blower, Door &door)
-    : m_status(status), m_config(config), m_blower(blower), m_door(door),
-      m_algorithm(CONTROL_PID), m_pid(config.kP, config.kI, config.kD, config.temperatureIntervalMSec),
-      m_bangBang(config.bangBangLowThreshold, config.bangBangHighThreshold, config.bangBangHysteresis)
+TemperatureController::TemperatureController(ControllerStatus &status, Configuration &config, Actuators &actuators)
+    : m_status(status), m_config(config), m_actuators(actuators),
+      m_algorithm(CONTROL_ALGORITHM_COUNT) // Forces a strategy reset on the first service
 {
     m_lastServiceTimeMSec = 0;
-    m_pid.enable(); // Enable PID controller by default
     m_lastOutput = 0;
+    m_lidState = LID_STATE_CLOSED;
+    m_heldBlowerAirflow = 0;
 }
 
 void TemperatureController::service(int currentTempF, ulong currentTimeMSec)
 {
 
-    BangBangState controlOutput;
-
 #ifdef DEBUG_TEMPERATURE_CONTROLLER
     DEBUG_PRINTLN();
     DEBUG_PRINTLN("TC::service() - Entry");
@@ -27,39 +25,67 @@ void TemperatureController::service(int currentTempF, ulong currentTimeMSec)
     }
     m_lastServiceTimeMSec = currentTimeMSec;
 
-    // Check for updated configuration values
-    m_bangBang.setThresholds(m_config.bangBangLowThreshold, m_config.bangBangHighThreshold);
-    m_bangBang.setHysteresis(m_config.bangBangHysteresis);
-    m_pid.setKp(m_config.kP);
-    m_pid.setKi(m_config.kI);
-    m_pid.setKd(m_config.kD);
-
-    // Figure out which control algorithm to use - may get more complicated later
-    if (m_config.isPIDEnabled)
+    // Look for lid-open disturbances before anything reacts to the sample
+    m_lidDetector.setParameters(m_config.isLidDetectionEnabled, m_config.lidOpenRateFPerMin, m_config.lidCloseRateFPerMin,
+                                m_config.lidMaxOpenMSec, m_config.lidRecoveryMSec);
+    LidState lidState = m_lidDetector.update(currentTempF, m_status.temperatureTarget, currentTimeMSec);
+    if (lidState == LID_STATE_OPEN && m_lidState == LID_STATE_CLOSED)
     {
-        m_algorithm = CONTROL_PID;
+        m_heldBlowerAirflow = m_actuators.getBlowerAirflow(); // Recovery ramps up from the output held during the event
     }
-    else
+    m_lidState = lidState;
+
+    m_fireMonitor.setParameters(m_config.isFireDetectionEnabled, m_config.fireDetectMSec);
+
+    // Feed the plant identifier with the sample and the actuator state applied over the interval ending
+    // with it, the output of this pass is only demanded below. A lid event is a disturbance the model
+    // should not learn from
+    if (lidState == LID_STATE_CLOSED)
     {
-        m_algorithm = CONTROL_BANGBANG;
+        float doorRange = static_cast<float>(m_config.doorOpenPosition - m_config.doorClosePosition) * 10.0f;
+        float doorFraction = doorRange > 0 ? (m_actuators.getDoorPositionTenths() - m_config.doorClosePosition * 10) / doorRange : 0.0f;
+        m_plantIdentifier.update(currentTempF, m_actuators.getBlowerAirflow(), doorFraction, currentTimeMSec);
     }
 
-    switch (m_algorithm)
+    // Reset the strategy when the configured algorithm changes so it starts from a clean state
+    const ControlStrategy &strategy = getControlStrategy(m_config.controlAlgorithm);
+    if (m_config.controlAlgorithm != m_algorithm)
     {
-    case CONTROL_PID:
+#ifdef DEBUG_TEMPERATURE_CONTROLLER
+        DEBUG_PRINTLN("TC::service() - Switching to " + String(strategy.name));
+#endif
+        strategy.reset(m_config);
+        m_algorithm = m_config.controlAlgorithm;
+    }
 
-        servicePIDController(currentTempF, m_status.temperatureTarget, currentTimeMSec);
-        break;
+    // Keep the integral out of the error caused by the open lid, until the pit has recovered
+    freezeIntegrator(strategy, lidState != LID_STATE_CLOSED);
+    if (lidState == LID_STATE_OPEN)
+    {
+#ifdef DEBUG_TEMPERATURE_CONTROLLER
+        DEBUG_PRINTLN("TC::service() - Lid open, holding the actuators");
+#endif
+        m_fireMonitor.update(currentTempF, m_status.temperatureTarget, m_actuators.getBlowerAirflow(), lidState, currentTimeMSec);
+        return; // Hold the actuators at their current state
+    }
 
-    case CONTROL_BANGBANG:
+    // Dispatch through the strategy table and demand the actuator state, the actuator layer drops repeats
+    ControlOutput output = strategy.service(m_config, currentTempF, m_status.temperatureTarget, currentTimeMSec);
+    m_lastOutput = output.output; // Store the last output for reference
 
-        serviceBangBangController(currentTempF, m_status.temperatureTarget, currentTimeMSec);
+    if (lidState == LID_STATE_RECOVERING)
+    {
+        // Ramp the blower limit from the held output to full scale over the recovery time
+        float fraction = m_lidDetector.getRecoveryFraction(currentTimeMSec);
+        int limitAirflow = m_heldBlowerAirflow + static_cast<int>((BLOWER_MAX_PWM - m_heldBlowerAirflow) * fraction);
+        output.blowerAirflow = min(output.blowerAirflow, limitAirflow);
+    }
 
-        break;
+    // Watch for a fire that no longer answers a saturated output
+    m_fireMonitor.update(currentTempF, m_status.temperatureTarget, output.blowerAirflow, lidState, currentTimeMSec);
 
-    default:
-        break;
-    }
+    m_actuators.setBlowerAirflow(output.blowerAirflow);
+    m_actuators.setDoorAirflow(output.doorAirflow);
 
 #ifdef DEBUG_TEMPERATURE_CONTROLLER
     DEBUG_PRINTLN("TC::service() - Exit");
@@ -71,60 +97,51 @@ int TemperatureController::getLastOutput()
     return m_lastOutput;
 }
 
-void TemperatureController::serviceBangBangController(int currentTempF, int targetTempF, ulong currentTimeMSec)
+PlantModel TemperatureController::getPlantModel() const
 {
-    BangBangState controlOutput = m_bangBang.service(currentTempF, currentTimeMSec);
-    m_lastOutput = static_cast<int>(controlOutput); // Store the last output for reference
-    switch (controlOutput)
-    {
-    case BANGBANG_STATE_IDLE:
-        // If the state is IDLE, stop the blower and set door position
-        m_blower.setPWM(0);
-        m_door.open();
-        break;
-    case BANGBANG_STATE_HEAT:
-        // If the state is HEAT, start the blower and open the door
-        m_blower.setPWM(m_config.bangBangFanSpeed);
-        m_door.open();
-        break;
-    case BANGBANG_STATE_COOL:
-        // If the state is COOL, stop the blower and close the door
-        m_blower.setPWM(0);
-        m_door.close();
-        break;
-    default:
-        break;
-    }
+    return m_plantIdentifier.getModel();
 }
 
-void TemperatureController::servicePIDController(int currentTempF, int targetTempF, ulong currentTimeMSec)
+const LidDetector &TemperatureController::getLidDetector() const
 {
+    return m_lidDetector;
+}
 
-    // Call the PID service to calculate the control output
-    int controlOutput = m_pid.service(currentTempF, targetTempF, currentTimeMSec);
-    m_lastOutput = controlOutput; // Store the last output for reference
-#ifdef DEBUG_TEMPERATURE_CONTROLLER
-    DEBUG_PRINTLN("TC::PID - CONTROL: " + String(controlOutput));
-#endif
+const FireMonitor &TemperatureController::getFireMonitor() const
+{
+    return m_fireMonitor;
+}
+
+bool TemperatureController::getIntegrator(ControlAlgorithm &algorithm, float &integrator) const
+{
+    // Nothing to checkpoint before the first service or for a strategy without integral action
+    if (m_algorithm == CONTROL_ALGORITHM_COUNT)
+        return false;
+    const ControlStrategy &strategy = getControlStrategy(m_algorithm);
+    if (!strategy.getIntegrator)
+        return false;
+
+    algorithm = m_algorithm;
+    integrator = strategy.getIntegrator();
+    return true;
+}
 
-    // Check whether the blower or the door should be activated
-    if (controlOutput > 0)
+void TemperatureController::restoreIntegrator(float integrator)
+{
+    // Reset here for the configured algorithm, the first service must not clear the restored value
+    const ControlStrategy &strategy = getControlStrategy(m_config.controlAlgorithm);
+    strategy.reset(m_config);
+    m_algorithm = m_config.controlAlgorithm;
+    if (strategy.setIntegrator)
     {
-#ifdef DEBUG_TEMPERATURE_CONTROLLER
-        DEBUG_PRINTLN("TC::PID - HEATING");
-#endif
-        // Truncate the control output to the range of 0-255
-        controlOutput = constrain(controlOutput, 0, 255);
-        m_blower.setPWM(controlOutput);
-        m_door.open();
+        strategy.setIntegrator(integrator);
     }
-    else
+}
+
+void TemperatureController::freezeIntegrator(const ControlStrategy &strategy, bool isFrozen)
+{
+    if (strategy.freezeIntegrator)
     {
-#ifdef DEBUG_TEMPERATURE_CONTROLLER
-        DEBUG_PRINTLN("TC::PID - COOLING");
-#endif
-        // If the control output is less than or equal to 0, stop the blower and close the door
-        m_blower.setPWM(0);
-        m_door.close();
+        strategy.freezeIntegrator(isFrozen);
     }
 }
@@ -3,40 +3,40 @@
 
 #include <Arduino.h>
 #include "types.h"
-#include "pid.h"
-#include "bangbang.h"
-#include "blower.h"
-#include "door.h"
+#include "controlstrategy.h"
+#include "actuator.h"
+#include "plantidentifier.h"
+#include "liddetector.h"
+#include "firemonitor.h"
 
 // #define DEBUG_TEMPERATURE_CONTROLLER
 
-enum ControlAlgorithm
-{
-    CONTROL_PID,
-    CONTROL_BANGBANG
-};
-
 class TemperatureController
 {
 private:
-    ControllerStatus &m_status;   // Reference to the controller status
-    Configuration &m_config;      // Reference to the configuration
-    Blower &m_blower;             // Reference to the blower motor
-    Door &m_door;                 // Reference to the door servo
-    ControlAlgorithm m_algorithm; // Current control algorithm
-    PID m_pid;                    // PID controller instance
-    BangBang m_bangBang;          // Bang-Bang controller instance
-    ulong m_lastServiceTimeMSec;  // Last service time in milliseconds
-    int m_lastOutput;             // Last output value from the controller
+    ControllerStatus &m_status;        // Reference to the controller status
+    Configuration &m_config;           // Reference to the configuration
+    Actuators &m_actuators;            // Reference to the blower and door command layer
+    ControlAlgorithm m_algorithm;      // Control algorithm the active strategy was reset for
+    ulong m_lastServiceTimeMSec;       // Last service time in milliseconds
+    int m_lastOutput;                  // Last output value from the controller
+    PlantIdentifier m_plantIdentifier; // Online identification of the smoker response
+    LidDetector m_lidDetector;         // Lid-open disturbance detection
+    LidState m_lidState;               // Lid state at the previous service
+    int m_heldBlowerAirflow;           // Blower airflow held when the lid opened, start of the recovery ramp
+    FireMonitor m_fireMonitor;         // Stalled and exhausted fire detection
 
-    void servicePIDController(int currentTempF, int targetTempF, ulong currentTimeMSec);
-    void serviceBangBangController(int currentTempF, int targetTempF, ulong currentTimeMSec);
+    void freezeIntegrator(const ControlStrategy &strategy, bool isFrozen);
 
 public:
-    TemperatureController(ControllerStatus &status, Configuration &config, Blower &blower, Door &door);
-    void setControlAlgorithm(ControlAlgorithm algo);
+    TemperatureController(ControllerStatus &status, Configuration &config, Actuators &actuators);
     void service(int currentTempF, ulong currentTimeMSec);
     int getLastOutput();
+    PlantModel getPlantModel() const;
+    const LidDetector &getLidDetector() const;
+    const FireMonitor &getFireMonitor() const;
+    bool getIntegrator(ControlAlgorithm &algorithm, float &integrator) const;
+    void restoreIntegrator(float integrator);
 };
 
 #endif // TEMPERATURE_CONTROLLER_H
@@ -84,7 +84,10 @@ void Thermometer::read()
         simulateTemperature();
     }
 
-    m_isNewTemperatureAvailable = true;
+    if (m_eventBus != nullptr)
+    {
+        m_eventBus->publish(EVENT_SAMPLE_READY, m_eventSource, m_temperatureF);
+    }
 }
 
 int Thermometer::getTemperatureC()
@@ -107,17 +110,10 @@ ulong Thermometer::getInterval()
     return m_intervalMSec;
 }
 
-bool Thermometer::isNewTemperatureAvailable()
+void Thermometer::setEventBus(EventBus *eventBus, EventSource source)
 {
-    if (m_isNewTemperatureAvailable)
-    {
-        m_isNewTemperatureAvailable = false;
-        return true;
-    }
-    else
-    {
-        return false;
-    }
+    m_eventBus = eventBus;
+    m_eventSource = source;
 }
 
 void Thermometer::setCalibration(float gain, float offset)
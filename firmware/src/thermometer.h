@@ -5,6 +5,7 @@
 #include <SPI.h>
 #include "types.h"
 #include "debug.h"
+#include "eventbus.h"
 
 // #define THERMOMETER_DEBUG
 
@@ -25,9 +26,11 @@ private:
     float m_gain;
     float m_offset;
 
-    bool m_isNewTemperatureAvailable;
     bool m_isSimulated = false;
 
+    EventBus *m_eventBus = nullptr;                // Receives a sample ready event for every reading
+    EventSource m_eventSource = EVENT_SOURCE_NONE; // Source of the sample ready events
+
     void simulateTemperature();
 
 public:
@@ -39,7 +42,7 @@ public:
     void service(ulong currentTimeMSec);
     void setInterval(ulong intervalMsec);
     ulong getInterval();
-    bool isNewTemperatureAvailable();
+    void setEventBus(EventBus *eventBus, EventSource source);
     void setCalibration(float gain, float offset);
     void setSimulated(bool isSimulated);
 };
@@ -12,46 +12,129 @@ enum TempProfileType
     TEMP_PROFILE_TYPE_RAMP
 };
 
+// Conditions a profile step advances on, combined with any or all
+enum TempProfileAdvance : uint8_t
+{
+    TEMP_PROFILE_ADVANCE_TIME = 0x01,     // Step time elapsed
+    TEMP_PROFILE_ADVANCE_FOOD = 0x02,     // Food probe at the step food temperature
+    TEMP_PROFILE_ADVANCE_PIT_HOLD = 0x04, // Pit held in the profile band around the target for the hold time
+    TEMP_PROFILE_ADVANCE_ALL = 0x07       // Every condition
+};
+
 struct TempProfileStep
 {
-    ulong timeMSec;        // Time in milliseconds for this step
-    TempProfileType type;  // Type of the step (dwell or ramp)
-    int temperatureStartF; // Temperature in degrees F for this step
-    int temperatureEndF;   // Temperature in degrees F for this step
+    ulong timeMSec;            // Time in milliseconds for this step
+    TempProfileType type;      // Type of the step (dwell or ramp)
+    int temperatureStartF;     // Temperature in degrees F for this step
+    int temperatureEndF;       // Temperature in degrees F for this step
+    uint8_t advanceConditions; // TempProfileAdvance flags, a step without the time flag holds its end temperature until they are met
+    bool isAdvanceOnAll;       // All conditions must be met, any one of them otherwise
+    int advanceFoodF;          // Food temperature of TEMP_PROFILE_ADVANCE_FOOD
+    ulong advancePitHoldMSec;  // Hold time of TEMP_PROFILE_ADVANCE_PIT_HOLD
 };
 
 #define MAX_PROFILE_STEPS 10
+#define MAX_PROFILE_TABLE_STEPS 64  // Steps of the profile table stored apart from the configuration
+#define BLOWER_CALIBRATION_POINTS 8 // PWM levels of the blower airflow characterization
+#define DOOR_AIRFLOW_POINTS 9       // Airflow points of the door position map
+
+// Long profile in a file of its own, it takes over from the configured steps once it holds any
+struct TempProfileTable
+{
+    int stepsCount;                                 // Number of steps, 0 runs the configured steps
+    TempProfileStep steps[MAX_PROFILE_TABLE_STEPS]; // Profile steps
+};
+
+// Stored in the configuration, the values match the legacy isPIDEnabled flag (false/true)
+enum ControlAlgorithm : uint8_t
+{
+    CONTROL_BANGBANG,
+    CONTROL_PID,
+    CONTROL_ALGORITHM_COUNT
+};
+
+// Over-the-air updates while a cook is running, see otaupdater.h
+enum OTAPolicy : uint8_t
+{
+    OTA_POLICY_ALLOW,  // Accepted at any time
+    OTA_POLICY_DEFER,  // Requests held until the cook ends
+    OTA_POLICY_REFUSE, // Listener closed until the cook ends
+    OTA_POLICY_COUNT
+};
+
+#define STATUS_UUID_LENGTH 37         // Canonical UUID and the terminator
+#define STATUS_IP_ADDRESS_LENGTH 16   // Dotted IPv4 address and the terminator
+#define STATUS_NETWORK_NAME_LENGTH 33 // Longest SSID and the terminator
+#define STATUS_TASK_NAME_LENGTH 16    // Scheduler task name and the terminator
 
 struct RunningStatus
 {
     bool isRunning;
-    String uuid;
+    char uuid[STATUS_UUID_LENGTH];
 };
 
 struct ControllerStatus
 {
     bool isRunning;
-    String uuid;
+    char uuid[STATUS_UUID_LENGTH];
     ulong uptime;
     ulong controllerStartMSec;
     int temperatureSmoker;
     int temperatureFood;
     int temperatureTarget;
     int fanPWM;
+    int blowerOutputPWM;           // Duty applied by the blower driver after kick-start and slew limiting
+    int blowerKickCount;           // Kick-start pulses since boot
+    bool isBlowerCalibrating;      // Airflow calibration sweep in progress, set to start or abort a sweep
+    int blowerCalibrationState;    // Last calibration sweep state (BlowerCalibrationState)
+    int blowerCalibrationProgress; // Calibration sweep progress in percent
     int doorPosition;
     int RSSI;
     int bars;
-    String ipAddress;
+    char ipAddress[STATUS_IP_ADDRESS_LENGTH];
     bool isWiFiConnected;
-    String networkName;
+    char networkName[STATUS_NETWORK_NAME_LENGTH];
     int temperatureError;
     int isProfileRunning;                       // 0 - not running, 1 - running, 2 - finished
     int temperatureProfileStepIndex;            // Current step index in the temperature profile, -1 means no active profile
     int temperatureProfileStartTimeMSec;        // Start time of the current temperature profile step
     int temperatureProfileStepsCount;           // Number of steps in the temperature profile
     TempProfileType temperatureProfileStepType; // Type of the current temperature profile step
+    bool isProfileStepHolding;                  // Step time over, waiting for its advance conditions
+    bool isPlantModelValid;                     // True when the identified plant model can be used
+    float plantGain;                            // Identified blower gain (F per 100% blower)
+    float plantTimeConstantSec;                 // Identified time constant in seconds
+    float plantDeadTimeSec;                     // Identified dead time in seconds
+    ulong blowerCommandsIssued;                 // Blower commands sent to the driver
+    ulong blowerCommandsSuppressed;             // Blower demands dropped by the actuator layer
+    ulong doorCommandsIssued;                   // Door commands sent to the driver
+    ulong doorCommandsSuppressed;               // Door demands dropped by the actuator layer
+    int lidState;                               // 0 - closed, 1 - open, 2 - recovering
+    uint lidEventCount;                         // Number of lid-open events since boot
+    ulong lastLidEventStartMSec;                // Start of the last lid-open event
+    ulong lastLidEventDurationMSec;             // Time the lid was open during the last event
+    int lastLidEventDropF;                      // Temperature drop during the last event
+    bool isFireAlarm;                           // True while a fire alarm is raised
+    int fireAlarm;                              // 0 - none, 1 - fire stalled, 2 - fire out
+    ulong fireAlarmStartMSec;                   // Time the current fire alarm was raised
+    bool isFoodStalled;                         // Food temperature on a stall plateau
+    bool isCookDone;                            // Food reached the finish temperature
+    float foodRateFPerHour;                     // Fitted food temperature rise rate
+    long cookEtaSec;                            // Predicted time to the finish temperature, -1 when unknown
+    long cookEtaLowSec;                         // Early end of the prediction band, -1 when unknown
+    long cookEtaHighSec;                        // Late end of the prediction band, -1 when unbounded
+    ulong schedulerOverrunCount;                // Task runs longer than their budget
+    ulong schedulerMaxPassTimeUSec;             // Longest main loop pass
+    bool isFailSafe;                            // Actuators held in the fail-safe state after a missed deadline
+    ulong failSafeTripCount;                    // Control loop deadline misses since boot
+    char failSafeTask[STATUS_TASK_NAME_LENGTH]; // Task running at the last miss, empty between two tasks
+    ulong failSafeStartMSec;                    // Last on time pass before the last miss
+    ulong failSafeStallMSec;                    // Duration of the last stall
+    bool isRunResumed;                          // Cook resumed from a run checkpoint at boot
+    long resumedAgeSec;                         // Age of the checkpoint resumed from, -1 when unknown
 };
 
+// A new field goes into the field table of controlchannel.cpp as well, configuration patches copy fields by it
 struct Configuration
 {
     int temperatureTarget;
@@ -60,8 +143,9 @@ struct Configuration
     bool isTemperatureProfilingEnabled;
     TempProfileStep temperatureProfile[MAX_PROFILE_STEPS];
     int temperatureProfileStepsCount;
+    int profilePitBandF; // Pit band around the target of TEMP_PROFILE_ADVANCE_PIT_HOLD
 
-    bool isPIDEnabled;
+    ControlAlgorithm controlAlgorithm;
     float kP;
     float kI;
     float kD;
@@ -71,8 +155,39 @@ struct Configuration
     int bangBangHysteresis;
     int bangBangFanSpeed;
 
+    int blowerPWMFrequencyHz;                              // Blower PWM carrier frequency
+    int blowerKickStartMSec;                               // Full duty pulse when starting from standstill, 0 disables the kick
+    int blowerSlewPWMPerSec;                               // Blower duty slew limit, 0 disables the limit
+    bool isBlowerAirflowCalibrated;                        // Use the measured airflow table, the map is linear otherwise
+    uint8_t blowerAirflowTable[BLOWER_CALIBRATION_POINTS]; // Normalized airflow at each calibration PWM level
+
     int doorOpenPosition;
     int doorClosePosition;
+    int doorMaxSpeedDegPerSec;                     // Door cruise speed
+    int doorAccelDegPerSec2;                       // Door acceleration and deceleration
+    bool isDoorAirflowMapEnabled;                  // Map door airflow demands through the table, linear otherwise
+    uint8_t doorAirflowTable[DOOR_AIRFLOW_POINTS]; // Door travel (0-255) at evenly spaced airflows
+
+    int actuatorBlowerDeadbandPWM;      // Blower PWM changes smaller than this are not sent
+    int actuatorBlowerMinDwellMSec;     // Minimum time between two blower commands
+    int actuatorBlowerMaxRatePWMPerSec; // Blower PWM slew limit, 0 disables the limit
+    int actuatorDoorDeadbandDeg;        // Door position changes smaller than this are not sent
+    int actuatorDoorMinDwellMSec;       // Minimum time between two door commands
+    int actuatorDoorMaxRateDegPerSec;   // Door slew limit, 0 disables the limit
+
+    bool isLidDetectionEnabled; // Hold the actuators and freeze the integrator on lid-open events
+    int lidOpenRateFPerMin;     // Falling slope that marks a lid-open event
+    int lidCloseRateFPerMin;    // Rising slope that marks the lid closing
+    int lidMaxOpenMSec;         // Longest time the actuators are held
+    int lidRecoveryMSec;        // Output ramp length after the lid closes
+
+    int foodFinishTemperatureF; // Food temperature the completion time is predicted for
+
+    bool isFireDetectionEnabled; // Raise an alarm when the fire stops answering a saturated output
+    int fireDetectMSec;          // Saturation time before a stalled fire is reported
+
+    int deadlineMissedPeriods; // Missed control periods before the actuators are put in the fail-safe state
+    int failSafeDoorPosition;  // Door position held in the fail-safe state
 
     float themometerSmokerGain;
     float themometerSmokerOffset;
@@ -90,6 +205,10 @@ struct Configuration
     bool isWiFiEnabled;    // Flag to indicate if WiFi is enabled
     char wifiSSID[65];     // WiFi SSID
     char wifiPassword[65]; // WiFi Password
+    OTAPolicy otaPolicy;   // OTA updates while a cook is running
+
+    int resumeWindowMin;                // Longest reset a cook resumes after, 0 disables the resume
+    bool isResumeAfterPowerLossEnabled; // Resume after a power-on reset, the outage length is unknown then
 
     bool isTemperatureFilterEnabled; // Flag to indicate if the temperature filter is enabled
     float temperatureFilterCoeff;    // Coefficient for the temperature filter (0.0 - 1.0)
@@ -1,7 +1,43 @@
 #include "webserver.h"
 
-WebServer::WebServer(uint16_t port, ControllerStatus &status, Configuration &config)
-    : m_server(port), m_status(status), m_config(config)
+// Status page around the status rows, kept in flash
+static const char ROOT_PAGE_HEAD[] = R"rawliteral(
+    <!DOCTYPE html>
+    <html>
+    <head>
+        <title>SmokeMATE Status</title>
+        <meta name="viewport" content="width=device-width, initial-scale=1">
+        <style>
+            body { background: #000; color: #fff; font-family: 'Segoe UI', Arial, sans-serif; margin: 0; }
+            .container { max-width: 420px; margin: 40px auto; background: #222; border-radius: 16px; box-shadow: 0 4px 16px #0008; padding: 24px; }
+            h1 { text-align: center; color: #ff6600; margin-bottom: 24px; }
+            .status-table { width: 100%; border-collapse: separate; border-spacing: 0 8px; }
+            .status-table td { padding: 8px 12px; border-radius: 8px; }
+            .label { color: #aaa; text-align: left; }
+            .value { color: #fff; font-weight: bold; text-align: right; }
+            .accent { color: #0083FE; }
+            .footer { text-align: center; margin-top: 24px; color: #666; font-size: 0.9em; }
+            .wifi { color: #00FFD0; }
+            .running { color: #008610; }
+            .stopped { color: #ff6600; }
+        </style>
+    </head>
+    <body>
+        <div class="container">
+            <h1>SmokeMATE</h1>
+            <table class="status-table">
+                <tr><td class="label">Status</td><td class="value )rawliteral";
+
+static const char ROOT_PAGE_TAIL[] = R"rawliteral(
+            </table>
+            <div class="footer">SmokeMATE &copy; 2025</div>
+        </div>
+    </body>
+    </html>
+    )rawliteral";
+
+WebServer::WebServer(uint16_t port, ControlChannel &channel)
+    : m_server(port), m_channel(channel)
 
 {
 }
@@ -23,7 +59,12 @@ void WebServer::setConfigSetCallback(ConfigSetCallback cb)
 
 void WebServer::begin()
 {
-    setupRoutes();
+    // Called on every WiFi connection, the routes are added once and a listening server is kept
+    if (!m_isRouted)
+    {
+        setupRoutes();
+        m_isRouted = true;
+    }
     m_server.begin();
 }
 
@@ -32,17 +73,21 @@ void WebServer::end()
     m_server.end();
 }
 
-bool WebServer::isNVRAMSaveRequired()
+void WebServer::setSchedulers(Scheduler *controlScheduler, Scheduler *uiScheduler)
 {
-    if (m_isNVRAMSaveRequired)
-    {
-        m_isNVRAMSaveRequired = false; // Reset the flag after checking
-        return true;                   // Indicate that NVRAM save is required
-    }
-    else
-    {
-        return false; // No NVRAM save required
-    }
+    m_controlScheduler = controlScheduler;
+    m_uiScheduler = uiScheduler;
+}
+
+void WebServer::setEventBuses(EventBus *controlEventBus, EventBus *uiEventBus)
+{
+    m_controlEventBus = controlEventBus;
+    m_uiEventBus = uiEventBus;
+}
+
+void WebServer::setOTAUpdater(const OTAUpdater *otaUpdater)
+{
+    m_otaUpdater = otaUpdater;
 }
 
 void WebServer::setupRoutes()
@@ -70,66 +115,75 @@ void WebServer::setupRoutes()
     m_server.on("/stop", HTTP_POST, [this](AsyncWebServerRequest *request)
                 { handleApiControllerStop(request); });
 
+    m_server.on("/blower/calibrate", HTTP_POST, [this](AsyncWebServerRequest *request)
+                { handleApiBlowerCalibrationStart(request); });
+
+    m_server.on("/blower/calibrate/stop", HTTP_POST, [this](AsyncWebServerRequest *request)
+                { handleApiBlowerCalibrationStop(request); });
+
+    m_server.on("/scheduler", HTTP_GET, [this](AsyncWebServerRequest *request)
+                { handleApiSchedulerGet(request); });
+
+    m_server.on("/scheduler/reset", HTTP_POST, [this](AsyncWebServerRequest *request)
+                { handleApiSchedulerReset(request); });
+
+    m_server.on("/events", HTTP_GET, [this](AsyncWebServerRequest *request)
+                { handleApiEventsGet(request); });
+
+    m_server.on("/profile", HTTP_GET, [this](AsyncWebServerRequest *request)
+                { handleApiProfileGet(request); });
+
+    m_server.on("/profile", HTTP_POST, [this](AsyncWebServerRequest *request)
+                {
+                    // This will be handled in the onRequestBody callback
+                },
+                NULL, [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+                { handleApiProfileSet(request, data, len, index, total); });
+
+    m_server.on("/debug/heap", HTTP_GET, [this](AsyncWebServerRequest *request)
+                { handleDebugHeap(request); });
+
+    m_server.on("/debug/heap/reset", HTTP_POST, [this](AsyncWebServerRequest *request)
+                { handleDebugHeapReset(request); });
+
+#ifdef ENABLE_METRICS
+    m_server.on("/metrics", HTTP_GET, [this](AsyncWebServerRequest *request)
+                { handleMetrics(request); });
+
+    m_server.on("/metrics/reset", HTTP_POST, [this](AsyncWebServerRequest *request)
+                { handleMetricsReset(request); });
+#endif
+
     // REST API endpoints will be added here
 }
 
 void WebServer::handleRoot(AsyncWebServerRequest *request)
 {
+    m_channel.readStatus(m_status);
     const ControllerStatus &s = m_status;
-    String html = R"rawliteral(
-    <!DOCTYPE html>
-    <html>
-    <head>
-        <title>SmokeMATE Status</title>
-        <meta name="viewport" content="width=device-width, initial-scale=1">
-        <style>
-            body { background: #000; color: #fff; font-family: 'Segoe UI', Arial, sans-serif; margin: 0; }
-            .container { max-width: 420px; margin: 40px auto; background: #222; border-radius: 16px; box-shadow: 0 4px 16px #0008; padding: 24px; }
-            h1 { text-align: center; color: #ff6600; margin-bottom: 24px; }
-            .status-table { width: 100%; border-collapse: separate; border-spacing: 0 8px; }
-            .status-table td { padding: 8px 12px; border-radius: 8px; }
-            .label { color: #aaa; text-align: left; }
-            .value { color: #fff; font-weight: bold; text-align: right; }
-            .accent { color: #0083FE; }
-            .footer { text-align: center; margin-top: 24px; color: #666; font-size: 0.9em; }
-            .wifi { color: #00FFD0; }
-            .running { color: #008610; }
-            .stopped { color: #ff6600; }
-        </style>
-    </head>
-    <body>
-        <div class="container">
-            <h1>SmokeMATE</h1>
-            <table class="status-table">
-                <tr><td class="label">Status</td><td class="value )rawliteral";
-    html += s.isRunning ? "running" : "stopped";
-    html += "\">";
-    html += s.isRunning ? "RUNNING" : "STOPPED";
-    html += "</td></tr>";
-
-    html += "<tr><td class=\"label\">Uptime</td><td class=\"value\">" + String(s.uptime / 1000) + " s</td></tr>";
-    html += "<tr><td class=\"label\">Smoker Temp</td><td class=\"value accent\">" + String(s.temperatureSmoker) + " &deg;F</td></tr>";
-    html += "<tr><td class=\"label\">Food Temp</td><td class=\"value accent\">" + String(s.temperatureFood) + " &deg;F</td></tr>";
-    html += "<tr><td class=\"label\">Target Temp</td><td class=\"value accent\">" + String(s.temperatureTarget) + " &deg;F</td></tr>";
-    html += "<tr><td class=\"label\">Fan PWM</td><td class=\"value\">" + String(s.fanPWM) + " / 255</td></tr>";
-    html += "<tr><td class=\"label\">Door Position</td><td class=\"value\">" + String(s.doorPosition) + " &deg;</td></tr>";
-    html += "<tr><td class=\"label\">WiFi</td><td class=\"value wifi\">" + String(s.isWiFiConnected ? "Connected" : "Disconnected") + "</td></tr>";
-    html += "<tr><td class=\"label\">IP Address</td><td class=\"value wifi\">" + s.ipAddress + "</td></tr>";
-    html += "<tr><td class=\"label\">RSSI</td><td class=\"value wifi\">" + String(s.RSSI) + " dBm (bars: " + String(s.bars) + ")</td></tr>";
-
-    html += R"rawliteral(
-            </table>
-            <div class="footer">SmokeMATE &copy; 2025</div>
-        </div>
-    </body>
-    </html>
-    )rawliteral";
 
-    request->send(200, "text/html", html);
+    // Streamed into the response buffer, no page sized String is built
+    AsyncResponseStream *response = request->beginResponseStream("text/html");
+    response->print(ROOT_PAGE_HEAD);
+    response->printf("%s\">%s</td></tr>", s.isRunning ? "running" : "stopped", s.isRunning ? "RUNNING" : "STOPPED");
+
+    response->printf("<tr><td class=\"label\">Uptime</td><td class=\"value\">%lu s</td></tr>", s.uptime / 1000);
+    response->printf("<tr><td class=\"label\">Smoker Temp</td><td class=\"value accent\">%d &deg;F</td></tr>", s.temperatureSmoker);
+    response->printf("<tr><td class=\"label\">Food Temp</td><td class=\"value accent\">%d &deg;F</td></tr>", s.temperatureFood);
+    response->printf("<tr><td class=\"label\">Target Temp</td><td class=\"value accent\">%d &deg;F</td></tr>", s.temperatureTarget);
+    response->printf("<tr><td class=\"label\">Fan PWM</td><td class=\"value\">%d / 255</td></tr>", s.fanPWM);
+    response->printf("<tr><td class=\"label\">Door Position</td><td class=\"value\">%d &deg;</td></tr>", s.doorPosition);
+    response->printf("<tr><td class=\"label\">WiFi</td><td class=\"value wifi\">%s</td></tr>", s.isWiFiConnected ? "Connected" : "Disconnected");
+    response->printf("<tr><td class=\"label\">IP Address</td><td class=\"value wifi\">%s</td></tr>", s.ipAddress);
+    response->printf("<tr><td class=\"label\">RSSI</td><td class=\"value wifi\">%d dBm (bars: %d)</td></tr>", s.RSSI, s.bars);
+
+    response->print(ROOT_PAGE_TAIL);
+    request->send(response);
 }
 
 void WebServer::handleApiStatus(AsyncWebServerRequest *request)
 {
+    m_channel.readStatus(m_status);
     const ControllerStatus &s = m_status;
     StaticJsonDocument<STATIC_JSON_DOCUMENT_SIZE> doc;
 
@@ -141,6 +195,11 @@ void WebServer::handleApiStatus(AsyncWebServerRequest *request)
     doc["temperatureFood"] = s.temperatureFood;
     doc["temperatureTarget"] = s.temperatureTarget;
     doc["fanPWM"] = s.fanPWM;
+    doc["blowerOutputPWM"] = s.blowerOutputPWM;
+    doc["blowerKickCount"] = s.blowerKickCount;
+    doc["isBlowerCalibrating"] = s.isBlowerCalibrating;
+    doc["blowerCalibrationState"] = s.blowerCalibrationState;
+    doc["blowerCalibrationProgress"] = s.blowerCalibrationProgress;
     doc["doorPosition"] = s.doorPosition;
     doc["RSSI"] = s.RSSI;
     doc["bars"] = s.bars;
@@ -153,16 +212,59 @@ void WebServer::handleApiStatus(AsyncWebServerRequest *request)
     doc["temperatureProfileStartTimeMSec"] = s.temperatureProfileStartTimeMSec;
     doc["temperatureProfileStepsCount"] = s.temperatureProfileStepsCount;
     doc["temperatureProfileStepType"] = static_cast<int>(s.temperatureProfileStepType); // Convert enum to int
+    doc["isProfileStepHolding"] = s.isProfileStepHolding;
+    doc["isPlantModelValid"] = s.isPlantModelValid;
+    doc["plantGain"] = s.plantGain;
+    doc["plantTimeConstantSec"] = s.plantTimeConstantSec;
+    doc["plantDeadTimeSec"] = s.plantDeadTimeSec;
+    doc["blowerCommandsIssued"] = s.blowerCommandsIssued;
+    doc["blowerCommandsSuppressed"] = s.blowerCommandsSuppressed;
+    doc["doorCommandsIssued"] = s.doorCommandsIssued;
+    doc["doorCommandsSuppressed"] = s.doorCommandsSuppressed;
+    doc["lidState"] = s.lidState;
+    doc["lidEventCount"] = s.lidEventCount;
+    doc["lastLidEventStartMSec"] = s.lastLidEventStartMSec;
+    doc["lastLidEventDurationMSec"] = s.lastLidEventDurationMSec;
+    doc["lastLidEventDropF"] = s.lastLidEventDropF;
+    doc["isFireAlarm"] = s.isFireAlarm;
+    doc["fireAlarm"] = s.fireAlarm;
+    doc["fireAlarmStartMSec"] = s.fireAlarmStartMSec;
+    doc["isFoodStalled"] = s.isFoodStalled;
+    doc["isCookDone"] = s.isCookDone;
+    doc["foodRateFPerHour"] = s.foodRateFPerHour;
+    doc["cookEtaSec"] = s.cookEtaSec;
+    doc["cookEtaLowSec"] = s.cookEtaLowSec;
+    doc["cookEtaHighSec"] = s.cookEtaHighSec;
+    doc["schedulerOverrunCount"] = s.schedulerOverrunCount;
+    doc["schedulerMaxPassTimeUSec"] = s.schedulerMaxPassTimeUSec;
+    doc["isFailSafe"] = s.isFailSafe;
+    doc["failSafeTripCount"] = s.failSafeTripCount;
+    doc["failSafeTask"] = s.failSafeTask;
+    doc["failSafeStartMSec"] = s.failSafeStartMSec;
+    doc["failSafeStallMSec"] = s.failSafeStallMSec;
+    doc["isRunResumed"] = s.isRunResumed;
+    doc["resumedAgeSec"] = s.resumedAgeSec;
+    if (m_otaUpdater != nullptr)
+    {
+        OTAStatus ota;
+        m_otaUpdater->getStatus(ota);
+        doc["otaPhase"] = OTAUpdater::phaseToString(ota.phase);
+        doc["otaProgress"] = ota.percent;
+        doc["otaLastError"] = ota.lastError;
+    }
+    JsonObject heap = doc.createNestedObject("heap");
+    addHeapSnapshot(heap);
 
-    String json;
-    serializeJson(doc, json);
-    request->send(200, "application/json", json);
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    serializeJson(doc, *response);
+    request->send(response);
 }
 
 void WebServer::handleApiConfigGet(AsyncWebServerRequest *request)
 {
+    m_channel.readConfiguration(m_config);
     const Configuration &c = m_config;
-    StaticJsonDocument<STATIC_JSON_DOCUMENT_SIZE> doc;
+    DynamicJsonDocument doc(CONFIG_JSON_DOCUMENT_SIZE);
 
     doc["temperatureTarget"] = c.temperatureTarget;
     doc["temperatureIntervalMSec"] = c.temperatureIntervalMSec;
@@ -177,18 +279,59 @@ void WebServer::handleApiConfigGet(AsyncWebServerRequest *request)
         step["temperatureEndF"] = c.temperatureProfile[i].temperatureEndF;
         step["timeMSec"] = c.temperatureProfile[i].timeMSec;
         step["type"] = static_cast<int>(c.temperatureProfile[i].type); // Convert enum to int
+        step["advanceConditions"] = c.temperatureProfile[i].advanceConditions;
+        step["isAdvanceOnAll"] = c.temperatureProfile[i].isAdvanceOnAll;
+        step["advanceFoodF"] = c.temperatureProfile[i].advanceFoodF;
+        step["advancePitHoldMSec"] = c.temperatureProfile[i].advancePitHoldMSec;
     }
+    doc["profilePitBandF"] = c.profilePitBandF;
 
-    doc["isPIDEnabled"] = c.isPIDEnabled;
-    doc["kP"] = c.kP;
-    doc["kI"] = c.kI;
-    doc["kD"] = c.kD;
-    doc["bangBangLowThreshold"] = c.bangBangLowThreshold;
-    doc["bangBangHighThreshold"] = c.bangBangHighThreshold;
-    doc["bangBangHysteresis"] = c.bangBangHysteresis;
-    doc["bangBangFanSpeed"] = c.bangBangFanSpeed;
+    doc["controlAlgorithm"] = static_cast<int>(c.controlAlgorithm);
+    doc["isPIDEnabled"] = c.controlAlgorithm == CONTROL_PID; // Kept for older clients
+    for (int i = 0; i < CONTROL_ALGORITHM_COUNT; ++i)
+    {
+        // Every strategy declares the parameters it reads from the configuration
+        const ControlStrategy &strategy = CONTROL_STRATEGIES[i];
+        for (int j = 0; j < strategy.parameterCount; ++j)
+        {
+            const ControlParameter &parameter = strategy.parameters[j];
+            if (parameter.type == CONTROL_PARAMETER_FLOAT)
+                doc[parameter.key] = getControlParameter(c, parameter);
+            else
+                doc[parameter.key] = static_cast<int>(getControlParameter(c, parameter));
+        }
+    }
+    doc["blowerPWMFrequencyHz"] = c.blowerPWMFrequencyHz;
+    doc["blowerKickStartMSec"] = c.blowerKickStartMSec;
+    doc["blowerSlewPWMPerSec"] = c.blowerSlewPWMPerSec;
+    doc["isBlowerAirflowCalibrated"] = c.isBlowerAirflowCalibrated;
+    JsonArray airflowTable = doc.createNestedArray("blowerAirflowTable");
+    for (int i = 0; i < BLOWER_CALIBRATION_POINTS; ++i)
+        airflowTable.add(c.blowerAirflowTable[i]);
     doc["doorOpenPosition"] = c.doorOpenPosition;
+    doc["doorMaxSpeedDegPerSec"] = c.doorMaxSpeedDegPerSec;
+    doc["doorAccelDegPerSec2"] = c.doorAccelDegPerSec2;
+    doc["isDoorAirflowMapEnabled"] = c.isDoorAirflowMapEnabled;
+    JsonArray doorAirflowTable = doc.createNestedArray("doorAirflowTable");
+    for (int i = 0; i < DOOR_AIRFLOW_POINTS; ++i)
+        doorAirflowTable.add(c.doorAirflowTable[i]);
     doc["doorClosePosition"] = c.doorClosePosition;
+    doc["actuatorBlowerDeadbandPWM"] = c.actuatorBlowerDeadbandPWM;
+    doc["actuatorBlowerMinDwellMSec"] = c.actuatorBlowerMinDwellMSec;
+    doc["actuatorBlowerMaxRatePWMPerSec"] = c.actuatorBlowerMaxRatePWMPerSec;
+    doc["actuatorDoorDeadbandDeg"] = c.actuatorDoorDeadbandDeg;
+    doc["actuatorDoorMinDwellMSec"] = c.actuatorDoorMinDwellMSec;
+    doc["actuatorDoorMaxRateDegPerSec"] = c.actuatorDoorMaxRateDegPerSec;
+    doc["isLidDetectionEnabled"] = c.isLidDetectionEnabled;
+    doc["lidOpenRateFPerMin"] = c.lidOpenRateFPerMin;
+    doc["lidCloseRateFPerMin"] = c.lidCloseRateFPerMin;
+    doc["lidMaxOpenMSec"] = c.lidMaxOpenMSec;
+    doc["lidRecoveryMSec"] = c.lidRecoveryMSec;
+    doc["foodFinishTemperatureF"] = c.foodFinishTemperatureF;
+    doc["isFireDetectionEnabled"] = c.isFireDetectionEnabled;
+    doc["fireDetectMSec"] = c.fireDetectMSec;
+    doc["deadlineMissedPeriods"] = c.deadlineMissedPeriods;
+    doc["failSafeDoorPosition"] = c.failSafeDoorPosition;
     doc["themometerSmokerGain"] = c.themometerSmokerGain;
     doc["themometerSmokerOffset"] = c.themometerSmokerOffset;
     doc["themometerFoodGain"] = c.themometerFoodGain;
@@ -199,19 +342,22 @@ void WebServer::handleApiConfigGet(AsyncWebServerRequest *request)
     doc["isForcedDoorPosition"] = c.isForcedDoorPosition;
     doc["forcedDoorPosition"] = c.forcedDoorPosition;
     doc["isWiFiEnabled"] = c.isWiFiEnabled;
-    doc["wifiSSID"] = String(c.wifiSSID);
+    doc["otaPolicy"] = static_cast<int>(c.otaPolicy);
+    doc["resumeWindowMin"] = c.resumeWindowMin;
+    doc["isResumeAfterPowerLossEnabled"] = c.isResumeAfterPowerLossEnabled;
+    doc["wifiSSID"] = c.wifiSSID;
 
     // Do not include wifiPassword for security, or include if needed:
     // doc["wifiPassword"] = String(c.wifiPassword);
 
-    String json;
-    serializeJson(doc, json);
-    request->send(200, "application/json", json);
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    serializeJson(doc, *response);
+    request->send(response);
 }
 
 void WebServer::handleApiConfigSet(AsyncWebServerRequest *request, uint8_t *data, size_t len)
 {
-    StaticJsonDocument<STATIC_JSON_DOCUMENT_SIZE> doc;
+    DynamicJsonDocument doc(CONFIG_JSON_DOCUMENT_SIZE);
     DeserializationError error = deserializeJson(doc, data, len);
 
     if (error)
@@ -220,6 +366,10 @@ void WebServer::handleApiConfigSet(AsyncWebServerRequest *request, uint8_t *data
         return;
     }
 
+    // Edit a copy of the published configuration, only the fields changed from it are posted
+    m_channel.readConfiguration(m_configBase);
+    m_config = m_configBase;
+
     // Update all Configuration fields if present in JSON
     if (doc.containsKey("temperatureTarget"))
         m_config.temperatureTarget = doc["temperatureTarget"];
@@ -245,32 +395,108 @@ void WebServer::handleApiConfigSet(AsyncWebServerRequest *request, uint8_t *data
                 m_config.temperatureProfile[i].temperatureStartF = step["temperatureStartF"];
             if (step.containsKey("temperatureEndF"))
                 m_config.temperatureProfile[i].temperatureEndF = step["temperatureEndF"];
+            if (step.containsKey("advanceConditions"))
+                m_config.temperatureProfile[i].advanceConditions = step["advanceConditions"].as<int>() & TEMP_PROFILE_ADVANCE_ALL;
+            if (step.containsKey("isAdvanceOnAll"))
+                m_config.temperatureProfile[i].isAdvanceOnAll = step["isAdvanceOnAll"];
+            if (step.containsKey("advanceFoodF"))
+                m_config.temperatureProfile[i].advanceFoodF = step["advanceFoodF"];
+            if (step.containsKey("advancePitHoldMSec"))
+                m_config.temperatureProfile[i].advancePitHoldMSec = step["advancePitHoldMSec"];
         }
     }
+    if (doc.containsKey("profilePitBandF"))
+        m_config.profilePitBandF = constrain(doc["profilePitBandF"].as<int>(), 1, PROFILE_PIT_BAND_MAX_F);
 
     if (doc.containsKey("isPIDEnabled"))
-        m_config.isPIDEnabled = doc["isPIDEnabled"];
-    if (doc.containsKey("kP"))
-        m_config.kP = doc["kP"];
-    if (doc.containsKey("kI"))
-        m_config.kI = doc["kI"];
-    if (doc.containsKey("kD"))
-        m_config.kD = doc["kD"];
-
-    if (doc.containsKey("bangBangLowThreshold"))
-        m_config.bangBangLowThreshold = doc["bangBangLowThreshold"];
-    if (doc.containsKey("bangBangHighThreshold"))
-        m_config.bangBangHighThreshold = doc["bangBangHighThreshold"];
-    if (doc.containsKey("bangBangHysteresis"))
-        m_config.bangBangHysteresis = doc["bangBangHysteresis"];
-    if (doc.containsKey("bangBangFanSpeed"))
-        m_config.bangBangFanSpeed = doc["bangBangFanSpeed"];
+        m_config.controlAlgorithm = doc["isPIDEnabled"].as<bool>() ? CONTROL_PID : CONTROL_BANGBANG;
+    if (doc.containsKey("controlAlgorithm"))
+    {
+        int algorithm = doc["controlAlgorithm"];
+        if (algorithm >= 0 && algorithm < CONTROL_ALGORITHM_COUNT)
+            m_config.controlAlgorithm = static_cast<ControlAlgorithm>(algorithm);
+    }
+    for (int i = 0; i < CONTROL_ALGORITHM_COUNT; ++i)
+    {
+        const ControlStrategy &strategy = CONTROL_STRATEGIES[i];
+        for (int j = 0; j < strategy.parameterCount; ++j)
+        {
+            const ControlParameter &parameter = strategy.parameters[j];
+            if (doc.containsKey(parameter.key))
+                setControlParameter(m_config, parameter, doc[parameter.key].as<float>());
+        }
+    }
 
+    if (doc.containsKey("blowerPWMFrequencyHz"))
+        m_config.blowerPWMFrequencyHz = constrain(doc["blowerPWMFrequencyHz"].as<int>(), BLOWER_PWM_FREQUENCY_MIN_HZ, BLOWER_PWM_FREQUENCY_MAX_HZ);
+    if (doc.containsKey("blowerKickStartMSec"))
+        m_config.blowerKickStartMSec = constrain(doc["blowerKickStartMSec"].as<int>(), 0, BLOWER_KICK_START_MAX_MSEC);
+    if (doc.containsKey("blowerSlewPWMPerSec"))
+        m_config.blowerSlewPWMPerSec = max(doc["blowerSlewPWMPerSec"].as<int>(), 0);
+    if (doc.containsKey("isBlowerAirflowCalibrated"))
+        m_config.isBlowerAirflowCalibrated = doc["isBlowerAirflowCalibrated"];
+    if (doc.containsKey("doorMaxSpeedDegPerSec"))
+        m_config.doorMaxSpeedDegPerSec = constrain(doc["doorMaxSpeedDegPerSec"].as<int>(), 1, 1000);
+    if (doc.containsKey("doorAccelDegPerSec2"))
+        m_config.doorAccelDegPerSec2 = constrain(doc["doorAccelDegPerSec2"].as<int>(), 1, 10000);
+    if (doc.containsKey("isDoorAirflowMapEnabled"))
+        m_config.isDoorAirflowMapEnabled = doc["isDoorAirflowMapEnabled"];
+    if (doc.containsKey("doorAirflowTable"))
+    {
+        // Door travel must not fall with a rising airflow
+        JsonArray arr = doc["doorAirflowTable"].as<JsonArray>();
+        int i = 0;
+        int previous = 0;
+        for (JsonVariant v : arr)
+        {
+            if (i >= DOOR_AIRFLOW_POINTS)
+                break;
+            previous = constrain(v.as<int>(), previous, 255);
+            m_config.doorAirflowTable[i++] = previous;
+        }
+    }
     if (doc.containsKey("doorOpenPosition"))
         m_config.doorOpenPosition = doc["doorOpenPosition"];
     if (doc.containsKey("doorClosePosition"))
         m_config.doorClosePosition = doc["doorClosePosition"];
 
+    if (doc.containsKey("actuatorBlowerDeadbandPWM"))
+        m_config.actuatorBlowerDeadbandPWM = constrain(doc["actuatorBlowerDeadbandPWM"].as<int>(), 0, 255);
+    if (doc.containsKey("actuatorBlowerMinDwellMSec"))
+        m_config.actuatorBlowerMinDwellMSec = max(doc["actuatorBlowerMinDwellMSec"].as<int>(), 0);
+    if (doc.containsKey("actuatorBlowerMaxRatePWMPerSec"))
+        m_config.actuatorBlowerMaxRatePWMPerSec = max(doc["actuatorBlowerMaxRatePWMPerSec"].as<int>(), 0);
+    if (doc.containsKey("actuatorDoorDeadbandDeg"))
+        m_config.actuatorDoorDeadbandDeg = constrain(doc["actuatorDoorDeadbandDeg"].as<int>(), 0, 180);
+    if (doc.containsKey("actuatorDoorMinDwellMSec"))
+        m_config.actuatorDoorMinDwellMSec = max(doc["actuatorDoorMinDwellMSec"].as<int>(), 0);
+    if (doc.containsKey("actuatorDoorMaxRateDegPerSec"))
+        m_config.actuatorDoorMaxRateDegPerSec = max(doc["actuatorDoorMaxRateDegPerSec"].as<int>(), 0);
+
+    if (doc.containsKey("isLidDetectionEnabled"))
+        m_config.isLidDetectionEnabled = doc["isLidDetectionEnabled"];
+    if (doc.containsKey("lidOpenRateFPerMin"))
+        m_config.lidOpenRateFPerMin = max(doc["lidOpenRateFPerMin"].as<int>(), 1);
+    if (doc.containsKey("lidCloseRateFPerMin"))
+        m_config.lidCloseRateFPerMin = max(doc["lidCloseRateFPerMin"].as<int>(), 1);
+    if (doc.containsKey("lidMaxOpenMSec"))
+        m_config.lidMaxOpenMSec = max(doc["lidMaxOpenMSec"].as<int>(), 0);
+    if (doc.containsKey("lidRecoveryMSec"))
+        m_config.lidRecoveryMSec = max(doc["lidRecoveryMSec"].as<int>(), 0);
+
+    if (doc.containsKey("foodFinishTemperatureF"))
+        m_config.foodFinishTemperatureF = constrain(doc["foodFinishTemperatureF"].as<int>(), 100, 250);
+
+    if (doc.containsKey("isFireDetectionEnabled"))
+        m_config.isFireDetectionEnabled = doc["isFireDetectionEnabled"];
+    if (doc.containsKey("fireDetectMSec"))
+        m_config.fireDetectMSec = max(doc["fireDetectMSec"].as<int>(), 60000);
+
+    if (doc.containsKey("deadlineMissedPeriods"))
+        m_config.deadlineMissedPeriods = constrain(doc["deadlineMissedPeriods"].as<int>(), DEADLINE_MISSED_PERIODS_MIN, DEADLINE_MISSED_PERIODS_MAX);
+    if (doc.containsKey("failSafeDoorPosition"))
+        m_config.failSafeDoorPosition = constrain(doc["failSafeDoorPosition"].as<int>(), 0, 180);
+
     if (doc.containsKey("themometerSmokerGain"))
         m_config.themometerSmokerGain = doc["themometerSmokerGain"];
     if (doc.containsKey("themometerSmokerOffset"))
@@ -295,6 +521,12 @@ void WebServer::handleApiConfigSet(AsyncWebServerRequest *request, uint8_t *data
 
     if (doc.containsKey("isWiFiEnabled"))
         m_config.isWiFiEnabled = doc["isWiFiEnabled"];
+    if (doc.containsKey("otaPolicy"))
+        m_config.otaPolicy = static_cast<OTAPolicy>(constrain(doc["otaPolicy"].as<int>(), 0, OTA_POLICY_COUNT - 1));
+    if (doc.containsKey("resumeWindowMin"))
+        m_config.resumeWindowMin = constrain(doc["resumeWindowMin"].as<int>(), 0, RESUME_WINDOW_MAX_MIN);
+    if (doc.containsKey("isResumeAfterPowerLossEnabled"))
+        m_config.isResumeAfterPowerLossEnabled = doc["isResumeAfterPowerLossEnabled"];
     if (doc.containsKey("wifiSSID"))
         strncpy(m_config.wifiSSID, doc["wifiSSID"], sizeof(m_config.wifiSSID));
     if (doc.containsKey("wifiPassword"))
@@ -312,20 +544,312 @@ void WebServer::handleApiConfigSet(AsyncWebServerRequest *request, uint8_t *data
         }
     }
 
+    m_channel.postConfiguration(m_configBase, m_config);
+    m_channel.postCommand(CONTROL_COMMAND_SAVE_CONFIGURATION); // Save once the control loop applied it
+
     request->send(200, "application/json", "{\"success\":true}");
+}
+
+void WebServer::handleApiProfileGet(AsyncWebServerRequest *request)
+{
+    m_channel.readProfile(m_profile);
+    DynamicJsonDocument doc(PROFILE_JSON_DOCUMENT_SIZE);
+
+    doc["maxStepsCount"] = MAX_PROFILE_TABLE_STEPS;
+    doc["stepsCount"] = m_profile.stepsCount; // 0 when the configured steps run
+    JsonArray steps = doc.createNestedArray("steps");
+    for (int i = 0; i < m_profile.stepsCount; ++i)
+    {
+        JsonObject step = steps.createNestedObject();
+        step["temperatureStartF"] = m_profile.steps[i].temperatureStartF;
+        step["temperatureEndF"] = m_profile.steps[i].temperatureEndF;
+        step["timeMSec"] = m_profile.steps[i].timeMSec;
+        step["type"] = static_cast<int>(m_profile.steps[i].type);
+        step["advanceConditions"] = m_profile.steps[i].advanceConditions;
+        step["isAdvanceOnAll"] = m_profile.steps[i].isAdvanceOnAll;
+        step["advanceFoodF"] = m_profile.steps[i].advanceFoodF;
+        step["advancePitHoldMSec"] = m_profile.steps[i].advancePitHoldMSec;
+    }
+
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    serializeJson(doc, *response);
+    request->send(response);
+}
+
+void WebServer::handleApiProfileSet(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    // A long table spans several body chunks, it is parsed once the last one arrived
+    if (total > sizeof(m_profileBody))
+    {
+        if (index == 0)
+            request->send(413, "application/json", "{\"error\":\"Profile too large\"}");
+        return;
+    }
+    memcpy(m_profileBody + index, data, len);
+    if (index + len < total)
+        return;
+
+    DynamicJsonDocument doc(PROFILE_JSON_DOCUMENT_SIZE);
+    DeserializationError error = deserializeJson(doc, m_profileBody, total);
+    if (error || !doc["steps"].is<JsonArray>())
+    {
+        request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+        return;
+    }
+
+    // An empty table hands the profile back to the configured steps
+    JsonArray arr = doc["steps"].as<JsonArray>();
+    if (arr.size() > MAX_PROFILE_TABLE_STEPS)
+    {
+        request->send(400, "application/json", "{\"error\":\"Too many steps\"}");
+        return;
+    }
+    m_profile.stepsCount = arr.size();
+    for (int i = 0; i < m_profile.stepsCount; ++i)
+    {
+        JsonObject step = arr[i];
+        m_profile.steps[i].timeMSec = step["timeMSec"].as<ulong>();
+        m_profile.steps[i].type = step["type"].as<int>() == TEMP_PROFILE_TYPE_RAMP ? TEMP_PROFILE_TYPE_RAMP : TEMP_PROFILE_TYPE_DWELL;
+        m_profile.steps[i].temperatureStartF = step["temperatureStartF"].as<int>();
+        if (step.containsKey("temperatureEndF"))
+            m_profile.steps[i].temperatureEndF = step["temperatureEndF"].as<int>();
+        else
+            m_profile.steps[i].temperatureEndF = m_profile.steps[i].temperatureStartF;
+
+        // Without advance conditions the step is a timed one
+        m_profile.steps[i].advanceConditions = TEMP_PROFILE_ADVANCE_TIME;
+        if (step.containsKey("advanceConditions"))
+            m_profile.steps[i].advanceConditions = step["advanceConditions"].as<int>() & TEMP_PROFILE_ADVANCE_ALL;
+        m_profile.steps[i].isAdvanceOnAll = step["isAdvanceOnAll"].as<bool>();
+        m_profile.steps[i].advanceFoodF = DEFAULT_PROFILE_ADVANCE_FOOD_F;
+        if (step.containsKey("advanceFoodF"))
+            m_profile.steps[i].advanceFoodF = step["advanceFoodF"].as<int>();
+        m_profile.steps[i].advancePitHoldMSec = DEFAULT_PROFILE_PIT_HOLD_MSEC;
+        if (step.containsKey("advancePitHoldMSec"))
+            m_profile.steps[i].advancePitHoldMSec = step["advancePitHoldMSec"].as<ulong>();
+    }
 
-    m_isNVRAMSaveRequired = true; // Set flag to indicate NVRAM save is required
+    // The control loop runs and stores it, a running profile keeps its start time
+    m_channel.postProfile(m_profile);
+    request->send(200, "application/json", "{\"success\":true}");
 }
 
 void WebServer::handleApiControllerStart(AsyncWebServerRequest *request)
 {
-    m_status.isRunning = true;
-    m_status.controllerStartMSec = millis();
+    m_channel.postCommand(CONTROL_COMMAND_START);
     request->send(200, "application/json", "{\"success\":true,\"message\":\"Controller started\"}");
 }
 
 void WebServer::handleApiControllerStop(AsyncWebServerRequest *request)
 {
-    m_status.isRunning = false;
+    m_channel.postCommand(CONTROL_COMMAND_STOP);
     request->send(200, "application/json", "{\"success\":true,\"message\":\"Controller stopped\"}");
-}
\ No newline at end of file
+}
+
+void WebServer::handleApiBlowerCalibrationStart(AsyncWebServerRequest *request)
+{
+    // The sweep drives the blower and the door itself, it cannot share them with the controller
+    m_channel.readStatus(m_status);
+    if (m_status.isRunning)
+    {
+        request->send(409, "application/json", "{\"error\":\"Stop the controller before calibrating the blower\"}");
+        return;
+    }
+    m_channel.postCommand(CONTROL_COMMAND_START_BLOWER_CALIBRATION);
+    request->send(200, "application/json", "{\"success\":true,\"message\":\"Blower calibration started\"}");
+}
+
+void WebServer::handleApiBlowerCalibrationStop(AsyncWebServerRequest *request)
+{
+    m_channel.postCommand(CONTROL_COMMAND_STOP_BLOWER_CALIBRATION);
+    request->send(200, "application/json", "{\"success\":true,\"message\":\"Blower calibration stopped\"}");
+}
+
+void WebServer::handleApiSchedulerGet(AsyncWebServerRequest *request)
+{
+    if (m_controlScheduler == nullptr || m_uiScheduler == nullptr)
+    {
+        request->send(503, "application/json", "{\"error\":\"Scheduler not available\"}");
+        return;
+    }
+
+    // The statistics belong to the loops on both cores, a task may update them during the report
+    DynamicJsonDocument doc(SCHEDULER_JSON_DOCUMENT_SIZE);
+    doc["passBudgetUSec"] = SCHEDULER_PASS_BUDGET_USEC;
+    JsonObject control = doc.createNestedObject("control");
+    addSchedulerStats(control, *m_controlScheduler);
+    JsonObject ui = doc.createNestedObject("ui");
+    addSchedulerStats(ui, *m_uiScheduler);
+
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    serializeJson(doc, *response);
+    request->send(response);
+}
+
+void WebServer::addSchedulerStats(JsonObject &object, const Scheduler &scheduler)
+{
+    object["overrunCount"] = scheduler.getOverrunCount();
+    object["maxPassTimeUSec"] = scheduler.getMaxPassTimeUSec();
+
+    // Histogram bucket i counts the samples of [2^i, 2^(i+1)) microseconds
+    JsonArray tasks = object.createNestedArray("tasks");
+    for (uint i = 0; i < scheduler.getTaskCount(); ++i)
+    {
+        const SchedulerTask *task = scheduler.getTask(i);
+        JsonObject t = tasks.createNestedObject();
+        t["name"] = task->name;
+        t["priority"] = static_cast<int>(task->priority);
+        t["periodUSec"] = task->periodUSec;
+        t["budgetUSec"] = task->budgetUSec;
+        t["runCount"] = task->stats.runCount;
+        t["overrunCount"] = task->stats.overrunCount;
+        t["deferCount"] = task->stats.deferCount;
+        t["skipCount"] = task->stats.skipCount;
+        t["maxRunTimeUSec"] = task->stats.maxRunTimeUSec;
+        t["maxLatenessUSec"] = task->stats.maxLatenessUSec;
+        JsonArray runTime = t.createNestedArray("runTimeHistogram");
+        JsonArray lateness = t.createNestedArray("latenessHistogram");
+        for (int b = 0; b < SCHEDULER_HISTOGRAM_BUCKETS; ++b)
+        {
+            runTime.add(task->stats.runTimeHistogram[b]);
+            lateness.add(task->stats.latenessHistogram[b]);
+        }
+    }
+}
+
+void WebServer::handleApiSchedulerReset(AsyncWebServerRequest *request)
+{
+    if (m_controlScheduler != nullptr)
+    {
+        m_controlScheduler->resetStats();
+    }
+    if (m_uiScheduler != nullptr)
+    {
+        m_uiScheduler->resetStats();
+    }
+    request->send(200, "application/json", "{\"success\":true,\"message\":\"Scheduler statistics reset\"}");
+}
+
+void WebServer::handleApiEventsGet(AsyncWebServerRequest *request)
+{
+    if (m_controlEventBus == nullptr || m_uiEventBus == nullptr)
+    {
+        request->send(503, "application/json", "{\"error\":\"Event bus not available\"}");
+        return;
+    }
+
+    DynamicJsonDocument doc(EVENTS_JSON_DOCUMENT_SIZE);
+    JsonObject control = doc.createNestedObject("control");
+    addEventTrace(control, *m_controlEventBus);
+    JsonObject ui = doc.createNestedObject("ui");
+    addEventTrace(ui, *m_uiEventBus);
+
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    serializeJson(doc, *response);
+    request->send(response);
+}
+
+void WebServer::addEventTrace(JsonObject &object, const EventBus &eventBus)
+{
+    object["publishedCount"] = eventBus.getPublishedCount();
+    object["droppedCount"] = eventBus.getDroppedCount();
+
+    // Last dispatched events, oldest first
+    Event events[EVENT_BUS_TRACE_LENGTH];
+    uint count = eventBus.getTrace(events, EVENT_BUS_TRACE_LENGTH);
+    JsonArray trace = object.createNestedArray("trace");
+    for (uint i = 0; i < count; ++i)
+    {
+        JsonObject e = trace.createNestedObject();
+        e["sequence"] = events[i].sequence;
+        e["timeMSec"] = events[i].timeMSec;
+        e["type"] = EventBus::typeToString(events[i].type);
+        e["source"] = static_cast<int>(events[i].source);
+        e["value"] = events[i].value;
+    }
+}
+
+void WebServer::addHeapSnapshot(JsonObject &object)
+{
+    // Sampled once a second by the heap task
+    HeapSnapshot snapshot;
+    HeapMonitor::getSnapshot(snapshot);
+    object["timeMSec"] = snapshot.timeMSec;
+    object["freeBytes"] = snapshot.freeBytes;
+    object["minFreeBytes"] = snapshot.minFreeBytes;
+    object["largestFreeBlock"] = snapshot.largestFreeBlock;
+    object["fragmentationPercent"] = snapshot.fragmentationPercent;
+    object["liveBlocks"] = snapshot.liveBlocks;
+    object["liveBytes"] = snapshot.liveBytes;
+    object["allocCount"] = snapshot.allocCount;
+    object["freeCount"] = snapshot.freeCount;
+    object["untrackedCount"] = snapshot.untrackedCount;
+    object["loopAllocCount"] = snapshot.loopAllocCount;
+    object["minStackTask"] = snapshot.minStackTask != nullptr ? snapshot.minStackTask : "";
+    object["minStackFreeBytes"] = snapshot.minStackFreeBytes;
+}
+
+void WebServer::handleDebugHeap(AsyncWebServerRequest *request)
+{
+    DynamicJsonDocument doc(HEAP_JSON_DOCUMENT_SIZE);
+    JsonObject heap = doc.createNestedObject("heap");
+    addHeapSnapshot(heap);
+
+    JsonArray tasks = doc.createNestedArray("tasks");
+    for (uint i = 0; i < HeapMonitor::getTaskCount(); ++i)
+    {
+        HeapTaskStack stack;
+        HeapMonitor::getTaskStack(i, stack);
+        JsonObject t = tasks.createNestedObject();
+        t["name"] = stack.name;
+        t["isFound"] = stack.handle != nullptr;
+        t["stackFreeBytes"] = stack.freeBytes;
+    }
+
+    // Largest live bytes first, the callers resolve with addr2line against the firmware ELF
+    JsonArray sites = doc.createNestedArray("sites");
+    uint count = HeapMonitor::getSites(m_heapSites, HEAP_TRACK_MAX_SITES);
+    for (uint i = 0; i < count; ++i)
+    {
+        const HeapSite &site = m_heapSites[i];
+        JsonObject s = sites.createNestedObject();
+        JsonArray callers = s.createNestedArray("callers");
+        for (int c = 0; c < HEAP_TRACK_CALLER_DEPTH && site.callers[c] != 0; ++c)
+        {
+            char address[11];
+            snprintf(address, sizeof(address), "0x%08lx", static_cast<unsigned long>(site.callers[c]));
+            callers.add(address);
+        }
+        s["allocCount"] = site.allocCount;
+        s["freeCount"] = site.freeCount;
+        s["liveCount"] = site.liveCount;
+        s["liveBytes"] = site.liveBytes;
+        s["peakLiveBytes"] = site.peakLiveBytes;
+    }
+
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    serializeJson(doc, *response);
+    request->send(response);
+}
+
+void WebServer::handleDebugHeapReset(AsyncWebServerRequest *request)
+{
+    HeapMonitor::resetSites();
+    request->send(200, "application/json", "{\"success\":true,\"message\":\"Heap site counters reset\"}");
+}
+
+#ifdef ENABLE_METRICS
+void WebServer::handleMetrics(AsyncWebServerRequest *request)
+{
+    // Streamed, the exposition is too large for a single String
+    AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4");
+    Metrics::writePrometheus(*response);
+    request->send(response);
+}
+
+void WebServer::handleMetricsReset(AsyncWebServerRequest *request)
+{
+    Metrics::reset();
+    request->send(200, "application/json", "{\"success\":true,\"message\":\"Metrics reset\"}");
+}
+#endif
@@ -8,8 +8,25 @@
 #include <HTTPClient.h>
 #include <functional>
 #include "types.h"
+#include "controlstrategy.h"
+#include "blower.h"
+#include "scheduler.h"
+#include "metrics.h"
+#include "controlchannel.h"
+#include "eventbus.h"
+#include "deadlinemonitor.h"
+#include "heapmonitor.h"
+#include "otaupdater.h"
+#include "runcheckpoint.h"
+#include "profileengine.h"
 
 #define STATIC_JSON_DOCUMENT_SIZE 2048
+#define CONFIG_JSON_DOCUMENT_SIZE 4096     // Configuration with MAX_PROFILE_STEPS conditional steps
+#define SCHEDULER_JSON_DOCUMENT_SIZE 12288 // Per task statistics of both loops with both histograms
+#define EVENTS_JSON_DOCUMENT_SIZE 8192     // Event traces of both buses
+#define HEAP_JSON_DOCUMENT_SIZE 12288      // Heap snapshot, task stacks and the allocation sites
+#define PROFILE_JSON_DOCUMENT_SIZE 16384   // Profile table with MAX_PROFILE_TABLE_STEPS conditional steps
+#define PROFILE_BODY_MAX_LENGTH 12288      // Longest accepted profile table upload
 
 class WebServer
 {
@@ -18,22 +35,38 @@ public:
     using ConfigGetCallback = std::function<String()>;
     using ConfigSetCallback = std::function<bool(const String &)>;
 
-    WebServer(uint16_t port, ControllerStatus &status, Configuration &config);
+    WebServer(uint16_t port, ControlChannel &channel);
 
     void begin();
     void end();
-    bool isNVRAMSaveRequired();
+    void setSchedulers(Scheduler *controlScheduler, Scheduler *uiScheduler);
+    void setEventBuses(EventBus *controlEventBus, EventBus *uiEventBus);
+    void setOTAUpdater(const OTAUpdater *otaUpdater);
 
 private:
     AsyncWebServer m_server;
+    bool m_isRouted = false; // Routes added, begin() may run again on a reconnect
     StatusCallback m_statusCallback;
     ConfigGetCallback m_configGetCallback;
     ConfigSetCallback m_configSetCallback;
 
-    ControllerStatus &m_status;
-    Configuration &m_config;
+    // The handlers run in the web server task, they work on copies read from the control channel
+    ControlChannel &m_channel;
+    ControllerStatus m_status;
+    Configuration m_config;
+    Configuration m_configBase; // Published configuration a /config post started from
 
-    bool m_isNVRAMSaveRequired = false;
+    Scheduler *m_controlScheduler = nullptr;
+    Scheduler *m_uiScheduler = nullptr;
+
+    EventBus *m_controlEventBus = nullptr;
+    EventBus *m_uiEventBus = nullptr;
+
+    const OTAUpdater *m_otaUpdater = nullptr;
+
+    HeapSite m_heapSites[HEAP_TRACK_MAX_SITES];     // Site table copy for /debug/heap, too large for the handler stack
+    TempProfileTable m_profile;                     // Profile table copy for /profile
+    uint8_t m_profileBody[PROFILE_BODY_MAX_LENGTH]; // Profile upload, arrives in several chunks
 
     void setStatusCallback(StatusCallback cb);
     void setConfigGetCallback(ConfigGetCallback cb);
@@ -46,6 +79,22 @@ private:
     void handleApiConfigSet(AsyncWebServerRequest *request, uint8_t *data, size_t len);
     void handleApiControllerStart(AsyncWebServerRequest *request);
     void handleApiControllerStop(AsyncWebServerRequest *request);
+    void handleApiBlowerCalibrationStart(AsyncWebServerRequest *request);
+    void handleApiBlowerCalibrationStop(AsyncWebServerRequest *request);
+    void handleApiSchedulerGet(AsyncWebServerRequest *request);
+    void handleApiSchedulerReset(AsyncWebServerRequest *request);
+    void addSchedulerStats(JsonObject &object, const Scheduler &scheduler);
+    void handleApiEventsGet(AsyncWebServerRequest *request);
+    void addEventTrace(JsonObject &object, const EventBus &eventBus);
+    void addHeapSnapshot(JsonObject &object);
+    void handleDebugHeap(AsyncWebServerRequest *request);
+    void handleDebugHeapReset(AsyncWebServerRequest *request);
+    void handleApiProfileGet(AsyncWebServerRequest *request);
+    void handleApiProfileSet(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+#ifdef ENABLE_METRICS
+    void handleMetrics(AsyncWebServerRequest *request);
+    void handleMetricsReset(AsyncWebServerRequest *request);
+#endif
 };
 
 #endif // WEBSERVER_SMOKEMATE_H
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "wifimanager.h"
+
+EventBus *WiFiManager::s_eventBus = nullptr;
+
+WiFiManager::WiFiManager()
+{
+    m_state = WIFI_STATE_DISABLED;
+    m_ssid[0] = '\0';
+    m_password[0] = '\0';
+    m_stateStartMSec = 0;
+    m_retryDelayMSec = 0;
+    m_nextRetryDelayMSec = WIFI_BACKOFF_MIN_MSEC;
+    m_attemptCount = 0;
+    m_disconnectCount = 0;
+}
+
+void WiFiManager::begin()
+{
+    // The manager schedules the retries, the driver must not reconnect behind its back
+    WiFi.setAutoReconnect(false);
+    WiFi.onEvent(onSystemEvent, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    WiFi.onEvent(onSystemEvent, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+}
+
+void WiFiManager::setEventBus(EventBus *eventBus)
+{
+    s_eventBus = eventBus;
+}
+
+void WiFiManager::configure(bool isEnabled, const char *ssid, const char *password, ulong currentTimeMSec)
+{
+    if (!isEnabled || ssid[0] == '\0')
+    {
+        if (m_state != WIFI_STATE_DISABLED)
+        {
+#ifdef DEBUG_WIFIMANAGER
+            DEBUG_PRINTLN("WIFIMANAGER::configure - disabled");
+#endif
+            m_state = WIFI_STATE_DISABLED;
+            WiFi.disconnect(true); // Radio off
+        }
+        return;
+    }
+
+    bool isChanged = strcmp(m_ssid, ssid) != 0 || strcmp(m_password, password) != 0;
+    if (m_state != WIFI_STATE_DISABLED && !isChanged)
+        return;
+
+    // Enabled or new credentials, start over without backoff
+    strlcpy(m_ssid, ssid, sizeof(m_ssid));
+    strlcpy(m_password, password, sizeof(m_password));
+    m_nextRetryDelayMSec = WIFI_BACKOFF_MIN_MSEC;
+    if (m_state == WIFI_STATE_DISABLED)
+    {
+        WiFi.mode(WIFI_STA);
+        startAttempt(currentTimeMSec);
+        return;
+    }
+
+    // Drop the old connection first. Its disconnect event arrives through the bus after this pass
+    // and must find the manager still in backoff, an attempt already started would be aborted by it
+    WiFi.disconnect();
+    m_state = WIFI_STATE_BACKOFF;
+    m_stateStartMSec = currentTimeMSec;
+    m_retryDelayMSec = WIFI_RECONNECT_DELAY_MSEC;
+}
+
+void WiFiManager::service(ulong currentTimeMSec)
+{
+    switch (m_state)
+    {
+    case WIFI_STATE_CONNECTING:
+        if (currentTimeMSec - m_stateStartMSec >= WIFI_CONNECT_TIMEOUT_MSEC)
+        {
+            WiFi.disconnect(); // Its disconnect event finds the manager in backoff already
+            startBackoff(currentTimeMSec);
+        }
+        break;
+
+    case WIFI_STATE_BACKOFF:
+        if (currentTimeMSec - m_stateStartMSec >= m_retryDelayMSec)
+            startAttempt(currentTimeMSec);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void WiFiManager::handleEvent(const Event &event, ulong currentTimeMSec)
+{
+    switch (event.type)
+    {
+    case EVENT_WIFI_CONNECTED:
+        if (m_state == WIFI_STATE_CONNECTING)
+        {
+            m_state = WIFI_STATE_CONNECTED;
+            m_nextRetryDelayMSec = WIFI_BACKOFF_MIN_MSEC;
+        }
+        break;
+
+    case EVENT_WIFI_DISCONNECTED:
+        // Repeated while an attempt fails, only the first one of an attempt or connection counts
+        if (m_state == WIFI_STATE_CONNECTED)
+            m_disconnectCount++;
+        if (m_state == WIFI_STATE_CONNECTED || m_state == WIFI_STATE_CONNECTING)
+            startBackoff(currentTimeMSec);
+        break;
+
+    default:
+        break;
+    }
+}
+
+WiFiState WiFiManager::getState() const
+{
+    return m_state;
+}
+
+bool WiFiManager::isConnected() const
+{
+    return m_state == WIFI_STATE_CONNECTED;
+}
+
+uint32_t WiFiManager::getAttemptCount() const
+{
+    return m_attemptCount;
+}
+
+uint32_t WiFiManager::getDisconnectCount() const
+{
+    return m_disconnectCount;
+}
+
+ulong WiFiManager::getRetryDelayMSec() const
+{
+    return m_retryDelayMSec;
+}
+
+const char *WiFiManager::stateToString(WiFiState state)
+{
+    switch (state)
+    {
+    case WIFI_STATE_CONNECTING:
+        return "CONNECTING";
+    case WIFI_STATE_CONNECTED:
+        return "CONNECTED";
+    case WIFI_STATE_BACKOFF:
+        return "BACKOFF";
+    default:
+        return "DISABLED";
+    }
+}
+
+void WiFiManager::onSystemEvent(arduino_event_id_t event, arduino_event_info_t info)
+{
+    // WiFi event task, the bus carries the event over to the loop that owns the manager
+    if (s_eventBus == nullptr)
+        return;
+
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP)
+        s_eventBus->publish(EVENT_WIFI_CONNECTED, EVENT_SOURCE_WIFI);
+    else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED)
+        s_eventBus->publish(EVENT_WIFI_DISCONNECTED, EVENT_SOURCE_WIFI, info.wifi_sta_disconnected.reason);
+}
+
+void WiFiManager::startAttempt(ulong currentTimeMSec)
+{
+#ifdef DEBUG_WIFIMANAGER
+    DEBUG_PRINTLN("WIFIMANAGER::startAttempt - connecting to " + String(m_ssid));
+#endif
+    m_state = WIFI_STATE_CONNECTING;
+    m_stateStartMSec = currentTimeMSec;
+    m_attemptCount++;
+    WiFi.begin(m_ssid, m_password); // Returns at once, the result arrives as an event
+}
+
+void WiFiManager::startBackoff(ulong currentTimeMSec)
+{
+    m_state = WIFI_STATE_BACKOFF;
+    m_stateStartMSec = currentTimeMSec;
+    m_retryDelayMSec = m_nextRetryDelayMSec;
+    m_nextRetryDelayMSec = min(m_nextRetryDelayMSec * 2, static_cast<ulong>(WIFI_BACKOFF_MAX_MSEC));
+#ifdef DEBUG_WIFIMANAGER
+    DEBUG_PRINTLN("WIFIMANAGER::startBackoff - retry in " + String(m_retryDelayMSec) + " ms");
+#endif
+}
@@ -0,0 +1,84 @@
+#ifndef WIFIMANAGER_H
+#define WIFIMANAGER_H
+
+/**
+ * @file wifimanager.h
+ * @brief Non-blocking WiFi station connection and reconnection state machine.
+ *
+ * WiFi.begin() only starts a connection, the outcome arrives as ESP32 WiFi system events in the
+ * WiFi event task. The manager forwards the got-IP and disconnect events to an event bus as
+ * EVENT_WIFI_CONNECTED and EVENT_WIFI_DISCONNECTED, the loop dispatching the bus feeds them back
+ * through handleEvent(). Nothing here waits on the network:
+ *
+ *   DISABLED ---configure(enabled)---> CONNECTING ---got IP---> CONNECTED
+ *                                        |   ^                     |
+ *                     timeout/disconnect |   | backoff elapsed     | disconnect
+ *                                        v   |                     |
+ *                                       BACKOFF <------------------+
+ *
+ * The backoff starts at WIFI_BACKOFF_MIN_MSEC and doubles on every failed attempt up to
+ * WIFI_BACKOFF_MAX_MSEC, a connection resets it. The driver's own auto reconnect is turned off,
+ * the manager owns every retry. configure() is called with the current settings on every pass,
+ * a change of the credentials drops the connection and reconnects after WIFI_RECONNECT_DELAY_MSEC,
+ * so the disconnect event of the dropped connection is ignored in backoff. Disabling WiFi turns
+ * the radio off.
+ */
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "eventbus.h"
+#include "debug.h"
+
+// #define DEBUG_WIFIMANAGER
+
+#define WIFI_CONNECT_TIMEOUT_MSEC 15000 // Attempt given up without an IP address
+#define WIFI_BACKOFF_MIN_MSEC 1000      // First retry delay
+#define WIFI_BACKOFF_MAX_MSEC 120000    // Longest retry delay
+#define WIFI_RECONNECT_DELAY_MSEC 500   // Delay after dropping a connection for new credentials
+#define WIFI_CREDENTIAL_LENGTH 65       // Longest password and the terminator, as in Configuration
+
+enum WiFiState : uint8_t
+{
+    WIFI_STATE_DISABLED,   // Radio off, WiFi disabled or no credentials
+    WIFI_STATE_CONNECTING, // WiFi.begin() issued, waiting for an IP address
+    WIFI_STATE_CONNECTED,  // Connected with an IP address
+    WIFI_STATE_BACKOFF     // Waiting before the next attempt
+};
+
+class WiFiManager
+{
+public:
+    WiFiManager();
+
+    void begin();
+    void setEventBus(EventBus *eventBus);
+    void configure(bool isEnabled, const char *ssid, const char *password, ulong currentTimeMSec);
+    void service(ulong currentTimeMSec);
+    void handleEvent(const Event &event, ulong currentTimeMSec);
+
+    WiFiState getState() const;
+    bool isConnected() const;
+    uint32_t getAttemptCount() const;
+    uint32_t getDisconnectCount() const;
+    ulong getRetryDelayMSec() const;
+
+    static const char *stateToString(WiFiState state);
+
+private:
+    WiFiState m_state;                       // Connection state
+    char m_ssid[WIFI_CREDENTIAL_LENGTH];     // Credentials of the current connection
+    char m_password[WIFI_CREDENTIAL_LENGTH]; // Credentials of the current connection
+    ulong m_stateStartMSec;                  // Start of the current attempt or backoff
+    ulong m_retryDelayMSec;                  // Delay of the current backoff
+    ulong m_nextRetryDelayMSec;              // Delay of the next backoff
+    uint32_t m_attemptCount;                 // Connection attempts since boot
+    uint32_t m_disconnectCount;              // Connections lost since boot
+
+    static EventBus *s_eventBus;             // Receives the WiFi events, written before they are registered
+    static void onSystemEvent(arduino_event_id_t event, arduino_event_info_t info);
+
+    void startAttempt(ulong currentTimeMSec);
+    void startBackoff(ulong currentTimeMSec);
+};
+
+#endif // WIFIMANAGER_H
@@ -0,0 +1,82 @@
+/**
+ * @file test_main.cpp
+ * @brief On-device check that the control loop does not allocate in steady state.
+ *
+ * The firmware is started as on a normal boot and left to settle, then the controller is started
+ * so the strategy, the lid detector, the fire monitor, the plant identifier, the profile engine
+ * and the cook predictor all run. After a warm-up the control loop is driven for
+ * TEST_MEASURE_SAMPLE_PERIODS temperature intervals, covering several samples and checkpoints.
+ * The heap monitor counts every allocation made on the control loop task, the count must not
+ * move over that window. The blower and the door move during the test. Run on the board with:
+ *
+ *   pio test -e esp32doit-devkit-v1 -f test_loop_allocations
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "types.h"
+#include "controlchannel.h"
+#include "heapmonitor.h"
+
+#define TEST_SETTLE_MSEC 30000        // Boot allocations are done by then, the same settle time as the heap task
+#define TEST_WARMUP_SAMPLE_PERIODS 2  // Temperature intervals run after the start before measuring
+#define TEST_MEASURE_SAMPLE_PERIODS 4 // Temperature intervals measured, each holds several checkpoints
+
+// setup() and loop() of the firmware, renamed under PIO_UNIT_TESTING in main.cpp
+void firmwareSetup();
+void firmwareLoop();
+
+extern Configuration g_configuration;
+extern ControlChannel g_controlChannel;
+
+static void runFirmwareFor(ulong durationMSec)
+{
+    ulong startMSec = millis();
+    while (millis() - startMSec < durationMSec)
+        firmwareLoop();
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_loop_does_not_allocate_in_steady_state()
+{
+#ifndef ENABLE_HEAP_TRACKING
+    TEST_IGNORE_MESSAGE("Allocation counting needs ENABLE_HEAP_TRACKING");
+#else
+    runFirmwareFor(TEST_SETTLE_MSEC);
+
+    // A running controller, the first samples after the start are not measured
+    g_controlChannel.postCommand(CONTROL_COMMAND_START);
+    runFirmwareFor(TEST_WARMUP_SAMPLE_PERIODS * g_configuration.temperatureIntervalMSec);
+
+    uint32_t allocCount = HeapMonitor::getLoopAllocCount();
+    runFirmwareFor(TEST_MEASURE_SAMPLE_PERIODS * g_configuration.temperatureIntervalMSec);
+    uint32_t steadyAllocCount = HeapMonitor::getLoopAllocCount();
+
+    // Back to stopped before the assertion, the actuators are not left running on a failure
+    g_controlChannel.postCommand(CONTROL_COMMAND_STOP);
+    runFirmwareFor(g_configuration.temperatureIntervalMSec);
+
+    TEST_ASSERT_EQUAL_UINT32(allocCount, steadyAllocCount);
+#endif
+}
+
+void setup()
+{
+    delay(2000); // Time for the test runner to open the serial port
+    firmwareSetup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_loop_does_not_allocate_in_steady_state);
+    UNITY_END();
+}
+
+void loop()
+{
+}